@@ -0,0 +1,407 @@
+//
+// Alert rules, see alerts.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+
+#include "alerts.h"
+
+#define NSEC_PER_SEC 1000000000ull
+// events waiting for the notifier, more are dropped
+#define ALERT_QUEUE 64
+
+extern char **environ;
+
+struct alert_event {
+    int rule;
+    enum alert_state state;
+    double value;
+    uint64_t timestamp;
+};
+
+static struct alert_rule rules[ALERT_MAX_RULES];
+static int ruleCount = 0;
+
+static struct alert_event queue[ALERT_QUEUE];
+static unsigned int queueHead = 0, queueTail = 0;
+static unsigned long dropped = 0;
+static int stopping = 0;
+static int started = 0;
+static pthread_mutex_t queueLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queueReady = PTHREAD_COND_INITIALIZER;
+static pthread_t notifier;
+
+static int find_metric(const char *name) {
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        if (strcmp(metric_name(i), name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// seconds as a non negative number, returns -1 otherwise
+static double parse_seconds(const char *text) {
+    char *end;
+    double seconds = strtod(text, &end);
+    return end != text && *end == '\0' && seconds >= 0 ? seconds : -1;
+}
+
+int alert_rule_parse(const char *line, struct alert_rule *rule, char *error, size_t errorSize) {
+    char buf[512];
+    char *token, *save, *end;
+    size_t length;
+
+    while (isspace((unsigned char) *line)) {
+        line++;
+    }
+    if (*line == '\0' || *line == '#') {
+        return 1;
+    }
+    length = strcspn(line, "\r\n");
+    if (length >= sizeof(buf)) {
+        snprintf(error, errorSize, "rule too long");
+        return -1;
+    }
+    memcpy(buf, line, length);
+    buf[length] = '\0';
+
+    memset(rule, 0, sizeof(struct alert_rule));
+    rule->action = ALERT_STDERR;
+    // only for messages, a longer rule is shortened there
+    if (snprintf(rule->text, sizeof(rule->text), "%s", buf) >= (int) sizeof(rule->text)) {
+        memcpy(rule->text + sizeof(rule->text) - 4, "...", 4);
+    }
+
+    token = strtok_r(buf, " \t", &save);
+    if ((rule->metric = find_metric(token)) < 0) {
+        snprintf(error, errorSize, "unknown metric %s", token);
+        return -1;
+    }
+    token = strtok_r(NULL, " \t", &save);
+    if (token != NULL && strcmp(token, "rate") == 0) {
+        rule->rate = 1;
+        token = strtok_r(NULL, " \t", &save);
+    }
+    if (token == NULL || (strcmp(token, ">") != 0 && strcmp(token, "<") != 0)) {
+        snprintf(error, errorSize, "expected > or < after the metric");
+        return -1;
+    }
+    rule->above = token[0] == '>';
+
+    token = strtok_r(NULL, " \t", &save);
+    if (token == NULL) {
+        snprintf(error, errorSize, "missing threshold");
+        return -1;
+    }
+    rule->threshold = strtod(token, &end);
+    if (end == token || (rule->rate ? *end != '/' : *end != '\0')) {
+        snprintf(error, errorSize, rule->rate ? "expected change/seconds, e.g. 5/10" : "bad threshold %s", token);
+        return -1;
+    }
+    if (rule->rate) {
+        double window = parse_seconds(end + 1);
+        if (!(window > 0)) {
+            snprintf(error, errorSize, "bad rate window %s", end + 1);
+            return -1;
+        }
+        rule->windowNs = (uint64_t) (window * NSEC_PER_SEC);
+    }
+
+    while ((token = strtok_r(NULL, " \t", &save)) != NULL) {
+        if (strncmp(token, "hysteresis=", 11) == 0) {
+            rule->hysteresis = parse_seconds(token + 11);
+            if (rule->hysteresis < 0) {
+                snprintf(error, errorSize, "bad hysteresis %s", token + 11);
+                return -1;
+            }
+        } else if (strncmp(token, "for=", 4) == 0) {
+            double hold = parse_seconds(token + 4);
+            if (hold < 0) {
+                snprintf(error, errorSize, "bad duration %s", token + 4);
+                return -1;
+            }
+            rule->holdNs = (uint64_t) (hold * NSEC_PER_SEC);
+        } else if (strcmp(token, "action=stderr") == 0) {
+            rule->action = ALERT_STDERR;
+        } else if (strncmp(token, "action=log:", 11) == 0 && token[11] != '\0') {
+            rule->action = ALERT_LOG;
+            rule->target = strdup(token + 11);
+        } else if (strncmp(token, "action=exec:", 12) == 0) {
+            // the command is the rest of the line, give it back the separator strtok took
+            if (save != NULL && *save != '\0') {
+                token[strlen(token)] = ' ';
+            }
+            rule->action = ALERT_EXEC;
+            rule->target = strdup(token + 12);
+            break;
+        } else {
+            snprintf(error, errorSize, "unknown option %s", token);
+            return -1;
+        }
+    }
+    if (rule->action != ALERT_STDERR && (rule->target == NULL || rule->target[0] == '\0')) {
+        free(rule->target);
+        rule->target = NULL;
+        snprintf(error, errorSize, "action needs a path or command");
+        return -1;
+    }
+    return 0;
+}
+
+int alert_rule_input(struct alert_rule *rule, const struct snapshot *snap, uint64_t now, double *value) {
+    uint64_t step, span;
+    double current;
+    int oldest;
+
+    if (!snapshot_metric(snap, rule->metric, &current)) {
+        return 0;
+    }
+    if (!rule->rate) {
+        *value = current;
+        return 1;
+    }
+
+    // time went backwards, e.g. a replay started over
+    if (rule->stepCount > 0 && now < rule->stepTime[rule->stepHead]) {
+        rule->stepCount = 0;
+    }
+    step = rule->windowNs / ALERT_RATE_STEPS;
+    if (rule->stepCount == 0 || now >= rule->stepTime[rule->stepHead] + step) {
+        rule->stepHead = (rule->stepHead + 1) % ALERT_RATE_STEPS;
+        rule->stepTime[rule->stepHead] = now;
+        rule->stepValue[rule->stepHead] = current;
+        if (rule->stepCount < ALERT_RATE_STEPS) {
+            rule->stepCount++;
+        }
+    }
+    oldest = (rule->stepHead - rule->stepCount + 1 + ALERT_RATE_STEPS) % ALERT_RATE_STEPS;
+    span = now - rule->stepTime[oldest];
+    if (rule->stepCount < 2 || span + step < rule->windowNs) {
+        return 0;
+    }
+    // change scaled to the window, the oldest step is up to one step older than it
+    *value = (current - rule->stepValue[oldest]) * (double) rule->windowNs / (double) span;
+    return 1;
+}
+
+int alert_rule_step(struct alert_rule *rule, double value, uint64_t now) {
+    int on = rule->above ? value > rule->threshold : value < rule->threshold;
+    int off = rule->above ? value < rule->threshold - rule->hysteresis : value > rule->threshold + rule->hysteresis;
+
+    switch (rule->state) {
+        case ALERT_CLEAR:
+            if (!on) {
+                return -1;
+            }
+            rule->state = ALERT_PENDING;
+            rule->pendingSince = now;
+            // a rule without a duration fires right away
+            if (rule->holdNs == 0) {
+                rule->state = ALERT_FIRING;
+                return ALERT_FIRING;
+            }
+            return ALERT_PENDING;
+        case ALERT_PENDING:
+            if (!on) {
+                rule->state = ALERT_CLEAR;
+                return ALERT_CLEAR;
+            }
+            if (now - rule->pendingSince >= rule->holdNs) {
+                rule->state = ALERT_FIRING;
+                return ALERT_FIRING;
+            }
+            return -1;
+        case ALERT_FIRING:
+            if (off) {
+                rule->state = ALERT_CLEAR;
+                return ALERT_CLEAR;
+            }
+            return -1;
+    }
+    return -1;
+}
+
+static void free_rules(void) {
+    for (int i = 0; i < ruleCount; i++) {
+        if (rules[i].log != NULL) {
+            fclose(rules[i].log);
+        }
+        free(rules[i].target);
+    }
+    ruleCount = 0;
+}
+
+int alerts_load(const char *path) {
+    char line[512], error[128];
+    int lineNumber = 0, result;
+    FILE *file = fopen(path, "r");
+
+    if (file == NULL) {
+        return -1;
+    }
+    free_rules();
+    while (fgets(line, sizeof(line), file) != NULL) {
+        lineNumber++;
+        if (ruleCount == ALERT_MAX_RULES) {
+            fprintf(stderr, "%s:%d: more than %d rules\n", path, lineNumber, ALERT_MAX_RULES);
+            break;
+        }
+        result = alert_rule_parse(line, &rules[ruleCount], error, sizeof(error));
+        if (result < 0) {
+            fprintf(stderr, "%s:%d: %s\n", path, lineNumber, error);
+            fclose(file);
+            free_rules();
+            return -1;
+        }
+        if (result == 0) {
+            struct alert_rule *rule = &rules[ruleCount++];
+            if (rule->action == ALERT_LOG && (rule->log = fopen(rule->target, "a")) == NULL) {
+                fprintf(stderr, "%s:%d: could not open %s\n", path, lineNumber, rule->target);
+                fclose(file);
+                free_rules();
+                return -1;
+            }
+        }
+    }
+    fclose(file);
+    return ruleCount;
+}
+
+static void format_event(const struct alert_event *event, char *message, size_t size) {
+    time_t seconds = (time_t) (event->timestamp / NSEC_PER_SEC);
+    struct tm local;
+    char when[32];
+
+    localtime_r(&seconds, &local);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &local);
+    snprintf(message, size, "%s alert %s: %s (value %.2f)\n", when,
+             event->state == ALERT_FIRING ? "firing" : "resolved", rules[event->rule].text, event->value);
+}
+
+// run the hook with the event in its environment and wait for it, on the notifier thread
+static void run_hook(const struct alert_rule *rule, const struct alert_event *event) {
+    char metric[64], value[64], state[32];
+    char *argv[] = {"sh", "-c", rule->target, NULL};
+    char **envp;
+    size_t count = 0;
+    pid_t pid;
+
+    while (environ[count] != NULL) {
+        count++;
+    }
+    if ((envp = malloc((count + 4) * sizeof(char *))) == NULL) {
+        return;
+    }
+    snprintf(metric, sizeof(metric), "MACRESMON_METRIC=%s", metric_name(rule->metric));
+    snprintf(value, sizeof(value), "MACRESMON_VALUE=%.2f", event->value);
+    snprintf(state, sizeof(state), "MACRESMON_STATE=%s", event->state == ALERT_FIRING ? "firing" : "resolved");
+    envp[0] = metric;
+    envp[1] = value;
+    envp[2] = state;
+    memcpy(envp + 3, environ, (count + 1) * sizeof(char *));
+
+    if (posix_spawn(&pid, "/bin/sh", NULL, NULL, argv, envp) == 0) {
+        waitpid(pid, NULL, 0);
+    }
+    free(envp);
+}
+
+static void *notify(void *arg) {
+    char message[256];
+
+    pthread_mutex_lock(&queueLock);
+    for (;;) {
+        while (queueHead == queueTail && !stopping) {
+            pthread_cond_wait(&queueReady, &queueLock);
+        }
+        if (queueHead == queueTail) {
+            break;
+        }
+        struct alert_event event = queue[queueTail++ % ALERT_QUEUE];
+        pthread_mutex_unlock(&queueLock);
+
+        const struct alert_rule *rule = &rules[event.rule];
+        format_event(&event, message, sizeof(message));
+        switch (rule->action) {
+            case ALERT_STDERR:
+                fputs(message, stderr);
+                break;
+            case ALERT_LOG:
+                fputs(message, rule->log);
+                fflush(rule->log);
+                break;
+            case ALERT_EXEC:
+                run_hook(rule, &event);
+                break;
+        }
+        pthread_mutex_lock(&queueLock);
+    }
+    pthread_mutex_unlock(&queueLock);
+    return NULL;
+}
+
+int alerts_start(void) {
+    sigset_t all, previous;
+    int result;
+
+    stopping = 0;
+    // signals stay with the main thread
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    result = pthread_create(&notifier, NULL, notify, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    started = result == 0;
+    return started ? 0 : -1;
+}
+
+void alerts_evaluate(const struct snapshot *snap) {
+    for (int i = 0; i < ruleCount; i++) {
+        struct alert_rule *rule = &rules[i];
+        enum alert_state before = rule->state;
+        double value;
+        int state;
+
+        if (!alert_rule_input(rule, snap, snap->timestamp, &value)) {
+            continue;
+        }
+        state = alert_rule_step(rule, value, snap->timestamp);
+        // only firing and resolving are worth telling, a pending rule that recovers is not
+        if (state != ALERT_FIRING && !(state == ALERT_CLEAR && before == ALERT_FIRING)) {
+            continue;
+        }
+        pthread_mutex_lock(&queueLock);
+        if (queueHead - queueTail < ALERT_QUEUE) {
+            queue[queueHead++ % ALERT_QUEUE] = (struct alert_event) {i, (enum alert_state) state, value,
+                                                                     snap->timestamp};
+            pthread_cond_signal(&queueReady);
+        } else {
+            dropped++;
+        }
+        pthread_mutex_unlock(&queueLock);
+    }
+}
+
+void alerts_stop(void) {
+    if (started) {
+        pthread_mutex_lock(&queueLock);
+        stopping = 1;
+        pthread_cond_signal(&queueReady);
+        pthread_mutex_unlock(&queueLock);
+        pthread_join(notifier, NULL);
+        started = 0;
+    }
+    if (dropped > 0) {
+        fprintf(stderr, "%lu alerts were dropped, the notifier could not keep up\n", dropped);
+    }
+    free_rules();
+    queueHead = queueTail = 0;
+    dropped = 0;
+}
@@ -0,0 +1,91 @@
+//
+// Alert rules on snapshot metrics, loaded from a file with one rule per line:
+//
+//     # metric [rate] (>|<) threshold[/seconds] [hysteresis=N] [for=SECONDS] [action=...]
+//     cpu_temp > 80 hysteresis=5 for=10
+//     cpu_temp rate > 5/10 action=log:/tmp/macResMon.alerts
+//     mem_used_gb > 14 for=30 action=exec:say memory
+//
+// A rate rule compares how much the metric changed over the last seconds instead of its
+// value. A rule fires once the condition held for the given time and resolves only after
+// the value is back past the threshold by the hysteresis band, so a value hovering at the
+// threshold does not flap. Actions are stderr (the default), log:PATH and exec:COMMAND,
+// run through /bin/sh with MACRESMON_METRIC, MACRESMON_VALUE and MACRESMON_STATE set.
+//
+// Rules are compiled once into a flat array; evaluating a snapshot is a constant amount of
+// work per rule, and actions run on a notifier thread so a slow hook never holds up the
+// engine. Events beyond what the notifier keeps up with are dropped and counted.
+//
+
+#ifndef FINALPROJECT_ALERTS_H
+#define FINALPROJECT_ALERTS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "snapshot.h"
+
+#define ALERT_MAX_RULES 64
+// samples kept per rate rule, the window is split into this many steps
+#define ALERT_RATE_STEPS 16
+
+enum alert_state {
+    ALERT_CLEAR,
+    ALERT_PENDING,      // condition holds, waiting for the minimum duration
+    ALERT_FIRING,
+};
+
+enum alert_action {
+    ALERT_STDERR,
+    ALERT_LOG,
+    ALERT_EXEC,
+};
+
+struct alert_rule {
+    // compiled from the rule line
+    int metric;
+    int above;                  // fire above the threshold, below otherwise
+    int rate;                   // compare the change over window instead of the value
+    double threshold;
+    double hysteresis;
+    uint64_t holdNs;            // the condition must hold this long before firing
+    uint64_t windowNs;          // rate rules only
+    enum alert_action action;
+    char *target;               // log path or command
+    FILE *log;
+    char text[96];              // the rule as written, for messages
+
+    // evaluation state
+    enum alert_state state;
+    uint64_t pendingSince;
+    // earlier values of a rate rule, one per window step, oldest at stepHead - stepCount + 1
+    uint64_t stepTime[ALERT_RATE_STEPS];
+    double stepValue[ALERT_RATE_STEPS];
+    int stepHead;
+    int stepCount;
+};
+
+// compile one rule line into rule, returns 0 on success, 1 for a blank or comment line,
+// and -1 with a message in error otherwise
+int alert_rule_parse(const char *line, struct alert_rule *rule, char *error, size_t errorSize);
+
+// value the rule compares against at time now (ns), advancing its rate window. Returns 0
+// when the snapshot lacks the metric or a rate rule has not seen enough history yet
+int alert_rule_input(struct alert_rule *rule, const struct snapshot *snap, uint64_t now, double *value);
+
+// run the state machine of rule on value at time now, returns the state it entered or -1
+int alert_rule_step(struct alert_rule *rule, double value, uint64_t now);
+
+// load the rules of path, replacing any loaded before, returns how many or -1
+int alerts_load(const char *path);
+
+// start the notifier thread, returns 0 on success
+int alerts_start(void);
+
+// evaluate every rule on snap, events are handed to the notifier
+void alerts_evaluate(const struct snapshot *snap);
+
+// stop the notifier after it ran what was queued, and free the rules
+void alerts_stop(void);
+
+#endif //FINALPROJECT_ALERTS_H
@@ -0,0 +1,38 @@
+//
+// Sources of snapshots. A backend reads the hardware (or makes values up) for the
+// sections selected in flag and sets the matching validity bits.
+//
+
+#ifndef FINALPROJECT_BACKEND_H
+#define FINALPROJECT_BACKEND_H
+
+#include "snapshot.h"
+
+struct backend {
+    const char *name;
+    // prepare for sampling the sections in flag, returns 0 on success
+    int (*open)(int flag);
+    void (*sample)(int flag, struct snapshot *snap);
+    void (*close)(void);
+};
+
+#ifdef __APPLE__
+extern const struct backend mac_backend;
+
+// key catalog the mac backend primes the SMC key info cache from, NULL for the default
+void mac_backend_set_catalog(const char *path);
+#endif
+#ifdef __linux__
+extern const struct backend linux_backend;
+#endif
+extern const struct backend synthetic_backend;
+extern const struct backend thermal_backend;
+extern const struct backend replay_backend;
+
+// file played by the replay backend, speed times faster than it was recorded
+void replay_backend_set_file(const char *path, double speed);
+
+// look a backend up by name, NULL selects the platform default
+const struct backend *backend_find(const char *name);
+
+#endif //FINALPROJECT_BACKEND_H
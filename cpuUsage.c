@@ -0,0 +1,92 @@
+//
+// CPU usage, see cpuUsage.h
+//
+
+#include <stdlib.h>
+
+#include "cpuUsage.h"
+
+// the two reads alternate, so a sample never copies the counters
+static struct cpu_ticks reads[2];
+static int current = 0;
+static int haveBefore = 0;
+
+// share of part in total per core, percent. Plain loops over the SoA arrays without
+// branches, the difference is taken in uint32 so a wrapped counter still subtracts right
+static void core_percent(int count, const uint32_t *restrict before, const uint32_t *restrict after,
+                         const float *restrict scale, float *restrict percent) {
+    for (int i = 0; i < count; i++) {
+        percent[i] = (float) (uint32_t) (after[i] - before[i]) * scale[i];
+    }
+}
+
+void cpu_usage_compute(const struct cpu_ticks *before, const struct cpu_ticks *after, struct snapshot *snap) {
+    int count = before->count < after->count ? before->count : after->count;
+    float scale[SNAPSHOT_MAX_CORES];
+    float total = 0.0f;
+
+    if (count > SNAPSHOT_MAX_CORES) {
+        count = SNAPSHOT_MAX_CORES;
+    }
+    for (int i = 0; i < count; i++) {
+        uint32_t ticks = (uint32_t) (after->user[i] - before->user[i]) +
+                         (uint32_t) (after->system[i] - before->system[i]) +
+                         (uint32_t) (after->nice[i] - before->nice[i]) +
+                         (uint32_t) (after->idle[i] - before->idle[i]);
+        total += (float) ticks;
+        // a core that did not tick, e.g. offline, reads as idle rather than dividing by zero
+        scale[i] = ticks != 0 ? 100.0f / (float) ticks : 0.0f;
+    }
+    core_percent(count, before->user, after->user, scale, snap->coreUser);
+    core_percent(count, before->system, after->system, scale, snap->coreSystem);
+    core_percent(count, before->nice, after->nice, scale, snap->coreNice);
+    core_percent(count, before->idle, after->idle, scale, snap->coreIdle);
+
+    float user = 0.0f, system = 0.0f, nice = 0.0f;
+    for (int i = 0; i < count; i++) {
+        if (scale[i] == 0.0f) {
+            snap->coreIdle[i] = 100.0f;
+        }
+        // back to ticks, so the total weighs every core by what it actually counted
+        user += (float) (uint32_t) (after->user[i] - before->user[i]);
+        system += (float) (uint32_t) (after->system[i] - before->system[i]);
+        nice += (float) (uint32_t) (after->nice[i] - before->nice[i]);
+    }
+    snap->coreCount = count;
+    if (total > 0.0f) {
+        snap->cpuUser = user * 100.0f / total;
+        snap->cpuSystem = system * 100.0f / total;
+        snap->cpuNice = nice * 100.0f / total;
+        snap->cpuIdle = 100.0f - snap->cpuUser - snap->cpuSystem - snap->cpuNice;
+    } else {
+        snap->cpuUser = snap->cpuSystem = snap->cpuNice = 0.0f;
+        snap->cpuIdle = 100.0f;
+    }
+    snap->valid |= SNAP_CPU_USAGE;
+}
+
+int cpu_usage_open(void) {
+    haveBefore = 0;
+    return cpu_platform_open();
+}
+
+void cpu_usage_sample(struct snapshot *snap) {
+    struct cpu_ticks *after = &reads[current ^ 1];
+
+    if (getloadavg(snap->loadAverage, 3) == 3) {
+        snap->valid |= SNAP_LOAD;
+    }
+    if (cpu_platform_read_ticks(after) != 0) {
+        haveBefore = 0;
+        return;
+    }
+    if (haveBefore) {
+        cpu_usage_compute(&reads[current], after, snap);
+    }
+    current ^= 1;
+    haveBefore = 1;
+}
+
+void cpu_usage_close(void) {
+    cpu_platform_close();
+}
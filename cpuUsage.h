@@ -0,0 +1,48 @@
+//
+// CPU usage shared by the hardware backends: user/system/nice/idle share of every core
+// and the load averages. The kernel only exposes cumulative tick counters, so a sample
+// reads them once and turns them into percentages against the previous read.
+// Counters are kept as structure of arrays, the difference of two reads is then one
+// loop per state over all cores that the compiler vectorizes.
+//
+
+#ifndef FINALPROJECT_CPUUSAGE_H
+#define FINALPROJECT_CPUUSAGE_H
+
+#include <stdint.h>
+
+#include "snapshot.h"
+
+// cumulative ticks of every core since boot. 32 bit like mach's natural_t, differences
+// are taken modulo 2^32 so a counter that wraps between two reads still gives its delta
+struct cpu_ticks {
+    int count;
+    uint32_t user[SNAPSHOT_MAX_CORES];
+    uint32_t system[SNAPSHOT_MAX_CORES];
+    uint32_t nice[SNAPSHOT_MAX_CORES];
+    uint32_t idle[SNAPSHOT_MAX_CORES];
+};
+
+// ---- platform part, cpuUsageLinux.c or cpuUsageMac.c ----
+
+int cpu_platform_open(void);
+
+void cpu_platform_close(void);
+
+// read the current counters of every core, returns 0 on success
+int cpu_platform_read_ticks(struct cpu_ticks *ticks);
+
+// ---- common part, cpuUsage.c ----
+
+// per core and total percentages between two reads into the SNAP_CPU_USAGE fields of snap,
+// cores missing from either read are left out
+void cpu_usage_compute(const struct cpu_ticks *before, const struct cpu_ticks *after, struct snapshot *snap);
+
+int cpu_usage_open(void);
+
+// fill SNAP_LOAD, and SNAP_CPU_USAGE from the second sample on
+void cpu_usage_sample(struct snapshot *snap);
+
+void cpu_usage_close(void);
+
+#endif //FINALPROJECT_CPUUSAGE_H
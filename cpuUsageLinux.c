@@ -0,0 +1,61 @@
+//
+// Linux part of cpu usage: the per core "cpuN" lines of /proc/stat, in USER_HZ ticks.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "cpuUsage.h"
+
+// the cpu lines come first, the interrupt counters after them can be far longer
+#define STAT_SIZE 16384
+
+static int statFd = -1;
+
+int cpu_platform_open(void) {
+    statFd = open("/proc/stat", O_RDONLY | O_CLOEXEC);
+    return statFd >= 0 ? 0 : -1;
+}
+
+void cpu_platform_close(void) {
+    if (statFd >= 0) {
+        close(statFd);
+        statFd = -1;
+    }
+}
+
+int cpu_platform_read_ticks(struct cpu_ticks *ticks) {
+    static char text[STAT_SIZE];
+    ssize_t length;
+    char *line;
+
+    if (statFd < 0 || (length = pread(statFd, text, sizeof(text) - 1, 0)) <= 0) {
+        return -1;
+    }
+    text[length] = '\0';
+
+    ticks->count = 0;
+    // skip the aggregate "cpu " line, the total is summed from the cores
+    for (line = strstr(text, "\ncpu"); line != NULL && ticks->count < SNAPSHOT_MAX_CORES;
+         line = strstr(line, "\ncpu")) {
+        char *field = line + 4;
+        unsigned long long value[8] = {0};
+        int i = ticks->count;
+
+        strtol(field, &field, 10);    // core number
+        // user nice system idle iowait irq softirq steal
+        for (int v = 0; v < 8; v++) {
+            value[v] = strtoull(field, &field, 10);
+        }
+        // truncated to 32 bits on purpose, see struct cpu_ticks
+        ticks->user[i] = (uint32_t) value[0];
+        ticks->nice[i] = (uint32_t) value[1];
+        ticks->system[i] = (uint32_t) (value[2] + value[5] + value[6] + value[7]);
+        ticks->idle[i] = (uint32_t) (value[3] + value[4]);
+        ticks->count++;
+        line = field;
+    }
+    return ticks->count > 0 ? 0 : -1;
+}
@@ -0,0 +1,44 @@
+//
+// macOS part of cpu usage: host_processor_info, in mach ticks.
+//
+
+#include <mach/mach.h>
+#include <mach/processor_info.h>
+#include <mach/mach_host.h>
+
+#include "cpuUsage.h"
+
+static mach_port_t hostPort = MACH_PORT_NULL;
+
+int cpu_platform_open(void) {
+    hostPort = mach_host_self();
+    return 0;
+}
+
+void cpu_platform_close(void) {
+    if (hostPort != MACH_PORT_NULL) {
+        mach_port_deallocate(mach_task_self(), hostPort);
+        hostPort = MACH_PORT_NULL;
+    }
+}
+
+int cpu_platform_read_ticks(struct cpu_ticks *ticks) {
+    natural_t cpuCount;
+    processor_info_array_t info;
+    mach_msg_type_number_t infoCount;
+
+    if (host_processor_info(hostPort, PROCESSOR_CPU_LOAD_INFO, &cpuCount, &info, &infoCount) != KERN_SUCCESS) {
+        return -1;
+    }
+    ticks->count = cpuCount < SNAPSHOT_MAX_CORES ? (int) cpuCount : SNAPSHOT_MAX_CORES;
+    for (int i = 0; i < ticks->count; i++) {
+        const integer_t *state = info + i * CPU_STATE_MAX;
+        ticks->user[i] = (uint32_t) state[CPU_STATE_USER];
+        ticks->system[i] = (uint32_t) state[CPU_STATE_SYSTEM];
+        ticks->nice[i] = (uint32_t) state[CPU_STATE_NICE];
+        ticks->idle[i] = (uint32_t) state[CPU_STATE_IDLE];
+    }
+    // the array is allocated in our address space for every call
+    vm_deallocate(mach_task_self(), (vm_address_t) info, infoCount * sizeof(integer_t));
+    return 0;
+}
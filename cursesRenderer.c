@@ -0,0 +1,480 @@
+//
+// Curses renderer: the colored full screen view.
+// Frames are drawn into the virtual screen after erase() and pushed with doupdate(), so
+// curses sends only the cells that differ from the previous frame instead of repainting
+// the whole terminal like clear() does.
+//
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <curses.h>
+
+#include "renderer.h"
+#include "infoCollector.h"
+#include "smcSensors.h"
+
+#define WARNING_WHEN_HIGH 0
+#define WARNING_WHEN_LOW 1
+
+#define GREEN_BLACK 1
+#define YELLOW_BLACK 2
+#define RED_BLACK 3
+#define CYAN_BLACK 4
+#define BLUE_BLACK 5
+
+void init_color_pair() {
+    init_pair(GREEN_BLACK, COLOR_GREEN, COLOR_BLACK);
+    init_pair(YELLOW_BLACK, COLOR_YELLOW, COLOR_BLACK);
+    init_pair(RED_BLACK, COLOR_RED, COLOR_BLACK);
+    init_pair(CYAN_BLACK, COLOR_CYAN, COLOR_BLACK);
+    init_pair(BLUE_BLACK, COLOR_BLUE, COLOR_BLACK);
+}
+
+#define BAR_FILLING "||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||"
+#define BAR_WIDTH 10
+
+// print a percentage bar
+void printPercent(double percentage) {
+    if (!(percentage > 0)) {
+        percentage = 0;
+    }
+    if (percentage > 1) {
+        percentage = 1;
+    }
+    int leftFilling = (int) (percentage * BAR_WIDTH);
+    int rightFilling = BAR_WIDTH - leftFilling;
+    printw(" [%.*s%*s]", leftFilling, BAR_FILLING, rightFilling, "");
+}
+
+
+// a section whose collector is stuck keeps its last values, flagged in red
+void print_seperation(int *row, char *title, int stale) {
+    move((*row)++, 0);
+    attron(COLOR_PAIR(CYAN_BLACK));
+    printw("--- %s ---", title);
+    attroff(COLOR_PAIR(CYAN_BLACK));
+    if (stale) {
+        attron(COLOR_PAIR(RED_BLACK));
+        printw(" (stale)");
+        attroff(COLOR_PAIR(RED_BLACK));
+    }
+    move((*row)++, 0);
+}
+
+
+// color of a temperature by the thresholds of its sensor
+static int temperature_color(enum smc_sensor_id sensor, double temperature) {
+    if (temperature < smc_sensors[sensor].warm) {
+        return GREEN_BLACK;
+    } else if (temperature < smc_sensors[sensor].hot) {
+        return YELLOW_BLACK;
+    }
+    return RED_BLACK;
+}
+
+// trend, when known, adds the average and maximum over the stats window
+void print_temperature(enum smc_sensor_id sensor, int *row, double temperature, const struct metric_summary *trend) {
+    int colorIdx = temperature_color(sensor, temperature);
+
+    attron(COLOR_PAIR(colorIdx));
+    printw("%s: ", smc_sensors[sensor].title);
+    printw("%.2f °C", temperature);
+    attroff(COLOR_PAIR(colorIdx));
+    if (trend != NULL && trend->count > 1) {
+        printw("  (avg %.1f, max %.1f)", trend->mean, trend->max);
+    }
+    move((*row)++, 0);
+}
+
+
+// choose different warning type, if WARNING_WHEN_HIGH then use red color for usage above 75%
+// select color according to percentage
+static int usage_color(double percentage, int warningType) {
+    int colorIdx = 1;
+    if (percentage < 0.5) {
+        if (warningType == WARNING_WHEN_HIGH) {
+            colorIdx = GREEN_BLACK;
+        } else {
+            colorIdx = RED_BLACK;
+        }
+    }
+    if (percentage >= 0.5 && percentage < 0.75) {
+        colorIdx = YELLOW_BLACK;
+    }
+    if (percentage >= 0.75) {
+        if (warningType == WARNING_WHEN_HIGH) {
+            colorIdx = RED_BLACK;
+        } else {
+            colorIdx = GREEN_BLACK;
+        }
+    }
+    return colorIdx;
+}
+
+void print_usage(const char *title, const char *unit, double numerator, double denominator, int *row, int warningType) {
+    double percentage = numerator / denominator;
+    int colorIdx = usage_color(percentage, warningType);
+
+        attron(COLOR_PAIR(colorIdx));
+        printw("%s: %.2f %s", title, numerator, unit);
+        printPercent(percentage);
+        attroff(COLOR_PAIR(colorIdx));
+
+    move((*row)++, 0);
+
+
+}
+
+void show_disk_status(int *row, const struct snapshot *snap) {
+    print_seperation(row, "Disk Status", snap->stale & SNAP_DISK);
+    printw("Total Disk Size: %.2f GB", snap->diskTotal);
+    move((*row)++, 0);
+    print_usage("Used Disk Space", "GB", snap->diskTotal - snap->diskFree, snap->diskTotal, row, WARNING_WHEN_HIGH);
+
+    // the other volumes, the root one is shown above
+    for (int i = 0; i < snap->volumeCount; ++i) {
+        const struct volume_sample *volume = &snap->volumes[i];
+        if (strcmp(volume->mount, "/") != 0) {
+            print_usage(volume->mount, "GB", volume->total - volume->free, volume->total, row, WARNING_WHEN_HIGH);
+        }
+    }
+    if (snap->valid & SNAP_DISK_IO) {
+        for (int i = 0; i < snap->deviceCount; ++i) {
+            const struct device_sample *device = &snap->devices[i];
+            printw("%s: read %.1f MB/s %.0f IOPS, write %.1f MB/s %.0f IOPS", device->name,
+                   device->readBytes / 1e6, device->reads, device->writeBytes / 1e6, device->writes);
+            move((*row)++, 0);
+        }
+    }
+}
+
+// summary of metric, NULL until the stats have seen it
+static const struct metric_summary *trend_of(const struct metric_stats *stats, int metric) {
+    static struct metric_summary summary;
+    if (stats == NULL || !metric_stats_get(stats, metric, &summary)) {
+        return NULL;
+    }
+    return &summary;
+}
+
+// busiest to idlest, one character per core
+#define HEAT_LEVELS "@%#*+=-:. "
+#define HEAT_LEVEL_COUNT 10
+
+// every core as one colored character, so a 64 core machine still fits on one line
+static void print_core_strip(int *row, const struct snapshot *snap) {
+    printw("Cores: ");
+    for (int i = 0; i < snap->coreCount; ++i) {
+        double busy = 100.0 - snap->coreIdle[i];
+        int level = (int) ((100.0 - busy) * HEAT_LEVEL_COUNT / 100.0);
+        int colorIdx = busy < 50 ? GREEN_BLACK : busy < 75 ? YELLOW_BLACK : RED_BLACK;
+
+        if (level < 0) {
+            level = 0;
+        } else if (level >= HEAT_LEVEL_COUNT) {
+            level = HEAT_LEVEL_COUNT - 1;
+        }
+        attron(COLOR_PAIR(colorIdx));
+        addch((chtype) HEAT_LEVELS[level]);
+        attroff(COLOR_PAIR(colorIdx));
+    }
+    move((*row)++, 0);
+}
+
+int sparkleController = 1;
+void show_CPU_status(int *row, const struct snapshot *snap, const struct metric_stats *stats) {
+    print_seperation(row, "CPU Status", snap->stale & (SNAP_CPU_TEMP | SNAP_CPU_USAGE));
+    if (snap->valid & SNAP_CPU_USAGE) {
+        print_usage("CPU busy", "%", 100.0 - snap->cpuIdle, 100.0, row, WARNING_WHEN_HIGH);
+        printw("user %.1f%%, system %.1f%%, nice %.1f%%", snap->cpuUser, snap->cpuSystem, snap->cpuNice);
+        move((*row)++, 0);
+        print_core_strip(row, snap);
+    }
+    if (snap->valid & SNAP_LOAD) {
+        printw("Load average: %.2f %.2f %.2f", snap->loadAverage[0], snap->loadAverage[1], snap->loadAverage[2]);
+        move((*row)++, 0);
+    }
+    if (!(snap->valid & SNAP_CPU_TEMP)) {
+        return;
+    }
+
+    double cpuTemperautre = snap->cpuTemp;
+    if (sparkleController) {
+        print_temperature(SENSOR_CPU_0_PROXIMITY, row, cpuTemperautre, trend_of(stats, METRIC_CPU_TEMP));
+    } else {
+        move((*row)++, 0);
+    }
+
+    // make cpu temp sparkle if it is above 70 degree
+    if (cpuTemperautre >= 70) {
+        sparkleController = !sparkleController;
+    } else {
+        sparkleController = 1;
+    }
+}
+
+void show_fan_status(int *row, const struct snapshot *snap) {
+    int fan_num = snap->fanCount;
+    // for machines such as Macbook which doesn't have any built-in fan
+    if (fan_num == 0) {
+        return;
+    }
+
+    print_seperation(row, "Fan Status", snap->stale & SNAP_FANS);
+
+    double maxFanSpeed = snap->fanMax;
+    printw("%s: %.0f %s", smc_sensors[SENSOR_FAN_0_MAX_RPM].title, maxFanSpeed, smc_sensors[SENSOR_FAN_0_MAX_RPM].unit);
+    move((*row)++, 0);
+
+    printw("Installed Fans: %d", fan_num);
+    move((*row)++, 0);
+
+    char blockName[12] = "Fan   Speed";
+
+    // print each fan
+    for (int i = 0; i < fan_num; ++i) {
+        blockName[4] = i + 48;
+        print_usage(blockName, "rpm", snap->fanSpeed[i], maxFanSpeed, row, WARNING_WHEN_HIGH);
+    }
+}
+
+void show_mem_status(int *row, const struct snapshot *snap, const struct metric_stats *stats) {
+    print_seperation(row, "Memory Status", snap->stale & SNAP_MEM);
+    printw("Installed Mem: %.1f GB", snap->memTotal);
+    move((*row)++, 0);
+
+    print_temperature(SENSOR_MEMORY_SLOTS_PROXIMITY, row, snap->memTemp, trend_of(stats, METRIC_MEM_TEMP));
+
+    print_usage("Memory Usage", "GB", snap->memUsed, snap->memTotal, row, WARNING_WHEN_HIGH);
+    if (snap->valid & SNAP_MEM_DETAIL) {
+        printw("active %.2f, inactive %.2f, wired %.2f, compressed %.2f, free %.2f GB",
+               snap->memActive, snap->memInactive, snap->memWired, snap->memCompressed, snap->memFree);
+        move((*row)++, 0);
+        printw("purgeable %.2f GB, swap used %.2f GB", snap->memPurgeable, snap->swapUsed);
+        move((*row)++, 0);
+    }
+    if (snap->valid & SNAP_MEM_RATES) {
+        // steady paging out is what a machine short of memory looks like, a full cache is not
+        int colorIdx = snap->pageOutRate > 0 ? RED_BLACK : snap->compressionRate > 0 ? YELLOW_BLACK : GREEN_BLACK;
+        attron(COLOR_PAIR(colorIdx));
+        printw("page in %.0f/s, out %.0f/s, compress %.0f/s, decompress %.0f/s", snap->pageInRate,
+               snap->pageOutRate, snap->compressionRate, snap->decompressionRate);
+        attroff(COLOR_PAIR(colorIdx));
+        move((*row)++, 0);
+    }
+}
+
+void show_GPU_status(int *row, const struct snapshot *snap, const struct metric_stats *stats) {
+    print_seperation(row, "GPU Status", snap->stale & SNAP_GPU_TEMP);
+
+    print_temperature(SENSOR_GPU_0_PROXIMITY, row, snap->gpuTemp, trend_of(stats, METRIC_GPU_TEMP));
+}
+
+void show_battery_status(int *row, const struct snapshot *snap, const struct metric_stats *stats) {
+    // for machines such as iMac which does not have a built-in battery
+    if (!snap->batteryPresent) {
+        return;
+    }
+
+    print_seperation(row, "Battery Status", snap->stale & SNAP_BATTERY);
+
+    if (snap->batteryPowered) {
+        printw("Battery Charged!");
+        move((*row)++, 0);
+    } else {
+        int batteryTime = snap->batteryMinutes;
+        if (batteryTime == -1) {
+            // -1 indicates the system is calculating the time
+            printw("Time remaining: Calculating");
+            move((*row)++, 0);
+        } else {
+            int hours = batteryTime / 60;
+            int mintues = batteryTime - hours * 60;
+            printw("Time remaining: %02d:%02d", hours, mintues);
+            move((*row)++, 0);
+        }
+    }
+    print_usage("Battery Charge", "%", snap->batteryPercent, 100, row, WARNING_WHEN_LOW);
+    print_temperature(SENSOR_BATTERY_0_TEMP, row, snap->batteryTemp, trend_of(stats, METRIC_BATTERY_TEMP));
+}
+
+static int curses_open(void) {
+    // set up window
+    WINDOW *wnd;
+    wnd = initscr();
+    cbreak();
+    noecho();
+    clear();
+    refresh();
+    start_color();
+    init_color_pair();
+    wbkgd(wnd, COLOR_PAIR(BLUE_BLACK));
+    // nothing is typed on this screen, don't spend bytes moving the cursor around
+    leaveok(wnd, TRUE);
+    curs_set(0);
+    return 0;
+}
+
+static void print_process_rows(int *row, const char *title, const struct process_sample *rows, int count) {
+    attron(A_BOLD);
+    printw("%-8s %-24s %7s %10s  %s", "PID", "NAME", "CPU%", "RSS MB", title);
+    attroff(A_BOLD);
+    move((*row)++, 0);
+    for (int i = 0; i < count; ++i) {
+        int colorIdx = rows[i].cpu < 50 ? GREEN_BLACK : rows[i].cpu < 90 ? YELLOW_BLACK : RED_BLACK;
+        attron(COLOR_PAIR(colorIdx));
+        printw("%-8d %-24.24s %7.1f %10.1f", rows[i].pid, rows[i].name, rows[i].cpu, rows[i].rss);
+        attroff(COLOR_PAIR(colorIdx));
+        move((*row)++, 0);
+    }
+}
+
+void show_process_status(int *row, const struct snapshot *snap) {
+    print_seperation(row, "Processes", snap->stale & SNAP_PROCESSES);
+    printw("%d running", snap->processCount);
+    move((*row)++, 0);
+    print_process_rows(row, "by cpu", snap->topCpu, snap->topCount);
+    print_process_rows(row, "by memory", snap->topMemory, snap->topCount);
+}
+
+static void curses_render(const struct snapshot *snap, const struct metric_stats *stats, int flag) {
+    // control which row to print onto
+    int row = 0;
+
+    // erase() only blanks the virtual screen, unlike clear() it does not force a full repaint
+    erase();
+    // DISK
+    if ((flag & _DISK_STATUS) && (snap->valid & SNAP_DISK)) {
+        show_disk_status(&row, snap);
+    }
+    // CPU
+    if (((flag & _CPU_TEMP) && (snap->valid & SNAP_CPU_TEMP)) ||
+        ((flag & _CPU_USAGE) && (snap->valid & (SNAP_CPU_USAGE | SNAP_LOAD)))) {
+        show_CPU_status(&row, snap, stats);
+    }
+    // FAN
+    if ((flag & _FAN_STATUS) && (snap->valid & SNAP_FANS)) {
+        show_fan_status(&row, snap);
+    }
+    // Memory
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM)) {
+        show_mem_status(&row, snap, stats);
+    }
+    // GPU
+    if ((flag & _GPU_STATUS) && (snap->valid & SNAP_GPU_TEMP)) {
+        show_GPU_status(&row, snap, stats);
+    }
+    // Battery charge
+    if ((flag & _BATTERY_STATUS) && (snap->valid & SNAP_BATTERY)) {
+        show_battery_status(&row, snap, stats);
+    }
+    // Processes
+    if ((flag & _PROCESSES) && (snap->valid & SNAP_PROCESSES)) {
+        show_process_status(&row, snap);
+    }
+    // what watching costs, one line at the bottom
+    if (snap->valid & SNAP_SELF) {
+        mvprintw(LINES - 1, 0, "macResMon: %.2f%% cpu, %.1f MB, %.0f syscalls/s, %.0f SMC calls/s",
+                 snap->selfCpu, snap->selfRss, snap->selfSyscalls, snap->selfSmcCalls);
+    }
+    wnoutrefresh(stdscr);
+    doupdate();
+}
+
+static const char *sortNames[] = {"name", "cpu temp", "load", "memory", "disk"};
+
+static void print_fleet_host(int *row, const struct fleet_host *host, uint64_t now) {
+    printw("%-24.24s ", host->name);
+    if (!host->connected) {
+        attron(COLOR_PAIR(RED_BLACK));
+        printw("%6s ", "down");
+        attroff(COLOR_PAIR(RED_BLACK));
+    } else {
+        printw("%5.0fs ", now > host->lastSeen ? (now - host->lastSeen) / 1e9 : 0.0);
+    }
+    if (host->valid & SNAP_CPU_TEMP) {
+        attron(COLOR_PAIR(temperature_color(SENSOR_CPU_0_PROXIMITY, host->cpuTemp)));
+        printw("%7.1f ", host->cpuTemp);
+        attroff(COLOR_PAIR(temperature_color(SENSOR_CPU_0_PROXIMITY, host->cpuTemp)));
+    } else {
+        printw("%7s ", "-");
+    }
+    if (host->valid & SNAP_LOAD) {
+        printw("%6.2f ", host->load);
+    } else {
+        printw("%6s ", "-");
+    }
+    if ((host->valid & SNAP_MEM) && host->memTotal > 0) {
+        int colorIdx = usage_color(host->memUsed / host->memTotal, WARNING_WHEN_HIGH);
+        attron(COLOR_PAIR(colorIdx));
+        printw("%6.1f/%-6.1f", host->memUsed, host->memTotal);
+        printPercent(host->memUsed / host->memTotal);
+        attroff(COLOR_PAIR(colorIdx));
+    } else {
+        printw("%-26s", "  -");
+    }
+    if ((host->valid & SNAP_DISK) && host->diskTotal > 0) {
+        double used = (host->diskTotal - host->diskFree) / host->diskTotal;
+        int colorIdx = usage_color(used, WARNING_WHEN_HIGH);
+        attron(COLOR_PAIR(colorIdx));
+        printw(" %5.1f%%", used * 100);
+        printPercent(used);
+        attroff(COLOR_PAIR(colorIdx));
+    } else {
+        printw(" %-19s", "    -");
+    }
+    if (host->valid & SNAP_GPU_TEMP) {
+        attron(COLOR_PAIR(temperature_color(SENSOR_GPU_0_PROXIMITY, host->gpuTemp)));
+        printw(" %7.1f", host->gpuTemp);
+        attroff(COLOR_PAIR(temperature_color(SENSOR_GPU_0_PROXIMITY, host->gpuTemp)));
+    } else {
+        printw(" %7s", "-");
+    }
+    // the fastest fan, what the host spins right now rather than what it could
+    if (host->valid & SNAP_FANS) {
+        printw(" %7.0f", host->fanSpeed);
+    } else {
+        printw(" %7s", "-");
+    }
+    move((*row)++, 0);
+}
+
+static void curses_render_fleet(const struct fleet_host *hosts, int count, enum fleet_sort sort, uint64_t now) {
+    char title[96];
+    int row = 0, up = 0;
+
+    for (int i = 0; i < count; i++) {
+        up += hosts[i].connected;
+    }
+    erase();
+    snprintf(title, sizeof(title), "Fleet: %d hosts, %d up, by %s", count, up, sortNames[sort]);
+    print_seperation(&row, title, 0);
+    attron(A_BOLD);
+    printw("%-24s %6s %7s %6s %-25s %-19s %7s %7s", "HOST", "SEEN", "CPU C", "LOAD", "MEMORY GB", "DISK",
+           "GPU C", "FAN");
+    attroff(A_BOLD);
+    move(row++, 0);
+    // as many hosts as the screen has rows, the sort decides which
+    for (int i = 0; i < count && row < LINES - 1; i++) {
+        print_fleet_host(&row, &hosts[i], now);
+    }
+    mvprintw(LINES - 1, 0, "sort: n name, c cpu temp, l load, m memory, d disk; q quit");
+    wnoutrefresh(stdscr);
+    doupdate();
+}
+
+static void curses_close(void) {
+    endwin();
+}
+
+static void curses_resize(void) {
+    struct winsize size;
+
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0 && size.ws_col > 0) {
+        resizeterm(size.ws_row, size.ws_col);
+    }
+}
+
+const struct renderer curses_renderer = {"curses", curses_open, curses_render, curses_close, curses_resize,
+                                         curses_render_fleet};
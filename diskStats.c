@@ -0,0 +1,124 @@
+//
+// Disk subsystem, see diskStats.h
+//
+
+#include <string.h>
+#include <time.h>
+#include <sys/statvfs.h>
+
+#include "diskStats.h"
+
+#define Byte_TO_GB (1024.0 * 1024 * 1024)
+
+static struct disk_volume volumes[SNAPSHOT_MAX_VOLUMES];
+static int volumeCount = 0;
+
+// counters of the previous sample, rates are the difference over the elapsed time
+static struct disk_counters previous[SNAPSHOT_MAX_DEVICES];
+static int previousCount = -1;
+static double previousTime;
+
+static double seconds_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+int disk_stats_open(void) {
+    volumeCount = 0;
+    previousCount = -1;
+    return disk_platform_open();
+}
+
+// counter increase, 0 when it went backwards because the device was reset or replaced
+static double increase(uint64_t before, uint64_t after) {
+    return after >= before ? (double) (after - before) : 0.0;
+}
+
+void disk_rates(const struct disk_counters *before, int beforeCount, const struct disk_counters *after,
+                int afterCount, double seconds, struct snapshot *snap) {
+    if (!(seconds > 0)) {
+        return;
+    }
+    snap->deviceCount = 0;
+    for (int i = 0; i < afterCount; i++) {
+        const struct disk_counters *previousDevice = NULL;
+        for (int j = 0; j < beforeCount && previousDevice == NULL; j++) {
+            if (strcmp(before[j].name, after[i].name) == 0) {
+                previousDevice = &before[j];
+            }
+        }
+        if (previousDevice == NULL) {
+            continue;
+        }
+        struct device_sample *device = &snap->devices[snap->deviceCount++];
+        memcpy(device->name, after[i].name, sizeof(device->name));
+        device->readBytes = increase(previousDevice->readBytes, after[i].readBytes) / seconds;
+        device->writeBytes = increase(previousDevice->writeBytes, after[i].writeBytes) / seconds;
+        device->reads = increase(previousDevice->reads, after[i].reads) / seconds;
+        device->writes = increase(previousDevice->writes, after[i].writes) / seconds;
+    }
+    snap->valid |= SNAP_DISK_IO;
+}
+
+static void sample_rates(struct snapshot *snap) {
+    struct disk_counters counters[SNAPSHOT_MAX_DEVICES];
+    double now = seconds_now();
+    int count = disk_platform_read_counters(volumes, volumeCount, counters, SNAPSHOT_MAX_DEVICES);
+
+    if (count < 0) {
+        previousCount = -1;
+        return;
+    }
+    if (previousCount >= 0) {
+        disk_rates(previous, previousCount, counters, count, now - previousTime, snap);
+    }
+    memcpy(previous, counters, (size_t) count * sizeof(struct disk_counters));
+    previousCount = count;
+    previousTime = now;
+}
+
+// the root volume comes first even when it is not backed by a device (containers, netboot)
+static void list_volumes(void) {
+    volumeCount = disk_platform_list_volumes(volumes + 1, SNAPSHOT_MAX_VOLUMES - 1);
+    for (int i = 1; i <= volumeCount; i++) {
+        if (strcmp(volumes[i].mount, "/") == 0) {
+            volumes[0] = volumes[i];
+            memmove(volumes + i, volumes + i + 1, (size_t) (volumeCount - i) * sizeof(struct disk_volume));
+            return;
+        }
+    }
+    memset(&volumes[0], 0, sizeof(volumes[0]));
+    strcpy(volumes[0].mount, "/");
+    volumeCount++;
+}
+
+void disk_stats_sample(struct snapshot *snap) {
+    if (disk_platform_mounts_changed()) {
+        list_volumes();
+    }
+
+    // one statvfs per volume, the root one also fills the summary fields
+    snap->volumeCount = 0;
+    for (int i = 0; i < volumeCount; i++) {
+        struct statvfs buf;
+        if (statvfs(volumes[i].mount, &buf) != 0) {
+            continue;
+        }
+        struct volume_sample *volume = &snap->volumes[snap->volumeCount++];
+        memcpy(volume->mount, volumes[i].mount, sizeof(volume->mount));
+        volume->total = (double) buf.f_frsize * buf.f_blocks / Byte_TO_GB;
+        volume->free = (double) buf.f_frsize * buf.f_bfree / Byte_TO_GB;
+        if (strcmp(volume->mount, "/") == 0) {
+            snap->diskTotal = volume->total;
+            snap->diskFree = volume->free;
+            snap->valid |= SNAP_DISK;
+        }
+    }
+
+    sample_rates(snap);
+}
+
+void disk_stats_close(void) {
+    disk_platform_close();
+}
@@ -0,0 +1,66 @@
+//
+// Disk subsystem shared by the hardware backends: space of every mounted volume and
+// read/write throughput and IOPS of the devices behind them.
+// The volume list is only rebuilt when the mount table changes; a sample then costs one
+// statvfs per volume and one read of the platform's cumulative I/O counters, turned into
+// rates against the previous sample.
+//
+
+#ifndef FINALPROJECT_DISKSTATS_H
+#define FINALPROJECT_DISKSTATS_H
+
+#include <stdint.h>
+
+#include "snapshot.h"
+
+struct disk_volume {
+    char mount[SNAPSHOT_NAME_LENGTH];
+    char device[SNAPSHOT_NAME_LENGTH];  // device name as the I/O counters know it, may be empty
+};
+
+// cumulative counters of a device since boot
+struct disk_counters {
+    char name[SNAPSHOT_NAME_LENGTH];
+    uint64_t readBytes;
+    uint64_t writeBytes;
+    uint64_t reads;
+    uint64_t writes;
+};
+
+// ---- platform part, diskStatsLinux.c or diskStatsMac.c ----
+
+int disk_platform_open(void);
+
+void disk_platform_close(void);
+
+// nonzero when the mount table changed since the last call, and on the first call
+int disk_platform_mounts_changed(void);
+
+// local volumes backed by a device, returns how many were stored
+int disk_platform_list_volumes(struct disk_volume *volumes, int max);
+
+// counters of the devices behind volumes, returns how many were stored or -1
+int disk_platform_read_counters(const struct disk_volume *volumes, int volumeCount,
+                                struct disk_counters *counters, int max);
+
+#ifdef __linux__
+// read the mount table and the I/O counters from other files than /proc/self/mounts and
+// /proc/diskstats, NULL for the default. Takes effect on the next disk_stats_open
+void disk_platform_set_paths(const char *mounts, const char *diskstats);
+#endif
+
+// ---- common part, diskStats.c ----
+
+int disk_stats_open(void);
+
+// bytes and operations per second of every device in after that is also in before, read
+// seconds apart, into the SNAP_DISK_IO fields of snap
+void disk_rates(const struct disk_counters *before, int beforeCount, const struct disk_counters *after,
+                int afterCount, double seconds, struct snapshot *snap);
+
+// fill the SNAP_DISK fields of snap, and SNAP_DISK_IO from the second sample on
+void disk_stats_sample(struct snapshot *snap);
+
+void disk_stats_close(void);
+
+#endif //FINALPROJECT_DISKSTATS_H
@@ -0,0 +1,145 @@
+//
+// Linux part of the disk subsystem: /proc/self/mounts for the volumes, polled for
+// changes, and /proc/diskstats for the I/O counters.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <mntent.h>
+#include <limits.h>
+
+#include "diskStats.h"
+
+#define SECTOR_SIZE 512
+#define DISKSTATS_SIZE 65536
+
+static const char *mountsPath = "/proc/self/mounts";
+static const char *diskstatsPath = "/proc/diskstats";
+static int mountsFd = -1;
+static int diskstatsFd = -1;
+static int listed = 0;
+
+void disk_platform_set_paths(const char *mounts, const char *diskstats) {
+    mountsPath = mounts != NULL ? mounts : "/proc/self/mounts";
+    diskstatsPath = diskstats != NULL ? diskstats : "/proc/diskstats";
+}
+
+int disk_platform_open(void) {
+    // the kernel flags this file POLLPRI whenever the mount table changes
+    mountsFd = open(mountsPath, O_RDONLY | O_CLOEXEC);
+    diskstatsFd = open(diskstatsPath, O_RDONLY | O_CLOEXEC);
+    listed = 0;
+    return 0;
+}
+
+void disk_platform_close(void) {
+    if (mountsFd >= 0) {
+        close(mountsFd);
+        mountsFd = -1;
+    }
+    if (diskstatsFd >= 0) {
+        close(diskstatsFd);
+        diskstatsFd = -1;
+    }
+}
+
+int disk_platform_mounts_changed(void) {
+    struct pollfd mounts = {mountsFd, POLLPRI, 0};
+
+    if (!listed || mountsFd < 0) {
+        listed = 1;
+        return 1;
+    }
+    return poll(&mounts, 1, 0) > 0 && (mounts.revents & (POLLPRI | POLLERR));
+}
+
+// kernel name of a device node, /dev/mapper/root -> dm-0; left empty when it does not fit,
+// a cut name would never match a line of /proc/diskstats anyway
+static void device_name(const char *node, char *name) {
+    char resolved[PATH_MAX];
+    const char *base;
+
+    if (realpath(node, resolved) != NULL) {
+        node = resolved;
+    }
+    base = strrchr(node, '/');
+    if (snprintf(name, SNAPSHOT_NAME_LENGTH, "%s", base != NULL ? base + 1 : node) >= SNAPSHOT_NAME_LENGTH) {
+        name[0] = '\0';
+    }
+}
+
+int disk_platform_list_volumes(struct disk_volume *volumes, int max) {
+    FILE *mounts = setmntent(mountsPath, "r");
+    struct mntent *entry;
+    int count = 0;
+
+    if (mounts == NULL) {
+        return 0;
+    }
+    while (count < max && (entry = getmntent(mounts)) != NULL) {
+        int duplicate = 0;
+
+        // only block devices, loop mounts are images (snaps and the like) rather than disks
+        if (strncmp(entry->mnt_fsname, "/dev/", 5) != 0 || strncmp(entry->mnt_fsname, "/dev/loop", 9) == 0) {
+            continue;
+        }
+        for (int i = 0; i < count && !duplicate; i++) {
+            duplicate = strcmp(volumes[i].mount, entry->mnt_dir) == 0;
+        }
+        if (duplicate) {
+            continue;
+        }
+        snprintf(volumes[count].mount, SNAPSHOT_NAME_LENGTH, "%s", entry->mnt_dir);
+        device_name(entry->mnt_fsname, volumes[count].device);
+        count++;
+    }
+    endmntent(mounts);
+    return count;
+}
+
+int disk_platform_read_counters(const struct disk_volume *volumes, int volumeCount,
+                                struct disk_counters *counters, int max) {
+    static char text[DISKSTATS_SIZE];
+    ssize_t length;
+    int count = 0;
+
+    if (diskstatsFd < 0 || (length = pread(diskstatsFd, text, sizeof(text) - 1, 0)) < 0) {
+        return -1;
+    }
+    text[length] = '\0';
+
+    for (char *line = text; line != NULL && *line != '\0' && count < max;) {
+        char *next = strchr(line, '\n');
+        char name[SNAPSHOT_NAME_LENGTH];
+        unsigned long long reads, readsMerged, sectorsRead, readTime, writes, writesMerged, sectorsWritten;
+        int wanted = 0;
+
+        if (next != NULL) {
+            *next++ = '\0';
+        }
+        // major minor name reads merged sectors ms writes merged sectors ...
+        if (sscanf(line, "%*u %*u %47s %llu %llu %llu %llu %llu %llu %llu", name, &reads, &readsMerged,
+                   &sectorsRead, &readTime, &writes, &writesMerged, &sectorsWritten) == 8) {
+            for (int i = 0; i < volumeCount && !wanted; i++) {
+                wanted = strcmp(volumes[i].device, name) == 0;
+            }
+            for (int i = 0; i < count && wanted; i++) {
+                wanted = strcmp(counters[i].name, name) != 0;
+            }
+        }
+        if (wanted) {
+            memcpy(counters[count].name, name, sizeof(name));
+            counters[count].readBytes = sectorsRead * SECTOR_SIZE;
+            counters[count].writeBytes = sectorsWritten * SECTOR_SIZE;
+            counters[count].reads = reads;
+            counters[count].writes = writes;
+            count++;
+        }
+        line = next;
+    }
+    return count;
+}
@@ -0,0 +1,112 @@
+//
+// macOS part of the disk subsystem: getfsstat for the volumes and the statistics of
+// every IOBlockStorageDriver for the I/O counters.
+// APFS volumes live in synthesized containers, so activity is reported per physical disk
+// rather than per volume.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/ucred.h>
+#include <sys/mount.h>
+#include <IOKit/IOKitLib.h>
+#include <IOKit/IOBSD.h>
+#include <IOKit/storage/IOBlockStorageDriver.h>
+
+#include "diskStats.h"
+
+static int mountCount = -1;
+
+int disk_platform_open(void) {
+    mountCount = -1;
+    return 0;
+}
+
+void disk_platform_close(void) {
+}
+
+// there is no mount notification to poll, but the number of mounts is one cheap syscall
+int disk_platform_mounts_changed(void) {
+    int count = getfsstat(NULL, 0, MNT_NOWAIT);
+    int changed = count != mountCount;
+    mountCount = count;
+    return changed;
+}
+
+int disk_platform_list_volumes(struct disk_volume *volumes, int max) {
+    struct statfs *mounts;
+    int mounted = getmntinfo(&mounts, MNT_NOWAIT);
+    int count = 0;
+
+    for (int i = 0; i < mounted && count < max; i++) {
+        // skip network mounts and the hidden system volumes (VM, Preboot, ...)
+        if (!(mounts[i].f_flags & MNT_LOCAL) || (mounts[i].f_flags & MNT_DONTBROWSE) ||
+            strncmp(mounts[i].f_mntfromname, "/dev/", 5) != 0) {
+            continue;
+        }
+        snprintf(volumes[count].mount, SNAPSHOT_NAME_LENGTH, "%s", mounts[i].f_mntonname);
+        snprintf(volumes[count].device, SNAPSHOT_NAME_LENGTH, "%s", mounts[i].f_mntfromname + 5);
+        count++;
+    }
+    return count;
+}
+
+static uint64_t statistic(CFDictionaryRef statistics, const char *key) {
+    CFStringRef name = CFStringCreateWithCString(kCFAllocatorDefault, key, kCFStringEncodingUTF8);
+    CFNumberRef number = CFDictionaryGetValue(statistics, name);
+    int64_t value = 0;
+
+    if (number != NULL) {
+        CFNumberGetValue(number, kCFNumberSInt64Type, &value);
+    }
+    CFRelease(name);
+    return (uint64_t) value;
+}
+
+// BSD name of the media below a block storage driver, e.g. disk0
+static int media_name(io_registry_entry_t driver, char *name) {
+    io_registry_entry_t media;
+    CFStringRef bsdName;
+    int found = 0;
+
+    if (IORegistryEntryGetChildEntry(driver, kIOServicePlane, &media) != KERN_SUCCESS) {
+        return 0;
+    }
+    bsdName = IORegistryEntryCreateCFProperty(media, CFSTR(kIOBSDNameKey), kCFAllocatorDefault, 0);
+    if (bsdName != NULL) {
+        found = CFStringGetCString(bsdName, name, SNAPSHOT_NAME_LENGTH, kCFStringEncodingUTF8);
+        CFRelease(bsdName);
+    }
+    IOObjectRelease(media);
+    return found;
+}
+
+int disk_platform_read_counters(const struct disk_volume *volumes, int volumeCount,
+                                struct disk_counters *counters, int max) {
+    io_iterator_t drivers;
+    io_registry_entry_t driver;
+    int count = 0;
+
+    if (IOServiceGetMatchingServices(kIOMasterPortDefault, IOServiceMatching(kIOBlockStorageDriverClass),
+                                     &drivers) != KERN_SUCCESS) {
+        return -1;
+    }
+    while ((driver = IOIteratorNext(drivers)) != 0) {
+        CFDictionaryRef statistics = IORegistryEntryCreateCFProperty(driver, CFSTR(kIOBlockStorageDriverStatisticsKey),
+                                                                     kCFAllocatorDefault, 0);
+        if (statistics != NULL && count < max && media_name(driver, counters[count].name)) {
+            counters[count].readBytes = statistic(statistics, kIOBlockStorageDriverStatisticsBytesReadKey);
+            counters[count].writeBytes = statistic(statistics, kIOBlockStorageDriverStatisticsBytesWrittenKey);
+            counters[count].reads = statistic(statistics, kIOBlockStorageDriverStatisticsReadsKey);
+            counters[count].writes = statistic(statistics, kIOBlockStorageDriverStatisticsWritesKey);
+            count++;
+        }
+        if (statistics != NULL) {
+            CFRelease(statistics);
+        }
+        IOObjectRelease(driver);
+    }
+    IOObjectRelease(drivers);
+    return count;
+}
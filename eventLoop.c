@@ -0,0 +1,145 @@
+//
+// Event loop, see eventLoop.h
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/select.h>
+
+#include "eventLoop.h"
+
+static const int watchedSignals[] = {SIGINT, SIGTERM, SIGWINCH, SIGUSR1};
+#define WATCHED_COUNT (sizeof(watchedSignals) / sizeof(watchedSignals[0]))
+
+static int selfPipe[2] = {-1, -1};
+static int keyFd = -1;
+static struct sigaction previous[WATCHED_COUNT];
+
+static void on_signal(int signal) {
+    int saved = errno;
+    unsigned char byte = (unsigned char) signal;
+
+    // a full pipe already holds enough wake ups, the byte can be lost
+    (void) write(selfPipe[1], &byte, 1);
+    errno = saved;
+}
+
+// wait until deadline or until the pipe or stdin become readable, whatever comes first
+static void event_sleep_until(void *ctx, uint64_t deadline) {
+    uint64_t now = monotonic_clock.now(NULL);
+    struct timespec timeout;
+    fd_set readable;
+    int highest = selfPipe[0];
+
+    if (selfPipe[0] < 0) {
+        monotonic_clock.sleep_until(ctx, deadline);
+        return;
+    }
+    if (deadline <= now) {
+        return;
+    }
+    timeout.tv_sec = (time_t) ((deadline - now) / NSEC_PER_SEC);
+    timeout.tv_nsec = (long) ((deadline - now) % NSEC_PER_SEC);
+    FD_ZERO(&readable);
+    FD_SET(selfPipe[0], &readable);
+    if (keyFd >= 0) {
+        FD_SET(keyFd, &readable);
+        highest = keyFd > highest ? keyFd : highest;
+    }
+    pselect(highest + 1, &readable, NULL, NULL, &timeout, NULL);
+}
+
+static uint64_t event_now(void *ctx) {
+    return monotonic_clock.now(ctx);
+}
+
+const struct sched_clock event_clock = {event_now, event_sleep_until, NULL};
+
+int event_loop_open(int keys) {
+    struct sigaction action;
+
+    if (pipe(selfPipe) != 0) {
+        selfPipe[0] = selfPipe[1] = -1;
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        fcntl(selfPipe[i], F_SETFL, fcntl(selfPipe[i], F_GETFL) | O_NONBLOCK);
+        fcntl(selfPipe[i], F_SETFD, FD_CLOEXEC);
+    }
+    keyFd = keys && isatty(STDIN_FILENO) ? STDIN_FILENO : -1;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_signal;
+    sigemptyset(&action.sa_mask);
+    // interrupted reads and writes of the collectors resume, the sleep ends on the pipe
+    action.sa_flags = SA_RESTART;
+    for (size_t i = 0; i < WATCHED_COUNT; i++) {
+        sigaction(watchedSignals[i], &action, &previous[i]);
+    }
+    return 0;
+}
+
+// nonzero when fd has something to read right now
+static int readable_now(int fd) {
+    struct timespec zero = {0, 0};
+    fd_set readable;
+
+    FD_ZERO(&readable);
+    FD_SET(fd, &readable);
+    return pselect(fd + 1, &readable, NULL, NULL, &zero, NULL) > 0;
+}
+
+int event_loop_next(struct event *event) {
+    unsigned char byte;
+
+    if (selfPipe[0] < 0) {
+        return 0;
+    }
+    while (read(selfPipe[0], &byte, 1) == 1) {
+        switch (byte) {
+            case SIGINT:
+            case SIGTERM:
+                event->type = EVENT_QUIT;
+                return 1;
+            case SIGWINCH:
+                event->type = EVENT_RESIZE;
+                return 1;
+            case SIGUSR1:
+                event->type = EVENT_DUMP;
+                return 1;
+            default:
+                break;
+        }
+    }
+    // stdin stays blocking, it is shared with the shell, so only read what is there
+    if (keyFd >= 0 && readable_now(keyFd)) {
+        ssize_t length = read(keyFd, &byte, 1);
+
+        if (length == 1) {
+            event->type = EVENT_KEY;
+            event->key = byte;
+            return 1;
+        }
+        if (length == 0) {
+            // end of input, stop watching it rather than waking up for it forever
+            keyFd = -1;
+        }
+    }
+    return 0;
+}
+
+void event_loop_close(void) {
+    if (selfPipe[0] < 0) {
+        return;
+    }
+    for (size_t i = 0; i < WATCHED_COUNT; i++) {
+        sigaction(watchedSignals[i], &previous[i], NULL);
+    }
+    close(selfPipe[0]);
+    close(selfPipe[1]);
+    selfPipe[0] = selfPipe[1] = -1;
+    keyFd = -1;
+}
@@ -0,0 +1,39 @@
+//
+// Events of the UI thread: quit (SIGINT, SIGTERM), terminal resizes (SIGWINCH), self
+// stats dumps (SIGUSR1) and keys typed on the terminal. Signal handlers only write the
+// signal number into a self-pipe; the scheduler sleeps in pselect() on that pipe and on
+// stdin through event_clock, so any of them ends the sleep at once instead of waiting
+// for the next deadline, and nothing runs between deadlines while idle.
+//
+
+#ifndef FINALPROJECT_EVENTLOOP_H
+#define FINALPROJECT_EVENTLOOP_H
+
+#include "scheduler.h"
+
+enum event_type {
+    EVENT_QUIT,
+    EVENT_RESIZE,
+    EVENT_DUMP,
+    EVENT_KEY,
+};
+
+struct event {
+    enum event_type type;
+    int key;                // EVENT_KEY only
+};
+
+// drop-in for monotonic_clock whose sleep also ends when an event arrives
+extern const struct sched_clock event_clock;
+
+// create the pipe and take over the signals, keys are read from stdin when it is a
+// terminal and keys is set. Returns 0 on success
+int event_loop_open(int keys);
+
+// next pending event without blocking, returns 0 when there is none
+int event_loop_next(struct event *event);
+
+// give the signals back to their previous handlers
+void event_loop_close(void);
+
+#endif //FINALPROJECT_EVENTLOOP_H
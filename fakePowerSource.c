@@ -0,0 +1,42 @@
+//
+// In-memory power source, see fakePowerSource.h
+//
+
+#include <stddef.h>
+
+#include "fakePowerSource.h"
+
+static struct power_info state;
+static int failing = 0;
+static unsigned long readCount = 0;
+
+void fakePower_set(const struct power_info *info) {
+    if (info == NULL) {
+        state = (struct power_info) {0};
+        return;
+    }
+    state = *info;
+}
+
+void fakePower_fail(int fail) {
+    failing = fail;
+}
+
+unsigned long fakePower_read_count(void) {
+    return readCount;
+}
+
+void fakePower_reset_counts(void) {
+    readCount = 0;
+}
+
+static int fake_read(struct power_info *info) {
+    readCount++;
+    if (failing) {
+        return -1;
+    }
+    *info = state;
+    return 0;
+}
+
+const struct power_source fake_power_source = {"fake", fake_read};
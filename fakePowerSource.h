@@ -0,0 +1,23 @@
+//
+// In-memory power source for machines without IOKit, counting every read so
+// callers can check that a tick costs one fetch.
+//
+
+#ifndef FINALPROJECT_FAKEPOWERSOURCE_H
+#define FINALPROJECT_FAKEPOWERSOURCE_H
+
+#include "powerSource.h"
+
+extern const struct power_source fake_power_source;
+
+// state returned by the following reads, NULL removes the battery
+void fakePower_set(const struct power_info *info);
+
+// make reads fail until cleared
+void fakePower_fail(int fail);
+
+unsigned long fakePower_read_count(void);
+
+void fakePower_reset_counts(void);
+
+#endif //FINALPROJECT_FAKEPOWERSOURCE_H
@@ -0,0 +1,206 @@
+//
+// In-memory SMC transport, see fakeSMC.h
+//
+
+#include <string.h>
+#include "fakeSMC.h"
+
+#define COMMAND_SLOTS 16
+
+typedef struct {
+    uint32_t key;
+    uint32_t dataType;
+    uint32_t dataSize;
+    int fail;
+    SMCBytes_t bytes;
+} FakeKey_t;
+
+static FakeKey_t keys[FAKE_SMC_MAX_KEYS];
+static int keyCount = 0;
+static unsigned long callCounts[COMMAND_SLOTS];
+static void (*callHook)(void) = NULL;
+
+static uint32_t pack(const char *key) {
+    return SMC_FOURCC((unsigned char) key[0], (unsigned char) key[1], (unsigned char) key[2],
+                      (unsigned char) key[3]);
+}
+
+// binary search, returns the index of key or the position it would be inserted at
+static int find(uint32_t key, int *found) {
+    int low = 0, high = keyCount;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (keys[mid].key < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *found = low < keyCount && keys[low].key == key;
+    return low;
+}
+
+void fakeSMC_reset(void) {
+    keyCount = 0;
+    fakeSMC_reset_counts();
+}
+
+int fakeSMC_set_key(const char *key, uint32_t dataType, uint32_t dataSize, const void *bytes) {
+    int found;
+    uint32_t packed = pack(key);
+    int idx = find(packed, &found);
+
+    if (dataSize > sizeof(SMCBytes_t)) {
+        return -1;
+    }
+    if (!found) {
+        if (keyCount == FAKE_SMC_MAX_KEYS) {
+            return -1;
+        }
+        memmove(&keys[idx + 1], &keys[idx], (keyCount - idx) * sizeof(FakeKey_t));
+        keyCount++;
+        memset(&keys[idx], 0, sizeof(FakeKey_t));
+        keys[idx].key = packed;
+    }
+    keys[idx].dataType = dataType;
+    keys[idx].dataSize = dataSize;
+    memset(keys[idx].bytes, 0, sizeof(SMCBytes_t));
+    memcpy(keys[idx].bytes, bytes, dataSize);
+    return 0;
+}
+
+int fakeSMC_set_sp78(const char *key, double celsius) {
+    int fixed = (int) (celsius * 256.0);
+    unsigned char bytes[2] = {(unsigned char) ((fixed >> 8) & 0xff), (unsigned char) (fixed & 0xff)};
+    return fakeSMC_set_key(key, DATA_TYPE_SP78, 2, bytes);
+}
+
+int fakeSMC_set_fpe2(const char *key, double rpm) {
+    unsigned int fixed = (unsigned int) (rpm * 4.0);
+    unsigned char bytes[2] = {(unsigned char) ((fixed >> 8) & 0xff), (unsigned char) (fixed & 0xff)};
+    return fakeSMC_set_key(key, DATA_TYPE_FPE2, 2, bytes);
+}
+
+int fakeSMC_set_ui8(const char *key, uint8_t value) {
+    return fakeSMC_set_key(key, DATA_TYPE_UINT8, 1, &value);
+}
+
+int fakeSMC_get_key(const char *key, uint32_t *dataType, SMCBytes_t bytes) {
+    int found;
+    int idx = find(pack(key), &found);
+
+    if (!found) {
+        return -1;
+    }
+    *dataType = keys[idx].dataType;
+    memcpy(bytes, keys[idx].bytes, sizeof(SMCBytes_t));
+    return (int) keys[idx].dataSize;
+}
+
+void fakeSMC_set_hook(void (*hook)(void)) {
+    callHook = hook;
+}
+
+void fakeSMC_fail_key(const char *key, int fail) {
+    int found;
+    int idx = find(pack(key), &found);
+    if (found) {
+        keys[idx].fail = fail;
+    }
+}
+
+unsigned long fakeSMC_call_count(int command) {
+    if (command < 0 || command >= COMMAND_SLOTS) {
+        return 0;
+    }
+    return callCounts[command];
+}
+
+void fakeSMC_reset_counts(void) {
+    memset(callCounts, 0, sizeof(callCounts));
+}
+
+static kern_return_t fake_open(void) {
+    return kIOReturnSuccess;
+}
+
+static kern_return_t fake_close(void) {
+    return kIOReturnSuccess;
+}
+
+static kern_return_t fake_call(int index, SMCKeyData_t *input, SMCKeyData_t *output) {
+    int found, idx;
+    int command = (unsigned char) input->data8;
+
+    if (index != kSMCHandleYPCEvent) {
+        return kIOReturnError;
+    }
+    if (command < COMMAND_SLOTS) {
+        callCounts[command]++;
+    }
+    if (callHook != NULL) {
+        callHook();
+    }
+
+    memset(output, 0, sizeof(SMCKeyData_t));
+    if (command == kSMCGetKeyFromIndex) {
+        if (input->data32 >= (uint32_t) keyCount) {
+            output->result = (char) kSMCKeyNotFound;
+            return kIOReturnSuccess;
+        }
+        output->key = keys[input->data32].key;
+        return kIOReturnSuccess;
+    }
+
+    // like the real controller, #KEY reports the number of keys unless it was set explicitly
+    idx = find(input->key, &found);
+    if (!found && input->key == SMC_FOURCC('#', 'K', 'E', 'Y')) {
+        uint32_t count = (uint32_t) keyCount;
+        output->key = input->key;
+        output->keyInfo.dataSize = 4;
+        output->keyInfo.dataType = DATA_TYPE_UINT32;
+        output->bytes[0] = (char) (count >> 24);
+        output->bytes[1] = (char) (count >> 16);
+        output->bytes[2] = (char) (count >> 8);
+        output->bytes[3] = (char) count;
+        return command == kSMCGetKeyInfo || command == kSMCReadKey ? kIOReturnSuccess : kIOReturnError;
+    }
+    if (found && keys[idx].fail) {
+        return kIOReturnError;
+    }
+
+    switch (command) {
+        case kSMCGetKeyInfo:
+            if (!found) {
+                output->result = (char) kSMCKeyNotFound;
+                break;
+            }
+            output->keyInfo.dataSize = keys[idx].dataSize;
+            output->keyInfo.dataType = keys[idx].dataType;
+            break;
+        case kSMCReadKey:
+            if (!found) {
+                output->result = (char) kSMCKeyNotFound;
+                break;
+            }
+            memcpy(output->bytes, keys[idx].bytes, sizeof(SMCBytes_t));
+            break;
+        case kSMCWriteKey:
+            if (!found) {
+                output->result = (char) kSMCKeyNotFound;
+                break;
+            }
+            if (input->keyInfo.dataSize != keys[idx].dataSize) {
+                output->result = (char) kSMCBadArgument;
+                break;
+            }
+            memcpy(keys[idx].bytes, input->bytes, keys[idx].dataSize);
+            break;
+        default:
+            return kIOReturnError;
+    }
+    output->key = input->key;
+    return kIOReturnSuccess;
+}
+
+const SMCTransport_t fakeSMC_transport = {"fake", fake_open, fake_close, fake_call};
@@ -0,0 +1,45 @@
+//
+// In-memory SMC used in place of AppleSMC where there is none (Linux, benchmarks).
+// Keys are kept sorted by packed code like the real controller, and every call
+// is counted per SMC command so callers can check how much traffic they cause.
+// Writes replace a key's bytes when the size matches, like the real controller.
+//
+
+#ifndef FINALPROJECT_FAKESMC_H
+#define FINALPROJECT_FAKESMC_H
+
+#include "smcTransport.h"
+
+#define FAKE_SMC_MAX_KEYS 2048
+
+extern const SMCTransport_t fakeSMC_transport;
+
+// drop all keys and counters
+void fakeSMC_reset(void);
+
+// add or replace a key, returns 0 on success and -1 when the table is full
+int fakeSMC_set_key(const char *key, uint32_t dataType, uint32_t dataSize, const void *bytes);
+
+// convenience setters encoding the value in the key's data type
+int fakeSMC_set_sp78(const char *key, double celsius);
+
+int fakeSMC_set_fpe2(const char *key, double rpm);
+
+int fakeSMC_set_ui8(const char *key, uint8_t value);
+
+// copy the bytes of key, returns its size or -1 when there is no such key
+int fakeSMC_get_key(const char *key, uint32_t *dataType, SMCBytes_t bytes);
+
+// hook runs before every call reaches the keys, so a simulation (thermalModel.c) can
+// bring them up to date lazily; NULL removes it
+void fakeSMC_set_hook(void (*hook)(void));
+
+// make every call touching key fail at the transport level until cleared
+void fakeSMC_fail_key(const char *key, int fail);
+
+// number of calls issued with the given SMC command (kSMCReadKey, kSMCGetKeyInfo, ...)
+unsigned long fakeSMC_call_count(int command);
+
+void fakeSMC_reset_counts(void);
+
+#endif //FINALPROJECT_FAKESMC_H
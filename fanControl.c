@@ -0,0 +1,425 @@
+//
+// Fan controller, see fanControl.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/select.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+
+#include "fanControl.h"
+#include "systemManagementController.h"
+#include "scheduler.h"
+#include "selfStats.h"
+#include "snapshot.h"
+
+#define DEFAULT_RATE 4.0
+#define DEFAULT_FAILSAFE 95.0
+// a target closer than this to the one written last is not worth an SMC write
+#define WRITE_STEP_RPM 25.0
+
+static struct fan_control_config config;
+static struct fan_pid pid;
+
+static int fanCount = 0;
+static double fanMin[SNAPSHOT_MAX_FANS], fanMax[SNAPSHOT_MAX_FANS], written[SNAPSHOT_MAX_FANS];
+static SMCKey_t targetKeys[SNAPSHOT_MAX_FANS], modeKeys[SNAPSHOT_MAX_FANS];
+static int useForceBits;        // FS! on Intel Macs, a F0Md per fan on Apple silicon
+static double savedForceBits;
+
+static volatile sig_atomic_t manual = 0;
+static pthread_t thread;
+static int stopPipe[2] = {-1, -1};
+static atomic_int stopping;
+static int running = 0;
+
+static uint64_t lastRun;
+static struct latency_histogram lateness;
+static unsigned long writes, fallbacks;
+
+static const int fatalSignals[] = {SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT, SIGHUP};
+#define FATAL_COUNT (sizeof(fatalSignals) / sizeof(fatalSignals[0]))
+static struct sigaction previous[FATAL_COUNT];
+static int handled[FATAL_COUNT];
+
+int fan_control_parse(const char *spec, struct fan_control_config *out) {
+    char buf[256];
+    char *token, *save;
+
+    memset(out, 0, sizeof(struct fan_control_config));
+    out->rate = DEFAULT_RATE;
+    out->failsafeTemp = DEFAULT_FAILSAFE;
+    out->kp = 0.15;
+    out->ki = 0.01;
+    out->kd = 0.1;
+    if (strncmp(spec, "curve:", 6) == 0) {
+        out->mode = FAN_CONTROL_CURVE;
+    } else if (strncmp(spec, "pid:", 4) == 0) {
+        out->mode = FAN_CONTROL_PID;
+    } else {
+        return -1;
+    }
+    if (strlen(spec) >= sizeof(buf)) {
+        return -1;
+    }
+    strcpy(buf, strchr(spec, ':') + 1);
+
+    for (token = strtok_r(buf, ",", &save); token != NULL; token = strtok_r(NULL, ",", &save)) {
+        char *equals = strchr(token, '=');
+        char *end;
+        double value = strtod(equals != NULL ? equals + 1 : token, &end);
+
+        if (*end != '\0') {
+            return -1;
+        }
+        if (equals == NULL) {
+            // the bare number of pid:75
+            if (out->mode != FAN_CONTROL_PID) {
+                return -1;
+            }
+            out->setpoint = value;
+            continue;
+        }
+        *equals = '\0';
+        if (strcmp(token, "rate") == 0 && value > 0 && value <= 100) {
+            out->rate = value;
+        } else if (strcmp(token, "failsafe") == 0) {
+            out->failsafeTemp = value;
+        } else if (out->mode == FAN_CONTROL_PID && strcmp(token, "kp") == 0) {
+            out->kp = value;
+        } else if (out->mode == FAN_CONTROL_PID && strcmp(token, "ki") == 0) {
+            out->ki = value;
+        } else if (out->mode == FAN_CONTROL_PID && strcmp(token, "kd") == 0) {
+            out->kd = value;
+        } else if (out->mode == FAN_CONTROL_CURVE && out->pointCount < FAN_CURVE_MAX_POINTS) {
+            // a point: temperature=percent
+            double temp = strtod(token, &end);
+            int n = out->pointCount;
+
+            if (*end != '\0' || value < 0 || value > 100 || (n > 0 && temp <= out->curveTemp[n - 1])) {
+                return -1;
+            }
+            out->curveTemp[n] = temp;
+            out->curveLevel[n] = value / 100.0;
+            out->pointCount++;
+        } else {
+            return -1;
+        }
+    }
+    if (out->mode == FAN_CONTROL_CURVE && out->pointCount == 0) {
+        return -1;
+    }
+    if (out->mode == FAN_CONTROL_PID && out->setpoint <= 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static double clamp_level(double level) {
+    return level < 0 ? 0 : level > 1 ? 1 : level;
+}
+
+static double curve_level(const struct fan_control_config *cfg, double temperature) {
+    int n = cfg->pointCount;
+
+    if (temperature <= cfg->curveTemp[0]) {
+        return cfg->curveLevel[0];
+    }
+    for (int i = 1; i < n; i++) {
+        if (temperature <= cfg->curveTemp[i]) {
+            double share = (temperature - cfg->curveTemp[i - 1]) / (cfg->curveTemp[i] - cfg->curveTemp[i - 1]);
+            return cfg->curveLevel[i - 1] + share * (cfg->curveLevel[i] - cfg->curveLevel[i - 1]);
+        }
+    }
+    return cfg->curveLevel[n - 1];
+}
+
+double fan_control_level(const struct fan_control_config *cfg, struct fan_pid *state, double temperature, double dt) {
+    double error, derivative, level;
+
+    if (temperature >= cfg->failsafeTemp) {
+        return 1.0;
+    }
+    if (cfg->mode == FAN_CONTROL_CURVE) {
+        return clamp_level(curve_level(cfg, temperature));
+    }
+
+    error = temperature - cfg->setpoint;
+    // on the measurement rather than the error, and nothing on the first call
+    derivative = state->primed && dt > 0 ? (temperature - state->previous) / dt : 0;
+    state->previous = temperature;
+    state->primed = 1;
+
+    level = cfg->kp * error + state->integral + cfg->ki * error * dt + cfg->kd * derivative;
+    // only integrate while the output is not pinned the same way, so nothing winds up
+    if ((level < 1 || error < 0) && (level > 0 || error > 0)) {
+        state->integral += cfg->ki * error * dt;
+    }
+    return clamp_level(level);
+}
+
+// force the fans or hand them back, the caller holds the SMC lock (the crash handler
+// cannot, and takes its chances)
+static void set_manual(int on) {
+    if (useForceBits) {
+        SMC_write_value(SMC_key(FORCE_BITS), on ? (double) ((int) savedForceBits | ((1 << fanCount) - 1)) : savedForceBits);
+    } else {
+        for (int i = 0; i < fanCount; i++) {
+            SMC_write_value(modeKeys[i], on);
+        }
+    }
+    manual = on;
+    for (int i = 0; i < fanCount; i++) {
+        written[i] = -1;
+    }
+}
+
+static void on_fatal(int sig) {
+    if (manual) {
+        set_manual(0);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// exit() while the controller runs: the thread may be in the middle of a tick, so it is
+// stopped before the fans are handed back
+static void on_exit_restore(void) {
+    fan_control_stop();
+}
+
+static int control_tick(void *arg) {
+    struct sched_task *task = arg;
+    SMCKey_t keys[2] = {SMC_KEY_CPU_0_PROXIMITY, SMC_KEY_GPU_0_PROXIMITY};
+    SMCSample_t samples[2];
+    uint64_t now = monotonic_clock.now(NULL);
+    double dt = lastRun != 0 ? (double) (now - lastRun) / NSEC_PER_SEC : 1.0 / config.rate;
+    double hottest = -1000, level;
+    int valid = 0;
+
+    latency_record(&lateness, now - task->deadline);
+    lastRun = now;
+
+    SMC_lock();
+    SMC_read_many(keys, 2, samples);
+    for (int i = 0; i < 2; i++) {
+        // a sensor reading 0 is one that failed, see SMC_get_sensor
+        if (samples[i].valid && samples[i].value > 0) {
+            hottest = samples[i].value > hottest ? samples[i].value : hottest;
+            valid = 1;
+        }
+    }
+    if (!valid) {
+        // blind, the firmware is better off deciding
+        if (manual) {
+            set_manual(0);
+            fallbacks++;
+        }
+        memset(&pid, 0, sizeof(pid));
+        SMC_unlock();
+        return 0;
+    }
+    level = fan_control_level(&config, &pid, hottest, dt);
+    if (!manual) {
+        set_manual(1);
+    }
+    for (int i = 0; i < fanCount; i++) {
+        double rpm = fanMin[i] + level * (fanMax[i] - fanMin[i]);
+        double change = rpm > written[i] ? rpm - written[i] : written[i] - rpm;
+
+        // the ends of the range are always written exactly
+        if (written[i] < 0 || change >= WRITE_STEP_RPM || (change > 0 && (level == 0 || level == 1))) {
+            if (SMC_write_value(targetKeys[i], rpm) == kIOReturnSuccess) {
+                written[i] = rpm;
+                writes++;
+            }
+        }
+    }
+    SMC_unlock();
+    return 1;
+}
+
+static uint64_t control_now(void *ctx) {
+    return monotonic_clock.now(ctx);
+}
+
+// sleeps like monotonic_clock but wakes up at once when the controller is stopped
+static void control_sleep_until(void *ctx, uint64_t deadline) {
+    uint64_t now = control_now(ctx);
+    fd_set readable;
+
+    if (deadline <= now) {
+        return;
+    }
+    struct timespec timeout = {(time_t) ((deadline - now) / NSEC_PER_SEC), (long) ((deadline - now) % NSEC_PER_SEC)};
+    FD_ZERO(&readable);
+    FD_SET(stopPipe[0], &readable);
+    pselect(stopPipe[0] + 1, &readable, NULL, NULL, &timeout, NULL);
+}
+
+static const struct sched_clock control_clock = {control_now, control_sleep_until, NULL};
+
+static void *control_loop(void *arg) {
+    struct scheduler sched;
+    struct sched_task task = {.name = "fans", .period = (uint64_t) (NSEC_PER_SEC / config.rate),
+                              .run = control_tick};
+
+    task.arg = &task;
+#ifdef __linux__
+    // the default 50 us of timer slack is most of the jitter of an idle machine
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+#endif
+    scheduler_init(&sched, &control_clock, 0);
+    scheduler_add(&sched, &task);
+    while (!atomic_load(&stopping)) {
+        scheduler_step(&sched);
+    }
+    return NULL;
+}
+
+// the fans of this SMC and how to force them, under the SMC lock
+static int discover_fans(void) {
+    SMCKey_t keys[2 * SNAPSHOT_MAX_FANS];
+    SMCSample_t samples[2 * SNAPSHOT_MAX_FANS];
+    SMCSample_t force;
+    SMCKey_t forceKey = SMC_key(FORCE_BITS);
+
+    fanCount = SMC_get_fan_num();
+    if (fanCount <= 0) {
+        return -1;
+    }
+    if (fanCount > SNAPSHOT_MAX_FANS) {
+        fanCount = SNAPSHOT_MAX_FANS;
+    }
+    for (int i = 0; i < fanCount; i++) {
+        keys[2 * i] = SMC_FAN_KEY(SMC_KEY_FAN_0_MIN_RPM, i);
+        keys[2 * i + 1] = SMC_FAN_KEY(SMC_KEY_FAN_0_MAX_RPM, i);
+        targetKeys[i] = SMC_FAN_KEY(SMC_KEY_FAN_0_TARGET_RPM, i);
+        modeKeys[i] = SMC_FAN_KEY(SMC_key(FAN_0_MODE), i);
+    }
+    if (SMC_read_many(keys, (size_t) (2 * fanCount), samples) != (size_t) (2 * fanCount)) {
+        return -1;
+    }
+    for (int i = 0; i < fanCount; i++) {
+        fanMin[i] = samples[2 * i].value;
+        fanMax[i] = samples[2 * i + 1].value;
+        if (!(fanMax[i] > fanMin[i])) {
+            return -1;
+        }
+    }
+    useForceBits = SMC_read_many(&forceKey, 1, &force) == 1;
+    savedForceBits = useForceBits ? force.value : 0;
+    if (!useForceBits) {
+        SMCSample_t mode;
+        if (SMC_read_many(&modeKeys[0], 1, &mode) != 1) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// the fatal signal actions found by fan_control_start
+static void restore_handlers(void) {
+    for (size_t i = 0; i < FATAL_COUNT; i++) {
+        if (handled[i]) {
+            sigaction(fatalSignals[i], &previous[i], NULL);
+        }
+    }
+}
+
+int fan_control_start(const struct fan_control_config *cfg) {
+    struct sigaction action;
+    int found;
+
+    config = *cfg;
+    memset(&pid, 0, sizeof(pid));
+    memset(&lateness, 0, sizeof(lateness));
+    writes = fallbacks = 0;
+    lastRun = 0;
+
+    SMC_lock();
+    found = discover_fans();
+    SMC_unlock();
+    if (found != 0 || pipe(stopPipe) != 0) {
+        return -1;
+    }
+    fcntl(stopPipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(stopPipe[1], F_SETFD, FD_CLOEXEC);
+
+    // a crash must not leave the fans where the controller last put them
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_fatal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND;
+    for (size_t i = 0; i < FATAL_COUNT; i++) {
+        sigaction(fatalSignals[i], NULL, &previous[i]);
+        // an ignored SIGHUP (daemon mode) stays ignored
+        handled[i] = previous[i].sa_handler == SIG_DFL;
+        if (handled[i]) {
+            sigaction(fatalSignals[i], &action, NULL);
+        }
+    }
+    static int registered = 0;
+    if (!registered) {
+        atexit(on_exit_restore);
+        registered = 1;
+    }
+
+    atomic_store(&stopping, 0);
+    // signals stay with the UI thread, but for the faults the thread itself raises: blocked,
+    // they would kill the process without on_fatal handing the fans back
+    sigset_t all, mask;
+    sigfillset(&all);
+    sigdelset(&all, SIGSEGV);
+    sigdelset(&all, SIGBUS);
+    sigdelset(&all, SIGILL);
+    sigdelset(&all, SIGFPE);
+    pthread_sigmask(SIG_BLOCK, &all, &mask);
+    int created = pthread_create(&thread, NULL, control_loop, NULL);
+    pthread_sigmask(SIG_SETMASK, &mask, NULL);
+    if (created != 0) {
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+        // fan_control_stop only runs for a started controller, it would leave on_fatal installed
+        restore_handlers();
+        return -1;
+    }
+    running = 1;
+    return 0;
+}
+
+void fan_control_stop(void) {
+    if (!running) {
+        return;
+    }
+    atomic_store(&stopping, 1);
+    if (write(stopPipe[1], "", 1) < 0) {
+        perror("could not stop the fan controller");
+    }
+    pthread_join(thread, NULL);
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    running = 0;
+
+    SMC_lock();
+    if (manual) {
+        set_manual(0);
+    }
+    SMC_unlock();
+    restore_handlers();
+}
+
+void fan_control_dump(FILE *out) {
+    if (atomic_load_explicit(&lateness.count, memory_order_relaxed) == 0) {
+        return;
+    }
+    fprintf(out, "fan control: %lu target writes, %lu fallbacks to the firmware\n", writes, fallbacks);
+    latency_print(out, "fans late", &lateness);
+}
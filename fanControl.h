@@ -0,0 +1,63 @@
+//
+// Closed-loop fan control through the SMC write path. A control thread reads the CPU and
+// GPU temperatures at a fixed rate and drives the target of every fan between its own
+// minimum and maximum (F0Mn..F0Mx) from the hotter of the two, along a curve or with a
+// PID loop, given as:
+//
+//     curve:50=0,70=40,85=100     percent of each fan's range at a temperature, linear
+//                                 in between and flat past the ends
+//     pid:75                      hold 75 °C, kp=, ki= and kd= override the gains
+//
+// Both take rate=HZ (default 4) and failsafe=°C (default 95), at which every fan goes to
+// its maximum whatever the curve or the loop say. The fans are handed back to the
+// firmware when the controller stops, when the process exits or crashes and for as long
+// as no temperature can be read. Only a SIGKILL leaves them forced.
+//
+
+#ifndef FINALPROJECT_FANCONTROL_H
+#define FINALPROJECT_FANCONTROL_H
+
+#include <stdio.h>
+
+#define FAN_CURVE_MAX_POINTS 8
+
+enum fan_control_mode {
+    FAN_CONTROL_CURVE,
+    FAN_CONTROL_PID,
+};
+
+struct fan_control_config {
+    enum fan_control_mode mode;
+    int pointCount;
+    double curveTemp[FAN_CURVE_MAX_POINTS];     // ascending, °C
+    double curveLevel[FAN_CURVE_MAX_POINTS];    // 0..1 of the fan range
+    double setpoint;                            // °C
+    double kp, ki, kd;                          // per °C, per °C s and s per °C
+    double rate;                                // Hz
+    double failsafeTemp;
+};
+
+// PID state, zeroed to start over
+struct fan_pid {
+    double integral;
+    double previous;
+    int primed;
+};
+
+// parse spec into config, returns 0 on success
+int fan_control_parse(const char *spec, struct fan_control_config *config);
+
+// fan level (0..1 of each fan's range) for temperature, dt seconds after the last call
+double fan_control_level(const struct fan_control_config *config, struct fan_pid *pid, double temperature, double dt);
+
+// take the fans over on a thread of its own, the SMC must be open already (the backend
+// opens it); returns 0 once the thread runs
+int fan_control_start(const struct fan_control_config *config);
+
+// stop the thread and give the fans back to the firmware
+void fan_control_stop(void);
+
+// writes, fallbacks and how late the control ticks ran, nothing when not started
+void fan_control_dump(FILE *out);
+
+#endif //FINALPROJECT_FANCONTROL_H
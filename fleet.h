@@ -0,0 +1,81 @@
+//
+// Fleet mode: agents stream their snapshots to one aggregator that shows every host in
+// one table. The protocol runs over TCP or a UNIX socket:
+//
+//     hello    "MRMF", version (2 bytes), column count (2 bytes), name length (1 byte), name
+//     sample   length (2 bytes), a sample as recording_encode_sample writes it
+//
+// Fixed fields are big endian. Samples are deltas against the previous sample of the same
+// connection, so a reconnecting agent starts over with every value in full; an agent whose
+// socket backs up drops the connection rather than a sample, which would desynchronize
+// the deltas. An address is host:port (or just :port to listen everywhere) for TCP, and a
+// path starting with / or unix: for a UNIX socket.
+//
+
+#ifndef FINALPROJECT_FLEET_H
+#define FINALPROJECT_FLEET_H
+
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "snapshot.h"
+
+#define FLEET_MAGIC "MRMF"
+#define FLEET_VERSION 1
+#define FLEET_HELLO_SIZE 9
+#define FLEET_NAME_LENGTH 64
+#define FLEET_MAX_HOSTS 1024
+
+// a host as the aggregator last heard from it: the figures of the fleet table, taken from
+// its latest sample, rather than the whole snapshot, so a frame copies little per host
+struct fleet_host {
+    char name[FLEET_NAME_LENGTH];
+    uint32_t valid;             // SNAP_* bits of the latest sample
+    double cpuTemp;
+    double gpuTemp;
+    double load;                // 1 minute average
+    double memUsed, memTotal;   // GB
+    double diskFree, diskTotal; // GB, of the root volume
+    double fanSpeed;            // rpm of the fastest fan
+    uint64_t lastSeen;          // monotonic ns
+    uint64_t samples;
+    int connected;
+};
+
+// orders of the fleet table
+enum fleet_sort {
+    FLEET_SORT_NAME,
+    FLEET_SORT_CPU_TEMP,
+    FLEET_SORT_LOAD,
+    FLEET_SORT_MEMORY,
+    FLEET_SORT_DISK,
+};
+
+// resolve address into addr, returns 0 on success
+int fleet_address_parse(const char *address, int passive, struct sockaddr_storage *addr, socklen_t *length);
+
+// ---- agent, fleetAgent.c ----
+
+// stream to the aggregator at address under name (NULL for the host name), returns 0 when
+// the address is valid; connecting is retried in the background of fleet_agent_send
+int fleet_agent_open(const char *address, const char *name);
+
+// send snap, never blocks
+void fleet_agent_send(const struct snapshot *snap);
+
+void fleet_agent_close(void);
+
+// ---- aggregator, fleetAggregator.c ----
+
+// accept agents on address on a thread of its own, returns 0 once it listens
+int fleet_aggregator_start(const char *address);
+
+// copy of every host heard from so far, returns how many
+int fleet_aggregator_hosts(struct fleet_host *hosts, int capacity);
+
+void fleet_aggregator_stop(void);
+
+// sort hosts for the table, the metrics largest first
+void fleet_sort_hosts(struct fleet_host *hosts, int count, enum fleet_sort sort);
+
+#endif //FINALPROJECT_FLEET_H
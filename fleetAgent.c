@@ -0,0 +1,205 @@
+//
+// Fleet agent and the parts of the protocol both sides share, see fleet.h
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/un.h>
+
+#include "fleet.h"
+#include "recording.h"
+
+// samples queued while the socket is busy, past that the connection is dropped
+#define AGENT_BUFFER_SIZE (16 * (2 + RECORDING_SAMPLE_MAX))
+#define RECONNECT_NS 1000000000ull
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+static struct sockaddr_storage target;
+static socklen_t targetLength;
+static char hostName[FLEET_NAME_LENGTH];
+static int fd = -1;
+static int connecting = 0;
+static uint64_t lastAttempt;
+static struct recording_stream stream;
+static uint8_t pending[AGENT_BUFFER_SIZE];
+static size_t pendingLength;
+
+int fleet_address_parse(const char *address, int passive, struct sockaddr_storage *addr, socklen_t *length) {
+    struct addrinfo hints, *found;
+    char host[256];
+    const char *colon;
+
+    memset(addr, 0, sizeof(struct sockaddr_storage));
+    if (strncmp(address, "unix:", 5) == 0 || address[0] == '/') {
+        struct sockaddr_un *local = (struct sockaddr_un *) addr;
+        const char *path = address[0] == '/' ? address : address + 5;
+
+        if (strlen(path) >= sizeof(local->sun_path)) {
+            return -1;
+        }
+        local->sun_family = AF_UNIX;
+        strcpy(local->sun_path, path);
+        *length = sizeof(struct sockaddr_un);
+        return 0;
+    }
+    colon = strrchr(address, ':');
+    if (colon == NULL || (size_t) (colon - address) >= sizeof(host)) {
+        return -1;
+    }
+    memcpy(host, address, (size_t) (colon - address));
+    host[colon - address] = '\0';
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    if (getaddrinfo(host[0] != '\0' ? host : NULL, colon + 1, &hints, &found) != 0) {
+        return -1;
+    }
+    memcpy(addr, found->ai_addr, found->ai_addrlen);
+    *length = found->ai_addrlen;
+    freeaddrinfo(found);
+    return 0;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+static void disconnect(void) {
+    if (fd >= 0) {
+        close(fd);
+    }
+    fd = -1;
+    connecting = 0;
+    pendingLength = 0;
+}
+
+// start a non-blocking connect and queue the hello, the deltas start over
+static void reconnect(void) {
+    size_t nameLength = strlen(hostName);
+    uint8_t *hello = pending;
+
+    lastAttempt = now_ns();
+    fd = socket(target.ss_family, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &yes, sizeof(yes));
+#endif
+    if (connect(fd, (struct sockaddr *) &target, targetLength) != 0 && errno != EINPROGRESS) {
+        disconnect();
+        return;
+    }
+    connecting = 1;
+
+    memset(&stream, 0, sizeof(stream));
+    memcpy(hello, FLEET_MAGIC, 4);
+    hello[4] = FLEET_VERSION >> 8;
+    hello[5] = FLEET_VERSION & 0xff;
+    hello[6] = REC_COLUMN_COUNT >> 8;
+    hello[7] = REC_COLUMN_COUNT & 0xff;
+    hello[8] = (uint8_t) nameLength;
+    memcpy(hello + FLEET_HELLO_SIZE, hostName, nameLength);
+    pendingLength = FLEET_HELLO_SIZE + nameLength;
+}
+
+// send what is queued, as much as the socket takes now
+static void flush(void) {
+    ssize_t sent;
+
+    if (connecting) {
+        struct pollfd ready = {fd, POLLOUT, 0};
+        int error = 0;
+        socklen_t length = sizeof(error);
+
+        // writable once the connect finished, either way
+        if (poll(&ready, 1, 0) == 0) {
+            return;
+        }
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+            disconnect();
+            return;
+        }
+        connecting = 0;
+    }
+    while (pendingLength > 0) {
+        sent = send(fd, pending, pendingLength, SEND_FLAGS);
+        if (sent < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                disconnect();
+            }
+            return;
+        }
+        memmove(pending, pending + sent, pendingLength - (size_t) sent);
+        pendingLength -= (size_t) sent;
+    }
+}
+
+int fleet_agent_open(const char *address, const char *name) {
+    if (fleet_address_parse(address, 0, &target, &targetLength) != 0) {
+        return -1;
+    }
+    if (name == NULL) {
+        if (gethostname(hostName, sizeof(hostName)) != 0) {
+            strcpy(hostName, "unknown");
+        }
+        hostName[sizeof(hostName) - 1] = '\0';
+    } else {
+        snprintf(hostName, sizeof(hostName), "%s", name);
+    }
+    lastAttempt = 0;
+    reconnect();
+    return 0;
+}
+
+void fleet_agent_send(const struct snapshot *snap) {
+    uint8_t *frame;
+    size_t length;
+
+    if (fd < 0) {
+        if (now_ns() - lastAttempt < RECONNECT_NS) {
+            return;
+        }
+        reconnect();
+        if (fd < 0) {
+            return;
+        }
+    }
+    // a sample that does not fit means the aggregator fell behind, start over later
+    if (pendingLength + 2 + RECORDING_SAMPLE_MAX > sizeof(pending)) {
+        disconnect();
+        return;
+    }
+    frame = pending + pendingLength;
+    length = recording_encode_sample(&stream, snap, frame + 2);
+    frame[0] = (uint8_t) (length >> 8);
+    frame[1] = (uint8_t) length;
+    pendingLength += 2 + length;
+    flush();
+}
+
+void fleet_agent_close(void) {
+    if (fd >= 0 && !connecting) {
+        flush();
+    }
+    disconnect();
+}
@@ -0,0 +1,357 @@
+//
+// Fleet aggregator, see fleet.h. One poll loop on its own thread reads every agent; the
+// table figures of each host sit in a flat array that the UI thread copies under a
+// mutex once per frame.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/un.h>
+
+#include "fleet.h"
+#include "recording.h"
+
+#define READ_BUFFER_SIZE 4096
+
+struct agent {
+    int fd;
+    int host;                   // index in hosts, -1 until the hello arrived
+    size_t received;
+    struct recording_stream stream;
+    uint8_t buffer[READ_BUFFER_SIZE];
+};
+
+static pthread_t thread;
+static pthread_mutex_t hostsLock = PTHREAD_MUTEX_INITIALIZER;
+static int listenFd = -1;
+static int stopPipe[2] = {-1, -1};
+static char unixPath[108];
+static struct agent agents[FLEET_MAX_HOSTS];
+static struct fleet_host hosts[FLEET_MAX_HOSTS];
+// agent whose connection a host row belongs to: the latest one to say hello under its name
+static struct agent *owners[FLEET_MAX_HOSTS];
+static int hostCount = 0;
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+static void drop_agent(struct agent *agent) {
+    // an agent that reconnected before its old connection was noticed dead keeps its row up
+    if (agent->host >= 0 && owners[agent->host] == agent) {
+        pthread_mutex_lock(&hostsLock);
+        hosts[agent->host].connected = 0;
+        owners[agent->host] = NULL;
+        pthread_mutex_unlock(&hostsLock);
+    }
+    close(agent->fd);
+    agent->fd = -1;
+}
+
+static void accept_agents(void) {
+    for (;;) {
+        int fd = accept(listenFd, NULL, NULL);
+        struct agent *agent = NULL;
+
+        if (fd < 0) {
+            return;
+        }
+        for (int i = 0; i < FLEET_MAX_HOSTS && agent == NULL; i++) {
+            if (agents[i].fd < 0) {
+                agent = &agents[i];
+            }
+        }
+        if (agent == NULL || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+            close(fd);
+            continue;
+        }
+        agent->fd = fd;
+        agent->host = -1;
+        agent->received = 0;
+        memset(&agent->stream, 0, sizeof(agent->stream));
+    }
+}
+
+// slot of the host called name, a reconnecting agent gets its old row back and owns it
+static int find_host(struct agent *agent, const char *name) {
+    int found = -1;
+
+    pthread_mutex_lock(&hostsLock);
+    for (int i = 0; i < hostCount && found < 0; i++) {
+        if (strcmp(hosts[i].name, name) == 0) {
+            found = i;
+        }
+    }
+    if (found < 0 && hostCount < FLEET_MAX_HOSTS) {
+        found = hostCount++;
+        memset(&hosts[found], 0, sizeof(struct fleet_host));
+        strcpy(hosts[found].name, name);
+    }
+    if (found >= 0) {
+        hosts[found].connected = 1;
+        owners[found] = agent;
+    }
+    pthread_mutex_unlock(&hostsLock);
+    return found;
+}
+
+// the figures of the fleet table out of a sample
+static void summarize(struct fleet_host *host, const struct snapshot *snap) {
+    host->valid = snap->valid;
+    host->cpuTemp = snap->cpuTemp;
+    host->gpuTemp = snap->gpuTemp;
+    host->load = snap->loadAverage[0];
+    host->memUsed = snap->memUsed;
+    host->memTotal = snap->memTotal;
+    host->diskFree = snap->diskFree;
+    host->diskTotal = snap->diskTotal;
+    host->fanSpeed = 0;
+    for (int i = 0; i < snap->fanCount && i < SNAPSHOT_MAX_FANS; i++) {
+        if (snap->fanSpeed[i] > host->fanSpeed) {
+            host->fanSpeed = snap->fanSpeed[i];
+        }
+    }
+}
+
+// bytes of the first complete message in the buffer, 0 when it is still incomplete and
+// -1 when the agent does not speak the protocol
+static long parse_message(struct agent *agent) {
+    const uint8_t *in = agent->buffer;
+    size_t length;
+
+    if (agent->host < 0) {
+        char name[FLEET_NAME_LENGTH];
+
+        if (agent->received < FLEET_HELLO_SIZE) {
+            return 0;
+        }
+        if (memcmp(in, FLEET_MAGIC, 4) != 0 || (in[4] << 8 | in[5]) != FLEET_VERSION ||
+            (in[6] << 8 | in[7]) != REC_COLUMN_COUNT || in[8] == 0 || in[8] >= FLEET_NAME_LENGTH) {
+            return -1;
+        }
+        length = FLEET_HELLO_SIZE + in[8];
+        if (agent->received < length) {
+            return 0;
+        }
+        memcpy(name, in + FLEET_HELLO_SIZE, in[8]);
+        name[in[8]] = '\0';
+        agent->host = find_host(agent, name);
+        return agent->host >= 0 ? (long) length : -1;
+    }
+
+    if (agent->received < 2) {
+        return 0;
+    }
+    length = (size_t) (in[0] << 8 | in[1]);
+    if (length > RECORDING_SAMPLE_MAX) {
+        return -1;
+    }
+    if (agent->received < 2 + length) {
+        return 0;
+    }
+    struct snapshot snap;
+    if (recording_decode_sample(&agent->stream, in + 2, length, &snap) != 0) {
+        return -1;
+    }
+    // a connection replaced by a newer one of the same host is only read until it closes
+    if (owners[agent->host] == agent) {
+        pthread_mutex_lock(&hostsLock);
+        summarize(&hosts[agent->host], &snap);
+        hosts[agent->host].lastSeen = now_ns();
+        hosts[agent->host].samples++;
+        pthread_mutex_unlock(&hostsLock);
+    }
+    return (long) (2 + length);
+}
+
+static void read_agent(struct agent *agent) {
+    ssize_t length = read(agent->fd, agent->buffer + agent->received, READ_BUFFER_SIZE - agent->received);
+    size_t consumed = 0;
+
+    if (length <= 0) {
+        if (length == 0 || (errno != EAGAIN && errno != EINTR)) {
+            drop_agent(agent);
+        }
+        return;
+    }
+    agent->received += (size_t) length;
+    for (;;) {
+        long used;
+
+        memmove(agent->buffer, agent->buffer + consumed, agent->received - consumed);
+        agent->received -= consumed;
+        used = parse_message(agent);
+        if (used < 0) {
+            drop_agent(agent);
+            return;
+        }
+        if (used == 0) {
+            return;
+        }
+        consumed = (size_t) used;
+    }
+}
+
+static void *serve(void *arg) {
+    static struct pollfd fds[FLEET_MAX_HOSTS + 2];
+    static int owner[FLEET_MAX_HOSTS + 2];
+
+    for (;;) {
+        nfds_t count = 0;
+
+        fds[count++] = (struct pollfd) {stopPipe[0], POLLIN, 0};
+        fds[count++] = (struct pollfd) {listenFd, POLLIN, 0};
+        for (int i = 0; i < FLEET_MAX_HOSTS; i++) {
+            if (agents[i].fd >= 0) {
+                owner[count] = i;
+                fds[count++] = (struct pollfd) {agents[i].fd, POLLIN, 0};
+            }
+        }
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+        for (nfds_t i = 2; i < count; i++) {
+            if (fds[i].revents & (POLLERR | POLLNVAL)) {
+                drop_agent(&agents[owner[i]]);
+            } else if (fds[i].revents & (POLLIN | POLLHUP)) {
+                read_agent(&agents[owner[i]]);
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            accept_agents();
+        }
+    }
+    return NULL;
+}
+
+int fleet_aggregator_start(const char *address) {
+    struct sockaddr_storage addr;
+    socklen_t length;
+    int yes = 1;
+
+    hostCount = 0;
+    for (int i = 0; i < FLEET_MAX_HOSTS; i++) {
+        agents[i].fd = -1;
+        owners[i] = NULL;
+    }
+    if (fleet_address_parse(address, 1, &addr, &length) != 0) {
+        return -1;
+    }
+    listenFd = socket(addr.ss_family, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        return -1;
+    }
+    unixPath[0] = '\0';
+    if (addr.ss_family == AF_UNIX) {
+        // a socket file left by an earlier run would make bind fail
+        snprintf(unixPath, sizeof(unixPath), "%s", ((struct sockaddr_un *) &addr)->sun_path);
+        unlink(unixPath);
+    } else {
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    }
+    if (bind(listenFd, (struct sockaddr *) &addr, length) != 0 || listen(listenFd, 512) != 0 ||
+        fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK) != 0 || pipe(stopPipe) != 0) {
+        close(listenFd);
+        listenFd = -1;
+        return -1;
+    }
+    // signals stay with the UI thread
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    int created = pthread_create(&thread, NULL, serve, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (created != 0) {
+        close(listenFd);
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+        listenFd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int fleet_aggregator_hosts(struct fleet_host *out, int capacity) {
+    int count;
+
+    pthread_mutex_lock(&hostsLock);
+    count = hostCount < capacity ? hostCount : capacity;
+    memcpy(out, hosts, (size_t) count * sizeof(struct fleet_host));
+    pthread_mutex_unlock(&hostsLock);
+    return count;
+}
+
+void fleet_aggregator_stop(void) {
+    if (listenFd < 0) {
+        return;
+    }
+    if (write(stopPipe[1], "", 1) < 0) {
+        perror("could not stop the aggregator");
+    }
+    pthread_join(thread, NULL);
+    for (int i = 0; i < FLEET_MAX_HOSTS; i++) {
+        if (agents[i].fd >= 0) {
+            drop_agent(&agents[i]);
+        }
+    }
+    close(listenFd);
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    listenFd = -1;
+    if (unixPath[0] != '\0') {
+        unlink(unixPath);
+    }
+}
+
+static double used_share(double used, double total) {
+    return total > 0 ? used / total : 0;
+}
+
+// how a host ranks under sort, larger first
+static double sort_key(const struct fleet_host *host, enum fleet_sort sort) {
+    switch (sort) {
+        case FLEET_SORT_CPU_TEMP:
+            return host->valid & SNAP_CPU_TEMP ? host->cpuTemp : -1;
+        case FLEET_SORT_LOAD:
+            return host->valid & SNAP_LOAD ? host->load : -1;
+        case FLEET_SORT_MEMORY:
+            return host->valid & SNAP_MEM ? used_share(host->memUsed, host->memTotal) : -1;
+        case FLEET_SORT_DISK:
+            return host->valid & SNAP_DISK ? used_share(host->diskTotal - host->diskFree, host->diskTotal) : -1;
+        default:
+            return 0;
+    }
+}
+
+static enum fleet_sort currentSort;
+
+static int compare_hosts(const void *a, const void *b) {
+    const struct fleet_host *left = a, *right = b;
+    double leftKey = sort_key(left, currentSort), rightKey = sort_key(right, currentSort);
+
+    if (leftKey != rightKey) {
+        return leftKey < rightKey ? 1 : -1;
+    }
+    return strcmp(left->name, right->name);
+}
+
+void fleet_sort_hosts(struct fleet_host *list, int count, enum fleet_sort sort) {
+    currentSort = sort;
+    qsort(list, (size_t) count, sizeof(struct fleet_host), compare_hosts);
+}
@@ -3,22 +3,24 @@
 //
 
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
-#include <sys/statvfs.h>
-#include <mach/vm_statistics.h>
-#include <mach/mach_types.h>
-#include <mach/mach_init.h>
-#include <mach/mach_host.h>
-#include <sys/types.h>
-#include <sys/sysctl.h>
-#include <curses.h>
+#include <signal.h>
+#include <time.h>
+#include <stdlib.h>
+#include <math.h>
 
 #include "infoCollector.h"
-#include "systemManagementController.h"
-
-#define Byte_TO_GB (1024.0 * 1024 * 1024)
-#define WARNING_WHEN_HIGH 0
-#define WARNING_WHEN_LOW 1
+#include "scheduler.h"
+#include "metricsServer.h"
+#include "recording.h"
+#include "workerPool.h"
+#include "alerts.h"
+#include "selfStats.h"
+#include "eventLoop.h"
+#include "fleet.h"
+#include "shmPublisher.h"
+#include "fanControl.h"
 
 // marco for debug print
 #define DEBUG
@@ -29,315 +31,683 @@
 #define DEBUG_PRINT(fmt, args...)    /* Don't do anything in release builds */
 #endif
 
-static volatile int keepRunning = 1;
+static int keepRunning = 1;
 
-void intHandler(int nothing) {
-    keepRunning = 0;
+static const struct backend *backends[] = {
+#ifdef __APPLE__
+        &mac_backend,
+#endif
+#ifdef __linux__
+        &linux_backend,
+#endif
+        &synthetic_backend,
+        &thermal_backend,
+        &replay_backend,
+};
+
+static const struct renderer *renderers[] = {
+#ifdef WITH_CURSES
+        &curses_renderer,
+#endif
+        &text_renderer,
+        &json_renderer,
+        &stream_renderer,
+        &null_renderer,
+};
+
+const struct backend *backend_find(const char *name) {
+    if (name == NULL) {
+        return backends[0];
+    }
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        if (strcmp(backends[i]->name, name) == 0) {
+            return backends[i];
+        }
+    }
+    return NULL;
 }
 
-double get_total_disk_size() {
-    struct statvfs buf;
-
-    // get current file system's stats
-    if (statvfs("/", &buf) != 0) {
-        perror("statvfs failed");
+const struct renderer *renderer_find(const char *name) {
+    if (name == NULL) {
+        return renderers[0];
     }
+    for (size_t i = 0; i < sizeof(renderers) / sizeof(renderers[0]); i++) {
+        if (strcmp(renderers[i]->name, name) == 0) {
+            return renderers[i];
+        }
+    }
+    return NULL;
+}
 
-    // size = block size * block numbers
-    double totalSize = buf.f_frsize * buf.f_blocks / Byte_TO_GB;
-    return totalSize;
+static uint64_t wall_clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t) now.tv_sec * NSEC_PER_SEC + (uint64_t) now.tv_nsec;
 }
 
-double get_free_disk_size() {
-    struct statvfs buf;
+void collect(const struct backend *backend, int flag, struct snapshot *snap) {
+    memset(snap, 0, sizeof(struct snapshot));
+    snap->timestamp = wall_clock_ns();
+    backend->sample(flag, snap);
+}
 
-    if (statvfs("/", &buf) != 0) {
-        perror("statvfs failed");
+// every section is sampled on its own period, slow sources like the battery far less often
+static const struct section {
+    const char *name;
+    int flag;
+    uint32_t bits;
+    unsigned int periodMs;
+} sections[SECTION_COUNT] = {
+        {"cpu",     _CPU_TEMP,       SNAP_CPU_TEMP,                  100},
+        {"fan",     _FAN_STATUS,     SNAP_FANS,                      500},
+        {"gpu",     _GPU_STATUS,     SNAP_GPU_TEMP,                  100},
+        {"mem",     _MEM_STATUS,     SNAP_MEM | SNAP_MEM_TEMP | SNAP_MEM_DETAIL | SNAP_MEM_RATES, 1000},
+        {"disk",    _DISK_STATUS,    SNAP_DISK | SNAP_DISK_IO,       2000},
+        {"battery", _BATTERY_STATUS, SNAP_BATTERY | SNAP_BATTERY_TEMP, 60000},
+        // tick counters advance 100 times a second, shorter windows would show 10% steps
+        {"load",    _CPU_USAGE,      SNAP_CPU_USAGE | SNAP_LOAD,     1000},
+        {"processes", _PROCESSES,    SNAP_PROCESSES,                 2000},
+};
+
+void engine_default_options(struct engine_options *options) {
+    memset(options, 0, sizeof(struct engine_options));
+    options->updateInterval = 1.0;
+    options->backend = backend_find(NULL);
+    options->renderer = renderer_find(NULL);
+    options->historyLength = 1024;
+    options->statsWindow = 60;
+    options->ewmaAlpha = 0.2;
+    options->staleMs = 2000;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        options->periodMs[i] = sections[i].periodMs;
     }
-    double freeSize = buf.f_frsize * buf.f_bfree / Byte_TO_GB;
-    return freeSize;
 }
 
-double get_mem_used() {
-    vm_size_t pageSize;
-    mach_port_t machPort;
-    mach_msg_type_number_t count;
-    vm_statistics64_data_t vmStats;
+int engine_set_period(struct engine_options *options, const char *spec) {
+    const char *equals = strchr(spec, '=');
+    char *end;
 
-    machPort = mach_host_self();
-    count = sizeof(vmStats) / sizeof(natural_t);
-    if (KERN_SUCCESS == host_page_size(machPort, &pageSize) &&
-        KERN_SUCCESS == host_statistics64(machPort, HOST_VM_INFO, (host_info64_t) &vmStats, &count)) {
-        // used memory = page size * (active + inactive + wired)
-        // note that on Mac inactive mem is still used
-        long long usedMemory = ((int64_t) vmStats.active_count + (int64_t) vmStats.inactive_count +
-                                (int64_t) vmStats.wire_count) * (int64_t) pageSize;
-        return (usedMemory / Byte_TO_GB);
+    if (equals == NULL) {
+        return -1;
     }
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (strlen(sections[i].name) == (size_t) (equals - spec) &&
+            strncmp(sections[i].name, spec, (size_t) (equals - spec)) == 0) {
+            unsigned long period = strtoul(equals + 1, &end, 10);
+            if (period == 0 || *end != '\0') {
+                return -1;
+            }
+            options->periodMs[i] = (unsigned int) period;
+            return 0;
+        }
+    }
+    return -1;
+}
 
-    return 0;
+static struct snapshot_ring history;
+static int historyReady = 0;
+
+const struct snapshot_ring *engine_history(void) {
+    return historyReady ? &history : NULL;
 }
 
-// use sysctl to get total memory
-// this is platform based, other ways to get it include /proc/stat, sysconfig
-int get_total_memory() {
-    int mib[2];
-    int64_t memSize;
-    mib[0] = CTL_HW;
-    mib[1] = HW_MEMSIZE;
-    size_t length = sizeof(int64_t);
-    sysctl(mib, 2, &memSize, &length, NULL, 0);
-
-    return (int) (memSize / Byte_TO_GB);
+// state of the running engine, shared by the scheduled tasks of the UI thread
+static const struct engine_options *engine;
+// sections shown, hotkeys 1 to 8 toggle them among those collected
+static int displayFlag;
+static int paused;
+static struct snapshot current;
+static struct metric_stats stats;
+
+// a section as run by its collector thread. The collector samples into its own snapshot
+// and publishes it through a two slot ring, the UI thread merges whatever is newest.
+static struct section_state {
+    const struct section *section;
+    struct sched_task task;
+    struct snapshot sampled;                // owned by the collector
+    struct snapshot_ring published;         // collector writes, UI thread reads
+    atomic_uint_fast64_t busySince;         // monotonic ns the running sample started, 0 when idle
+    uint64_t merged;                        // UI thread: publications merged so far
+    struct latency_histogram latency;       // of every backend sample
+} states[SECTION_COUNT];
+
+static struct worker_pool workers;
+
+// nonzero when a metric in bits appeared, vanished or moved by more than 1%
+static int section_changed(const struct snapshot *before, const struct snapshot *after, uint32_t bits) {
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        double old, new;
+        int hadOld, hasNew;
+
+        if (!(metric_valid_bit(i) & bits)) {
+            continue;
+        }
+        hadOld = snapshot_metric(before, i, &old);
+        hasNew = snapshot_metric(after, i, &new);
+        if (hadOld != hasNew) {
+            return 1;
+        }
+        if (hasNew && fabs(new - old) > 0.01 * fmax(fabs(old), 1.0)) {
+            return 1;
+        }
+    }
+    return 0;
 }
 
-#define GREEN_BLACK 1
-#define YELLOW_BLACK 2
-#define RED_BLACK 3
-#define CYAN_BLACK 4
-#define BLUE_BLACK 5
-
-void init_color_pair() {
-    init_pair(GREEN_BLACK, COLOR_GREEN, COLOR_BLACK);
-    init_pair(YELLOW_BLACK, COLOR_YELLOW, COLOR_BLACK);
-    init_pair(RED_BLACK, COLOR_RED, COLOR_BLACK);
-    init_pair(CYAN_BLACK, COLOR_CYAN, COLOR_BLACK);
-    init_pair(BLUE_BLACK, COLOR_BLUE, COLOR_BLACK);
+// runs on the collector thread of the section
+static int sample_section(void *arg) {
+    struct section_state *state = arg;
+    const struct section *section = state->section;
+    struct snapshot before = state->sampled;
+
+    uint64_t start = monotonic_clock.now(NULL);
+
+    atomic_store(&state->busySince, start);
+    // bits are cleared first so a source that disappears is not reported from old values
+    state->sampled.valid &= ~section->bits;
+    // stamped before sampling so a replayed recording can keep its own time
+    state->sampled.timestamp = wall_clock_ns();
+    engine->backend->sample(section->flag, &state->sampled);
+    atomic_store(&state->busySince, 0);
+    latency_record(&state->latency, monotonic_clock.now(NULL) - start);
+
+    snapshot_ring_push(&state->published, &state->sampled);
+    return section_changed(&before, &state->sampled, section->bits);
 }
 
-#define BAR_FILLING "||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||"
-#define BAR_WIDTH 10
+// fold the newest sample of every section into current, record it and mark hung collectors
+static int merge_sections(void *arg) {
+    uint64_t now = monotonic_clock.now(NULL);
+    uint64_t timeout = engine->staleMs * NSEC_PER_MSEC;
+    struct snapshot sample;
+    int merged = 0;
 
-// print a percentage bar
-void printPercent(double percentage) {
-    int leftFilling = (int) (percentage * BAR_WIDTH);
-    int rightFilling = BAR_WIDTH - leftFilling;
-    printw(" [%.*s%*s]", leftFilling, BAR_FILLING, rightFilling, "");
+    current.stale = 0;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        struct section_state *state = &states[i];
+        uint64_t head, busySince;
+
+        if (state->section == NULL) {
+            continue;
+        }
+        busySince = atomic_load(&state->busySince);
+        if (busySince != 0 && now > busySince + timeout) {
+            current.stale |= state->section->bits;
+        }
+        head = snapshot_ring_head(&state->published);
+        if (head == state->merged || snapshot_ring_latest(&state->published, &sample, &head) != 0) {
+            continue;
+        }
+        state->merged = head + 1;
+        snapshot_merge(&current, &sample, state->section->bits);
+        current.timestamp = sample.timestamp;
+        snapshot_ring_push(&history, &current);
+        metric_stats_update(&stats, &current, state->section->bits);
+        merged = 1;
+    }
+    if (merged && engine->alertsPath != NULL) {
+        alerts_evaluate(&current);
+    }
+    return 1;
 }
 
+static struct latency_histogram renderLatency;
+static uint64_t frames = 0;
 
-void print_seperation(int *row, char *title) {
-    move((*row)++, 0);
-    attron(COLOR_PAIR(CYAN_BLACK));
-    printw("--- %s ---", title);
-    attroff(COLOR_PAIR(CYAN_BLACK));
-    move((*row)++, 0);
+static int render_tick(void *arg) {
+    uint64_t start = monotonic_clock.now(NULL);
+
+    merge_sections(NULL);
+    if (paused) {
+        return 1;
+    }
+    engine->renderer->render(&current, &stats, displayFlag);
+    latency_record(&renderLatency, monotonic_clock.now(NULL) - start);
+    frames++;
+    return 1;
 }
 
+// own usage at start and at the last self_tick, rates are taken between the two last ones
+static struct self_usage startUsage, lastUsage;
+static uint64_t startTime, lastTime, startSmcCalls, lastSmcCalls;
 
-void print_temperature(char *title, int *row, double temperature) {
-    int colorIdx;
+static int self_tick(void *arg) {
+    struct self_usage usage;
+    uint64_t now = monotonic_clock.now(NULL), smcCalls = self_stats_smc_calls();
+    double seconds = (now - lastTime) / (double) NSEC_PER_SEC;
 
-    if (temperature < 40) {
-        colorIdx = GREEN_BLACK;
-    } else if (temperature >= 40 && temperature < 60) {
-        colorIdx = YELLOW_BLACK;
-    } else {
-        colorIdx = RED_BLACK;
+    // a shorter interval is mostly the start up
+    if (seconds < 0.5 || self_usage_read(&usage) != 0) {
+        return 1;
     }
+    current.selfCpu = (usage.cpuSeconds - lastUsage.cpuSeconds) * 100.0 / seconds;
+    current.selfRss = usage.rssMB;
+    current.selfSyscalls = (double) (usage.syscalls - lastUsage.syscalls) / seconds;
+    current.selfSmcCalls = (double) (smcCalls - lastSmcCalls) / seconds;
+    current.valid |= SNAP_SELF;
+    metric_stats_update(&stats, &current, SNAP_SELF);
+    lastUsage = usage;
+    lastTime = now;
+    lastSmcCalls = smcCalls;
+    return 1;
+}
 
-    attron(COLOR_PAIR(colorIdx));
-    printw("%s: ", title);
-    printw("%.2f °C", temperature);
-    attroff(COLOR_PAIR(colorIdx));
-    move((*row)++, 0);
+static void self_stats_begin(void) {
+    memset(&renderLatency, 0, sizeof(renderLatency));
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        memset(&states[i].latency, 0, sizeof(states[i].latency));
+    }
+    frames = 0;
+    self_usage_read(&startUsage);
+    lastUsage = startUsage;
+    startTime = lastTime = monotonic_clock.now(NULL);
+    startSmcCalls = lastSmcCalls = self_stats_smc_calls();
 }
 
+// what the engine cost since it started, overall and per collector
+static void self_stats_dump(FILE *out) {
+    struct self_usage usage;
+    double seconds = (monotonic_clock.now(NULL) - startTime) / (double) NSEC_PER_SEC;
+    double perFrame = frames > 0 ? 1.0 / (double) frames : 0.0;
 
-void print_usage(char *title, char *unit, double numerator, double denominator, int *row, int warningType) {
-    // choose different warning type, if WARNING_WHEN_HIGH then use red color for usage above 75%
-    // select color according to percentage
-    int colorIdx = 1;
-    double percentage = numerator / denominator;
-    if (percentage < 0.5) {
-        if (warningType == WARNING_WHEN_HIGH) {
-            colorIdx = GREEN_BLACK;
-        } else {
-            colorIdx = RED_BLACK;
-        }
-    }
-    if (percentage >= 0.5 && percentage < 0.75) {
-        colorIdx = YELLOW_BLACK;
+    if (self_usage_read(&usage) != 0 || !(seconds > 0)) {
+        return;
     }
-    if (percentage >= 0.75) {
-        if (warningType == WARNING_WHEN_HIGH) {
-            colorIdx = RED_BLACK;
-        } else {
-            colorIdx = GREEN_BLACK;
+    fprintf(out, "macResMon self stats over %.1f s, %llu frames\n", seconds, (unsigned long long) frames);
+    fprintf(out, "cpu %.4f%% of one core, rss %.1f MB\n",
+            (usage.cpuSeconds - startUsage.cpuSeconds) * 100.0 / seconds, usage.rssMB);
+    fprintf(out, "per frame: %.1f syscalls, %.1f SMC calls\n",
+            (double) (usage.syscalls - startUsage.syscalls) * perFrame,
+            (double) (self_stats_smc_calls() - startSmcCalls) * perFrame);
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (states[i].section != NULL) {
+            latency_print(out, states[i].section->name, &states[i].latency);
         }
     }
+    latency_print(out, "render", &renderLatency);
+    fan_control_dump(out);
+    fflush(out);
+}
 
-        attron(COLOR_PAIR(colorIdx));
-        printw("%s: %.2f %s", title, numerator, unit);
-        printPercent(percentage);
-        attroff(COLOR_PAIR(colorIdx));
-
-    move((*row)++, 0);
+static struct recording_writer recorder;
 
+static int record_tick(void *arg) {
+    if (recording_append(&recorder, &current) != 0) {
+        perror("could not write the recording");
+    }
+    return 1;
+}
 
+static int agent_tick(void *arg) {
+    fleet_agent_send(&current);
+    return 1;
 }
 
-void show_disk_status(int *row) {
-    print_seperation(row, "Disk Status");
-    double totalDiskSize = get_total_disk_size();
-    double freeDiskSize = get_free_disk_size();
-    printw("Total Disk Size: %.2f GB", totalDiskSize);
-    move((*row)++, 0);
-    print_usage("Used Disk Space", "GB", totalDiskSize - freeDiskSize, totalDiskSize, row, WARNING_WHEN_HIGH);
+static int shm_tick(void *arg) {
+    shm_publisher_publish(&current);
+    return 1;
 }
 
-int sparkleController = 1;
-void show_CPU_status(int *row) {
-    print_seperation(row, "CPU Status");
-    double cpuTemperautre = SMC_get_temperature(CPU_0_PROXIMITY);
-    if (sparkleController) {
-        print_temperature("CPU temp", row, cpuTemperautre);
-    } else {
-        move((*row)++, 0);
+// collector thread of each section: slow sources get a thread of their own
+static const char *section_worker(const struct section *section) {
+    switch (section->flag) {
+        case _DISK_STATUS:
+            return "disk";
+        case _BATTERY_STATUS:
+            return "power";
+        case _MEM_STATUS:
+        case _CPU_USAGE:
+            return "system";
+        case _PROCESSES:
+            return "processes";
+        default:
+            return "sensors";
     }
+}
 
-    // make cpu temp sparkle if it is above 70 degree
-    if (cpuTemperautre >= 70) {
-        sparkleController = !sparkleController;
-    } else {
-        sparkleController = 1;
+// give the collectors a moment so the first frame is not empty, a hung one is not waited for
+static void wait_first_samples(unsigned int timeoutMs) {
+    struct timespec step = {0, (long) NSEC_PER_MSEC};
+
+    for (unsigned int waited = 0; waited < timeoutMs; waited++) {
+        int missing = 0;
+        for (int i = 0; i < SECTION_COUNT; i++) {
+            missing |= states[i].section != NULL && snapshot_ring_head(&states[i].published) == 0;
+        }
+        if (!missing) {
+            return;
+        }
+        nanosleep(&step, NULL);
     }
 }
 
-void show_fan_status(int *row) {
-    int fan_num = SMC_get_fan_num();
-    // for machines such as Macbook which doesn't have any built-in fan
-    if (fan_num == 0) {
-        return;
+static int start_collectors(const struct engine_options *options) {
+    if (worker_pool_init(&workers, options->adaptive) != 0) {
+        return -1;
     }
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        struct section_state *state = &states[i];
+        struct scheduler *sched;
+
+        memset(&state->sampled, 0, sizeof(state->sampled));
+        state->section = NULL;
+        state->merged = 0;
+        atomic_init(&state->busySince, 0);
+        if (!(options->flag & sections[i].flag)) {
+            continue;
+        }
+        sched = worker_pool_scheduler(&workers, section_worker(&sections[i]));
+        if (sched == NULL || snapshot_ring_init(&state->published, 2) != 0) {
+            return -1;
+        }
+        state->section = &sections[i];
+        state->task = (struct sched_task) {.name = sections[i].name, .period = options->periodMs[i] * NSEC_PER_MSEC,
+                                           .run = sample_section, .arg = state};
+        scheduler_add(sched, &state->task);
+    }
+    return worker_pool_start(&workers);
+}
 
-    print_seperation(row, "Fan Status");
-
-    double maxFanSpeed = SMC_get_fan_speed(FAN_0_MAX_RPM);
-    printw("Max Fan Speed: %.0f rpm", maxFanSpeed);
-    move((*row)++, 0);
-
-    printw("Installed Fans: %d", fan_num);
-    move((*row)++, 0);
-
-    double fanSpeeds[fan_num];
-    SMC_get_fan_speeds(fan_num, fanSpeeds);
-    char blockName[12] = "Fan   Speed";
+// returns nonzero when a collector was left behind still inside the backend
+static int stop_collectors(const struct engine_options *options) {
+    int abandoned = worker_pool_stop(&workers, options->staleMs);
 
-    // print each fan
-    for (int i = 0; i < fan_num; ++i) {
-        blockName[4] = i + 48;
-        print_usage(blockName, "rpm", fanSpeeds[i], maxFanSpeed, row, WARNING_WHEN_HIGH);
+    for (int i = 0; i < SECTION_COUNT && abandoned == 0; i++) {
+        if (states[i].section != NULL) {
+            snapshot_ring_free(&states[i].published);
+            states[i].section = NULL;
+        }
     }
+    return abandoned;
 }
 
-void show_mem_status(int *row) {
-    print_seperation(row, "Memory Status");
-    int total_mem = get_total_memory();
-    printw("Installed Mem: %d GB", total_mem);
-    move((*row)++, 0);
-
-    double memTemperature = SMC_get_temperature(MEMORY_SLOTS_PROXIMITY);
-    print_temperature("Mem Temp: ", row, memTemperature);
+// hotkeys: q quits, p or space pauses the display, + and - halve and double the refresh
+// interval, 1 to 8 toggle the sections in the order of their flags
+static void handle_key(int key, struct scheduler *sched, struct sched_task *renderTask) {
+    if (key == 'q' || key == 'Q') {
+        keepRunning = 0;
+    } else if (key == 'p' || key == ' ') {
+        paused = !paused;
+    } else if (key == '+' || key == '=') {
+        if (renderTask->period / 2 >= NSEC_PER_MSEC) {
+            scheduler_set_period(sched, renderTask, renderTask->period / 2);
+        }
+    } else if (key == '-') {
+        if (renderTask->period * 2 <= 3600 * NSEC_PER_SEC) {
+            scheduler_set_period(sched, renderTask, renderTask->period * 2);
+        }
+    } else if (key >= '1' && key <= '8') {
+        // only sections that are collected can be shown
+        displayFlag ^= (1 << (key - '1')) & engine->flag;
+        scheduler_set_period(sched, renderTask, renderTask->period);
+    }
+}
 
-    double used_mem = get_mem_used();
-    print_usage("Memory Usage", "GB", used_mem, total_mem, row, WARNING_WHEN_HIGH);
+static void handle_event(const struct event *event, struct scheduler *sched, struct sched_task *renderTask) {
+    switch (event->type) {
+        case EVENT_QUIT:
+            keepRunning = 0;
+            break;
+        case EVENT_RESIZE:
+            if (engine->renderer->resize != NULL) {
+                engine->renderer->resize();
+                // redrawn at the new size now instead of at the next tick
+                scheduler_set_period(sched, renderTask, renderTask->period);
+            }
+            break;
+        case EVENT_DUMP:
+            self_stats_dump(stderr);
+            break;
+        case EVENT_KEY:
+            handle_key(event->key, sched, renderTask);
+            break;
+    }
 }
 
-void show_GPU_status(int *row) {
-    print_seperation(row, "GPU Status");
+// the publishers are opened before anything else, so every way out of show() closes them
+static void close_publishers(const struct engine_options *options) {
+    if (options->agentAddress != NULL) {
+        fleet_agent_close();
+    }
+    if (options->shmName != NULL) {
+        shm_publisher_close();
+    }
+}
 
-    double gpuTemperautre = SMC_get_temperature(GPU_0_PROXIMITY);
-    print_temperature("GPU Temp: ", row, gpuTemperautre);
+// show() giving up before the loop, after the history was allocated
+static void abandon_show(const struct engine_options *options) {
+    close_publishers(options);
+    metric_stats_free(&stats);
+    snapshot_ring_free(&history);
 }
 
-void show_battery_status(int *row) {
-    // for machines such as iMac which does not have a built-in battery
-    if (!hasBattery()) {
+void show(const struct engine_options *options) {
+    const struct backend *backend = options->backend;
+    const struct renderer *renderer = options->renderer;
+    struct sched_task renderTask = {.name = "render", .period = (uint64_t) (options->updateInterval * NSEC_PER_SEC),
+                                    .run = render_tick};
+    struct sched_task recordTask = {.name = "record", .period = renderTask.period, .run = record_tick};
+    struct sched_task mergeTask = {.name = "merge", .run = merge_sections};
+    struct sched_task selfTask = {.name = "self", .period = NSEC_PER_SEC, .run = self_tick};
+    struct sched_task agentTask = {.name = "agent", .period = renderTask.period, .run = agent_tick};
+    struct sched_task shmTask = {.name = "shm", .period = renderTask.period, .run = shm_tick};
+    struct scheduler sched;
+    struct event event;
+    int rendererOpen, fanControlFailed;
+
+    if (options->agentAddress != NULL && fleet_agent_open(options->agentAddress, options->agentName) != 0) {
+        fprintf(stderr, "bad aggregator address %s\n", options->agentAddress);
+        return;
+    }
+    if (options->shmName != NULL && shm_publisher_open(options->shmName) != 0) {
+        perror(options->shmName);
+        close_publishers(options);
+        return;
+    }
+    if (snapshot_ring_init(&history, options->historyLength) != 0 ||
+        metric_stats_init(&stats, options->statsWindow, options->ewmaAlpha) != 0) {
+        perror("could not allocate history");
+        abandon_show(options);
+        return;
+    }
+    if (backend->open(options->flag) != 0) {
+        perror("System not supported!");
+        abandon_show(options);
         return;
     }
+    if (options->servePort != 0 && metrics_server_start(options->servePort, &history) != 0) {
+        perror("could not serve metrics");
+        backend->close();
+        abandon_show(options);
+        return;
+    }
+    if (options->recordPath != NULL && recording_writer_open(&recorder, options->recordPath) != 0) {
+        perror("could not open the recording");
+        metrics_server_stop();
+        backend->close();
+        abandon_show(options);
+        return;
+    }
+    if (options->alertsPath != NULL && (alerts_load(options->alertsPath) < 0 || alerts_start() != 0)) {
+        fprintf(stderr, "could not load the alert rules of %s\n", options->alertsPath);
+        alerts_stop();
+        if (options->recordPath != NULL) {
+            recording_writer_close(&recorder);
+        }
+        metrics_server_stop();
+        backend->close();
+        abandon_show(options);
+        return;
+    }
+    engine = options;
+    memset(&current, 0, sizeof(current));
+    historyReady = 1;
+    if (start_collectors(options) != 0) {
+        perror("could not start the collectors");
+        keepRunning = 0;
+    } else {
+        wait_first_samples(options->staleMs < 500 ? options->staleMs : 500);
+    }
+    if (options->daemon) {
+        // there is no terminal to hang up
+        signal(SIGHUP, SIG_IGN);
+    }
+    rendererOpen = keepRunning && renderer->open() == 0;
+    if (!rendererOpen) {
+        keepRunning = 0;
+    }
 
-    print_seperation(row, "Battery Status");
+    // samples are merged as often as the fastest section produces them, so the history
+    // and the stats see every one of them even with a slow frame rate
+    mergeTask.period = renderTask.period;
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (states[i].section != NULL && states[i].task.period < mergeTask.period) {
+            mergeTask.period = states[i].task.period;
+        }
+    }
+    scheduler_init(&sched, &event_clock, 0);
+    scheduler_add(&sched, &renderTask);
+    scheduler_add(&sched, &mergeTask);
+    if (options->recordPath != NULL) {
+        scheduler_add(&sched, &recordTask);
+    }
+    if (options->agentAddress != NULL) {
+        scheduler_add(&sched, &agentTask);
+    }
+    if (options->shmName != NULL) {
+        scheduler_add(&sched, &shmTask);
+    }
+    scheduler_add(&sched, &selfTask);
+    self_stats_begin();
+
+    displayFlag = options->flag;
+    paused = 0;
+    // after the renderer set up the terminal, so its resize handling is replaced by ours
+    if (event_loop_open(renderer->resize != NULL) != 0) {
+        perror("could not set up the event loop");
+        keepRunning = 0;
+    }
+    // only once SIGINT and SIGTERM end the loop instead of the process, so the fans are
+    // always handed back; a failure is reported after the terminal is restored
+    fanControlFailed = keepRunning && options->fanControl != NULL && fan_control_start(options->fanControl) != 0;
+    if (fanControlFailed) {
+        keepRunning = 0;
+    }
 
-    int batteryPercentage = SMC_get_current_battery_percent();
-    if (SMC_is_battery_powered()) {
-        printw("Battery Charged!");
-        move(*row++, 0);
-    } else {
-        int batteryTime = SMC_get_time_remaining();
-        if (batteryTime == -1) {
-            // -1 indicates the system is calculating the time
-            printw("Time remaining: Calculating");
-            move(*row++, 0);
-        } else {
-            int hours = batteryTime / 60;
-            int mintues = batteryTime - hours * 60;
-            printw("Time remaining: %02d:%02d", hours, mintues);
-            move(*row++, 0);
+    while (keepRunning) {
+        scheduler_step(&sched);
+        while (keepRunning && event_loop_next(&event)) {
+            handle_event(&event, &sched, &renderTask);
         }
     }
-    print_usage("Battery Charge", "%", batteryPercentage, 100, row, WARNING_WHEN_LOW);
-    printw("\n");
-    double batteryTemperautre = SMC_get_temperature(BATTERY_0_TEMP);
-    print_temperature("Battery Temp", row, batteryTemperautre);
+    event_loop_close();
+    // the fans go back to the firmware first, whatever else is slow to stop
+    fan_control_stop();
+
+    historyReady = 0;
+    if (options->recordPath != NULL && recording_writer_close(&recorder) != 0) {
+        perror("could not write the recording");
+    }
+    metrics_server_stop();
+    if (options->alertsPath != NULL) {
+        alerts_stop();
+    }
+    close_publishers(options);
+    if (rendererOpen) {
+        renderer->close();
+    }
+    if (fanControlFailed) {
+        fprintf(stderr, "could not take over the fans of the %s backend\n", backend->name);
+    }
+    // after the screen is restored and while the sections are still known
+    if (options->selfStats) {
+        self_stats_dump(stderr);
+    }
+    // a collector stuck in the backend still uses it, leave it to the process exit
+    if (stop_collectors(options) == 0) {
+        backend->close();
+    } else {
+        fprintf(stderr, "a collector did not stop within %u ms\n", options->staleMs);
+    }
+    metric_stats_free(&stats);
+    snapshot_ring_free(&history);
 }
 
+static struct fleet_host fleetHosts[FLEET_MAX_HOSTS];
+static enum fleet_sort fleetSort;
 
-void show(int flag, unsigned int updateInterval) {
-    if (!systemSupported()) {
-        perror("System not supported!");
+static int fleet_tick(void *arg) {
+    int count = fleet_aggregator_hosts(fleetHosts, FLEET_MAX_HOSTS);
+
+    if (!paused) {
+        fleet_sort_hosts(fleetHosts, count, fleetSort);
+        engine->renderer->render_fleet(fleetHosts, count, fleetSort, monotonic_clock.now(NULL));
+    }
+    return 1;
+}
+
+// keys of the fleet view: the sort order, pause and quit
+static void handle_fleet_key(int key, struct scheduler *sched, struct sched_task *renderTask) {
+    static const char sortKeys[] = "nclmd";
+    const char *found = key != 0 ? strchr(sortKeys, key) : NULL;
+
+    if (key == 'q' || key == 'Q') {
+        keepRunning = 0;
+        return;
+    }
+    if (key == 'p' || key == ' ') {
+        paused = !paused;
+    } else if (found != NULL) {
+        fleetSort = (enum fleet_sort) (found - sortKeys);
+    } else {
         return;
     }
+    scheduler_set_period(sched, renderTask, renderTask->period);
+}
 
-    signal(SIGINT, intHandler);
+void show_fleet(const struct engine_options *options) {
+    const struct renderer *renderer = options->renderer;
+    struct sched_task renderTask = {.name = "fleet", .period = (uint64_t) (options->updateInterval * NSEC_PER_SEC),
+                                    .run = fleet_tick};
+    struct scheduler sched;
+    struct event event;
 
-    // set up window
-    WINDOW *wnd;
-    wnd = initscr();
-    cbreak();
-    noecho();
-    clear();
-    refresh();
-    start_color();
-    init_color_pair();
-    wbkgd(wnd, COLOR_PAIR(BLUE_BLACK));
-    SMC_open();
+    if (renderer->render_fleet == NULL) {
+        fprintf(stderr, "the %s renderer has no fleet view\n", renderer->name);
+        return;
+    }
+    if (fleet_aggregator_start(options->aggregateAddress) != 0) {
+        perror("could not listen for agents");
+        return;
+    }
+    if (renderer->open() != 0) {
+        fleet_aggregator_stop();
+        return;
+    }
+    engine = options;
+    paused = 0;
+    fleetSort = FLEET_SORT_NAME;
+    keepRunning = event_loop_open(renderer->resize != NULL) == 0;
+    if (options->daemon) {
+        signal(SIGHUP, SIG_IGN);
+    }
+    scheduler_init(&sched, &event_clock, 0);
+    scheduler_add(&sched, &renderTask);
 
-    // control which row to print onto
-    int row = 0;
     while (keepRunning) {
-        clear();
-
-        row = 0;
-        // DISK
-        if (flag & _DISK_STATUS) {
-            show_disk_status(&row);
-        }
-        // CPU
-        if (flag & _CPU_TEMP) {
-            show_CPU_status(&row);
+        scheduler_step(&sched);
+        while (keepRunning && event_loop_next(&event)) {
+            if (event.type == EVENT_QUIT) {
+                keepRunning = 0;
+            } else if (event.type == EVENT_RESIZE && renderer->resize != NULL) {
+                renderer->resize();
+                scheduler_set_period(&sched, &renderTask, renderTask.period);
+            } else if (event.type == EVENT_KEY) {
+                handle_fleet_key(event.key, &sched, &renderTask);
+            }
         }
-        // FAN
-        if (flag & _FAN_STATUS) {
-            show_fan_status(&row);
-        }
-        // Memory
-        if (flag & _MEM_STATUS) {
-            show_mem_status(&row);
-        }
-        // GPU
-        if (flag & _GPU_STATUS) {
-            show_GPU_status(&row);
-        }
-        // Battery charge
-        if (flag & _BATTERY_STATUS) {
-            show_battery_status(&row);
-        }
-
-        refresh();
-        sleep(updateInterval);
     }
-
-    SMC_close();
-    endwin();
-}
\ No newline at end of file
+    event_loop_close();
+    renderer->close();
+    fleet_aggregator_stop();
+}
@@ -5,6 +5,12 @@
 #ifndef FINALPROJECT_INFOCOLLECTOR_H
 #define FINALPROJECT_INFOCOLLECTOR_H
 
+#include "snapshot.h"
+#include "backend.h"
+#include "renderer.h"
+#include "snapshotRing.h"
+#include "fanControl.h"
+
 // marco for flag passed in
 #define _CPU_TEMP (0b1)
 #define _DISK_STATUS (0b10)
@@ -12,9 +18,54 @@
 #define _MEM_STATUS (0b1000)
 #define _GPU_STATUS (0b10000)
 #define _BATTERY_STATUS (0b100000)
+#define _CPU_USAGE (0b1000000)
+#define _PROCESSES (0b10000000)
+
+#define _VERBOSE (0B11111111)
+
+// take one timestamped sample of the sections in flag
+void collect(const struct backend *backend, int flag, struct snapshot *snap);
+
+// sections sampled on their own schedule: cpu, fan, gpu, mem, disk, battery, load, processes
+#define SECTION_COUNT 8
+
+struct engine_options {
+    int flag;
+    double updateInterval;          // seconds between frames
+    unsigned int periodMs[SECTION_COUNT];   // sampling period of each section
+    int adaptive;                   // poll stable sections less often
+    const struct backend *backend;
+    const struct renderer *renderer;
+    unsigned int historyLength;     // snapshots kept in the history ring
+    unsigned int statsWindow;       // samples covered by min/max/mean
+    double ewmaAlpha;
+    int servePort;                  // serve /metrics on this port, 0 for no server
+    const char *recordPath;         // append a snapshot every updateInterval to this file
+    unsigned int staleMs;           // a collector busy for longer is reported as stale
+    const char *alertsPath;         // alert rules evaluated on every merged sample, see alerts.h
+    int daemon;                     // no terminal, stop cleanly on SIGTERM
+    int selfStats;                  // print what the engine cost at exit, SIGUSR1 prints it any time
+    const char *agentAddress;       // stream every frame to the fleet aggregator there, see fleet.h
+    const char *agentName;          // host name the agent reports, NULL for gethostname()
+    const char *aggregateAddress;   // show_fleet() accepts agents there
+    const struct fan_control_config *fanControl;    // drive the fans, NULL leaves them to the firmware
+    const char *shmName;            // publish every frame in this shared memory segment, see macResMonShm.h
+};
+
+void engine_default_options(struct engine_options *options);
+
+// parse "section=milliseconds", returns -1 for an unknown section or bad period
+int engine_set_period(struct engine_options *options, const char *spec);
+
+// sample every section on its own period on collector threads, record each sample in the
+// history ring and render the latest values every updateInterval seconds until SIGINT
+void show(const struct engine_options *options);
 
-#define _VERBOSE (0B111111)
+// accept fleet agents on options->aggregateAddress and render a table of every host
+// every updateInterval seconds until quit, nothing is sampled locally
+void show_fleet(const struct engine_options *options);
 
-void show(int flag, unsigned int updateInterval);
+// history of the running engine for other threads to read, NULL outside show()
+const struct snapshot_ring *engine_history(void);
 
 #endif //FINALPROJECT_INFOCOLLECTOR_H
@@ -0,0 +1,136 @@
+//
+// JSON renderer: one object per snapshot and line on stdout.
+//
+
+#include <stdio.h>
+
+#include "renderer.h"
+#include "infoCollector.h"
+
+static int json_open(void) {
+    return 0;
+}
+
+// process names are whatever the program set, escape what would break the string
+static void print_name(const char *name) {
+    putchar('"');
+    for (; *name != '\0'; name++) {
+        if (*name == '"' || *name == '\\') {
+            printf("\\%c", *name);
+        } else if ((unsigned char) *name < 0x20) {
+            printf("\\u%04x", *name);
+        } else {
+            putchar(*name);
+        }
+    }
+    putchar('"');
+}
+
+static void print_processes(const char *key, const struct process_sample *rows, int count) {
+    printf(",\"%s\":[", key);
+    for (int i = 0; i < count; ++i) {
+        printf("%s{\"pid\":%d,\"name\":", i ? "," : "", rows[i].pid);
+        print_name(rows[i].name);
+        printf(",\"cpu\":%.1f,\"rss_mb\":%.1f}", rows[i].cpu, rows[i].rss);
+    }
+    putchar(']');
+}
+
+static void json_render(const struct snapshot *snap, const struct metric_stats *stats, int flag) {
+    printf("{\"timestamp\":%.3f", snap->timestamp / 1e9);
+    if ((flag & _DISK_STATUS) && (snap->valid & SNAP_DISK)) {
+        printf(",\"disk_total_gb\":%.2f,\"disk_free_gb\":%.2f,\"volumes\":[", snap->diskTotal, snap->diskFree);
+        for (int i = 0; i < snap->volumeCount; ++i) {
+            printf("%s{\"mount\":\"%s\",\"total_gb\":%.2f,\"free_gb\":%.2f}", i ? "," : "",
+                   snap->volumes[i].mount, snap->volumes[i].total, snap->volumes[i].free);
+        }
+        putchar(']');
+    }
+    if ((flag & _DISK_STATUS) && (snap->valid & SNAP_DISK_IO)) {
+        fputs(",\"devices\":[", stdout);
+        for (int i = 0; i < snap->deviceCount; ++i) {
+            const struct device_sample *device = &snap->devices[i];
+            printf("%s{\"name\":\"%s\",\"read_bps\":%.0f,\"write_bps\":%.0f,\"read_iops\":%.1f,\"write_iops\":%.1f}",
+                   i ? "," : "", device->name, device->readBytes, device->writeBytes, device->reads, device->writes);
+        }
+        putchar(']');
+    }
+    if ((flag & _CPU_USAGE) && (snap->valid & SNAP_CPU_USAGE)) {
+        printf(",\"cpu_user\":%.1f,\"cpu_system\":%.1f,\"cpu_nice\":%.1f,\"cpu_idle\":%.1f,\"core_busy\":[",
+               snap->cpuUser, snap->cpuSystem, snap->cpuNice, snap->cpuIdle);
+        for (int i = 0; i < snap->coreCount; ++i) {
+            printf(i ? ",%.1f" : "%.1f", 100.0f - snap->coreIdle[i]);
+        }
+        putchar(']');
+    }
+    if ((flag & _CPU_USAGE) && (snap->valid & SNAP_LOAD)) {
+        printf(",\"load\":[%.2f,%.2f,%.2f]", snap->loadAverage[0], snap->loadAverage[1], snap->loadAverage[2]);
+    }
+    if ((flag & _CPU_TEMP) && (snap->valid & SNAP_CPU_TEMP)) {
+        printf(",\"cpu_temp\":%.2f", snap->cpuTemp);
+    }
+    if ((flag & _FAN_STATUS) && (snap->valid & SNAP_FANS)) {
+        printf(",\"fan_max_rpm\":%.0f,\"fan_rpm\":[", snap->fanMax);
+        for (int i = 0; i < snap->fanCount; ++i) {
+            printf(i ? ",%.0f" : "%.0f", snap->fanSpeed[i]);
+        }
+        putchar(']');
+    }
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM)) {
+        printf(",\"mem_total_gb\":%.2f,\"mem_used_gb\":%.2f", snap->memTotal, snap->memUsed);
+    }
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM_DETAIL)) {
+        printf(",\"mem_free_gb\":%.2f,\"mem_active_gb\":%.2f,\"mem_inactive_gb\":%.2f,\"mem_wired_gb\":%.2f"
+               ",\"mem_compressed_gb\":%.2f,\"mem_purgeable_gb\":%.2f,\"swap_used_gb\":%.2f",
+               snap->memFree, snap->memActive, snap->memInactive, snap->memWired, snap->memCompressed,
+               snap->memPurgeable, snap->swapUsed);
+    }
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM_RATES)) {
+        printf(",\"page_ins_per_second\":%.1f,\"page_outs_per_second\":%.1f,\"compressions_per_second\":%.1f"
+               ",\"decompressions_per_second\":%.1f", snap->pageInRate, snap->pageOutRate,
+               snap->compressionRate, snap->decompressionRate);
+    }
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM_TEMP)) {
+        printf(",\"mem_temp\":%.2f", snap->memTemp);
+    }
+    if ((flag & _GPU_STATUS) && (snap->valid & SNAP_GPU_TEMP)) {
+        printf(",\"gpu_temp\":%.2f", snap->gpuTemp);
+    }
+    if ((flag & _BATTERY_STATUS) && (snap->valid & SNAP_BATTERY)) {
+        printf(",\"battery_present\":%s", snap->batteryPresent ? "true" : "false");
+        if (snap->batteryPresent) {
+            printf(",\"battery_percent\":%d,\"battery_powered\":%s,\"battery_minutes\":%d",
+                   snap->batteryPercent, snap->batteryPowered ? "true" : "false", snap->batteryMinutes);
+        }
+        if (snap->valid & SNAP_BATTERY_TEMP) {
+            printf(",\"battery_temp\":%.2f", snap->batteryTemp);
+        }
+    }
+    if ((flag & _PROCESSES) && (snap->valid & SNAP_PROCESSES)) {
+        printf(",\"processes\":%d", snap->processCount);
+        print_processes("top_cpu", snap->topCpu, snap->topCount);
+        print_processes("top_memory", snap->topMemory, snap->topCount);
+    }
+    if (snap->valid & SNAP_SELF) {
+        printf(",\"self\":{\"cpu\":%.2f,\"rss_mb\":%.1f,\"syscalls_per_second\":%.0f,\"smc_calls_per_second\":%.0f}",
+               snap->selfCpu, snap->selfRss, snap->selfSyscalls, snap->selfSmcCalls);
+    }
+    if (snap->stale) {
+        const char *separator = "";
+        fputs(",\"stale\":[", stdout);
+        for (int i = 0; i < SNAP_BIT_COUNT; i++) {
+            if (snap->stale & (1u << i)) {
+                printf("%s\"%s\"", separator, snapshot_bit_name(1u << i));
+                separator = ",";
+            }
+        }
+        putchar(']');
+    }
+    puts("}");
+    fflush(stdout);
+}
+
+static void json_close(void) {
+}
+
+const struct renderer json_renderer = {"json", json_open, json_render, json_close, NULL, NULL};
@@ -0,0 +1,340 @@
+//
+// Linux backend: hwmon for temperatures and fans, the memory subsystem for memory,
+// power_supply for the battery, the disk subsystem for volumes and I/O, /proc/stat for cpu usage
+// and /proc/[pid]/stat for the process table.
+// Every file is opened once in open() and re-read with pread at offset 0, so a sample
+// costs one syscall per value instead of an open/read/close each; per-process files come
+// and go with the processes and are the exception.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "backend.h"
+#include "infoCollector.h"
+#include "diskStats.h"
+#include "memoryStats.h"
+#include "cpuUsage.h"
+#include "processTable.h"
+
+#define HWMON_ROOT "/sys/class/hwmon"
+#define POWER_SUPPLY_ROOT "/sys/class/power_supply"
+
+static int cpuTempFd = -1;
+static int gpuTempFd = -1;
+static int memTempFd = -1;
+static int fanFds[SNAPSHOT_MAX_FANS];
+static int fanMaxFd = -1;
+static int fanCount = 0;
+
+static int batteryCapacityFd = -1;
+static int batteryStatusFd = -1;
+static int batteryEnergyFd = -1;    // energy_now (µWh) or charge_now (µAh)
+static int batteryRateFd = -1;      // power_now (µW) or current_now (µA), same unit family
+static int batteryTempFd = -1;      // tenths of °C
+
+static int open_in(const char *dir, const char *file) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, file);
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+static void close_fd(int *fd) {
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+// read a whole small sysfs/procfs file from the start, returns the length or -1
+static ssize_t read_text(int fd, char *buf, size_t size) {
+    ssize_t length;
+
+    if (fd < 0) {
+        return -1;
+    }
+    length = pread(fd, buf, size - 1, 0);
+    if (length < 0) {
+        return -1;
+    }
+    buf[length] = '\0';
+    return length;
+}
+
+static int read_long(int fd, long *value) {
+    char buf[32];
+    char *end;
+
+    if (read_text(fd, buf, sizeof(buf)) <= 0) {
+        return -1;
+    }
+    *value = strtol(buf, &end, 10);
+    return end == buf ? -1 : 0;
+}
+
+// a hwmon temperature in °C, returns -1 when it could not be read
+static int read_millidegrees(int fd, double *celsius) {
+    long value;
+
+    if (read_long(fd, &value) != 0) {
+        return -1;
+    }
+    *celsius = value / 1000.0;
+    return 0;
+}
+
+// every fan and the maximum when the chip has one, returns -1 when any read failed
+static int read_fans(struct snapshot *snap) {
+    long rpm;
+
+    snap->fanCount = fanCount;
+    snap->fanMax = 0.0;
+    if (fanMaxFd >= 0) {
+        if (read_long(fanMaxFd, &rpm) != 0) {
+            return -1;
+        }
+        snap->fanMax = (double) rpm;
+    }
+    for (int i = 0; i < fanCount; ++i) {
+        if (read_long(fanFds[i], &rpm) != 0) {
+            return -1;
+        }
+        snap->fanSpeed[i] = (double) rpm;
+    }
+    return 0;
+}
+
+// find the temp*_input of a hwmon device whose label starts with one of the given prefixes,
+// falling back to temp1_input
+static int open_labeled_temp(const char *dir, const char *const *labels) {
+    for (int i = 1; i <= 32; i++) {
+        char file[32], label[64];
+        snprintf(file, sizeof(file), "temp%d_label", i);
+        int fd = open_in(dir, file);
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t length = read_text(fd, label, sizeof(label));
+        close(fd);
+        for (const char *const *prefix = labels; length > 0 && *prefix != NULL; prefix++) {
+            if (strncmp(label, *prefix, strlen(*prefix)) == 0) {
+                snprintf(file, sizeof(file), "temp%d_input", i);
+                return open_in(dir, file);
+            }
+        }
+    }
+    return open_in(dir, "temp1_input");
+}
+
+static int name_in(const char *name, const char *const *names) {
+    for (; *names != NULL; names++) {
+        if (strcmp(name, *names) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void open_hwmon(void) {
+    static const char *const cpuDrivers[] = {"coretemp", "k10temp", "zenpower", "cpu_thermal", NULL};
+    static const char *const cpuLabels[] = {"Package", "Tctl", "Tdie", NULL};
+    static const char *const gpuDrivers[] = {"amdgpu", "radeon", "nouveau", NULL};
+    static const char *const memDrivers[] = {"jc42", "spd5118", NULL};
+    static const char *const noLabels[] = {NULL};
+    DIR *root = opendir(HWMON_ROOT);
+    struct dirent *entry;
+
+    if (root == NULL) {
+        return;
+    }
+    while ((entry = readdir(root)) != NULL) {
+        char dir[300], name[64];
+        int fd;
+
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(dir, sizeof(dir), "%s/%s", HWMON_ROOT, entry->d_name);
+        fd = open_in(dir, "name");
+        if (fd < 0) {
+            continue;
+        }
+        ssize_t length = read_text(fd, name, sizeof(name));
+        close(fd);
+        if (length <= 0) {
+            continue;
+        }
+        name[strcspn(name, "\n")] = '\0';
+
+        if (cpuTempFd < 0 && name_in(name, cpuDrivers)) {
+            cpuTempFd = open_labeled_temp(dir, cpuLabels);
+        } else if (gpuTempFd < 0 && name_in(name, gpuDrivers)) {
+            gpuTempFd = open_labeled_temp(dir, noLabels);
+        } else if (memTempFd < 0 && name_in(name, memDrivers)) {
+            memTempFd = open_labeled_temp(dir, noLabels);
+        }
+
+        // fans can live on any chip, usually the super I/O one
+        for (int i = 1; i <= SNAPSHOT_MAX_FANS && fanCount < SNAPSHOT_MAX_FANS; i++) {
+            char file[32];
+            snprintf(file, sizeof(file), "fan%d_input", i);
+            fd = open_in(dir, file);
+            if (fd < 0) {
+                continue;
+            }
+            fanFds[fanCount++] = fd;
+            if (fanMaxFd < 0) {
+                snprintf(file, sizeof(file), "fan%d_max", i);
+                fanMaxFd = open_in(dir, file);
+            }
+        }
+    }
+    closedir(root);
+
+    // ACPI thermal zone as the last resort for the CPU
+    if (cpuTempFd < 0) {
+        cpuTempFd = open("/sys/class/thermal/thermal_zone0/temp", O_RDONLY | O_CLOEXEC);
+    }
+}
+
+static void open_battery(void) {
+    DIR *root = opendir(POWER_SUPPLY_ROOT);
+    struct dirent *entry;
+
+    if (root == NULL) {
+        return;
+    }
+    while (batteryCapacityFd < 0 && (entry = readdir(root)) != NULL) {
+        char dir[300], type[32];
+        int fd;
+
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(dir, sizeof(dir), "%s/%s", POWER_SUPPLY_ROOT, entry->d_name);
+        fd = open_in(dir, "type");
+        ssize_t length = read_text(fd, type, sizeof(type));
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (length <= 0 || strncmp(type, "Battery", 7) != 0) {
+            continue;
+        }
+
+        batteryCapacityFd = open_in(dir, "capacity");
+        batteryStatusFd = open_in(dir, "status");
+        batteryTempFd = open_in(dir, "temp");
+        batteryEnergyFd = open_in(dir, "energy_now");
+        if (batteryEnergyFd >= 0) {
+            batteryRateFd = open_in(dir, "power_now");
+        } else {
+            batteryEnergyFd = open_in(dir, "charge_now");
+            batteryRateFd = open_in(dir, "current_now");
+        }
+    }
+    closedir(root);
+}
+
+static int linux_open(int flag) {
+    fanCount = 0;
+    if (flag & (_CPU_TEMP | _GPU_STATUS | _MEM_STATUS | _FAN_STATUS)) {
+        open_hwmon();
+    }
+    if (flag & _MEM_STATUS) {
+        memory_stats_open();
+    }
+    if (flag & _BATTERY_STATUS) {
+        open_battery();
+    }
+    if (flag & _DISK_STATUS) {
+        disk_stats_open();
+    }
+    if (flag & _CPU_USAGE) {
+        cpu_usage_open();
+    }
+    if (flag & _PROCESSES) {
+        process_table_open();
+    }
+    return 0;
+}
+
+static void sample_battery(struct snapshot *snap) {
+    char status[32];
+    long capacity, energy, rate, temp;
+
+    snap->batteryPresent = batteryCapacityFd >= 0 && read_long(batteryCapacityFd, &capacity) == 0;
+    snap->valid |= SNAP_BATTERY;
+    if (!snap->batteryPresent) {
+        return;
+    }
+    snap->batteryPercent = (int) capacity;
+    snap->batteryPowered = read_text(batteryStatusFd, status, sizeof(status)) > 0 &&
+                           strncmp(status, "Discharging", 11) != 0;
+    snap->batteryMinutes = -1;
+    if (!snap->batteryPowered && read_long(batteryEnergyFd, &energy) == 0 &&
+        read_long(batteryRateFd, &rate) == 0 && rate > 0) {
+        snap->batteryMinutes = (int) (energy * 60 / rate);
+    }
+    if (read_long(batteryTempFd, &temp) == 0) {
+        snap->batteryTemp = temp / 10.0;
+        snap->valid |= SNAP_BATTERY_TEMP;
+    }
+}
+
+static void linux_sample(int flag, struct snapshot *snap) {
+    if (flag & _DISK_STATUS) {
+        disk_stats_sample(snap);
+    }
+    if (flag & _CPU_USAGE) {
+        cpu_usage_sample(snap);
+    }
+    if (flag & _PROCESSES) {
+        process_table_sample(snap);
+    }
+    // a file that fails to read leaves its section invalid rather than a 0 °C or 0 rpm
+    // the renderers, alerts and the recording would take for a reading
+    if ((flag & _CPU_TEMP) && read_millidegrees(cpuTempFd, &snap->cpuTemp) == 0) {
+        snap->valid |= SNAP_CPU_TEMP;
+    }
+    if ((flag & _FAN_STATUS) && read_fans(snap) == 0) {
+        snap->valid |= SNAP_FANS;
+    }
+    if (flag & _MEM_STATUS) {
+        memory_stats_sample(snap);
+        if (read_millidegrees(memTempFd, &snap->memTemp) == 0) {
+            snap->valid |= SNAP_MEM_TEMP;
+        }
+    }
+    if ((flag & _GPU_STATUS) && read_millidegrees(gpuTempFd, &snap->gpuTemp) == 0) {
+        snap->valid |= SNAP_GPU_TEMP;
+    }
+    if (flag & _BATTERY_STATUS) {
+        sample_battery(snap);
+    }
+}
+
+static void linux_close(void) {
+    disk_stats_close();
+    cpu_usage_close();
+    process_table_close();
+    close_fd(&cpuTempFd);
+    close_fd(&gpuTempFd);
+    close_fd(&memTempFd);
+    close_fd(&fanMaxFd);
+    for (int i = 0; i < fanCount; ++i) {
+        close_fd(&fanFds[i]);
+    }
+    fanCount = 0;
+    memory_stats_close();
+    close_fd(&batteryCapacityFd);
+    close_fd(&batteryStatusFd);
+    close_fd(&batteryEnergyFd);
+    close_fd(&batteryRateFd);
+    close_fd(&batteryTempFd);
+}
+
+const struct backend linux_backend = {"linux", linux_open, linux_sample, linux_close};
@@ -0,0 +1,111 @@
+//
+// macOS backend: the disk and memory subsystems, mach processor info for cpu usage,
+// libproc for the process table, the SMC for temperatures and fans and IOKit power sources for the battery.
+//
+
+#include <stdio.h>
+
+#include "backend.h"
+#include "infoCollector.h"
+#include "systemManagementController.h"
+#include "smcCatalog.h"
+#include "powerSource.h"
+#include "diskStats.h"
+#include "memoryStats.h"
+#include "cpuUsage.h"
+#include "processTable.h"
+
+// SMC sensors sampled every tick, compiled once from the enabled sections and read in one batch
+static struct smc_sensor_plan tickPlan;
+static const char *catalogPath = NULL;
+
+void mac_backend_set_catalog(const char *path) {
+    catalogPath = path;
+}
+
+static void compile_tick_keys(int flag) {
+    int fanCount = 0;
+
+    if (flag & _FAN_STATUS) {
+        // the number of fans is fixed hardware, read it once
+        fanCount = SMC_get_fan_num();
+        if (fanCount < 0) {
+            fanCount = 0;
+        }
+        if (fanCount > SNAPSHOT_MAX_FANS) {
+            fanCount = SNAPSHOT_MAX_FANS;
+        }
+    }
+    smc_sensor_plan_compile(&tickPlan, flag, fanCount);
+}
+
+static int mac_open(int flag) {
+    if (!systemSupported()) {
+        return -1;
+    }
+    if (SMC_open() != kIOReturnSuccess) {
+        return -1;
+    }
+    // a catalog saved by --list-keys (at --catalog, if given) spares the key info lookups
+    // of the first tick
+    SMC_catalog_prime(catalogPath != NULL ? catalogPath : SMC_catalog_default_path());
+    compile_tick_keys(flag);
+    if (flag & _DISK_STATUS) {
+        disk_stats_open();
+    }
+    if (flag & _MEM_STATUS) {
+        memory_stats_open();
+    }
+    if (flag & _CPU_USAGE) {
+        cpu_usage_open();
+    }
+    if (flag & _PROCESSES) {
+        process_table_open();
+    }
+    return 0;
+}
+
+static void mac_sample(int flag, struct snapshot *snap) {
+    smc_sensor_plan_sample(&tickPlan, flag, snap);
+
+    if (flag & _DISK_STATUS) {
+        disk_stats_sample(snap);
+    }
+    if (flag & _CPU_USAGE) {
+        cpu_usage_sample(snap);
+    }
+    if (flag & _PROCESSES) {
+        process_table_sample(snap);
+    }
+    if (flag & _FAN_STATUS) {
+        snap->fanCount = tickPlan.fanCount;
+    }
+    if (flag & _MEM_STATUS) {
+        memory_stats_sample(snap);
+    }
+    if (flag & _BATTERY_STATUS) {
+        // one power source fetch for every battery field
+        struct power_info power;
+        power_source_read(&power);
+        snap->batteryPresent = power.present;
+        if (snap->batteryPresent) {
+            snap->batteryPercent = power.percent;
+            snap->batteryPowered = power_info_powered(&power);
+            snap->batteryMinutes = snap->batteryPowered ? 0 : power.minutesToEmpty;
+        } else {
+            // the key may well be there without a battery
+            snap->valid &= ~SNAP_BATTERY_TEMP;
+        }
+        snap->valid |= SNAP_BATTERY;
+    }
+}
+
+static void mac_close(void) {
+    disk_stats_close();
+    memory_stats_close();
+    cpu_usage_close();
+    process_table_close();
+    SMC_close();
+}
+
+const struct backend mac_backend = {"mac", mac_open, mac_sample, mac_close};
@@ -0,0 +1,148 @@
+//
+// Reader of the snapshot macResMon publishes in POSIX shared memory (macResMon -M NAME).
+// Header only and independent of the rest of the tree, so a local tool copies this file
+// and nothing else:
+//
+//     struct mrm_shm *shm = mrm_shm_open("/macResMon");
+//     struct mrm_values values;
+//     if (shm != NULL && mrm_shm_read(shm, &values, NULL) == 0 && (values.valid & MRM_CPU_TEMP)) {
+//         printf("%.1f\n", values.cpuTemp);
+//     }
+//
+// Opening maps the segment once; after that a read is a seqlock loop over a few hundred
+// bytes of mapped memory, no syscall and no lock, and the publisher never waits for a
+// reader. The layout only uses fixed width fields; a new field is appended and bumps
+// MRM_SHM_VERSION, a reader of another version gets NULL from mrm_shm_open.
+//
+
+#ifndef FINALPROJECT_MACRESMONSHM_H
+#define FINALPROJECT_MACRESMONSHM_H
+
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MRM_SHM_MAGIC 0x534d524du       // "MRMS"
+#define MRM_SHM_VERSION 1
+#define MRM_MAX_FANS 10
+
+// bits of mrm_values.valid, a field group is only meaningful when its bit is set
+#define MRM_DISK         (1u << 0)
+#define MRM_CPU_TEMP     (1u << 1)
+#define MRM_FANS         (1u << 2)
+#define MRM_MEM          (1u << 3)
+#define MRM_MEM_TEMP     (1u << 4)
+#define MRM_GPU_TEMP     (1u << 5)
+#define MRM_BATTERY      (1u << 6)
+#define MRM_BATTERY_TEMP (1u << 7)
+#define MRM_CPU_USAGE    (1u << 9)
+#define MRM_LOAD         (1u << 10)
+#define MRM_PROCESSES    (1u << 11)
+
+struct mrm_values {
+    uint64_t timestamp;         // wall clock of the sample, nanoseconds since the epoch
+    uint32_t valid;             // MRM_* bits
+    uint32_t fanCount;
+    // °C
+    double cpuTemp;
+    double gpuTemp;
+    double memTemp;
+    double batteryTemp;
+    // percent of every core together, and the 1, 5 and 15 minute load
+    double cpuUser;
+    double cpuSystem;
+    double cpuNice;
+    double cpuIdle;
+    double loadAverage[3];
+    // GB
+    double memTotal;
+    double memUsed;
+    double swapUsed;
+    double diskTotal;
+    double diskFree;
+    // rpm
+    double fanMax;
+    double fanSpeed[MRM_MAX_FANS];
+    int32_t batteryPercent;
+    int32_t batteryPowered;
+    int32_t batteryMinutes;     // -1 while the system is still calculating
+    int32_t processCount;
+};
+
+// the whole segment
+struct mrm_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;              // sizeof(struct mrm_shm) of the publisher
+    int32_t pid;                // of the publisher
+    // 2 * samples published, odd while the publisher is writing values
+    _Alignas(64) _Atomic uint64_t seq;
+    struct mrm_values values;
+};
+
+// map the segment called name read only, NULL when there is none or of another version
+static inline struct mrm_shm *mrm_shm_open(const char *name) {
+    struct mrm_shm *shm;
+    struct stat info;
+    int fd = shm_open(name, O_RDONLY, 0);
+
+    if (fd < 0) {
+        return NULL;
+    }
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(struct mrm_shm)) {
+        close(fd);
+        return NULL;
+    }
+    shm = (struct mrm_shm *) mmap(NULL, sizeof(struct mrm_shm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        return NULL;
+    }
+    if (shm->magic != MRM_SHM_MAGIC || shm->version != MRM_SHM_VERSION || shm->size != sizeof(struct mrm_shm)) {
+        munmap(shm, sizeof(struct mrm_shm));
+        return NULL;
+    }
+    return shm;
+}
+
+// number of samples published so far, compare with the last one read to see if there is
+// a new sample without copying it
+static inline uint64_t mrm_shm_sequence(const struct mrm_shm *shm) {
+    return atomic_load_explicit(&shm->seq, memory_order_acquire) / 2;
+}
+
+// copy the latest sample into out and its number into sequence (may be NULL), -1 while
+// nothing is published yet
+static inline int mrm_shm_read(const struct mrm_shm *shm, struct mrm_values *out, uint64_t *sequence) {
+    for (;;) {
+        uint64_t before = atomic_load_explicit(&shm->seq, memory_order_acquire);
+
+        if (before == 0) {
+            return -1;
+        }
+        // odd: the publisher is halfway through, it takes well under a microsecond
+        if (before & 1) {
+            continue;
+        }
+        memcpy(out, &shm->values, sizeof(struct mrm_values));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&shm->seq, memory_order_relaxed) == before) {
+            if (sequence != NULL) {
+                *sequence = before / 2;
+            }
+            return 0;
+        }
+    }
+}
+
+static inline void mrm_shm_close(struct mrm_shm *shm) {
+    if (shm != NULL) {
+        munmap(shm, sizeof(struct mrm_shm));
+    }
+}
+
+#endif //FINALPROJECT_MACRESMONSHM_H
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <memory.h>
 #include "infoCollector.h"
+#include "smcCatalog.h"
 
 
 // marco for debug print
@@ -24,21 +25,54 @@ struct option long_options[] =
                 {"memory",    no_argument, 0, 'm'},
                 {"gpu",       no_argument, 0, 'g'},
                 {"battery",   no_argument, 0, 'b'},
+                {"processes", no_argument, 0, 'o'},
                 {"gpu",       no_argument, 0, 'g'},
                 {"frequency", required_argument, 0, 't'},
                 {"help",      no_argument, 0, 'h'},
+                {"list-keys", no_argument, 0, 'l'},
+                {"catalog",   required_argument, 0, 'k'},
+                {"headless",  no_argument, 0, 'H'},
+                {"renderer",  required_argument, 0, 'r'},
+                {"backend",   required_argument, 0, 'B'},
+                {"window",    required_argument, 0, 'w'},
+                {"period",    required_argument, 0, 'P'},
+                {"adaptive",  no_argument, 0, 'a'},
+                {"serve",     required_argument, 0, 'S'},
+                {"record",    required_argument, 0, 'R'},
+                {"replay",    required_argument, 0, 'p'},
+                {"speed",     required_argument, 0, 'x'},
+                {"timeout",   required_argument, 0, 'T'},
+                {"alerts",    required_argument, 0, 'A'},
+                {"daemon",    no_argument, 0, 'D'},
+                {"self-stats", no_argument, 0, 'I'},
+                {"format",    required_argument, 0, 'F'},
+                {"output",    required_argument, 0, 'O'},
+                {"agent",     required_argument, 0, 'G'},
+                {"name",      required_argument, 0, 'N'},
+                {"aggregate", required_argument, 0, 'C'},
+                {"shm",       required_argument, 0, 'M'},
+                {"fan-control", required_argument, 0, 'c'},
 
                 {0, 0,                     0, 0}
         };
 
 int main(int argc, char *argv[]) {
-    int c, flag = 0, updateInterval = 1, option_index = 0;
+    int c, flag = 0, option_index = 0, listKeys = 0;
+    double updateInterval = 1.0;
+    const char *catalogPath = SMC_catalog_default_path();
+    const char *rendererName = NULL, *backendName = NULL, *replayPath = NULL;
+    const char *formatName = "ndjson", *outputPath = NULL;
+    double replaySpeed = 1.0;
+    struct engine_options options;
+    struct fan_control_config fanConfig;
+
+    engine_default_options(&options);
 
     // I chose to use getopt_long instead of argparse as argparse doesn't exit on OSX by default
-    while ((c = getopt_long(argc, argv, "ubdfmgvh?t:", long_options, &option_index)) != -1)
+    while ((c = getopt_long(argc, argv, "ubdfmgovh?t:lk:Hr:B:w:P:aS:R:p:x:T:A:DIF:O:G:N:C:M:c:", long_options, &option_index)) != -1)
         switch (c) {
             case 'u':
-                flag |= _CPU_TEMP;
+                flag |= _CPU_TEMP | _CPU_USAGE;
                 DEBUG_PRINT("cput temp\n");
                 break;
             case 'd':
@@ -61,30 +95,180 @@ int main(int argc, char *argv[]) {
                 flag |= _BATTERY_STATUS;
                 DEBUG_PRINT("battery status\n");
                 break;
+            case 'o':
+                flag |= _PROCESSES;
+                DEBUG_PRINT("processes\n");
+                break;
             case 't':
                 DEBUG_PRINT("user-defined interval\n");
-                updateInterval = (int) strtol(optarg, NULL, 10);
-                if (updateInterval <= 0) {
+                updateInterval = strtod(optarg, NULL);
+                if (!(updateInterval >= 0.001)) {
                     perror("updateInterval should be a positive value");
                     exit(1);
                 }
-                DEBUG_PRINT("user input intvl is %d\n", updateInterval);
+                DEBUG_PRINT("user input intvl is %f\n", updateInterval);
                 break;
             case 'v':
                 flag |= _VERBOSE;
                 DEBUG_PRINT("verbose\n");
                 break;
+            case 'l':
+                listKeys = 1;
+                break;
+            case 'k':
+                catalogPath = optarg;
+                break;
+            case 'H':
+                // sample without a terminal
+                rendererName = "text";
+                break;
+            case 'r':
+                rendererName = optarg;
+                break;
+            case 'B':
+                backendName = optarg;
+                break;
+            case 'w':
+                options.statsWindow = (unsigned int) strtoul(optarg, NULL, 10);
+                if (options.statsWindow == 0) {
+                    perror("window should be a positive number of samples");
+                    exit(1);
+                }
+                break;
+            case 'P':
+                if (engine_set_period(&options, optarg) != 0) {
+                    fprintf(stderr, "bad period %s, expected cpu|fan|gpu|mem|disk|battery|load|processes=milliseconds\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'a':
+                options.adaptive = 1;
+                break;
+            case 'S':
+                options.servePort = (int) strtol(optarg, NULL, 10);
+                if (options.servePort <= 0 || options.servePort > 65535) {
+                    fprintf(stderr, "bad port %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'R':
+                options.recordPath = optarg;
+                break;
+            case 'p':
+                replayPath = optarg;
+                backendName = "replay";
+                break;
+            case 'x':
+                replaySpeed = strtod(optarg, NULL);
+                if (!(replaySpeed > 0)) {
+                    fprintf(stderr, "bad speed %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'T':
+                options.staleMs = (unsigned int) strtoul(optarg, NULL, 10);
+                if (options.staleMs == 0) {
+                    fprintf(stderr, "bad timeout %s\n", optarg);
+                    exit(1);
+                }
+                break;
+            case 'A':
+                options.alertsPath = optarg;
+                break;
+            case 'D':
+                options.daemon = 1;
+                break;
+            case 'I':
+                options.selfStats = 1;
+                break;
+            case 'F':
+                formatName = optarg;
+                rendererName = "stream";
+                break;
+            case 'O':
+                outputPath = optarg;
+                break;
+            case 'G':
+                options.agentAddress = optarg;
+                break;
+            case 'N':
+                options.agentName = optarg;
+                break;
+            case 'C':
+                options.aggregateAddress = optarg;
+                break;
+            case 'M':
+                options.shmName = optarg;
+                break;
+            case 'c':
+                if (fan_control_parse(optarg, &fanConfig) != 0) {
+                    fprintf(stderr, "bad fan control %s, e.g. curve:50=0,70=40,85=100 or pid:75\n", optarg);
+                    exit(1);
+                }
+                options.fanControl = &fanConfig;
+                break;
             case 'h':
-                puts("u: CPU temp, g: GPU temp, d: Disk Status, f: Fan status, m: Memory status, b: Battery status, v: all, t: specify update frequency");
+                puts("u: CPU temp and usage, g: GPU temp, d: Disk Status, f: Fan status, m: Memory status, b: Battery status, o: top processes, v: all, t: specify update frequency");
+                puts("l: list every SMC key, k: key catalog file (default ~/.macResMon.keys)");
+                puts("H: headless plain text output, r: renderer (curses, text, json, none, stream), B: backend (mac, linux, synthetic, thermal, replay), w: samples in the avg/max window");
+                puts("P: sampling period of a section, e.g. -P disk=60000, a: poll stable sensors less often");
+                puts("S: serve Prometheus metrics on http://host:PORT/metrics");
+                puts("R: record snapshots to a file, p: replay a recorded file, x: replay speed");
+                puts("T: milliseconds after which a busy collector is shown as stale (default 2000)");
+                puts("A: alert rules file, one rule per line, e.g. cpu_temp > 80 hysteresis=5 for=10");
+                puts("F: stream one record per tick as csv, ndjson or json, O: file the records go to (default stdout)");
+                puts("G: stream to a fleet aggregator at host:port or a socket path, N: host name sent (default the host's)");
+                puts("C: aggregate agents listening on [host]:port or a socket path, one table of every host, sorted with n/c/l/m/d");
+                puts("M: publish every frame in the shared memory segment NAME (e.g. /macResMon), read it with macResMonShm.h");
+                puts("c: drive the fans from the CPU/GPU temperature, curve:50=0,70=40,85=100 (percent of the fan range) or pid:75,");
+                puts("   each with optional rate=HZ and failsafe=C; -B thermal runs it against a simulated machine");
+                puts("D: daemon, no output unless a renderer is given, stops on SIGTERM");
+                puts("keys in the curses view: q quit, p pause, +/- refresh faster/slower, 1-8 toggle cpu temp, disk, fan, memory, gpu, battery, cpu usage, processes");
+                puts("I: print the collectors' latency and macResMon's own cost at exit, SIGUSR1 prints it any time");
                 return 0;
             default:
                 exit(1);
         }
+    if (listKeys) {
+        if (SMC_list_keys(catalogPath, stdout) != 0) {
+            perror("could not enumerate SMC keys");
+            exit(1);
+        }
+        return 0;
+    }
+    // the fleet table needs no sections of its own
+    if (options.aggregateAddress != NULL && flag == 0) {
+        flag = _VERBOSE;
+    }
     if (flag == 0) {
-        perror("u: CPU temp, g: GPU temp, d: Disk Status, f: Fan status, m: Memory status, Battery status, v: all, t: specify update frequency");
+        perror("u: CPU temp and usage, g: GPU temp, d: Disk Status, f: Fan status, m: Memory status, Battery status, o: top processes, v: all, t: specify update frequency");
+        exit(1);
+    }
+
+    options.flag = flag;
+    options.updateInterval = updateInterval;
+    if (stream_renderer_configure(formatName, outputPath) != 0) {
+        fprintf(stderr, "unknown format %s\n", formatName);
+        exit(1);
+    }
+    if (options.daemon && rendererName == NULL) {
+        rendererName = "none";
+    }
+    options.backend = backend_find(backendName);
+    replay_backend_set_file(replayPath, replaySpeed);
+#ifdef __APPLE__
+    mac_backend_set_catalog(catalogPath);
+#endif
+    options.renderer = renderer_find(rendererName);
+    if (options.backend == NULL || options.renderer == NULL) {
+        fprintf(stderr, "unknown %s\n", options.backend == NULL ? "backend" : "renderer");
         exit(1);
     }
 
-    show(flag, (unsigned int) updateInterval);
+    if (options.aggregateAddress != NULL) {
+        show_fleet(&options);
+    } else {
+        show(&options);
+    }
     return 0;
 }
\ No newline at end of file
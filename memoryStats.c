@@ -0,0 +1,79 @@
+//
+// Memory subsystem, see memoryStats.h
+//
+
+#include <time.h>
+
+#include "memoryStats.h"
+
+#define Byte_TO_GB (1024.0 * 1024 * 1024)
+
+static double totalGB;
+static struct memory_counters previous;
+static int havePrevious = 0;
+static double previousTime;
+
+static double seconds_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// pages per second, 0 when the counter went backwards
+static double rate(uint64_t before, uint64_t after, double seconds) {
+    return after >= before ? (double) (after - before) / seconds : 0.0;
+}
+
+void memory_rates(const struct memory_counters *before, const struct memory_counters *after,
+                  double seconds, struct snapshot *snap) {
+    if (!(seconds > 0)) {
+        return;
+    }
+    snap->pageInRate = rate(before->pageIns, after->pageIns, seconds);
+    snap->pageOutRate = rate(before->pageOuts, after->pageOuts, seconds);
+    snap->compressionRate = rate(before->compressions, after->compressions, seconds);
+    snap->decompressionRate = rate(before->decompressions, after->decompressions, seconds);
+    snap->valid |= SNAP_MEM_RATES;
+}
+
+int memory_stats_open(void) {
+    uint64_t total = 0;
+
+    havePrevious = 0;
+    if (memory_platform_open(&total) != 0) {
+        return -1;
+    }
+    totalGB = total / Byte_TO_GB;
+    return 0;
+}
+
+void memory_stats_sample(struct snapshot *snap) {
+    struct memory_counters counters;
+    double now = seconds_now();
+
+    if (memory_platform_read(&counters) != 0) {
+        havePrevious = 0;
+        return;
+    }
+    snap->memTotal = totalGB;
+    snap->memUsed = counters.used / Byte_TO_GB;
+    snap->memFree = counters.free / Byte_TO_GB;
+    snap->memActive = counters.active / Byte_TO_GB;
+    snap->memInactive = counters.inactive / Byte_TO_GB;
+    snap->memWired = counters.wired / Byte_TO_GB;
+    snap->memCompressed = counters.compressed / Byte_TO_GB;
+    snap->memPurgeable = counters.purgeable / Byte_TO_GB;
+    snap->swapUsed = counters.swapUsed / Byte_TO_GB;
+    snap->valid |= SNAP_MEM | SNAP_MEM_DETAIL;
+
+    if (havePrevious) {
+        memory_rates(&previous, &counters, now - previousTime, snap);
+    }
+    previous = counters;
+    previousTime = now;
+    havePrevious = 1;
+}
+
+void memory_stats_close(void) {
+    memory_platform_close();
+}
@@ -0,0 +1,53 @@
+//
+// Memory subsystem shared by the hardware backends: used memory, its breakdown by page
+// state and the paging and compression rates that tell memory pressure apart from a
+// merely full cache. Installed memory and the page size never change and are read once
+// at open; a sample is then one statistics read, turned into rates against the previous.
+//
+
+#ifndef FINALPROJECT_MEMORYSTATS_H
+#define FINALPROJECT_MEMORYSTATS_H
+
+#include <stdint.h>
+
+#include "snapshot.h"
+
+// one statistics read, sizes in bytes and activity as cumulative pages since boot
+struct memory_counters {
+    uint64_t used;
+    uint64_t free;
+    uint64_t active;
+    uint64_t inactive;
+    uint64_t wired;
+    uint64_t compressed;
+    uint64_t purgeable;
+    uint64_t swapUsed;
+    uint64_t pageIns;
+    uint64_t pageOuts;
+    uint64_t compressions;
+    uint64_t decompressions;
+};
+
+// ---- platform part, memoryStatsLinux.c or memoryStatsMac.c ----
+
+// cache installed memory in bytes, returns 0 on success
+int memory_platform_open(uint64_t *total);
+
+void memory_platform_close(void);
+
+int memory_platform_read(struct memory_counters *counters);
+
+// ---- common part, memoryStats.c ----
+
+// pages per second between two reads seconds apart into the SNAP_MEM_RATES fields of snap
+void memory_rates(const struct memory_counters *before, const struct memory_counters *after,
+                  double seconds, struct snapshot *snap);
+
+int memory_stats_open(void);
+
+// fill SNAP_MEM and SNAP_MEM_DETAIL, and SNAP_MEM_RATES from the second sample on
+void memory_stats_sample(struct snapshot *snap);
+
+void memory_stats_close(void);
+
+#endif //FINALPROJECT_MEMORYSTATS_H
@@ -0,0 +1,97 @@
+//
+// Linux part of the memory subsystem: /proc/meminfo for the sizes and /proc/vmstat for
+// the activity counters, both kept open and re-read with pread.
+// Linux has no wired or purgeable pages as such; wired is memory the kernel cannot page
+// out (unevictable pages, kernel stacks, page tables, unreclaimable slab) and purgeable
+// is the reclaimable slab. Compression is zswap, when it is enabled.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "memoryStats.h"
+
+#define KB 1024ull
+
+static int meminfoFd = -1;
+static int vmstatFd = -1;
+static uint64_t pageSize;
+
+// whole small procfs file from the start, returns the length or -1
+static ssize_t read_text(int fd, char *buf, size_t size) {
+    ssize_t length;
+
+    if (fd < 0 || (length = pread(fd, buf, size - 1, 0)) < 0) {
+        return -1;
+    }
+    buf[length] = '\0';
+    return length;
+}
+
+// number after key at the start of a line, 0 when the kernel does not have it
+static uint64_t field(const char *text, const char *key) {
+    size_t length = strlen(key);
+
+    for (const char *line = text; line != NULL; line = strchr(line, '\n')) {
+        if (*line == '\n') {
+            line++;
+        }
+        if (strncmp(line, key, length) == 0) {
+            return strtoull(line + length, NULL, 10);
+        }
+    }
+    return 0;
+}
+
+int memory_platform_open(uint64_t *total) {
+    char text[4096];
+
+    meminfoFd = open("/proc/meminfo", O_RDONLY | O_CLOEXEC);
+    vmstatFd = open("/proc/vmstat", O_RDONLY | O_CLOEXEC);
+    pageSize = (uint64_t) sysconf(_SC_PAGESIZE);
+    if (read_text(meminfoFd, text, sizeof(text)) <= 0) {
+        return -1;
+    }
+    *total = field(text, "MemTotal:") * KB;
+    return 0;
+}
+
+void memory_platform_close(void) {
+    if (meminfoFd >= 0) {
+        close(meminfoFd);
+        meminfoFd = -1;
+    }
+    if (vmstatFd >= 0) {
+        close(vmstatFd);
+        vmstatFd = -1;
+    }
+}
+
+int memory_platform_read(struct memory_counters *counters) {
+    char text[8192];
+
+    if (read_text(meminfoFd, text, sizeof(text)) <= 0) {
+        return -1;
+    }
+    counters->used = (field(text, "MemTotal:") - field(text, "MemAvailable:")) * KB;
+    counters->free = field(text, "MemFree:") * KB;
+    counters->active = field(text, "Active:") * KB;
+    counters->inactive = field(text, "Inactive:") * KB;
+    counters->wired = (field(text, "Unevictable:") + field(text, "KernelStack:") +
+                       field(text, "PageTables:") + field(text, "SUnreclaim:")) * KB;
+    counters->compressed = field(text, "Zswap:") * KB;
+    counters->purgeable = field(text, "SReclaimable:") * KB;
+    counters->swapUsed = (field(text, "SwapTotal:") - field(text, "SwapFree:")) * KB;
+
+    if (read_text(vmstatFd, text, sizeof(text)) <= 0) {
+        return -1;
+    }
+    // pgpgin and pgpgout count kB moved from and to disk
+    counters->pageIns = field(text, "pgpgin ") * KB / pageSize;
+    counters->pageOuts = field(text, "pgpgout ") * KB / pageSize;
+    counters->compressions = field(text, "zswpout ");
+    counters->decompressions = field(text, "zswpin ");
+    return 0;
+}
@@ -0,0 +1,61 @@
+//
+// macOS part of the memory subsystem: one host_statistics64 call per sample, plus the
+// vm.swapusage sysctl for swap.
+//
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+#include <mach/mach.h>
+#include <mach/vm_statistics.h>
+#include <mach/mach_host.h>
+
+#include "memoryStats.h"
+
+static mach_port_t hostPort = MACH_PORT_NULL;
+static uint64_t pageSize;
+
+int memory_platform_open(uint64_t *total) {
+    int mib[2] = {CTL_HW, HW_MEMSIZE};
+    size_t length = sizeof(*total);
+    vm_size_t hostPageSize;
+
+    hostPort = mach_host_self();
+    if (host_page_size(hostPort, &hostPageSize) != KERN_SUCCESS ||
+        sysctl(mib, 2, total, &length, NULL, 0) != 0) {
+        return -1;
+    }
+    pageSize = hostPageSize;
+    return 0;
+}
+
+void memory_platform_close(void) {
+    if (hostPort != MACH_PORT_NULL) {
+        mach_port_deallocate(mach_task_self(), hostPort);
+        hostPort = MACH_PORT_NULL;
+    }
+}
+
+int memory_platform_read(struct memory_counters *counters) {
+    vm_statistics64_data_t vmStats;
+    mach_msg_type_number_t count = HOST_VM_INFO64_COUNT;
+    struct xsw_usage swap;
+    size_t length = sizeof(swap);
+
+    if (host_statistics64(hostPort, HOST_VM_INFO64, (host_info64_t) &vmStats, &count) != KERN_SUCCESS) {
+        return -1;
+    }
+    // used memory = active + inactive + wired, note that on Mac inactive mem is still used
+    counters->used = ((uint64_t) vmStats.active_count + vmStats.inactive_count + vmStats.wire_count) * pageSize;
+    counters->free = (uint64_t) vmStats.free_count * pageSize;
+    counters->active = (uint64_t) vmStats.active_count * pageSize;
+    counters->inactive = (uint64_t) vmStats.inactive_count * pageSize;
+    counters->wired = (uint64_t) vmStats.wire_count * pageSize;
+    counters->compressed = (uint64_t) vmStats.compressor_page_count * pageSize;
+    counters->purgeable = (uint64_t) vmStats.purgeable_count * pageSize;
+    counters->pageIns = vmStats.pageins;
+    counters->pageOuts = vmStats.pageouts;
+    counters->compressions = vmStats.compressions;
+    counters->decompressions = vmStats.decompressions;
+    counters->swapUsed = sysctlbyname("vm.swapusage", &swap, &length, NULL, 0) == 0 ? swap.xsu_used : 0;
+    return 0;
+}
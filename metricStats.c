@@ -0,0 +1,97 @@
+//
+// Sliding window statistics, see metricStats.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "metricStats.h"
+
+int metric_stats_init(struct metric_stats *stats, unsigned int window, double alpha) {
+    memset(stats, 0, sizeof(struct metric_stats));
+    stats->window = window > 0 ? window : 1;
+    stats->alpha = alpha;
+
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        struct metric_window *w = &stats->metrics[i];
+        w->values = calloc(stats->window, sizeof(double));
+        w->minQueue = calloc(stats->window + 1, sizeof(uint64_t));
+        w->maxQueue = calloc(stats->window + 1, sizeof(uint64_t));
+        if (w->values == NULL || w->minQueue == NULL || w->maxQueue == NULL) {
+            metric_stats_free(stats);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void metric_stats_free(struct metric_stats *stats) {
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        free(stats->metrics[i].values);
+        free(stats->metrics[i].minQueue);
+        free(stats->metrics[i].maxQueue);
+        stats->metrics[i].values = NULL;
+        stats->metrics[i].minQueue = NULL;
+        stats->metrics[i].maxQueue = NULL;
+    }
+}
+
+// the queues are circular over window + 1 entries, head == tail means empty
+static void window_push(struct metric_window *w, unsigned int window, double alpha, double value) {
+    uint64_t n = w->samples;
+    unsigned int size = window + 1;
+
+    if (n >= window) {
+        w->sum -= w->values[n % window];
+    }
+    w->values[n % window] = value;
+    w->sum += value;
+    w->ewma = n == 0 ? value : alpha * value + (1 - alpha) * w->ewma;
+
+    // drop samples that left the window from the front
+    while (w->minHead != w->minTail && w->minQueue[w->minHead] + window <= n) {
+        w->minHead = (w->minHead + 1) % size;
+    }
+    while (w->maxHead != w->maxTail && w->maxQueue[w->maxHead] + window <= n) {
+        w->maxHead = (w->maxHead + 1) % size;
+    }
+    // and samples the new value dominates from the back
+    while (w->minHead != w->minTail && w->values[w->minQueue[(w->minTail + window) % size] % window] >= value) {
+        w->minTail = (w->minTail + window) % size;
+    }
+    while (w->maxHead != w->maxTail && w->values[w->maxQueue[(w->maxTail + window) % size] % window] <= value) {
+        w->maxTail = (w->maxTail + window) % size;
+    }
+    w->minQueue[w->minTail] = n;
+    w->minTail = (w->minTail + 1) % size;
+    w->maxQueue[w->maxTail] = n;
+    w->maxTail = (w->maxTail + 1) % size;
+
+    w->samples = n + 1;
+}
+
+void metric_stats_update(struct metric_stats *stats, const struct snapshot *snap, uint32_t bits) {
+    double value;
+
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        if ((metric_valid_bit(i) & bits) && snapshot_metric(snap, i, &value)) {
+            window_push(&stats->metrics[i], stats->window, stats->alpha, value);
+        }
+    }
+}
+
+int metric_stats_get(const struct metric_stats *stats, int metric, struct metric_summary *out) {
+    const struct metric_window *w = &stats->metrics[metric];
+    unsigned int window = stats->window;
+
+    if (w->samples == 0) {
+        return 0;
+    }
+    out->count = w->samples < window ? (unsigned int) w->samples : window;
+    out->min = w->values[w->minQueue[w->minHead] % window];
+    out->max = w->values[w->maxQueue[w->maxHead] % window];
+    out->mean = w->sum / out->count;
+    out->ewma = w->ewma;
+    out->last = w->values[(w->samples - 1) % window];
+    return 1;
+}
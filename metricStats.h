@@ -0,0 +1,48 @@
+//
+// Sliding window statistics per metric: min, max and mean over the last `window` samples
+// that carried the metric, plus an exponentially weighted moving average.
+// Each update is O(1) (amortized for min/max, which use monotonic queues).
+//
+
+#ifndef FINALPROJECT_METRICSTATS_H
+#define FINALPROJECT_METRICSTATS_H
+
+#include "snapshot.h"
+
+struct metric_window {
+    double *values;         // circular buffer of the last `window` values
+    uint64_t *minQueue;     // sample numbers with increasing values, front is the minimum
+    uint64_t *maxQueue;     // sample numbers with decreasing values, front is the maximum
+    unsigned int minHead, minTail, maxHead, maxTail;
+    uint64_t samples;       // values pushed so far
+    double sum;
+    double ewma;
+};
+
+struct metric_stats {
+    unsigned int window;
+    double alpha;
+    struct metric_window metrics[METRIC_COUNT];
+};
+
+struct metric_summary {
+    unsigned int count;     // samples inside the window
+    double min;
+    double max;
+    double mean;
+    double ewma;
+    double last;
+};
+
+// window in samples, alpha is the EWMA weight of the newest sample; returns 0 on success
+int metric_stats_init(struct metric_stats *stats, unsigned int window, double alpha);
+
+void metric_stats_free(struct metric_stats *stats);
+
+// fold the metrics of snap whose SNAP_* bit is in bits into their windows
+void metric_stats_update(struct metric_stats *stats, const struct snapshot *snap, uint32_t bits);
+
+// returns 0 when the metric has not been seen yet
+int metric_stats_get(const struct metric_stats *stats, int metric, struct metric_summary *out);
+
+#endif //FINALPROJECT_METRICSTATS_H
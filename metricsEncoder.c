@@ -0,0 +1,161 @@
+//
+// Prometheus text encoder, see metricsEncoder.h
+//
+
+#include <string.h>
+#include <stddef.h>
+
+#include "metricsEncoder.h"
+#include "textBuffer.h"
+
+#define METRIC_PREFIX "macresmon_"
+
+static void put_header(struct text *out, const char *name, const char *help) {
+    text_put_str(out, "# HELP " METRIC_PREFIX);
+    text_put_str(out, name);
+    text_put_bytes(out, " ", 1);
+    text_put_str(out, help);
+    text_put_str(out, "\n# TYPE " METRIC_PREFIX);
+    text_put_str(out, name);
+    text_put_str(out, " gauge\n");
+}
+
+static void put_gauge(struct text *out, const char *name, const char *help, double value) {
+    put_header(out, name, help);
+    text_put_str(out, METRIC_PREFIX);
+    text_put_str(out, name);
+    text_put_bytes(out, " ", 1);
+    text_put_double(out, value);
+    text_put_bytes(out, "\n", 1);
+}
+
+// escaped as the exposition format wants label values
+static void put_label_value(struct text *out, const char *value) {
+    for (; *value != '\0'; value++) {
+        if (*value == '\\' || *value == '"') {
+            text_put_bytes(out, "\\", 1);
+        } else if (*value == '\n') {
+            text_put_bytes(out, "\\n", 2);
+            continue;
+        }
+        text_put_bytes(out, value, 1);
+    }
+}
+
+static void put_labeled(struct text *out, const char *name, const char *label, const char *labelValue, double value) {
+    text_put_str(out, METRIC_PREFIX);
+    text_put_str(out, name);
+    text_put_bytes(out, "{", 1);
+    text_put_str(out, label);
+    text_put_bytes(out, "=\"", 2);
+    put_label_value(out, labelValue);
+    text_put_bytes(out, "\"} ", 3);
+    text_put_double(out, value);
+    text_put_bytes(out, "\n", 1);
+}
+
+size_t metrics_encode(const struct snapshot *snap, char *buf, size_t size) {
+    struct text out = {buf, 0, size, 0};
+    double value;
+
+    put_gauge(&out, "sample_timestamp_seconds", "Wall clock time of the newest sample.", snap->timestamp / 1e9);
+
+    // scalar metrics straight from the snapshot's metric table, fans are grouped below
+    for (int i = 0; i < METRIC_FAN_0; i++) {
+        if (i == METRIC_FAN_MAX || !snapshot_metric(snap, i, &value)) {
+            continue;
+        }
+        put_gauge(&out, metric_name(i), metric_help(i), value);
+    }
+    if (snap->valid & SNAP_DISK) {
+        put_gauge(&out, "disk_total_gb", "Size of the root volume in GB.", snap->diskTotal);
+        put_header(&out, "volume_total_gb", "Size of each mounted volume in GB.");
+        for (int i = 0; i < snap->volumeCount; i++) {
+            put_labeled(&out, "volume_total_gb", "mount", snap->volumes[i].mount, snap->volumes[i].total);
+        }
+        put_header(&out, "volume_free_gb", "Free space on each mounted volume in GB.");
+        for (int i = 0; i < snap->volumeCount; i++) {
+            put_labeled(&out, "volume_free_gb", "mount", snap->volumes[i].mount, snap->volumes[i].free);
+        }
+    }
+    if ((snap->valid & SNAP_DISK_IO) && snap->deviceCount > 0) {
+        static const struct {
+            const char *name;
+            const char *help;
+            size_t offset;
+        } rates[] = {
+                {"device_read_bytes_per_second",  "Bytes read per second.",    offsetof(struct device_sample, readBytes)},
+                {"device_write_bytes_per_second", "Bytes written per second.", offsetof(struct device_sample, writeBytes)},
+                {"device_reads_per_second",       "Read operations per second.", offsetof(struct device_sample, reads)},
+                {"device_writes_per_second",      "Write operations per second.", offsetof(struct device_sample, writes)},
+        };
+        for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+            put_header(&out, rates[r].name, rates[r].help);
+            for (int i = 0; i < snap->deviceCount; i++) {
+                const char *device = (const char *) &snap->devices[i];
+                put_labeled(&out, rates[r].name, "device", snap->devices[i].name,
+                            *(const double *) (device + rates[r].offset));
+            }
+        }
+    }
+    if ((snap->valid & SNAP_CPU_USAGE) && snap->coreCount > 0) {
+        put_header(&out, "core_busy_percent", "Share of time each core spent outside idle, in percent.");
+        for (int i = 0; i < snap->coreCount; i++) {
+            text_put_str(&out, METRIC_PREFIX "core_busy_percent{core=\"");
+            text_put_uint(&out, (uint64_t) i);
+            text_put_str(&out, "\"} ");
+            text_put_double(&out, 100.0 - snap->coreIdle[i]);
+            text_put_bytes(&out, "\n", 1);
+        }
+    }
+    if (snap->valid & SNAP_LOAD) {
+        put_gauge(&out, "load_5m", "Load average over the last 5 minutes.", snap->loadAverage[1]);
+        put_gauge(&out, "load_15m", "Load average over the last 15 minutes.", snap->loadAverage[2]);
+    }
+    // per process series would come and go with every pid, only the count is exported
+    if (snap->valid & SNAP_PROCESSES) {
+        put_gauge(&out, "processes", "Processes running.", snap->processCount);
+    }
+    if (snap->valid & SNAP_MEM) {
+        put_gauge(&out, "mem_total_gb", "Physical memory installed in GB.", snap->memTotal);
+    }
+    if (snap->valid & SNAP_MEM_DETAIL) {
+        const struct {
+            const char *state;
+            double value;
+        } states[] = {
+                {"free", snap->memFree}, {"active", snap->memActive}, {"inactive", snap->memInactive},
+                {"wired", snap->memWired}, {"compressed", snap->memCompressed}, {"purgeable", snap->memPurgeable},
+        };
+        put_header(&out, "mem_state_gb", "Physical memory by page state in GB.");
+        for (size_t i = 0; i < sizeof(states) / sizeof(states[0]); i++) {
+            put_labeled(&out, "mem_state_gb", "state", states[i].state, states[i].value);
+        }
+    }
+    if (snap->valid & SNAP_MEM_RATES) {
+        put_gauge(&out, "page_ins_per_second", "Pages read in from disk per second.", snap->pageInRate);
+        put_gauge(&out, "compressions_per_second", "Pages compressed per second.", snap->compressionRate);
+        put_gauge(&out, "decompressions_per_second", "Pages decompressed per second.", snap->decompressionRate);
+    }
+    if (snap->valid & SNAP_SELF) {
+        put_gauge(&out, "self_syscalls_per_second", "System calls of macResMon itself.", snap->selfSyscalls);
+        put_gauge(&out, "self_smc_calls_per_second", "SMC calls of macResMon itself.", snap->selfSmcCalls);
+    }
+    if ((snap->valid & SNAP_BATTERY) && snap->batteryPresent) {
+        put_gauge(&out, "battery_powered", "1 when charging or fully charged.", snap->batteryPowered);
+        put_gauge(&out, "battery_minutes", "Time to empty, -1 while the system is still calculating.",
+                  snap->batteryMinutes);
+    }
+    if ((snap->valid & SNAP_FANS) && snap->fanCount > 0) {
+        put_gauge(&out, "fan_max_rpm", metric_help(METRIC_FAN_MAX), snap->fanMax);
+        put_header(&out, "fan_rpm", "Current speed of each fan in rpm.");
+        for (int i = 0; i < snap->fanCount; i++) {
+            text_put_str(&out, METRIC_PREFIX "fan_rpm{fan=\"");
+            text_put_uint(&out, (uint64_t) i);
+            text_put_str(&out, "\"} ");
+            text_put_double(&out, snap->fanSpeed[i]);
+            text_put_bytes(&out, "\n", 1);
+        }
+    }
+    return out.overflow ? 0 : out.length;
+}
@@ -0,0 +1,19 @@
+//
+// Prometheus text exposition of a snapshot, written into a caller supplied buffer
+// with hand rolled number formatting instead of printf.
+//
+
+#ifndef FINALPROJECT_METRICSENCODER_H
+#define FINALPROJECT_METRICSENCODER_H
+
+#include <stddef.h>
+
+#include "snapshot.h"
+
+// large enough for every metric of a snapshot
+#define METRICS_TEXT_SIZE 16384
+
+// encode the metrics carried by snap, returns the length or 0 when buf is too small
+size_t metrics_encode(const struct snapshot *snap, char *buf, size_t size);
+
+#endif //FINALPROJECT_METRICSENCODER_H
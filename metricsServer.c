@@ -0,0 +1,251 @@
+//
+// /metrics server, see metricsServer.h
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "metricsServer.h"
+#include "metricsEncoder.h"
+
+#define MAX_CLIENTS 64
+#define REQUEST_SIZE 2048
+#define RESPONSE_HEADER_SIZE 160
+
+#define NOT_FOUND_RESPONSE "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+
+struct client {
+    int fd;
+    size_t received;
+    const char *response;       // NULL while the request is still being read
+    size_t responseLength;
+    size_t sent;
+    char request[REQUEST_SIZE];
+};
+
+static const struct snapshot_ring *ring;
+static pthread_t thread;
+static int listenFd = -1;
+static int stopPipe[2] = {-1, -1};
+static struct client clients[MAX_CLIENTS];
+
+// header and body are encoded back to back so a scrape is a single write
+static char response[RESPONSE_HEADER_SIZE + METRICS_TEXT_SIZE];
+static size_t responseLength = 0;
+static uint64_t encodedHead = 0;
+
+static int set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags < 0 ? -1 : fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// a client still writing the shared buffer would get a torn body under its old Content-Length
+static int response_in_flight(void) {
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0 && clients[i].response == response) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// re-encode only when a sample landed since the last scrape and nobody is still reading the previous one
+static void refresh_response(void) {
+    static char body[METRICS_TEXT_SIZE];
+    struct snapshot snap;
+    uint64_t head = snapshot_ring_head(ring);
+    size_t length;
+    int header;
+
+    if (responseLength != 0 && (head == encodedHead || response_in_flight())) {
+        return;
+    }
+    length = snapshot_ring_latest(ring, &snap, NULL) == 0 ? metrics_encode(&snap, body, sizeof(body)) : 0;
+    header = snprintf(response, RESPONSE_HEADER_SIZE,
+                      "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                      "Content-Length: %zu\r\nConnection: close\r\n\r\n", length);
+    memcpy(response + header, body, length);
+    responseLength = (size_t) header + length;
+    encodedHead = head;
+}
+
+static void drop_client(struct client *client) {
+    close(client->fd);
+    client->fd = -1;
+}
+
+static void accept_clients(void) {
+    for (;;) {
+        int fd = accept(listenFd, NULL, NULL);
+        if (fd < 0) {
+            return;
+        }
+        struct client *client = NULL;
+        for (int i = 0; i < MAX_CLIENTS && client == NULL; i++) {
+            if (clients[i].fd < 0) {
+                client = &clients[i];
+            }
+        }
+        if (client == NULL || set_nonblocking(fd) != 0) {
+            close(fd);
+            continue;
+        }
+        client->fd = fd;
+        client->received = 0;
+        client->response = NULL;
+        client->sent = 0;
+    }
+}
+
+static void read_request(struct client *client) {
+    ssize_t length = read(client->fd, client->request + client->received, REQUEST_SIZE - 1 - client->received);
+
+    if (length <= 0) {
+        if (length == 0 || (errno != EAGAIN && errno != EINTR)) {
+            drop_client(client);
+        }
+        return;
+    }
+    client->received += (size_t) length;
+    client->request[client->received] = '\0';
+    if (strstr(client->request, "\r\n\r\n") == NULL) {
+        if (client->received == REQUEST_SIZE - 1) {
+            drop_client(client);
+        }
+        return;
+    }
+
+    if (strncmp(client->request, "GET /metrics ", 13) == 0) {
+        refresh_response();
+        client->response = response;
+        client->responseLength = responseLength;
+    } else {
+        client->response = NOT_FOUND_RESPONSE;
+        client->responseLength = sizeof(NOT_FOUND_RESPONSE) - 1;
+    }
+}
+
+static void write_response(struct client *client) {
+    ssize_t length = write(client->fd, client->response + client->sent, client->responseLength - client->sent);
+
+    if (length < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            drop_client(client);
+        }
+        return;
+    }
+    client->sent += (size_t) length;
+    if (client->sent == client->responseLength) {
+        drop_client(client);
+    }
+}
+
+static void *serve(void *arg) {
+    struct pollfd fds[MAX_CLIENTS + 2];
+    int owner[MAX_CLIENTS + 2];
+
+    for (;;) {
+        nfds_t count = 0;
+
+        fds[count++] = (struct pollfd) {stopPipe[0], POLLIN, 0};
+        fds[count++] = (struct pollfd) {listenFd, POLLIN, 0};
+        for (int i = 0; i < MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                owner[count] = i;
+                fds[count++] = (struct pollfd) {clients[i].fd, clients[i].response ? POLLOUT : POLLIN, 0};
+            }
+        }
+        if (poll(fds, count, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[0].revents) {
+            break;
+        }
+        for (nfds_t i = 2; i < count; i++) {
+            struct client *client = &clients[owner[i]];
+            if (fds[i].revents & (POLLERR | POLLNVAL)) {
+                drop_client(client);
+            } else if (fds[i].revents & (POLLIN | POLLHUP) && client->response == NULL) {
+                read_request(client);
+            } else if (fds[i].revents & POLLOUT) {
+                write_response(client);
+            }
+        }
+        if (fds[1].revents & POLLIN) {
+            accept_clients();
+        }
+    }
+    return NULL;
+}
+
+int metrics_server_start(int port, const struct snapshot_ring *history) {
+    struct sockaddr_in address;
+    int yes = 1;
+
+    ring = history;
+    responseLength = 0;
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+
+    listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        return -1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t) port);
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+    if (bind(listenFd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen(listenFd, 128) != 0 ||
+        set_nonblocking(listenFd) != 0 || pipe(stopPipe) != 0) {
+        close(listenFd);
+        listenFd = -1;
+        return -1;
+    }
+    // the thread inherits a blocked mask, so SIGINT keeps waking the sampling loop
+    sigset_t all, previous;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    int created = pthread_create(&thread, NULL, serve, NULL);
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    if (created != 0) {
+        close(listenFd);
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+        listenFd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+void metrics_server_stop(void) {
+    if (listenFd < 0) {
+        return;
+    }
+    // wake the poll loop, it exits as soon as the pipe is readable
+    if (write(stopPipe[1], "", 1) < 0) {
+        perror("could not stop the metrics server");
+    }
+    pthread_join(thread, NULL);
+    for (int i = 0; i < MAX_CLIENTS; i++) {
+        if (clients[i].fd >= 0) {
+            drop_client(&clients[i]);
+        }
+    }
+    close(listenFd);
+    close(stopPipe[0]);
+    close(stopPipe[1]);
+    listenFd = -1;
+}
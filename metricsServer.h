@@ -0,0 +1,18 @@
+//
+// Minimal HTTP server answering GET /metrics from the newest snapshot of the history ring.
+// It runs a poll loop on its own thread and never touches the sensors: the exposition text
+// is encoded once per new sample and every scrape in between gets the same bytes.
+//
+
+#ifndef FINALPROJECT_METRICSSERVER_H
+#define FINALPROJECT_METRICSSERVER_H
+
+#include "snapshotRing.h"
+
+// listen on port (loopback and every other interface) and serve history until stopped,
+// returns 0 once the server thread is running
+int metrics_server_start(int port, const struct snapshot_ring *history);
+
+void metrics_server_stop(void);
+
+#endif //FINALPROJECT_METRICSSERVER_H
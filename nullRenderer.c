@@ -0,0 +1,20 @@
+//
+// Renderer that draws nothing. A daemon keeps sampling, recording, exporting and
+// alerting without paying for formatting output nobody reads.
+//
+
+#include <stddef.h>
+
+#include "renderer.h"
+
+static int null_open(void) {
+    return 0;
+}
+
+static void null_render(const struct snapshot *snap, const struct metric_stats *stats, int flag) {
+}
+
+static void null_close(void) {
+}
+
+const struct renderer null_renderer = {"none", null_open, null_render, null_close, NULL, NULL};
@@ -0,0 +1,31 @@
+//
+// Power source selection, see powerSource.h
+//
+
+#include <string.h>
+
+#include "powerSource.h"
+#include "fakePowerSource.h"
+
+#ifdef __APPLE__
+static const struct power_source *source = &iokit_power_source;
+#else
+static const struct power_source *source = &fake_power_source;
+#endif
+
+void power_source_set(const struct power_source *newSource) {
+    source = newSource;
+}
+
+int power_source_read(struct power_info *info) {
+    memset(info, 0, sizeof(*info));
+    if (source->read(info) != 0) {
+        info->present = 0;
+        return -1;
+    }
+    return 0;
+}
+
+int power_info_powered(const struct power_info *info) {
+    return info->charged || info->charging;
+}
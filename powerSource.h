@@ -0,0 +1,38 @@
+//
+// Battery information, read once per tick into a plain struct.
+// The source behind it is pluggable: IOKit power sources on macOS, an in-memory fake elsewhere.
+//
+
+#ifndef FINALPROJECT_POWERSOURCE_H
+#define FINALPROJECT_POWERSOURCE_H
+
+#define POWER_HEALTH_LENGTH 32
+
+struct power_info {
+    int present;            // 0 on machines without a battery, the other fields are then unset
+    int percent;
+    int charging;
+    int charged;
+    int minutesToEmpty;     // -1 while the system is still calculating
+    char health[POWER_HEALTH_LENGTH];
+};
+
+struct power_source {
+    const char *name;
+    // fill info from one fetch of the system state, returns 0 on success
+    int (*read)(struct power_info *info);
+};
+
+#ifdef __APPLE__
+extern const struct power_source iokit_power_source;
+#endif
+
+void power_source_set(const struct power_source *source);
+
+// one fetch of the battery state, info->present is 0 when there is none or the fetch failed
+int power_source_read(struct power_info *info);
+
+// charging or fully charged, the machine runs from the wall
+int power_info_powered(const struct power_info *info);
+
+#endif //FINALPROJECT_POWERSOURCE_H
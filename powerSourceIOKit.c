@@ -0,0 +1,69 @@
+//
+// IOKit power source: one IOPSCopyPowerSourcesInfo per read, copied into a power_info
+// and released before returning.
+// Some parts of this c file come from Github repo /osx-cpu-temp and /libsmc and /iStats
+// Please refer to their repos for license information
+//
+
+#include <string.h>
+#include <IOKit/ps/IOPowerSources.h>
+#include <IOKit/ps/IOPSKeys.h>
+
+#include "powerSource.h"
+
+static int dictionary_int(CFDictionaryRef dictionary, CFStringRef key, int fallback) {
+    int value;
+    CFNumberRef number = CFDictionaryGetValue(dictionary, key);
+    if (number == NULL || !CFNumberGetValue(number, kCFNumberIntType, &value)) {
+        return fallback;
+    }
+    return value;
+}
+
+static int dictionary_bool(CFDictionaryRef dictionary, CFStringRef key) {
+    // a missing boolean means false, IsCharged for one is only present once it is
+    CFBooleanRef boolean = CFDictionaryGetValue(dictionary, key);
+    return boolean != NULL && CFBooleanGetValue(boolean);
+}
+
+static void copy_description(CFDictionaryRef description, struct power_info *info) {
+    info->present = 1;
+    info->percent = dictionary_int(description, CFSTR(kIOPSCurrentCapacityKey), 0);
+    info->charging = dictionary_bool(description, CFSTR(kIOPSIsChargingKey));
+    info->charged = dictionary_bool(description, CFSTR(kIOPSIsChargedKey));
+    info->minutesToEmpty = dictionary_int(description, CFSTR(kIOPSTimeToEmptyKey), -1);
+
+    // copy instead of CFStringGetCStringPtr, whose pointer dies with the dictionary
+    CFStringRef health = CFDictionaryGetValue(description, CFSTR("BatteryHealth"));
+    if (health == NULL || !CFStringGetCString(health, info->health, sizeof(info->health), kCFStringEncodingUTF8)) {
+        strcpy(info->health, "Unknown");
+    }
+}
+
+static int iokit_read(struct power_info *info) {
+    CFTypeRef powerInfo = IOPSCopyPowerSourcesInfo();
+    if (powerInfo == NULL) {
+        return -1;
+    }
+
+    CFArrayRef powerSourcesList = IOPSCopyPowerSourcesList(powerInfo);
+    if (powerSourcesList == NULL) {
+        CFRelease(powerInfo);
+        return -1;
+    }
+
+    // the description is owned by powerInfo, it has to be copied out before the release
+    if (CFArrayGetCount(powerSourcesList)) {
+        CFDictionaryRef description = IOPSGetPowerSourceDescription(powerInfo,
+                                                                    CFArrayGetValueAtIndex(powerSourcesList, 0));
+        if (description != NULL) {
+            copy_description(description, info);
+        }
+    }
+
+    CFRelease(powerSourcesList);
+    CFRelease(powerInfo);
+    return 0;
+}
+
+const struct power_source iokit_power_source = {"iokit", iokit_read};
@@ -0,0 +1,231 @@
+//
+// Process table, see processTable.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "processTable.h"
+
+#define Byte_TO_MB (1024.0 * 1024)
+#define MIN_CAPACITY 1024
+
+struct heap_entry {
+    double key;
+    int index;
+};
+
+static uint32_t slot_of(int pid, uint64_t startTime, uint32_t capacity) {
+    uint64_t hash = ((uint64_t) (uint32_t) pid << 32 ^ startTime) * 0x9e3779b97f4a7c15ull;
+    return (uint32_t) (hash >> 32) & (capacity - 1);
+}
+
+static struct process_slot *find(struct process_slot *map, uint32_t capacity, int pid, uint64_t startTime) {
+    for (uint32_t i = slot_of(pid, startTime, capacity);; i = (i + 1) & (capacity - 1)) {
+        if (map[i].pid == -1 || (map[i].pid == pid && map[i].startTime == startTime)) {
+            return &map[i];
+        }
+    }
+}
+
+static void clear_map(struct process_slot *map, uint32_t capacity) {
+    // all ones is pid -1 in every slot
+    memset(map, 0xff, capacity * sizeof(struct process_slot));
+}
+
+void process_tracker_init(struct process_tracker *tracker) {
+    memset(tracker, 0, sizeof(struct process_tracker));
+}
+
+// keep both maps at most half full, the previous readings move to the new map
+static int reserve(struct process_tracker *tracker, int count) {
+    uint32_t capacity = tracker->capacity ? tracker->capacity : MIN_CAPACITY;
+    struct process_slot *previous, *current;
+
+    while (capacity < (uint32_t) count * 2) {
+        capacity *= 2;
+    }
+    if (count > tracker->processCapacity) {
+        float *cpu = realloc(tracker->cpu, (size_t) count * sizeof(float));
+        double *keys = realloc(tracker->keys, (size_t) count * sizeof(double));
+        if (cpu != NULL) {
+            tracker->cpu = cpu;
+        }
+        if (keys != NULL) {
+            tracker->keys = keys;
+        }
+        if (cpu == NULL || keys == NULL) {
+            return -1;
+        }
+        tracker->processCapacity = count;
+    }
+    if (capacity == tracker->capacity) {
+        return 0;
+    }
+
+    previous = malloc(capacity * sizeof(struct process_slot));
+    current = malloc(capacity * sizeof(struct process_slot));
+    if (previous == NULL || current == NULL) {
+        free(previous);
+        free(current);
+        return -1;
+    }
+    clear_map(previous, capacity);
+    for (uint32_t i = 0; i < tracker->capacity; i++) {
+        if (tracker->previous[i].pid != -1) {
+            *find(previous, capacity, tracker->previous[i].pid, tracker->previous[i].startTime) = tracker->previous[i];
+        }
+    }
+    free(tracker->previous);
+    free(tracker->current);
+    tracker->previous = previous;
+    tracker->current = current;
+    tracker->capacity = capacity;
+    return 0;
+}
+
+static void sift_down(struct heap_entry *heap, int size, int i) {
+    for (;;) {
+        int smallest = i, left = 2 * i + 1, right = left + 1;
+        if (left < size && heap[left].key < heap[smallest].key) {
+            smallest = left;
+        }
+        if (right < size && heap[right].key < heap[smallest].key) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        struct heap_entry swap = heap[i];
+        heap[i] = heap[smallest];
+        heap[smallest] = swap;
+        i = smallest;
+    }
+}
+
+// the n largest keys into rows, largest first, in O(count log n)
+static int select_top(const double *keys, int count, const struct process_counters *counters,
+                      const float *cpu, struct process_sample *rows) {
+    struct heap_entry heap[SNAPSHOT_MAX_PROCESSES];
+    int size = 0;
+
+    for (int i = 0; i < count; i++) {
+        if (size < SNAPSHOT_MAX_PROCESSES) {
+            heap[size++] = (struct heap_entry) {keys[i], i};
+            if (size == SNAPSHOT_MAX_PROCESSES) {
+                for (int j = size / 2 - 1; j >= 0; j--) {
+                    sift_down(heap, size, j);
+                }
+            }
+        } else if (keys[i] > heap[0].key) {
+            heap[0] = (struct heap_entry) {keys[i], i};
+            sift_down(heap, size, 0);
+        }
+    }
+    if (size < SNAPSHOT_MAX_PROCESSES) {
+        for (int j = size / 2 - 1; j >= 0; j--) {
+            sift_down(heap, size, j);
+        }
+    }
+
+    // popping the min-heap yields the rows from the bottom up
+    for (int row = size - 1; row >= 0; row--) {
+        const struct process_counters *process = &counters[heap[0].index];
+        rows[row].pid = process->pid;
+        memcpy(rows[row].name, process->name, PROCESS_NAME_LENGTH);
+        rows[row].cpu = cpu[heap[0].index];
+        rows[row].rss = process->rss / Byte_TO_MB;
+        heap[0] = heap[row];
+        sift_down(heap, row, 0);
+    }
+    return size;
+}
+
+int process_tracker_update(struct process_tracker *tracker, const struct process_counters *counters,
+                           int count, uint64_t now, struct snapshot *snap) {
+    uint64_t elapsed = now - tracker->previousTime;
+    int first = tracker->previousTime == 0 || elapsed == 0;
+
+    if (reserve(tracker, count) != 0) {
+        return -1;
+    }
+
+    clear_map(tracker->current, tracker->capacity);
+    for (int i = 0; i < count; i++) {
+        const struct process_counters *process = &counters[i];
+        const struct process_slot *before = find(tracker->previous, tracker->capacity, process->pid,
+                                                 process->startTime);
+        struct process_slot *slot = find(tracker->current, tracker->capacity, process->pid, process->startTime);
+
+        // a process started since the last update used all of its cpu time since its start,
+        // or since the last update when the platform does not tell its age
+        if (first || (before->pid != -1 && process->cpuTime < before->cpuTime)) {
+            tracker->cpu[i] = 0.0f;
+        } else if (before->pid == -1) {
+            uint64_t window = process->age != 0 && process->age < elapsed ? process->age : elapsed;
+            tracker->cpu[i] = (float) (process->cpuTime * 100.0 / window);
+        } else {
+            tracker->cpu[i] = (float) ((process->cpuTime - before->cpuTime) * 100.0 / elapsed);
+        }
+        *slot = (struct process_slot) {process->pid, process->startTime, process->cpuTime};
+    }
+
+    struct process_slot *swap = tracker->previous;
+    tracker->previous = tracker->current;
+    tracker->current = swap;
+    tracker->previousTime = now;
+    if (first) {
+        return 0;
+    }
+
+    for (int i = 0; i < count; i++) {
+        tracker->keys[i] = tracker->cpu[i];
+    }
+    snap->topCount = select_top(tracker->keys, count, counters, tracker->cpu, snap->topCpu);
+    for (int i = 0; i < count; i++) {
+        tracker->keys[i] = (double) counters[i].rss;
+    }
+    select_top(tracker->keys, count, counters, tracker->cpu, snap->topMemory);
+    snap->processCount = count;
+    snap->valid |= SNAP_PROCESSES;
+    return 0;
+}
+
+void process_tracker_free(struct process_tracker *tracker) {
+    free(tracker->previous);
+    free(tracker->current);
+    free(tracker->cpu);
+    free(tracker->keys);
+    process_tracker_init(tracker);
+}
+
+static struct process_tracker tracker;
+static struct process_counters *counters = NULL;
+static int counterCapacity = 0;
+
+static uint64_t nanoseconds_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+int process_table_open(void) {
+    process_tracker_init(&tracker);
+    return process_platform_open();
+}
+
+void process_table_sample(struct snapshot *snap) {
+    int count = process_platform_read(&counters, &counterCapacity);
+    if (count > 0) {
+        process_tracker_update(&tracker, counters, count, nanoseconds_now(), snap);
+    }
+}
+
+void process_table_close(void) {
+    process_platform_close();
+    process_tracker_free(&tracker);
+    free(counters);
+    counters = NULL;
+    counterCapacity = 0;
+}
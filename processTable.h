@@ -0,0 +1,70 @@
+//
+// Process table shared by the hardware backends: the busiest processes by cpu and by
+// resident memory. Cpu time is cumulative, so the tracker keeps each process's previous
+// reading in a hash map keyed by pid and start time (a reused pid is a new process) and
+// turns two readings into a share. The top rows are picked with a bounded heap instead
+// of sorting every process, and all buffers live across samples.
+//
+
+#ifndef FINALPROJECT_PROCESSTABLE_H
+#define FINALPROJECT_PROCESSTABLE_H
+
+#include <stdint.h>
+
+#include "snapshot.h"
+
+// one process as the platform reports it
+struct process_counters {
+    int pid;
+    uint64_t startTime;     // platform units, only compared for equality
+    uint64_t cpuTime;       // user and system, ns since the process started
+    uint64_t age;           // ns since the process started, 0 when the platform cannot tell
+    uint64_t rss;           // bytes
+    char name[PROCESS_NAME_LENGTH];
+};
+
+// previous reading of a process, pid -1 marks an empty slot
+struct process_slot {
+    int pid;
+    uint64_t startTime;
+    uint64_t cpuTime;
+};
+
+struct process_tracker {
+    // readings of the previous and the current update, swapped after every update
+    struct process_slot *previous;
+    struct process_slot *current;
+    uint32_t capacity;          // slots of each map, a power of two
+    float *cpu;                 // share of each process of the last update
+    double *keys;               // scratch for picking the top rows
+    int processCapacity;        // entries of cpu and keys
+    uint64_t previousTime;      // ns, 0 before the first update
+};
+
+// ---- platform part, processTableLinux.c or processTableMac.c ----
+
+int process_platform_open(void);
+
+void process_platform_close(void);
+
+// read every process into *counters, growing it as needed, returns how many or -1
+int process_platform_read(struct process_counters **counters, int *capacity);
+
+// ---- common part, processTable.c ----
+
+void process_tracker_init(struct process_tracker *tracker);
+
+// match counters against the previous update taken at time now (ns, monotonic) and fill
+// the SNAP_PROCESSES fields of snap, from the second update on. Returns 0 on success
+int process_tracker_update(struct process_tracker *tracker, const struct process_counters *counters,
+                           int count, uint64_t now, struct snapshot *snap);
+
+void process_tracker_free(struct process_tracker *tracker);
+
+int process_table_open(void);
+
+void process_table_sample(struct snapshot *snap);
+
+void process_table_close(void);
+
+#endif //FINALPROJECT_PROCESSTABLE_H
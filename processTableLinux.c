@@ -0,0 +1,117 @@
+//
+// Linux part of the process table: /proc/[pid]/stat of every numeric entry of /proc.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+
+#include "processTable.h"
+
+static DIR *proc = NULL;
+static uint64_t nsPerTick;
+static uint64_t pageSize;
+
+int process_platform_open(void) {
+    proc = opendir("/proc");
+    nsPerTick = 1000000000ull / (uint64_t) sysconf(_SC_CLK_TCK);
+    pageSize = (uint64_t) sysconf(_SC_PAGESIZE);
+    return proc != NULL ? 0 : -1;
+}
+
+void process_platform_close(void) {
+    if (proc != NULL) {
+        closedir(proc);
+        proc = NULL;
+    }
+}
+
+// fields of /proc/[pid]/stat after the command, which is in parentheses and may contain
+// spaces or parentheses itself, so the line is split at the last ')'
+static int read_stat(const char *pid, uint64_t uptime, struct process_counters *process) {
+    char path[32], text[1024];
+    char *nameStart, *nameEnd, *field;
+    ssize_t length;
+    int fd;
+
+    snprintf(path, sizeof(path), "/proc/%s/stat", pid);
+    if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0) {
+        return -1;
+    }
+    length = read(fd, text, sizeof(text) - 1);
+    close(fd);
+    if (length <= 0) {
+        return -1;
+    }
+    text[length] = '\0';
+    if ((nameStart = strchr(text, '(')) == NULL || (nameEnd = strrchr(text, ')')) == NULL || nameEnd < nameStart) {
+        return -1;
+    }
+
+    size_t nameLength = (size_t) (nameEnd - nameStart - 1);
+    if (nameLength >= PROCESS_NAME_LENGTH) {
+        nameLength = PROCESS_NAME_LENGTH - 1;
+    }
+    memcpy(process->name, nameStart + 1, nameLength);
+    process->name[nameLength] = '\0';
+    process->pid = atoi(text);
+
+    // field 3 is the state, utime and stime are 14 and 15, starttime 22 and rss 24
+    field = nameEnd + 2;
+    unsigned long long value[25] = {0};
+    for (int i = 3; i <= 24 && *field != '\0'; i++) {
+        char *end;
+        value[i] = strtoull(field, &end, 10);
+        field = end;
+        while (*field != '\0' && *field != ' ') {
+            field++;
+        }
+        while (*field == ' ') {
+            field++;
+        }
+    }
+    process->cpuTime = (value[14] + value[15]) * nsPerTick;
+    process->startTime = value[22];
+    process->age = uptime > value[22] * nsPerTick ? uptime - value[22] * nsPerTick : 0;
+    process->rss = value[24] * pageSize;
+    return 0;
+}
+
+int process_platform_read(struct process_counters **counters, int *capacity) {
+    struct dirent *entry;
+    struct timespec now;
+    uint64_t uptime;
+    int count = 0;
+
+    if (proc == NULL) {
+        return -1;
+    }
+    // starttime counts ticks since boot, suspended time included
+    clock_gettime(CLOCK_BOOTTIME, &now);
+    uptime = (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+    rewinddir(proc);
+    while ((entry = readdir(proc)) != NULL) {
+        if (!isdigit((unsigned char) entry->d_name[0])) {
+            continue;
+        }
+        if (count == *capacity) {
+            int grown = *capacity ? *capacity * 2 : 512;
+            struct process_counters *larger = realloc(*counters, (size_t) grown * sizeof(struct process_counters));
+            if (larger == NULL) {
+                break;
+            }
+            *counters = larger;
+            *capacity = grown;
+        }
+        // a process that exited since readdir is simply skipped
+        if (read_stat(entry->d_name, uptime, &(*counters)[count]) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,86 @@
+//
+// macOS part of the process table: proc_listpids for the pids and proc_pidinfo for each.
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <libproc.h>
+#include <sys/proc_info.h>
+#include <sys/time.h>
+#include <mach/mach_time.h>
+
+#include "processTable.h"
+
+static pid_t *pids = NULL;
+static int pidCapacity = 0;
+// task times are in mach absolute time units, which are not ns on Apple silicon
+static mach_timebase_info_data_t timebase;
+
+int process_platform_open(void) {
+    return mach_timebase_info(&timebase) == KERN_SUCCESS ? 0 : -1;
+}
+
+void process_platform_close(void) {
+    free(pids);
+    pids = NULL;
+    pidCapacity = 0;
+}
+
+int process_platform_read(struct process_counters **counters, int *capacity) {
+    struct timeval now;
+    uint64_t nowMicroseconds;
+    int bytes, pidCount, count = 0;
+
+    // the list can grow between sizing and reading it, leave some room
+    bytes = proc_listpids(PROC_ALL_PIDS, 0, NULL, 0);
+    if (bytes <= 0) {
+        return -1;
+    }
+    if (bytes / (int) sizeof(pid_t) + 64 > pidCapacity) {
+        int grown = bytes / (int) sizeof(pid_t) + 256;
+        pid_t *larger = realloc(pids, (size_t) grown * sizeof(pid_t));
+        if (larger == NULL) {
+            return -1;
+        }
+        pids = larger;
+        pidCapacity = grown;
+    }
+    bytes = proc_listpids(PROC_ALL_PIDS, 0, pids, pidCapacity * (int) sizeof(pid_t));
+    if (bytes <= 0) {
+        return -1;
+    }
+    pidCount = bytes / (int) sizeof(pid_t);
+    // start times are wall clock
+    gettimeofday(&now, NULL);
+    nowMicroseconds = (uint64_t) now.tv_sec * 1000000ull + (uint64_t) now.tv_usec;
+    if (pidCount > *capacity) {
+        struct process_counters *larger = realloc(*counters, (size_t) pidCount * sizeof(struct process_counters));
+        if (larger == NULL) {
+            return -1;
+        }
+        *counters = larger;
+        *capacity = pidCount;
+    }
+
+    for (int i = 0; i < pidCount; i++) {
+        struct proc_bsdinfo bsd;
+        struct proc_taskinfo task;
+        struct process_counters *process = &(*counters)[count];
+
+        // processes of other users fail without root and are left out
+        if (pids[i] == 0 ||
+            proc_pidinfo(pids[i], PROC_PIDTBSDINFO, 0, &bsd, sizeof(bsd)) != sizeof(bsd) ||
+            proc_pidinfo(pids[i], PROC_PIDTASKINFO, 0, &task, sizeof(task)) != sizeof(task)) {
+            continue;
+        }
+        process->pid = pids[i];
+        process->startTime = bsd.pbi_start_tvsec * 1000000ull + bsd.pbi_start_tvusec;
+        process->age = nowMicroseconds > process->startTime ? (nowMicroseconds - process->startTime) * 1000 : 0;
+        process->cpuTime = (task.pti_total_user + task.pti_total_system) * timebase.numer / timebase.denom;
+        process->rss = task.pti_resident_size;
+        strncpy(process->name, bsd.pbi_name[0] != '\0' ? bsd.pbi_name : bsd.pbi_comm, PROCESS_NAME_LENGTH - 1);
+        process->name[PROCESS_NAME_LENGTH - 1] = '\0';
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,487 @@
+//
+// Snapshot recording format, see recording.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "recording.h"
+
+#define FIELD(name) offsetof(struct snapshot, name)
+#define FAN_COLUMN(i) [REC_FAN_0 + (i)] = {FIELD(fanSpeed) + (i) * sizeof(double), 0, 4.0, SNAP_FANS}
+
+// worst case of one block: every varint at its longest
+#define VARINT_MAX 10
+#define PAYLOAD_MAX (RECORDING_BLOCK_SAMPLES * (2 + REC_COLUMN_COUNT) * VARINT_MAX)
+
+static const struct {
+    size_t offset;
+    int isInt;
+    double scale;
+    uint32_t validBit;
+} columns[REC_COLUMN_COUNT] = {
+        [REC_DISK_TOTAL]      = {FIELD(diskTotal), 0, 1000.0, SNAP_DISK},
+        [REC_DISK_FREE]       = {FIELD(diskFree), 0, 1000.0, SNAP_DISK},
+        [REC_CPU_TEMP]        = {FIELD(cpuTemp), 0, 256.0, SNAP_CPU_TEMP},
+        [REC_MEM_TEMP]        = {FIELD(memTemp), 0, 256.0, SNAP_MEM_TEMP},
+        [REC_GPU_TEMP]        = {FIELD(gpuTemp), 0, 256.0, SNAP_GPU_TEMP},
+        [REC_BATTERY_TEMP]    = {FIELD(batteryTemp), 0, 256.0, SNAP_BATTERY_TEMP},
+        [REC_FAN_COUNT]       = {FIELD(fanCount), 1, 1.0, SNAP_FANS},
+        [REC_FAN_MAX]         = {FIELD(fanMax), 0, 4.0, SNAP_FANS},
+        FAN_COLUMN(0), FAN_COLUMN(1), FAN_COLUMN(2), FAN_COLUMN(3), FAN_COLUMN(4),
+        FAN_COLUMN(5), FAN_COLUMN(6), FAN_COLUMN(7), FAN_COLUMN(8), FAN_COLUMN(9),
+        [REC_MEM_TOTAL]       = {FIELD(memTotal), 0, 1000.0, SNAP_MEM},
+        [REC_MEM_USED]        = {FIELD(memUsed), 0, 1000.0, SNAP_MEM},
+        [REC_BATTERY_PRESENT] = {FIELD(batteryPresent), 1, 1.0, SNAP_BATTERY},
+        [REC_BATTERY_PERCENT] = {FIELD(batteryPercent), 1, 1.0, SNAP_BATTERY},
+        [REC_BATTERY_POWERED] = {FIELD(batteryPowered), 1, 1.0, SNAP_BATTERY},
+        [REC_BATTERY_MINUTES] = {FIELD(batteryMinutes), 1, 1.0, SNAP_BATTERY},
+        [REC_LOAD_1]          = {FIELD(loadAverage[0]), 0, 100.0, SNAP_LOAD},
+        [REC_LOAD_5]          = {FIELD(loadAverage[1]), 0, 100.0, SNAP_LOAD},
+        [REC_LOAD_15]         = {FIELD(loadAverage[2]), 0, 100.0, SNAP_LOAD},
+        [REC_MEM_FREE]        = {FIELD(memFree), 0, 1000.0, SNAP_MEM_DETAIL},
+        [REC_MEM_ACTIVE]      = {FIELD(memActive), 0, 1000.0, SNAP_MEM_DETAIL},
+        [REC_MEM_INACTIVE]    = {FIELD(memInactive), 0, 1000.0, SNAP_MEM_DETAIL},
+        [REC_MEM_WIRED]       = {FIELD(memWired), 0, 1000.0, SNAP_MEM_DETAIL},
+        [REC_MEM_COMPRESSED]  = {FIELD(memCompressed), 0, 1000.0, SNAP_MEM_DETAIL},
+        [REC_MEM_PURGEABLE]   = {FIELD(memPurgeable), 0, 1000.0, SNAP_MEM_DETAIL},
+        [REC_SWAP_USED]       = {FIELD(swapUsed), 0, 1000.0, SNAP_MEM_DETAIL},
+        [REC_PAGE_IN_RATE]    = {FIELD(pageInRate), 0, 1.0, SNAP_MEM_RATES},
+        [REC_PAGE_OUT_RATE]   = {FIELD(pageOutRate), 0, 1.0, SNAP_MEM_RATES},
+        [REC_COMPRESSION_RATE] = {FIELD(compressionRate), 0, 1.0, SNAP_MEM_RATES},
+        [REC_DECOMPRESSION_RATE] = {FIELD(decompressionRate), 0, 1.0, SNAP_MEM_RATES},
+};
+
+// validity bits of fields that have no column
+#define UNRECORDED_BITS (SNAP_CPU_USAGE | SNAP_PROCESSES | SNAP_SELF | SNAP_DISK_IO)
+
+double recording_scale(int column) {
+    return columns[column].scale;
+}
+
+static int64_t to_fixed(const struct snapshot *snap, int column) {
+    const char *field = (const char *) snap + columns[column].offset;
+    if (columns[column].isInt) {
+        return *(const int *) field;
+    }
+    return llround(*(const double *) field * columns[column].scale);
+}
+
+static void from_fixed(struct snapshot *snap, int column, int64_t value) {
+    char *field = (char *) snap + columns[column].offset;
+    if (columns[column].isInt) {
+        *(int *) field = (int) value;
+    } else {
+        *(double *) field = value / columns[column].scale;
+    }
+}
+
+static uint64_t zigzag(int64_t value) {
+    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);
+}
+
+static int64_t unzigzag(uint64_t value) {
+    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);
+}
+
+static uint8_t *put_varint(uint8_t *out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    *out++ = (uint8_t) value;
+    return out;
+}
+
+// returns NULL when the varint runs past end
+static const uint8_t *get_varint(const uint8_t *in, const uint8_t *end, uint64_t *value) {
+    uint64_t result = 0;
+    for (int shift = 0; in < end && shift < 64; shift += 7) {
+        uint8_t byte = *in++;
+        result |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = result;
+            return in;
+        }
+    }
+    return NULL;
+}
+
+// ---- writer ----
+
+static int check_header(FILE *file) {
+    struct recording_header header;
+    return fread(&header, sizeof(header), 1, file) == 1 && header.magic == RECORDING_MAGIC &&
+           header.version == RECORDING_VERSION && header.columnCount == REC_COLUMN_COUNT ? 0 : -1;
+}
+
+// whether the block at offset reads and decodes, -1 when that cannot be checked
+static int block_decodes(FILE *file, long offset) {
+    struct recording_reader *reader = calloc(1, sizeof(struct recording_reader));
+    int result;
+
+    if (reader == NULL) {
+        return -1;
+    }
+    reader->file = file;
+    fseek(file, offset, SEEK_SET);
+    result = recording_next_block(reader) == 0 && recording_decode_block(reader) == 0;
+    free(reader->payload);
+    free(reader);
+    return result;
+}
+
+// offset just past the last complete block. Only the last block is ever rewritten, so it
+// is the only one a crash can leave cut short or torn, and it is dropped then
+static long last_complete_block(FILE *file) {
+    struct recording_block block;
+    long end = (long) sizeof(struct recording_header), last = end, size;
+    int decodes;
+
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, end, SEEK_SET);
+    while (fread(&block, sizeof(block), 1, file) == 1) {
+        long next = end + (long) sizeof(block) + (long) block.payloadSize;
+        if (next > size) {
+            break;
+        }
+        last = end;
+        end = next;
+        fseek(file, end, SEEK_SET);
+    }
+    if (end == last) {
+        return end;
+    }
+    decodes = block_decodes(file, last);
+    return decodes < 0 ? -1 : decodes ? end : last;
+}
+
+int recording_writer_open(struct recording_writer *writer, const char *path) {
+    struct recording_header header = {RECORDING_MAGIC, RECORDING_VERSION, REC_COLUMN_COUNT};
+    long size, end;
+    // not "a": the open block is written over its previous version
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+
+    writer->count = 0;
+    writer->written = 0;
+    writer->file = fd < 0 ? NULL : fdopen(fd, "r+b");
+    if (writer->file == NULL) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    fseek(writer->file, 0, SEEK_END);
+    size = ftell(writer->file);
+    if (size == 0) {
+        if (fwrite(&header, sizeof(header), 1, writer->file) != 1 || fflush(writer->file) != 0) {
+            fclose(writer->file);
+            return -1;
+        }
+        writer->blockStart = (long) sizeof(header);
+        return 0;
+    }
+
+    rewind(writer->file);
+    if (check_header(writer->file) != 0) {
+        fclose(writer->file);
+        return -1;
+    }
+    end = last_complete_block(writer->file);
+    if (end < 0 || (end < size && ftruncate(fileno(writer->file), end) != 0)) {
+        fclose(writer->file);
+        return -1;
+    }
+    writer->blockStart = end;
+    return 0;
+}
+
+int recording_append(struct recording_writer *writer, const struct snapshot *snap) {
+    uint32_t i = writer->count++;
+
+    writer->timestamps[i] = snap->timestamp / RECORDING_TIME_UNIT;
+    writer->valid[i] = snap->valid & ~UNRECORDED_BITS;
+    for (int c = 0; c < REC_COLUMN_COUNT; c++) {
+        writer->values[c][i] = (snap->valid & columns[c].validBit) ? to_fixed(snap, c) : 0;
+    }
+    if (writer->count == RECORDING_BLOCK_SAMPLES ||
+        (writer->timestamps[i] - writer->timestamps[writer->written]) * RECORDING_TIME_UNIT >=
+        RECORDING_FLUSH_INTERVAL) {
+        return recording_flush(writer);
+    }
+    return 0;
+}
+
+int recording_flush(struct recording_writer *writer) {
+    static uint8_t payload[PAYLOAD_MAX];
+    struct recording_block block;
+    uint8_t *out = payload;
+    uint32_t n = writer->count;
+    int64_t previousDelta = 0;
+    uint32_t previousValid = 0;
+    int result;
+
+    if (n == writer->written) {
+        return 0;
+    }
+
+    // timestamps: delta of delta, 0 for a steady sampling period
+    for (uint32_t i = 1; i < n; i++) {
+        int64_t delta = (int64_t) (writer->timestamps[i] - writer->timestamps[i - 1]);
+        out = put_varint(out, zigzag(delta - previousDelta));
+        previousDelta = delta;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        out = put_varint(out, writer->valid[i] ^ previousValid);
+        previousValid = writer->valid[i];
+    }
+
+    // values: an even token is a zigzag delta, an odd one a run of unchanged samples
+    for (int c = 0; c < REC_COLUMN_COUNT; c++) {
+        int64_t previous = 0;
+        uint64_t run = 0;
+
+        block.min[c] = INT64_MAX;
+        block.max[c] = INT64_MIN;
+        for (uint32_t i = 0; i < n; i++) {
+            int64_t value = writer->values[c][i];
+            if (!(writer->valid[i] & columns[c].validBit)) {
+                continue;
+            }
+            if (value < block.min[c]) {
+                block.min[c] = value;
+            }
+            if (value > block.max[c]) {
+                block.max[c] = value;
+            }
+            if (value == previous) {
+                run++;
+                continue;
+            }
+            if (run != 0) {
+                out = put_varint(out, run << 1 | 1);
+                run = 0;
+            }
+            out = put_varint(out, zigzag(value - previous) << 1);
+            previous = value;
+        }
+        if (run != 0) {
+            out = put_varint(out, run << 1 | 1);
+        }
+    }
+
+    block.count = n;
+    block.payloadSize = (uint32_t) (out - payload);
+    block.firstTimestamp = writer->timestamps[0] * RECORDING_TIME_UNIT;
+    block.lastTimestamp = writer->timestamps[n - 1] * RECORDING_TIME_UNIT;
+
+    // the open block only grows, so its new version covers every byte of the previous one
+    result = fseek(writer->file, writer->blockStart, SEEK_SET) != 0 ||
+             fwrite(&block, sizeof(block), 1, writer->file) != 1 ||
+             fwrite(payload, block.payloadSize, 1, writer->file) != 1 || fflush(writer->file) != 0 ? -1 : 0;
+    if (n < RECORDING_BLOCK_SAMPLES) {
+        writer->written = result == 0 ? n : writer->written;
+        return result;
+    }
+    // a full block is sealed even when it failed to write, its samples are lost then
+    if (result == 0) {
+        writer->blockStart = ftell(writer->file);
+    }
+    writer->count = 0;
+    writer->written = 0;
+    return result;
+}
+
+int recording_writer_close(struct recording_writer *writer) {
+    int result = recording_flush(writer);
+    if (fclose(writer->file) != 0) {
+        result = -1;
+    }
+    writer->file = NULL;
+    return result;
+}
+
+// ---- reader ----
+
+int recording_reader_open(struct recording_reader *reader, const char *path) {
+    memset(&reader->block, 0, sizeof(reader->block));
+    reader->payloadPending = 0;
+    reader->next = 0;
+    reader->payload = NULL;
+    reader->payloadCapacity = 0;
+    reader->file = fopen(path, "rb");
+    if (reader->file == NULL) {
+        return -1;
+    }
+    if (check_header(reader->file) != 0) {
+        fclose(reader->file);
+        reader->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int recording_next_block(struct recording_reader *reader) {
+    if (reader->payloadPending && fseek(reader->file, reader->block.payloadSize, SEEK_CUR) != 0) {
+        return -1;
+    }
+    reader->payloadPending = 0;
+    reader->next = 0;
+    if (fread(&reader->block, sizeof(reader->block), 1, reader->file) != 1 || reader->block.count == 0 ||
+        reader->block.count > RECORDING_BLOCK_SAMPLES || reader->block.payloadSize > PAYLOAD_MAX ||
+        reader->block.lastTimestamp < reader->block.firstTimestamp) {
+        reader->block.count = 0;
+        return -1;
+    }
+    reader->payloadPending = 1;
+    return 0;
+}
+
+int recording_decode_block(struct recording_reader *reader) {
+    const struct recording_block *block = &reader->block;
+    struct snapshot *samples = reader->samples;
+    const uint8_t *in, *end;
+    uint64_t token, timestamp = block->firstTimestamp / RECORDING_TIME_UNIT;
+    int64_t delta = 0;
+    uint32_t valid = 0;
+
+    if (!reader->payloadPending) {
+        return -1;
+    }
+    if (block->payloadSize > reader->payloadCapacity) {
+        uint8_t *grown = realloc(reader->payload, block->payloadSize);
+        if (grown == NULL) {
+            return -1;
+        }
+        reader->payload = grown;
+        reader->payloadCapacity = block->payloadSize;
+    }
+    if (fread(reader->payload, 1, block->payloadSize, reader->file) != block->payloadSize) {
+        return -1;
+    }
+    reader->payloadPending = 0;
+    in = reader->payload;
+    end = in + block->payloadSize;
+
+    memset(samples, 0, block->count * sizeof(struct snapshot));
+    samples[0].timestamp = timestamp * RECORDING_TIME_UNIT;
+    for (uint32_t i = 1; i < block->count; i++) {
+        if ((in = get_varint(in, end, &token)) == NULL) {
+            return -1;
+        }
+        delta += unzigzag(token);
+        timestamp += (uint64_t) delta;
+        samples[i].timestamp = timestamp * RECORDING_TIME_UNIT;
+    }
+    for (uint32_t i = 0; i < block->count; i++) {
+        if ((in = get_varint(in, end, &token)) == NULL) {
+            return -1;
+        }
+        valid ^= (uint32_t) token;
+        samples[i].valid = valid;
+    }
+
+    for (int c = 0; c < REC_COLUMN_COUNT; c++) {
+        int64_t value = 0;
+        uint64_t run = 0;
+
+        for (uint32_t i = 0; i < block->count; i++) {
+            if (!(samples[i].valid & columns[c].validBit)) {
+                continue;
+            }
+            if (run == 0) {
+                if ((in = get_varint(in, end, &token)) == NULL) {
+                    return -1;
+                }
+                if (token & 1) {
+                    run = token >> 1;
+                } else {
+                    value += unzigzag(token >> 1);
+                }
+            }
+            // a run token covers this sample as well
+            if (run != 0) {
+                run--;
+            }
+            from_fixed(&samples[i], c, value);
+        }
+    }
+    // a damaged payload rarely runs out exactly at the end
+    return in == end ? 0 : -1;
+}
+
+int recording_read(struct recording_reader *reader, struct snapshot *out) {
+    while (reader->next >= reader->block.count || reader->payloadPending) {
+        if (recording_next_block(reader) != 0 || recording_decode_block(reader) != 0) {
+            return -1;
+        }
+    }
+    *out = reader->samples[reader->next++];
+    return 0;
+}
+
+void recording_reader_close(struct recording_reader *reader) {
+    if (reader->file != NULL) {
+        fclose(reader->file);
+        reader->file = NULL;
+    }
+    free(reader->payload);
+    reader->payload = NULL;
+}
+
+// ---- single samples ----
+
+size_t recording_encode_sample(struct recording_stream *stream, const struct snapshot *snap, uint8_t *out) {
+    uint8_t *start = out;
+    uint64_t timestamp = snap->timestamp / RECORDING_TIME_UNIT;
+    uint32_t valid = snap->valid & ~UNRECORDED_BITS;
+
+    out = put_varint(out, zigzag((int64_t) (timestamp - stream->timestamp)));
+    out = put_varint(out, valid ^ stream->valid);
+    for (int c = 0; c < REC_COLUMN_COUNT; c++) {
+        int64_t value;
+
+        if (!(valid & columns[c].validBit)) {
+            continue;
+        }
+        value = to_fixed(snap, c);
+        out = put_varint(out, zigzag(value - stream->values[c]));
+        stream->values[c] = value;
+    }
+    stream->timestamp = timestamp;
+    stream->valid = valid;
+    return (size_t) (out - start);
+}
+
+int recording_decode_sample(struct recording_stream *stream, const uint8_t *in, size_t length, struct snapshot *out) {
+    const uint8_t *end = in + length;
+    uint64_t token;
+
+    memset(out, 0, sizeof(struct snapshot));
+    if ((in = get_varint(in, end, &token)) == NULL) {
+        return -1;
+    }
+    stream->timestamp += (uint64_t) unzigzag(token);
+    if ((in = get_varint(in, end, &token)) == NULL) {
+        return -1;
+    }
+    stream->valid ^= (uint32_t) token;
+    for (int c = 0; c < REC_COLUMN_COUNT; c++) {
+        if (!(stream->valid & columns[c].validBit)) {
+            continue;
+        }
+        if ((in = get_varint(in, end, &token)) == NULL) {
+            return -1;
+        }
+        stream->values[c] += unzigzag(token);
+        from_fixed(out, c, stream->values[c]);
+    }
+    out->timestamp = stream->timestamp * RECORDING_TIME_UNIT;
+    out->valid = stream->valid;
+    return in == end ? 0 : -1;
+}
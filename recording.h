@@ -0,0 +1,151 @@
+//
+// Compact on-disk log of snapshots for recording an incident and replaying it later.
+// Samples are grouped in blocks stored column by column: timestamps as delta-of-delta,
+// validity bits as XOR with the previous sample and every value as a fixed-point delta
+// (1/256 °C like sp78, 1/4 rpm like fpe2) with runs of unchanged values collapsed.
+// Per core cpu usage, device I/O and the process table are not recorded, only the load
+// averages and the disk totals.
+// Each block header carries the time range and per-column min/max, so a scan can skip
+// a block without decoding it. Integers are stored in host byte order.
+//
+
+#ifndef FINALPROJECT_RECORDING_H
+#define FINALPROJECT_RECORDING_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "snapshot.h"
+
+#define RECORDING_MAGIC   0x524d524du   // "MRMR"
+#define RECORDING_VERSION 3
+#define RECORDING_BLOCK_SAMPLES 512
+// the open block is rewritten in place once the samples since its last write span this
+// long, so a crash at a slow sampling rate loses seconds rather than the minutes a full
+// block takes to fill, while a block still pays for one header however often it is written
+#define RECORDING_FLUSH_INTERVAL (10 * 1000000000ull)
+// timestamps are kept to the millisecond
+#define RECORDING_TIME_UNIT 1000000ull
+
+// recorded fields of struct snapshot
+enum recording_column {
+    REC_DISK_TOTAL,
+    REC_DISK_FREE,
+    REC_CPU_TEMP,
+    REC_MEM_TEMP,
+    REC_GPU_TEMP,
+    REC_BATTERY_TEMP,
+    REC_FAN_COUNT,
+    REC_FAN_MAX,
+    REC_FAN_0,
+    REC_MEM_TOTAL = REC_FAN_0 + SNAPSHOT_MAX_FANS,
+    REC_MEM_USED,
+    REC_BATTERY_PRESENT,
+    REC_BATTERY_PERCENT,
+    REC_BATTERY_POWERED,
+    REC_BATTERY_MINUTES,
+    REC_LOAD_1,
+    REC_LOAD_5,
+    REC_LOAD_15,
+    REC_MEM_FREE,
+    REC_MEM_ACTIVE,
+    REC_MEM_INACTIVE,
+    REC_MEM_WIRED,
+    REC_MEM_COMPRESSED,
+    REC_MEM_PURGEABLE,
+    REC_SWAP_USED,
+    REC_PAGE_IN_RATE,
+    REC_PAGE_OUT_RATE,
+    REC_COMPRESSION_RATE,
+    REC_DECOMPRESSION_RATE,
+    REC_COLUMN_COUNT
+};
+
+struct recording_header {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t columnCount;
+};
+
+struct recording_block {
+    uint32_t count;             // samples in the block
+    uint32_t payloadSize;       // encoded bytes following the header
+    uint64_t firstTimestamp;    // ns
+    uint64_t lastTimestamp;
+    // fixed-point range of each column, min > max when no sample carried it
+    int64_t min[REC_COLUMN_COUNT];
+    int64_t max[REC_COLUMN_COUNT];
+};
+
+struct recording_writer {
+    FILE *file;
+    long blockStart;            // file offset of the open block
+    uint32_t written;           // samples of the open block already on disk
+    uint32_t count;
+    uint64_t timestamps[RECORDING_BLOCK_SAMPLES];
+    uint32_t valid[RECORDING_BLOCK_SAMPLES];
+    int64_t values[REC_COLUMN_COUNT][RECORDING_BLOCK_SAMPLES];
+};
+
+struct recording_reader {
+    FILE *file;
+    struct recording_block block;
+    int payloadPending;         // the payload of block has not been read yet
+    uint32_t next;              // next sample of the decoded block
+    struct snapshot samples[RECORDING_BLOCK_SAMPLES];
+    uint8_t *payload;
+    uint32_t payloadCapacity;
+};
+
+// previous sample of a stream of single samples, each is encoded as the difference to it.
+// Zeroed at the start of a stream, so the first sample carries every value in full
+struct recording_stream {
+    uint64_t timestamp;         // RECORDING_TIME_UNIT
+    uint32_t valid;
+    int64_t values[REC_COLUMN_COUNT];
+};
+
+// longest encoding of a single sample
+#define RECORDING_SAMPLE_MAX ((2 + REC_COLUMN_COUNT) * 10)
+
+// fixed-point steps per unit of column, min/max of a block are in these steps
+double recording_scale(int column);
+
+// append to path, creating it with a header when it does not exist yet, returns 0 on success.
+// A last block that no longer decodes, cut short or torn by a crash mid-write, is dropped
+int recording_writer_open(struct recording_writer *writer, const char *path);
+
+// buffer snap, the open block is encoded and written once it is full or its unwritten
+// samples span RECORDING_FLUSH_INTERVAL, returns 0 on success
+int recording_append(struct recording_writer *writer, const struct snapshot *snap);
+
+// write the open block over its previous version, a full block is sealed and the next
+// sample starts a new one. The file stays valid after every flush
+int recording_flush(struct recording_writer *writer);
+
+int recording_writer_close(struct recording_writer *writer);
+
+int recording_reader_open(struct recording_reader *reader, const char *path);
+
+// read the next block header without decoding it, returns 0 on success, -1 at the end or
+// for a header no writer produces. Blocks hold 1 to RECORDING_BLOCK_SAMPLES samples
+int recording_next_block(struct recording_reader *reader);
+
+// decode the samples of the block read by recording_next_block, -1 when the payload does
+// not decode to exactly block.count samples
+int recording_decode_block(struct recording_reader *reader);
+
+// next snapshot in the file across blocks, returns 0 on success, -1 at the end
+int recording_read(struct recording_reader *reader, struct snapshot *out);
+
+void recording_reader_close(struct recording_reader *reader);
+
+// encode snap against the previous sample of stream into out, at least RECORDING_SAMPLE_MAX
+// bytes, and make it the previous one. Returns the encoded length. This is the wire format
+// of fleet mode, where samples go out one at a time
+size_t recording_encode_sample(struct recording_stream *stream, const struct snapshot *snap, uint8_t *out);
+
+// decode a sample of length bytes encoded by recording_encode_sample, returns 0 on success
+int recording_decode_sample(struct recording_stream *stream, const uint8_t *in, size_t length, struct snapshot *out);
+
+#endif //FINALPROJECT_RECORDING_H
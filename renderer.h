@@ -0,0 +1,51 @@
+//
+// Consumers of snapshots. Renderers never touch the hardware, they only format what
+// the sampler collected.
+//
+
+#ifndef FINALPROJECT_RENDERER_H
+#define FINALPROJECT_RENDERER_H
+
+#include "snapshot.h"
+#include "metricStats.h"
+#include "fleet.h"
+
+struct renderer {
+    const char *name;
+    int (*open)(void);
+    // stats holds the history of every metric up to and including snap
+    void (*render)(const struct snapshot *snap, const struct metric_stats *stats, int flag);
+    void (*close)(void);
+    // set by renderers that own the terminal: called after it was resized, and the
+    // engine reads hotkeys from stdin while they run
+    void (*resize)(void);
+    // one row per host of the aggregator, NULL when the renderer has no fleet view
+    void (*render_fleet)(const struct fleet_host *hosts, int count, enum fleet_sort sort, uint64_t now);
+};
+
+#ifdef WITH_CURSES
+extern const struct renderer curses_renderer;
+
+// drawing helpers of the curses renderer, also driven directly by the benchmark
+void init_color_pair();
+
+void printPercent(double percentage);
+
+void print_usage(const char *title, const char *unit, double numerator, double denominator, int *row, int warningType);
+#endif
+extern const struct renderer text_renderer;
+extern const struct renderer json_renderer;
+// one record per tick as csv, ndjson or a json array, see streamRenderer.c
+extern const struct renderer stream_renderer;
+
+// select the format of stream_renderer and the file it writes, NULL for stdout.
+// Returns -1 for an unknown format
+int stream_renderer_configure(const char *format, const char *path);
+
+// renders nothing, for daemons that only record, export or alert
+extern const struct renderer null_renderer;
+
+// look a renderer up by name, NULL selects curses when it is built in and text otherwise
+const struct renderer *renderer_find(const char *name);
+
+#endif //FINALPROJECT_RENDERER_H
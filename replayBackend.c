@@ -0,0 +1,99 @@
+//
+// Replay backend: plays a file written by --record back through the engine.
+// The recorded clock runs speed times faster than the wall clock from the moment the
+// backend is opened, and every sample returns the last recorded snapshot at or before
+// that point, so any section schedule sees the values the recorder saw.
+//
+
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "backend.h"
+#include "infoCollector.h"
+#include "recording.h"
+
+static const char *replayPath = NULL;
+static double replaySpeed = 1.0;
+
+static struct recording_reader reader;
+static struct snapshot shown, upcoming;
+static int haveUpcoming;
+static uint64_t openTime;
+static uint64_t firstTimestamp;
+static pthread_mutex_t replayLock = PTHREAD_MUTEX_INITIALIZER;
+
+void replay_backend_set_file(const char *path, double speed) {
+    replayPath = path;
+    replaySpeed = speed;
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+// validity bits a section flag stands for
+static uint32_t section_bits(int flag) {
+    uint32_t bits = 0;
+    if (flag & _DISK_STATUS) {
+        bits |= SNAP_DISK | SNAP_DISK_IO;
+    }
+    if (flag & _CPU_TEMP) {
+        bits |= SNAP_CPU_TEMP;
+    }
+    if (flag & _CPU_USAGE) {
+        bits |= SNAP_LOAD;
+    }
+    if (flag & _FAN_STATUS) {
+        bits |= SNAP_FANS;
+    }
+    if (flag & _MEM_STATUS) {
+        bits |= SNAP_MEM | SNAP_MEM_TEMP | SNAP_MEM_DETAIL | SNAP_MEM_RATES;
+    }
+    if (flag & _GPU_STATUS) {
+        bits |= SNAP_GPU_TEMP;
+    }
+    if (flag & _BATTERY_STATUS) {
+        bits |= SNAP_BATTERY | SNAP_BATTERY_TEMP;
+    }
+    return bits;
+}
+
+static int replay_open(int flag) {
+    if (replayPath == NULL || recording_reader_open(&reader, replayPath) != 0) {
+        fprintf(stderr, "could not open recording %s\n", replayPath ? replayPath : "(none)");
+        return -1;
+    }
+    if (recording_read(&reader, &shown) != 0) {
+        fprintf(stderr, "recording %s is empty\n", replayPath);
+        recording_reader_close(&reader);
+        return -1;
+    }
+    firstTimestamp = shown.timestamp;
+    haveUpcoming = recording_read(&reader, &upcoming) == 0;
+    openTime = monotonic_ns();
+    return 0;
+}
+
+static void replay_sample(int flag, struct snapshot *snap) {
+    // position in the recording, relative to its first sample
+    uint64_t position = (uint64_t) ((double) (monotonic_ns() - openTime) * replaySpeed);
+
+    // sections are sampled from several collector threads, the reader is shared
+    pthread_mutex_lock(&replayLock);
+    while (haveUpcoming && upcoming.timestamp - firstTimestamp <= position) {
+        shown = upcoming;
+        haveUpcoming = recording_read(&reader, &upcoming) == 0;
+    }
+    snapshot_merge(snap, &shown, section_bits(flag));
+    snap->timestamp = shown.timestamp;
+    pthread_mutex_unlock(&replayLock);
+}
+
+static void replay_close(void) {
+    recording_reader_close(&reader);
+}
+
+const struct backend replay_backend = {"replay", replay_open, replay_sample, replay_close};
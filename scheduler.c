@@ -0,0 +1,145 @@
+//
+// Deadline scheduler, see scheduler.h
+//
+
+#include <time.h>
+
+#include "scheduler.h"
+
+static uint64_t monotonic_now(void *ctx) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * NSEC_PER_SEC + (uint64_t) now.tv_nsec;
+}
+
+static void monotonic_sleep_until(void *ctx, uint64_t deadline) {
+#ifdef __APPLE__
+    // no clock_nanosleep on macOS, sleep for the remaining relative time instead
+    uint64_t now = monotonic_now(ctx);
+    if (deadline > now) {
+        struct timespec remaining = {(time_t) ((deadline - now) / NSEC_PER_SEC),
+                                     (long) ((deadline - now) % NSEC_PER_SEC)};
+        nanosleep(&remaining, NULL);
+    }
+#else
+    struct timespec until = {(time_t) (deadline / NSEC_PER_SEC), (long) (deadline % NSEC_PER_SEC)};
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL);
+#endif
+}
+
+const struct sched_clock monotonic_clock = {monotonic_now, monotonic_sleep_until, NULL};
+
+static int earlier(const struct sched_task *a, const struct sched_task *b) {
+    return a->deadline < b->deadline || (a->deadline == b->deadline && a->order < b->order);
+}
+
+static void swap(struct scheduler *sched, unsigned int i, unsigned int j) {
+    struct sched_task *tmp = sched->heap[i];
+    sched->heap[i] = sched->heap[j];
+    sched->heap[j] = tmp;
+}
+
+static void sift_up(struct scheduler *sched, unsigned int i) {
+    while (i > 0 && earlier(sched->heap[i], sched->heap[(i - 1) / 2])) {
+        swap(sched, i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(struct scheduler *sched, unsigned int i) {
+    for (;;) {
+        unsigned int smallest = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < sched->count && earlier(sched->heap[left], sched->heap[smallest])) {
+            smallest = left;
+        }
+        if (right < sched->count && earlier(sched->heap[right], sched->heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            return;
+        }
+        swap(sched, i, smallest);
+        i = smallest;
+    }
+}
+
+void scheduler_init(struct scheduler *sched, const struct sched_clock *clock, int adaptive) {
+    sched->clock = clock;
+    sched->adaptive = adaptive;
+    sched->adaptiveLimit = 8;
+    sched->count = 0;
+}
+
+int scheduler_add(struct scheduler *sched, struct sched_task *task) {
+    if (sched->count == SCHED_MAX_TASKS) {
+        return -1;
+    }
+    task->currentPeriod = task->period;
+    task->deadline = sched->clock->now(sched->clock->ctx);
+    task->maxLateness = 0;
+    task->runs = 0;
+    task->order = sched->count;
+    sched->heap[sched->count] = task;
+    sift_up(sched, sched->count++);
+    return 0;
+}
+
+void scheduler_set_period(struct scheduler *sched, struct sched_task *task, uint64_t period) {
+    for (unsigned int i = 0; i < sched->count; i++) {
+        if (sched->heap[i] == task) {
+            task->period = task->currentPeriod = period;
+            task->deadline = sched->clock->now(sched->clock->ctx);
+            sift_up(sched, i);
+            return;
+        }
+    }
+}
+
+uint64_t scheduler_next_deadline(const struct scheduler *sched) {
+    return sched->count > 0 ? sched->heap[0]->deadline : UINT64_MAX;
+}
+
+int scheduler_run_due(struct scheduler *sched) {
+    int ran = 0;
+    uint64_t now = sched->clock->now(sched->clock->ctx);
+
+    while (sched->count > 0 && sched->heap[0]->deadline <= now) {
+        struct sched_task *task = sched->heap[0];
+        int changed;
+
+        if (now - task->deadline > task->maxLateness) {
+            task->maxLateness = now - task->deadline;
+        }
+        changed = task->run(task->arg);
+        task->runs++;
+        ran++;
+
+        if (sched->adaptive) {
+            if (changed) {
+                task->currentPeriod = task->period;
+            } else if (task->currentPeriod < task->period * sched->adaptiveLimit) {
+                task->currentPeriod *= 2;
+            }
+        }
+
+        // next slot on the period grid, missed slots are skipped rather than run in a burst
+        task->deadline += task->currentPeriod;
+        if (task->deadline <= now) {
+            task->deadline += (now - task->deadline) / task->currentPeriod * task->currentPeriod + task->currentPeriod;
+        }
+        sift_down(sched, 0);
+    }
+    return ran;
+}
+
+int scheduler_step(struct scheduler *sched) {
+    uint64_t deadline = scheduler_next_deadline(sched);
+
+    if (deadline == UINT64_MAX) {
+        return 0;
+    }
+    if (deadline > sched->clock->now(sched->clock->ctx)) {
+        sched->clock->sleep_until(sched->clock->ctx, deadline);
+    }
+    return scheduler_run_due(sched);
+}
@@ -0,0 +1,68 @@
+//
+// Deadline scheduler for periodic tasks, a binary min-heap ordered by the next deadline.
+// Deadlines advance by whole periods from the previous deadline (not from when the task
+// happened to run), so late wake-ups never accumulate into drift. The clock is pluggable
+// so a mock clock can drive the scheduler deterministically.
+//
+
+#ifndef FINALPROJECT_SCHEDULER_H
+#define FINALPROJECT_SCHEDULER_H
+
+#include <stdint.h>
+
+#define SCHED_MAX_TASKS 32
+#define NSEC_PER_MSEC 1000000ull
+#define NSEC_PER_SEC  1000000000ull
+
+struct sched_clock {
+    // monotonic time in nanoseconds
+    uint64_t (*now)(void *ctx);
+    // block until now() >= deadline or a signal arrives
+    void (*sleep_until)(void *ctx, uint64_t deadline);
+    void *ctx;
+};
+
+extern const struct sched_clock monotonic_clock;
+
+struct sched_task {
+    const char *name;
+    uint64_t period;        // base period, ns
+    // returns nonzero when the task saw its values change, used by adaptive scheduling
+    int (*run)(void *arg);
+    void *arg;
+
+    // maintained by the scheduler
+    uint64_t currentPeriod;
+    uint64_t deadline;
+    uint64_t maxLateness;   // worst gap between a deadline and the actual run, ns
+    unsigned long runs;
+    unsigned int order;     // insertion order, breaks deadline ties
+};
+
+struct scheduler {
+    const struct sched_clock *clock;
+    // adaptive mode doubles the period of stable tasks up to adaptiveLimit times the base
+    // period and snaps back to the base period as soon as a value changes
+    int adaptive;
+    unsigned int adaptiveLimit;
+    struct sched_task *heap[SCHED_MAX_TASKS];
+    unsigned int count;
+};
+
+void scheduler_init(struct scheduler *sched, const struct sched_clock *clock, int adaptive);
+
+// the task is first due immediately, returns -1 when the scheduler is full
+int scheduler_add(struct scheduler *sched, struct sched_task *task);
+
+// give a scheduled task a new base period, it runs next right away
+void scheduler_set_period(struct scheduler *sched, struct sched_task *task, uint64_t period);
+
+uint64_t scheduler_next_deadline(const struct scheduler *sched);
+
+// run every task whose deadline has passed, returns the number of tasks run
+int scheduler_run_due(struct scheduler *sched);
+
+// sleep until the earliest deadline and run what is due then
+int scheduler_step(struct scheduler *sched);
+
+#endif //FINALPROJECT_SCHEDULER_H
@@ -0,0 +1,167 @@
+//
+// Self instrumentation, see selfStats.h
+//
+
+#include <string.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#ifdef __APPLE__
+#include <mach/mach.h>
+#endif
+
+#include "selfStats.h"
+
+static atomic_uint_fast64_t smcCalls;
+
+static int bucket_of(uint64_t ns) {
+    int exponent;
+
+    if (ns < 16) {
+        return (int) ns;
+    }
+    if (ns >= (1ull << 41)) {
+        ns = (1ull << 41) - 1;
+    }
+    exponent = 63 - __builtin_clzll(ns);
+    return 16 + (exponent - 4) * LATENCY_SUB_BUCKETS + (int) ((ns >> (exponent - 3)) & (LATENCY_SUB_BUCKETS - 1));
+}
+
+// largest value that falls into bucket
+static uint64_t bucket_bound(int bucket) {
+    int exponent, sub;
+
+    if (bucket < 16) {
+        return (uint64_t) bucket;
+    }
+    exponent = (bucket - 16) / LATENCY_SUB_BUCKETS + 4;
+    sub = (bucket - 16) % LATENCY_SUB_BUCKETS;
+    return ((uint64_t) (LATENCY_SUB_BUCKETS + sub + 1) << (exponent - 3)) - 1;
+}
+
+void latency_record(struct latency_histogram *histogram, uint64_t ns) {
+    uint_fast64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+
+    atomic_fetch_add_explicit(&histogram->buckets[bucket_of(ns)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->total, ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&histogram->max, &max, ns, memory_order_relaxed,
+                                                              memory_order_relaxed)) {
+    }
+}
+
+uint64_t latency_percentile(const struct latency_histogram *histogram, double fraction) {
+    uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    uint64_t wanted = (uint64_t) (fraction * (double) count + 0.5), seen = 0;
+
+    if (wanted == 0) {
+        wanted = 1;
+    }
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        if (seen >= wanted) {
+            // the top bucket bound can lie past the largest value recorded
+            return bucket_bound(i) < max ? bucket_bound(i) : max;
+        }
+    }
+    return max;
+}
+
+void latency_print(FILE *out, const char *name, const struct latency_histogram *histogram) {
+    uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    uint64_t total = atomic_load_explicit(&histogram->total, memory_order_relaxed);
+
+    if (count == 0) {
+        fprintf(out, "%-10s no calls\n", name);
+        return;
+    }
+    fprintf(out, "%-10s %8llu calls, mean %9.1f us, p50 %9.1f us, p99 %9.1f us, max %9.1f us\n", name,
+            (unsigned long long) count, total / 1e3 / count, latency_percentile(histogram, 0.5) / 1e3,
+            latency_percentile(histogram, 0.99) / 1e3,
+            atomic_load_explicit(&histogram->max, memory_order_relaxed) / 1e3);
+}
+
+void self_stats_count_smc_call(void) {
+    atomic_fetch_add_explicit(&smcCalls, 1, memory_order_relaxed);
+}
+
+uint64_t self_stats_smc_calls(void) {
+    return atomic_load_explicit(&smcCalls, memory_order_relaxed);
+}
+
+#ifdef __APPLE__
+
+static int read_memory_and_calls(struct self_usage *usage) {
+    mach_task_basic_info_data_t basic;
+    task_events_info_data_t events;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+    if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t) &basic, &count) != KERN_SUCCESS) {
+        return -1;
+    }
+    usage->rssMB = basic.resident_size / (1024.0 * 1024);
+    count = TASK_EVENTS_INFO_COUNT;
+    if (task_info(mach_task_self(), TASK_EVENTS_INFO, (task_info_t) &events, &count) == KERN_SUCCESS) {
+        usage->syscalls = (uint64_t) events.syscalls_mach + (uint64_t) events.syscalls_unix;
+    }
+    return 0;
+}
+
+#else
+
+// whole small procfs file of this process, returns the length or -1
+static ssize_t read_proc_self(const char *path, char *text, size_t size) {
+    ssize_t length;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return -1;
+    }
+    length = read(fd, text, size - 1);
+    close(fd);
+    if (length < 0) {
+        return -1;
+    }
+    text[length] = '\0';
+    return length;
+}
+
+// number after key, 0 when it is not there
+static uint64_t field(const char *text, const char *key) {
+    const char *line = strstr(text, key);
+    return line != NULL ? strtoull(line + strlen(key), NULL, 10) : 0;
+}
+
+static int read_memory_and_calls(struct self_usage *usage) {
+    char text[512];
+    unsigned long long size = 0, resident = 0;
+
+    // the second field of statm is the resident size in pages
+    if (read_proc_self("/proc/self/statm", text, sizeof(text)) <= 0 ||
+        sscanf(text, "%llu %llu", &size, &resident) != 2) {
+        return -1;
+    }
+    usage->rssMB = resident * (double) sysconf(_SC_PAGESIZE) / (1024.0 * 1024);
+    // Linux only counts the read and write family per process
+    if (read_proc_self("/proc/self/io", text, sizeof(text)) > 0) {
+        usage->syscalls = field(text, "syscr: ") + field(text, "syscw: ");
+    }
+    return 0;
+}
+
+#endif
+
+int self_usage_read(struct self_usage *usage) {
+    struct rusage self;
+
+    memset(usage, 0, sizeof(struct self_usage));
+    if (getrusage(RUSAGE_SELF, &self) != 0) {
+        return -1;
+    }
+    usage->cpuSeconds = self.ru_utime.tv_sec + self.ru_utime.tv_usec / 1e6 +
+                        self.ru_stime.tv_sec + self.ru_stime.tv_usec / 1e6;
+    return read_memory_and_calls(usage);
+}
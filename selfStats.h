@@ -0,0 +1,50 @@
+//
+// What macResMon itself costs: latency histograms of the collectors, calls into the SMC
+// and the process's own cpu time, resident memory and system calls.
+// Histograms are log-linear like HdrHistogram, eight buckets per power of two so every
+// bucket is within 12.5% of its values, and recorded with relaxed atomic adds so the
+// collector threads never take a lock to instrument themselves.
+//
+
+#ifndef FINALPROJECT_SELFSTATS_H
+#define FINALPROJECT_SELFSTATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+#define LATENCY_SUB_BUCKETS 8
+// exact below 16 ns, then 8 per power of two up to 2^40 ns (about 18 minutes)
+#define LATENCY_BUCKETS (16 + 37 * LATENCY_SUB_BUCKETS)
+
+struct latency_histogram {
+    atomic_uint_fast64_t buckets[LATENCY_BUCKETS];
+    atomic_uint_fast64_t count;
+    atomic_uint_fast64_t total;     // ns
+    atomic_uint_fast64_t max;
+};
+
+// the process's own resource usage since it started
+struct self_usage {
+    double cpuSeconds;          // user and system
+    double rssMB;               // resident now
+    uint64_t syscalls;          // every system call on macOS, read and write calls on Linux
+};
+
+// safe from any thread
+void latency_record(struct latency_histogram *histogram, uint64_t ns);
+
+// smallest bucket bound that covers fraction (0..1] of the recorded values, in ns
+uint64_t latency_percentile(const struct latency_histogram *histogram, double fraction);
+
+// called by the SMC layer for every user client call
+void self_stats_count_smc_call(void);
+
+uint64_t self_stats_smc_calls(void);
+
+int self_usage_read(struct self_usage *usage);
+
+// one line per histogram: calls, mean, p50, p99 and max
+void latency_print(FILE *out, const char *name, const struct latency_histogram *histogram);
+
+#endif //FINALPROJECT_SELFSTATS_H
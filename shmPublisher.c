@@ -0,0 +1,107 @@
+//
+// Shared memory publisher, see shmPublisher.h
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "shmPublisher.h"
+#include "macResMonShm.h"
+
+// the reader header is self-contained, so it repeats the SNAP_* numbers it shares
+_Static_assert(MRM_DISK == SNAP_DISK && MRM_CPU_TEMP == SNAP_CPU_TEMP && MRM_FANS == SNAP_FANS &&
+               MRM_MEM == SNAP_MEM && MRM_MEM_TEMP == SNAP_MEM_TEMP && MRM_GPU_TEMP == SNAP_GPU_TEMP &&
+               MRM_BATTERY == SNAP_BATTERY && MRM_BATTERY_TEMP == SNAP_BATTERY_TEMP &&
+               MRM_CPU_USAGE == SNAP_CPU_USAGE && MRM_LOAD == SNAP_LOAD && MRM_PROCESSES == SNAP_PROCESSES,
+               "MRM_* bits must match SNAP_*");
+_Static_assert(MRM_MAX_FANS == SNAPSHOT_MAX_FANS, "fan arrays must match");
+
+#define PUBLISHED_BITS (MRM_DISK | MRM_CPU_TEMP | MRM_FANS | MRM_MEM | MRM_MEM_TEMP | MRM_GPU_TEMP | \
+                        MRM_BATTERY | MRM_BATTERY_TEMP | MRM_CPU_USAGE | MRM_LOAD | MRM_PROCESSES)
+
+static struct mrm_shm *shm = NULL;
+static char shmName[256];
+static uint64_t published;
+
+int shm_publisher_open(const char *name) {
+    int fd;
+
+    // a fresh object rather than truncating the old one, readers of a crashed run keep
+    // their mapping and never see the sequence go backwards
+    snprintf(shmName, sizeof(shmName), "%s", name);
+    shm_unlink(shmName);
+    fd = shm_open(shmName, O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    if (ftruncate(fd, sizeof(struct mrm_shm)) != 0) {
+        close(fd);
+        shm_unlink(shmName);
+        return -1;
+    }
+    shm = mmap(NULL, sizeof(struct mrm_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (shm == MAP_FAILED) {
+        shm = NULL;
+        shm_unlink(shmName);
+        return -1;
+    }
+    // a new object is zero filled, so seq is 0 and readers wait for the first sample
+    shm->version = MRM_SHM_VERSION;
+    shm->size = sizeof(struct mrm_shm);
+    shm->pid = (int32_t) getpid();
+    atomic_thread_fence(memory_order_release);
+    shm->magic = MRM_SHM_MAGIC;
+    published = 0;
+    return 0;
+}
+
+void shm_publisher_publish(const struct snapshot *snap) {
+    struct mrm_values *values;
+
+    if (shm == NULL) {
+        return;
+    }
+    values = &shm->values;
+    atomic_store_explicit(&shm->seq, 2 * published + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    values->timestamp = snap->timestamp;
+    values->valid = snap->valid & ~snap->stale & PUBLISHED_BITS;
+    values->fanCount = (uint32_t) snap->fanCount;
+    values->cpuTemp = snap->cpuTemp;
+    values->gpuTemp = snap->gpuTemp;
+    values->memTemp = snap->memTemp;
+    values->batteryTemp = snap->batteryTemp;
+    values->cpuUser = snap->cpuUser;
+    values->cpuSystem = snap->cpuSystem;
+    values->cpuNice = snap->cpuNice;
+    values->cpuIdle = snap->cpuIdle;
+    memcpy(values->loadAverage, snap->loadAverage, sizeof(values->loadAverage));
+    values->memTotal = snap->memTotal;
+    values->memUsed = snap->memUsed;
+    values->swapUsed = snap->swapUsed;
+    values->diskTotal = snap->diskTotal;
+    values->diskFree = snap->diskFree;
+    values->fanMax = snap->fanMax;
+    memcpy(values->fanSpeed, snap->fanSpeed, sizeof(values->fanSpeed));
+    values->batteryPercent = snap->batteryPercent;
+    values->batteryPowered = snap->batteryPowered;
+    values->batteryMinutes = snap->batteryMinutes;
+    values->processCount = snap->processCount;
+
+    published++;
+    atomic_store_explicit(&shm->seq, 2 * published, memory_order_release);
+}
+
+void shm_publisher_close(void) {
+    if (shm == NULL) {
+        return;
+    }
+    munmap(shm, sizeof(struct mrm_shm));
+    shm = NULL;
+    shm_unlink(shmName);
+}
@@ -0,0 +1,22 @@
+//
+// Publishes every snapshot into a POSIX shared memory segment so local tools read the
+// sensors from memory instead of opening the SMC themselves. The layout and the reader
+// are in macResMonShm.h.
+//
+
+#ifndef FINALPROJECT_SHMPUBLISHER_H
+#define FINALPROJECT_SHMPUBLISHER_H
+
+#include "snapshot.h"
+
+// create the segment called name (e.g. "/macResMon"), replacing one left by an earlier
+// run, returns 0 on success
+int shm_publisher_open(const char *name);
+
+// must only be called from one thread
+void shm_publisher_publish(const struct snapshot *snap);
+
+// unlink the segment, readers that still map it keep the last sample
+void shm_publisher_close(void);
+
+#endif //FINALPROJECT_SHMPUBLISHER_H
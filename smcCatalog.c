@@ -0,0 +1,232 @@
+//
+// On-disk SMC key catalog, see smcCatalog.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "smcCatalog.h"
+
+static int compare_records(const void *a, const void *b) {
+    SMCKey_t left = ((const SMCCatalogRecord_t *) a)->key;
+    SMCKey_t right = ((const SMCCatalogRecord_t *) b)->key;
+    return left < right ? -1 : left > right;
+}
+
+int SMC_enumerate_keys(SMCCatalogRecord_t **records, uint32_t *count) {
+    int keyCount = SMC_get_key_count();
+    uint32_t filled = 0;
+
+    if (keyCount < 0) {
+        return -1;
+    }
+
+    SMCCatalogRecord_t *list = calloc(keyCount > 0 ? (size_t) keyCount : 1, sizeof(SMCCatalogRecord_t));
+    if (list == NULL) {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < (uint32_t) keyCount; i++) {
+        SMCKey_t key;
+        uint32_t dataSize, dataType;
+        uint8_t attributes;
+
+        // keys that vanish or refuse to describe themselves are left out
+        if (SMC_get_key_at(i, &key) != kIOReturnSuccess ||
+            SMC_get_key_info(key, &dataSize, &dataType, &attributes) != kIOReturnSuccess) {
+            continue;
+        }
+        list[filled].key = key;
+        list[filled].dataType = dataType;
+        list[filled].dataSize = (uint8_t) dataSize;
+        list[filled].attributes = attributes;
+        filled++;
+    }
+
+    qsort(list, filled, sizeof(SMCCatalogRecord_t), compare_records);
+    *records = list;
+    *count = filled;
+    return 0;
+}
+
+int SMC_catalog_write(const char *path, SMCCatalogRecord_t *records, uint32_t count, uint32_t smcKeyCount) {
+    SMCCatalogHeader_t header = {SMC_CATALOG_MAGIC, SMC_CATALOG_VERSION, sizeof(SMCCatalogRecord_t), count,
+                                 smcKeyCount};
+    size_t pathLength = strlen(path);
+    char *tmpPath = malloc(pathLength + 5);
+    FILE *file;
+
+    if (tmpPath == NULL) {
+        return -1;
+    }
+    memcpy(tmpPath, path, pathLength);
+    memcpy(tmpPath + pathLength, ".tmp", 5);
+
+    qsort(records, count, sizeof(SMCCatalogRecord_t), compare_records);
+
+    // write next to the target and rename so readers never map a half written file
+    file = fopen(tmpPath, "wb");
+    if (file == NULL) {
+        free(tmpPath);
+        return -1;
+    }
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(records, sizeof(SMCCatalogRecord_t), count, file) != count) {
+        fclose(file);
+        unlink(tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    if (fclose(file) != 0 || rename(tmpPath, path) != 0) {
+        unlink(tmpPath);
+        free(tmpPath);
+        return -1;
+    }
+    free(tmpPath);
+    return 0;
+}
+
+int SMC_catalog_open(const char *path, SMCCatalog_t *catalog) {
+    struct stat info;
+    const SMCCatalogHeader_t *header;
+    int fd;
+
+    memset(catalog, 0, sizeof(SMCCatalog_t));
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < sizeof(SMCCatalogHeader_t)) {
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    header = map;
+    if (header->magic != SMC_CATALOG_MAGIC || header->version != SMC_CATALOG_VERSION ||
+        header->recordSize != sizeof(SMCCatalogRecord_t) ||
+        (size_t) info.st_size != sizeof(SMCCatalogHeader_t) + (size_t) header->count * sizeof(SMCCatalogRecord_t)) {
+        munmap(map, (size_t) info.st_size);
+        return -1;
+    }
+
+    catalog->map = map;
+    catalog->mapSize = (size_t) info.st_size;
+    catalog->records = (const SMCCatalogRecord_t *) (header + 1);
+    catalog->count = header->count;
+    catalog->smcKeyCount = header->smcKeyCount;
+    return 0;
+}
+
+void SMC_catalog_close(SMCCatalog_t *catalog) {
+    if (catalog->map != NULL) {
+        munmap(catalog->map, catalog->mapSize);
+    }
+    memset(catalog, 0, sizeof(SMCCatalog_t));
+}
+
+const SMCCatalogRecord_t *SMC_catalog_find(const SMCCatalog_t *catalog, SMCKey_t key) {
+    uint32_t low = 0, high = catalog->count;
+
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        if (catalog->records[mid].key < key) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    if (low < catalog->count && catalog->records[low].key == key) {
+        return &catalog->records[low];
+    }
+    return NULL;
+}
+
+int SMC_catalog_prime(const char *path) {
+    SMCCatalog_t catalog;
+    int keyCount;
+
+    if (SMC_catalog_open(path, &catalog) != 0) {
+        return -1;
+    }
+    keyCount = SMC_get_key_count();
+    if (keyCount < 0 || catalog.smcKeyCount != (uint32_t) keyCount) {
+        SMC_catalog_close(&catalog);
+        return -1;
+    }
+    for (uint32_t i = 0; i < catalog.count; i++) {
+        SMC_prime_key_info(catalog.records[i].key, catalog.records[i].dataSize, catalog.records[i].dataType);
+    }
+    SMC_catalog_close(&catalog);
+    return 0;
+}
+
+const char *SMC_catalog_default_path(void) {
+    static char path[1024];
+    const char *home = getenv("HOME");
+
+    snprintf(path, sizeof(path), "%s/.macResMon.keys", home != NULL ? home : ".");
+    return path;
+}
+
+// a key of the sensor table gets its title, fan sensors the fan they belong to
+static void print_record(FILE *out, const SMCCatalogRecord_t *record) {
+    const struct smc_sensor *sensor = smc_sensor_find(record->key);
+    char key[5], type[5];
+
+    uint32_to_str(key, record->key);
+    uint32_to_str(type, record->dataType);
+    fprintf(out, "%s  %s  %2u  0x%02x", key, type, record->dataSize, record->attributes);
+    if (sensor != NULL && sensor->perFan) {
+        fprintf(out, "  %s, fan %c", sensor->title, key[1]);
+    } else if (sensor != NULL) {
+        fprintf(out, "  %s", sensor->title);
+    }
+    fputc('\n', out);
+}
+
+int SMC_list_keys(const char *path, FILE *out) {
+    SMCCatalog_t catalog;
+    int keyCount;
+
+    if (SMC_open() != kIOReturnSuccess) {
+        return -1;
+    }
+    keyCount = SMC_get_key_count();
+
+    // a catalog whose size disagrees with #KEY belongs to other firmware, build a new one
+    if (SMC_catalog_open(path, &catalog) != 0 || (keyCount >= 0 && catalog.smcKeyCount != (uint32_t) keyCount)) {
+        SMCCatalogRecord_t *records;
+        uint32_t count;
+
+        SMC_catalog_close(&catalog);
+        if (SMC_enumerate_keys(&records, &count) != 0) {
+            SMC_close();
+            return -1;
+        }
+        if (SMC_catalog_write(path, records, count, keyCount >= 0 ? (uint32_t) keyCount : count) != 0) {
+            fprintf(stderr, "could not save key catalog to %s\n", path);
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            print_record(out, &records[i]);
+        }
+        free(records);
+    } else {
+        for (uint32_t i = 0; i < catalog.count; i++) {
+            print_record(out, &catalog.records[i]);
+        }
+        SMC_catalog_close(&catalog);
+    }
+
+    SMC_close();
+    return 0;
+}
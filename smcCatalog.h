@@ -0,0 +1,66 @@
+//
+// On-disk catalog of every SMC key with its type and size.
+// Enumerating a machine with 1000+ keys takes seconds, so the result is written once as
+// a versioned file of fixed-width records sorted by packed key; later runs mmap it and
+// binary-search instead of asking the SMC again. Integers are stored in host byte order.
+//
+
+#ifndef FINALPROJECT_SMCCATALOG_H
+#define FINALPROJECT_SMCCATALOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "systemManagementController.h"
+
+#define SMC_CATALOG_MAGIC   SMC_FOURCC('M', 'R', 'M', 'K')
+#define SMC_CATALOG_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t count;
+    uint32_t smcKeyCount;   // #KEY at enumeration time, tells whether the catalog is still current
+} SMCCatalogHeader_t;
+
+typedef struct {
+    SMCKey_t key;
+    uint32_t dataType;
+    uint8_t dataSize;
+    uint8_t attributes;
+    uint16_t reserved;
+} SMCCatalogRecord_t;
+
+typedef struct {
+    void *map;
+    size_t mapSize;
+    const SMCCatalogRecord_t *records;
+    uint32_t count;
+    uint32_t smcKeyCount;
+} SMCCatalog_t;
+
+// ask the SMC for every key, *records is malloc'ed and sorted by key, returns 0 on success
+int SMC_enumerate_keys(SMCCatalogRecord_t **records, uint32_t *count);
+
+// sort records and atomically replace the catalog at path, returns 0 on success
+int SMC_catalog_write(const char *path, SMCCatalogRecord_t *records, uint32_t count, uint32_t smcKeyCount);
+
+// map and validate the catalog at path, returns 0 on success
+int SMC_catalog_open(const char *path, SMCCatalog_t *catalog);
+
+void SMC_catalog_close(SMCCatalog_t *catalog);
+
+const SMCCatalogRecord_t *SMC_catalog_find(const SMCCatalog_t *catalog, SMCKey_t key);
+
+// seed the key info cache from the catalog at path when it matches the open SMC,
+// so first reads skip kSMCGetKeyInfo; returns 0 when the cache was primed
+int SMC_catalog_prime(const char *path);
+
+// default catalog location, $HOME/.macResMon.keys
+const char *SMC_catalog_default_path(void);
+
+// --list-keys: print every key from the catalog at path, enumerating and saving it first
+// when it is missing or no longer matches the SMC's key count
+int SMC_list_keys(const char *path, FILE *out);
+
+#endif //FINALPROJECT_SMCCATALOG_H
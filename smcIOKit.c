@@ -0,0 +1,59 @@
+//
+// IOKit transport: forwards SMC calls to the AppleSMC user client.
+// Some parts of this c file come from Github repo /osx-cpu-temp and /libsmc and /iStats
+// Please refer to their repos for license information
+//
+
+#include <stdio.h>
+#include "smcTransport.h"
+
+static io_connect_t conn;
+
+static kern_return_t iokit_open(void) {
+    kern_return_t result;
+    io_iterator_t iterator;
+    io_object_t device;
+
+    CFMutableDictionaryRef matchingDictionary = IOServiceMatching("AppleSMC");
+    result = IOServiceGetMatchingServices(kIOMasterPortDefault, matchingDictionary, &iterator);
+    if (result != kIOReturnSuccess) {
+        printf("Error: IOServiceGetMatchingServices() = %08x\n", result);
+        return 1;
+    }
+
+    device = IOIteratorNext(iterator);
+    IOObjectRelease(iterator);
+    if (device == 0) {
+        printf("Error: no SMC found\n");
+        return 1;
+    }
+
+    result = IOServiceOpen(device, mach_task_self(), 0, &conn);
+    IOObjectRelease(device);
+    if (result != kIOReturnSuccess) {
+        printf("Error: IOServiceOpen() = %08x\n", result);
+        return 1;
+    }
+
+    return kIOReturnSuccess;
+}
+
+static kern_return_t iokit_close(void) {
+    return IOServiceClose(conn);
+}
+
+static kern_return_t iokit_call(int index, SMCKeyData_t *inputStructure, SMCKeyData_t *outputStructure) {
+    size_t structureInputSize;
+    size_t structureOutputSize;
+
+    structureInputSize = sizeof(SMCKeyData_t);
+    structureOutputSize = sizeof(SMCKeyData_t);
+
+    return IOConnectCallStructMethod(conn, index,
+            // inputStructure
+                                     inputStructure, structureInputSize,
+            // ouputStructure
+                                     outputStructure, &structureOutputSize);
+}
+
+const SMCTransport_t SMC_iokit_transport = {"iokit", iokit_open, iokit_close, iokit_call};
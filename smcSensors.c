@@ -0,0 +1,84 @@
+//
+// The sensor table of smcSensors.h and the per tick sampling it drives
+//
+
+#include <string.h>
+
+#include "smcSensors.h"
+#include "systemManagementController.h"
+#include "infoCollector.h"
+
+#define SMC_SENSOR_ROW(id, c0, c1, c2, c3, type, name, title, unit, section, validBit, field, perFan, warm, hot) \
+    [SENSOR_##id] = {SMC_FOURCC(c0, c1, c2, c3), type, {c0, c1, c2, c3, '\0'}, name, title, unit, \
+                     section, validBit, field, SENSOR_FIELD_ELEMENTS(field), perFan, warm, hot},
+
+const struct smc_sensor smc_sensors[SMC_SENSOR_COUNT] = {
+        SMC_SENSORS(SMC_SENSOR_ROW)
+};
+
+const struct smc_sensor *smc_sensor_find(uint32_t key) {
+    for (int i = 0; i < SMC_SENSOR_COUNT; i++) {
+        const struct smc_sensor *sensor = &smc_sensors[i];
+
+        if (sensor->key == key) {
+            return sensor;
+        }
+        // fan i only differs from fan 0 in the second character, its number
+        if (sensor->perFan && (key & 0xff00ffffu) == (sensor->key & 0xff00ffffu)) {
+            uint32_t fan = (key >> 16) & 0xffu;
+
+            if (fan >= '0' && fan < '0' + SNAPSHOT_MAX_FANS) {
+                return sensor;
+            }
+        }
+    }
+    return NULL;
+}
+
+void smc_sensor_plan_compile(struct smc_sensor_plan *plan, int flag, int fanCount) {
+    memset(plan, 0, sizeof(struct smc_sensor_plan));
+    if (fanCount > SNAPSHOT_MAX_FANS) {
+        fanCount = SNAPSHOT_MAX_FANS;
+    }
+    plan->fanCount = fanCount;
+    for (int i = 0; i < SMC_SENSOR_COUNT; i++) {
+        const struct smc_sensor *sensor = &smc_sensors[i];
+        int count = sensor->perFan && sensor->elements > 1 ? fanCount : 1;
+
+        if (sensor->offset == SENSOR_NO_FIELD || !(sensor->section & flag)) {
+            continue;
+        }
+        for (int fan = 0; fan < count; fan++) {
+            plan->keys[plan->count] = SMC_FAN_KEY(sensor->key, fan);
+            plan->sensor[plan->count] = (uint8_t) i;
+            plan->fan[plan->count] = (uint8_t) fan;
+            plan->count++;
+        }
+    }
+}
+
+void smc_sensor_plan_sample(const struct smc_sensor_plan *plan, int flag, struct snapshot *snap) {
+    SMCKey_t keys[SMC_SENSOR_PLAN_SIZE];
+    SMCSample_t samples[SMC_SENSOR_PLAN_SIZE];
+
+    // sections are scheduled separately, only read the keys of the ones asked for
+    for (int i = 0; i < plan->count; i++) {
+        keys[i] = (smc_sensors[plan->sensor[i]].section & flag) ? plan->keys[i] : 0;
+    }
+    // sections are sampled from several collector threads, and the fan controller has one
+    SMC_lock();
+    SMC_read_many(keys, (size_t) plan->count, samples);
+    SMC_unlock();
+
+    for (int i = 0; i < plan->count; i++) {
+        const struct smc_sensor *sensor = &smc_sensors[plan->sensor[i]];
+        double *field;
+
+        if (keys[i] == 0) {
+            continue;
+        }
+        field = (double *) ((char *) snap + sensor->offset) + plan->fan[i];
+        *field = samples[i].valid ? samples[i].value : 0.0;
+        snap->valid |= sensor->validBit;
+    }
+}
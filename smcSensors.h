@@ -0,0 +1,145 @@
+//
+// Every SMC sensor macResMon knows, declared once. SMC_SENSORS expands X once per sensor:
+//
+//     X(id, key (4 chars), type, name, title, unit, section, validBit, field, perFan, warm, hot)
+//
+// id         SENSOR_<id> indexes smc_sensors, SMC_KEY_<id> is the packed key
+// type       the data type Intel machines report it in (Apple silicon reports flt for
+//            the fans, which decodes just as well)
+// name       export name, the one of the metric table and the exporters
+// title      display name
+// section    _CPU_TEMP, _FAN_STATUS, ... of infoCollector.h that samples it, 0 for none
+// field      SENSOR_FIELD(member) of struct snapshot it is sampled into, or SENSOR_NO_FIELD
+// perFan     1 when fan i has its own key, SMC_FAN_KEY of the fan 0 key; sampled into
+//            field[i] when the field is an array of SNAPSHOT_MAX_FANS, into a scalar field
+//            from fan 0 only
+// warm, hot  display colors: green below warm, yellow below hot, red past it; 0 for the
+//            fans, whose color is their share of the maximum
+//
+// Keys: T = temperature, then C = CPU, G = GPU, M = memory, B = battery/enclosure, with
+// P = proximity, D = diode, H = heatsink; F<n> = fan n, then Ac = actual, Mn = min,
+// Mx = max, Sf = safe, Tg = target. Sources: see TMP SMC keys.
+//
+// The section column only means something where infoCollector.h is included as well.
+//
+
+#ifndef FINALPROJECT_SMCSENSORS_H
+#define FINALPROJECT_SMCSENSORS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "smcTransport.h"
+#include "snapshot.h"
+
+#define SMC_SENSOR_CPU_0_PROXIMITY(X) \
+    X(CPU_0_PROXIMITY, 'T','C','0','P', DATA_TYPE_SP78, "cpu_temp", "CPU temp", "C", \
+      _CPU_TEMP, SNAP_CPU_TEMP, SENSOR_FIELD(cpuTemp), 0, 40, 60)
+#define SMC_SENSOR_MEMORY_SLOTS_PROXIMITY(X) \
+    X(MEMORY_SLOTS_PROXIMITY, 'T','M','0','P', DATA_TYPE_SP78, "mem_temp", "Mem temp", "C", \
+      _MEM_STATUS, SNAP_MEM_TEMP, SENSOR_FIELD(memTemp), 0, 40, 60)
+#define SMC_SENSOR_GPU_0_PROXIMITY(X) \
+    X(GPU_0_PROXIMITY, 'T','G','0','P', DATA_TYPE_SP78, "gpu_temp", "GPU temp", "C", \
+      _GPU_STATUS, SNAP_GPU_TEMP, SENSOR_FIELD(gpuTemp), 0, 40, 60)
+#define SMC_SENSOR_BATTERY_0_TEMP(X) \
+    X(BATTERY_0_TEMP, 'T','B','0','T', DATA_TYPE_SP78, "battery_temp", "Battery temp", "C", \
+      _BATTERY_STATUS, SNAP_BATTERY_TEMP, SENSOR_FIELD(batteryTemp), 0, 40, 60)
+#define SMC_SENSOR_FAN_0(X) \
+    X(FAN_0, 'F','0','A','c', DATA_TYPE_FPE2, "fan_rpm", "Fan speed", "rpm", \
+      _FAN_STATUS, SNAP_FANS, SENSOR_FIELD(fanSpeed), 1, 0, 0)
+#define SMC_SENSOR_FAN_0_MAX_RPM(X) \
+    X(FAN_0_MAX_RPM, 'F','0','M','x', DATA_TYPE_FPE2, "fan_max_rpm", "Max fan speed", "rpm", \
+      _FAN_STATUS, SNAP_FANS, SENSOR_FIELD(fanMax), 1, 0, 0)
+
+// the sampled sensors above have a macro of their own so snapshot.c can take its metric
+// from one row; the rest are known by name only
+#define SMC_SENSORS(X) \
+    SMC_SENSOR_CPU_0_PROXIMITY(X) \
+    SMC_SENSOR_MEMORY_SLOTS_PROXIMITY(X) \
+    SMC_SENSOR_GPU_0_PROXIMITY(X) \
+    SMC_SENSOR_BATTERY_0_TEMP(X) \
+    SMC_SENSOR_FAN_0(X) \
+    SMC_SENSOR_FAN_0_MAX_RPM(X) \
+    X(FAN_0_MIN_RPM,         'F','0','M','n', DATA_TYPE_FPE2, "fan_min_rpm",       "Min fan speed",         "rpm", 0, 0, SENSOR_NO_FIELD, 1, 0, 0) \
+    X(FAN_0_SAFE_RPM,        'F','0','S','f', DATA_TYPE_FPE2, "fan_safe_rpm",      "Safe fan speed",        "rpm", 0, 0, SENSOR_NO_FIELD, 1, 0, 0) \
+    X(FAN_0_TARGET_RPM,      'F','0','T','g', DATA_TYPE_FPE2, "fan_target_rpm",    "Target fan speed",      "rpm", 0, 0, SENSOR_NO_FIELD, 1, 0, 0) \
+    X(AMBIENT_AIR_0,         'T','A','0','P', DATA_TYPE_SP78, "ambient_0_temp",    "Ambient air 0",         "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(AMBIENT_AIR_1,         'T','A','1','P', DATA_TYPE_SP78, "ambient_1_temp",    "Ambient air 1",         "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(CPU_0_DIODE,           'T','C','0','D', DATA_TYPE_SP78, "cpu_diode_temp",    "CPU diode",             "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(CPU_0_HEATSINK,        'T','C','0','H', DATA_TYPE_SP78, "cpu_heatsink_temp", "CPU heatsink",          "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(ENCLOSURE_BASE_1,      'T','B','1','T', DATA_TYPE_SP78, "enclosure_1_temp",  "Enclosure base 1",      "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(ENCLOSURE_BASE_2,      'T','B','2','T', DATA_TYPE_SP78, "enclosure_2_temp",  "Enclosure base 2",      "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(ENCLOSURE_BASE_3,      'T','B','3','T', DATA_TYPE_SP78, "enclosure_3_temp",  "Enclosure base 3",      "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(GPU_0_DIODE,           'T','G','0','D', DATA_TYPE_SP78, "gpu_diode_temp",    "GPU diode",             "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(GPU_0_HEATSINK,        'T','G','0','H', DATA_TYPE_SP78, "gpu_heatsink_temp", "GPU heatsink",          "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(HARD_DRIVE_BAY,        'T','H','0','P', DATA_TYPE_SP78, "drive_bay_temp",    "Hard drive bay",        "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(MEMORY_SLOT_0,         'T','M','0','S', DATA_TYPE_SP78, "mem_slot_0_temp",   "Memory slot 0",         "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(NORTHBRIDGE,           'T','N','0','H', DATA_TYPE_SP78, "northbridge_temp",  "Northbridge",           "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(NORTHBRIDGE_DIODE,     'T','N','0','D', DATA_TYPE_SP78, "northbridge_diode_temp", "Northbridge diode", "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(NORTHBRIDGE_PROXIMITY, 'T','N','0','P', DATA_TYPE_SP78, "northbridge_proximity_temp", "Northbridge proximity", "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(THUNDERBOLT_0,         'T','I','0','P', DATA_TYPE_SP78, "thunderbolt_0_temp", "Thunderbolt 0",        "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(THUNDERBOLT_1,         'T','I','1','P', DATA_TYPE_SP78, "thunderbolt_1_temp", "Thunderbolt 1",        "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60) \
+    X(WIRELESS_MODULE,       'T','W','0','P', DATA_TYPE_SP78, "wireless_temp",     "Wireless module",       "C", 0, 0, SENSOR_NO_FIELD, 0, 40, 60)
+
+#define SENSOR_FIELD(member) offsetof(struct snapshot, member)
+#define SENSOR_NO_FIELD ((size_t) -1)
+// doubles in the field at offset: fanSpeed is the one array of per fan values
+#define SENSOR_FIELD_ELEMENTS(offset) ((offset) == SENSOR_FIELD(fanSpeed) ? SNAPSHOT_MAX_FANS : 1)
+
+#define SMC_SENSOR_ID(id, c0, c1, c2, c3, type, name, title, unit, section, validBit, field, perFan, warm, hot) \
+    SENSOR_##id,
+#define SMC_SENSOR_KEY(id, c0, c1, c2, c3, type, name, title, unit, section, validBit, field, perFan, warm, hot) \
+    SMC_KEY_##id = SMC_FOURCC(c0, c1, c2, c3),
+
+enum smc_sensor_id {
+    SMC_SENSORS(SMC_SENSOR_ID)
+    SMC_SENSOR_COUNT
+};
+
+// packed keys as integer constants, usable in case labels and static initializers
+enum smc_sensor_key {
+    SMC_SENSORS(SMC_SENSOR_KEY)
+};
+
+struct smc_sensor {
+    uint32_t key;               // packed, of fan 0 for a per fan sensor
+    uint32_t dataType;
+    char keyName[5];
+    const char *name;
+    const char *title;
+    const char *unit;
+    int section;
+    uint32_t validBit;
+    size_t offset;              // in struct snapshot, SENSOR_NO_FIELD when not sampled
+    int elements;               // doubles at offset, more than 1 for an array of per fan values
+    int perFan;
+    double warm, hot;
+};
+
+extern const struct smc_sensor smc_sensors[SMC_SENSOR_COUNT];
+
+// sensor whose key is key (fan i's key of a per fan sensor too, for a fan below
+// SNAPSHOT_MAX_FANS), NULL for an unknown key
+const struct smc_sensor *smc_sensor_find(uint32_t key);
+
+// the sensors of the enabled sections as a flat list of keys, compiled once when a backend
+// opens so a tick is a single batched read and a store per key
+#define SMC_SENSOR_PLAN_SIZE (SMC_SENSOR_COUNT + SNAPSHOT_MAX_FANS)
+
+struct smc_sensor_plan {
+    int count;
+    int fanCount;
+    uint32_t keys[SMC_SENSOR_PLAN_SIZE];
+    uint8_t sensor[SMC_SENSOR_PLAN_SIZE];
+    uint8_t fan[SMC_SENSOR_PLAN_SIZE];
+};
+
+// plan the sampled sensors of the sections in flag, per fan sensors sampled into an array
+// once for each of fanCount fans
+void smc_sensor_plan_compile(struct smc_sensor_plan *plan, int flag, int fanCount);
+
+// read the keys of the sections in flag in one batch into their snapshot fields and set
+// their validity bits; a key that fails to read leaves 0
+void smc_sensor_plan_sample(const struct smc_sensor_plan *plan, int flag, struct snapshot *snap);
+
+#endif //FINALPROJECT_SMCSENSORS_H
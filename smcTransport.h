@@ -0,0 +1,101 @@
+//
+// Wire structures of the AppleSMC user client and the seam used to deliver them.
+// systemManagementController.c only talks to an SMCTransport_t, so the IOKit connection
+// (smcIOKit.c) can be swapped for the in-memory fake (fakeSMC.c).
+//
+
+#ifndef FINALPROJECT_SMCTRANSPORT_H
+#define FINALPROJECT_SMCTRANSPORT_H
+
+#include <stdint.h>
+
+#ifdef __APPLE__
+#include <IOKit/IOKitLib.h>
+#else
+typedef int kern_return_t;
+#define kIOReturnSuccess  0
+#define kIOReturnError    ((kern_return_t) 0xe00002bc)
+#define kIOReturnNotFound ((kern_return_t) 0xe00002f0)
+#endif
+
+// pack four characters into the 32 bit code the SMC uses for keys and data types
+#define SMC_FOURCC(a, b, c, d) \
+    (((uint32_t) (a) << 24) | ((uint32_t) (b) << 16) | ((uint32_t) (c) << 8) | (uint32_t) (d))
+
+/**
+SMC data types - packed 4 byte codes
+*/
+#define DATA_TYPE_UINT8  SMC_FOURCC('u', 'i', '8', ' ')
+#define DATA_TYPE_UINT16 SMC_FOURCC('u', 'i', '1', '6')
+#define DATA_TYPE_UINT32 SMC_FOURCC('u', 'i', '3', '2')
+#define DATA_TYPE_FLAG   SMC_FOURCC('f', 'l', 'a', 'g')
+#define DATA_TYPE_FPE2   SMC_FOURCC('f', 'p', 'e', '2')
+#define DATA_TYPE_SFDS   SMC_FOURCC('{', 'f', 'd', 's')
+#define DATA_TYPE_SP78   SMC_FOURCC('s', 'p', '7', '8')
+#define DATA_TYPE_FLT    SMC_FOURCC('f', 'l', 't', ' ')   // little endian float, Apple silicon fans
+
+// result codes reported by the SMC itself in SMCKeyData_t.result
+#define kSMCSuccess     0
+#define kSMCKeyNotFound 132
+#define kSMCBadArgument 137
+
+typedef struct {
+    char major;
+    char minor;
+    char build;
+    char reserved[1];
+    uint16_t release;
+} SMCKeyData_vers_t;
+
+typedef struct {
+    uint16_t version;
+    uint16_t length;
+    uint32_t cpuPLimit;
+    uint32_t gpuPLimit;
+    uint32_t memPLimit;
+} SMCKeyData_pLimitData_t;
+
+typedef struct {
+    uint32_t dataSize;
+    uint32_t dataType;
+    char dataAttributes;
+} SMCKeyData_keyInfo_t;
+
+typedef char SMCBytes_t[32];
+
+typedef struct {
+    uint32_t key;
+    SMCKeyData_vers_t vers;
+    SMCKeyData_pLimitData_t pLimitData;
+    SMCKeyData_keyInfo_t keyInfo;
+    char result;
+    char status;
+    char data8;
+    uint32_t data32;
+    SMCBytes_t bytes;
+} SMCKeyData_t;
+
+typedef enum {
+    kSMCUserClientOpen = 0,
+    kSMCUserClientClose = 1,
+    kSMCHandleYPCEvent = 2,
+    kSMCReadKey = 5,
+    kSMCWriteKey = 6,
+    kSMCGetKeyCount = 7,
+    kSMCGetKeyFromIndex = 8,
+    kSMCGetKeyInfo = 9
+} selector_t;
+
+typedef struct {
+    const char *name;
+    kern_return_t (*open)(void);
+    kern_return_t (*close)(void);
+    // index is the user client method, the SMC command itself travels in input->data8
+    kern_return_t (*call)(int index, SMCKeyData_t *input, SMCKeyData_t *output);
+} SMCTransport_t;
+
+#ifdef __APPLE__
+extern const SMCTransport_t SMC_iokit_transport;
+#endif
+
+#endif //FINALPROJECT_SMCTRANSPORT_H
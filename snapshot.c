@@ -0,0 +1,205 @@
+//
+// Metric table of struct snapshot, see snapshot.h
+//
+
+#include <stddef.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "smcSensors.h"
+
+// the SMC sensors take name, unit, bit and field from their row of the sensor table
+#define SENSOR_METRIC(id, c0, c1, c2, c3, type, name, title, unit, section, validBit, field, perFan, warm, hot) \
+    {name, unit, validBit, field, 0}
+#define FAN_METRIC(i) {"fan" #i "_rpm", "rpm", SNAP_FANS, offsetof(struct snapshot, fanSpeed) + (i) * sizeof(double), 0}
+
+static const struct {
+    const char *name;
+    const char *unit;
+    uint32_t validBit;
+    size_t offset;
+    int isInt;
+} metrics[METRIC_COUNT] = {
+        [METRIC_DISK_USED]       = {"disk_used_gb", "GB", SNAP_DISK, 0, 0},
+        [METRIC_CPU_TEMP]        = SMC_SENSOR_CPU_0_PROXIMITY(SENSOR_METRIC),
+        [METRIC_CPU_BUSY]        = {"cpu_busy_percent", "%", SNAP_CPU_USAGE, 0, 0},
+        [METRIC_LOAD_1]          = {"load_1m", "", SNAP_LOAD, offsetof(struct snapshot, loadAverage), 0},
+        [METRIC_MEM_TEMP]        = SMC_SENSOR_MEMORY_SLOTS_PROXIMITY(SENSOR_METRIC),
+        [METRIC_GPU_TEMP]        = SMC_SENSOR_GPU_0_PROXIMITY(SENSOR_METRIC),
+        [METRIC_BATTERY_TEMP]    = SMC_SENSOR_BATTERY_0_TEMP(SENSOR_METRIC),
+        [METRIC_MEM_USED]        = {"mem_used_gb", "GB", SNAP_MEM, offsetof(struct snapshot, memUsed), 0},
+        [METRIC_SWAP_USED]       = {"swap_used_gb", "GB", SNAP_MEM_DETAIL, offsetof(struct snapshot, swapUsed), 0},
+        [METRIC_PAGE_OUT_RATE]   = {"page_outs_per_second", "pages/s", SNAP_MEM_RATES,
+                                    offsetof(struct snapshot, pageOutRate), 0},
+        [METRIC_BATTERY_PERCENT] = {"battery_percent", "%", SNAP_BATTERY, offsetof(struct snapshot, batteryPercent), 1},
+        [METRIC_SELF_CPU]        = {"self_cpu_percent", "%", SNAP_SELF, offsetof(struct snapshot, selfCpu), 0},
+        [METRIC_SELF_RSS]        = {"self_rss_mb", "MB", SNAP_SELF, offsetof(struct snapshot, selfRss), 0},
+        [METRIC_FAN_MAX]         = SMC_SENSOR_FAN_0_MAX_RPM(SENSOR_METRIC),
+        FAN_METRIC(0), FAN_METRIC(1), FAN_METRIC(2), FAN_METRIC(3), FAN_METRIC(4),
+        FAN_METRIC(5), FAN_METRIC(6), FAN_METRIC(7), FAN_METRIC(8), FAN_METRIC(9),
+};
+
+#define FAN_HELP(i) [METRIC_FAN_0 + (i)] = "Current speed of fan " #i " in rpm."
+
+// one line descriptions for the # HELP lines of the /metrics export
+static const char *helps[METRIC_COUNT] = {
+        [METRIC_DISK_USED]       = "Space used on the root volume in GB.",
+        [METRIC_CPU_TEMP]        = "CPU proximity temperature in degrees Celsius.",
+        [METRIC_CPU_BUSY]        = "Share of CPU time spent outside idle across all cores, in percent.",
+        [METRIC_LOAD_1]          = "Load average over the last minute.",
+        [METRIC_MEM_TEMP]        = "Memory slot proximity temperature in degrees Celsius.",
+        [METRIC_GPU_TEMP]        = "GPU proximity temperature in degrees Celsius.",
+        [METRIC_BATTERY_TEMP]    = "Battery temperature in degrees Celsius.",
+        [METRIC_MEM_USED]        = "Physical memory in use in GB.",
+        [METRIC_SWAP_USED]       = "Swap space in use in GB.",
+        [METRIC_PAGE_OUT_RATE]   = "Pages written out to swap per second.",
+        [METRIC_BATTERY_PERCENT] = "Battery charge in percent.",
+        [METRIC_SELF_CPU]        = "CPU time of macResMon itself in percent of one core.",
+        [METRIC_SELF_RSS]        = "Resident memory of macResMon itself in MB.",
+        [METRIC_FAN_MAX]         = "Highest speed the fans are rated for in rpm.",
+        FAN_HELP(0), FAN_HELP(1), FAN_HELP(2), FAN_HELP(3), FAN_HELP(4),
+        FAN_HELP(5), FAN_HELP(6), FAN_HELP(7), FAN_HELP(8), FAN_HELP(9),
+};
+
+static const char *bitNames[SNAP_BIT_COUNT] = {
+        "disk", "cpu_temp", "fans", "mem", "mem_temp", "gpu_temp", "battery", "battery_temp",
+        "disk_io", "cpu_usage", "load", "processes", "mem_detail", "mem_rates", "self",
+};
+
+const char *snapshot_bit_name(uint32_t bit) {
+    for (int i = 0; i < SNAP_BIT_COUNT; i++) {
+        if (bit == 1u << i) {
+            return bitNames[i];
+        }
+    }
+    return "?";
+}
+
+void snapshot_merge(struct snapshot *dst, const struct snapshot *src, uint32_t bits) {
+    if (bits & SNAP_DISK) {
+        dst->diskTotal = src->diskTotal;
+        dst->diskFree = src->diskFree;
+        dst->volumeCount = src->volumeCount;
+        memcpy(dst->volumes, src->volumes, (size_t) src->volumeCount * sizeof(struct volume_sample));
+    }
+    if (bits & SNAP_DISK_IO) {
+        dst->deviceCount = src->deviceCount;
+        memcpy(dst->devices, src->devices, (size_t) src->deviceCount * sizeof(struct device_sample));
+    }
+    if (bits & SNAP_CPU_TEMP) {
+        dst->cpuTemp = src->cpuTemp;
+    }
+    if (bits & SNAP_CPU_USAGE) {
+        size_t cores = (size_t) src->coreCount * sizeof(float);
+        dst->coreCount = src->coreCount;
+        dst->cpuUser = src->cpuUser;
+        dst->cpuSystem = src->cpuSystem;
+        dst->cpuNice = src->cpuNice;
+        dst->cpuIdle = src->cpuIdle;
+        memcpy(dst->coreUser, src->coreUser, cores);
+        memcpy(dst->coreSystem, src->coreSystem, cores);
+        memcpy(dst->coreNice, src->coreNice, cores);
+        memcpy(dst->coreIdle, src->coreIdle, cores);
+    }
+    if (bits & SNAP_LOAD) {
+        memcpy(dst->loadAverage, src->loadAverage, sizeof(dst->loadAverage));
+    }
+    if (bits & SNAP_PROCESSES) {
+        size_t rows = (size_t) src->topCount * sizeof(struct process_sample);
+        dst->processCount = src->processCount;
+        dst->topCount = src->topCount;
+        memcpy(dst->topCpu, src->topCpu, rows);
+        memcpy(dst->topMemory, src->topMemory, rows);
+    }
+    if (bits & SNAP_FANS) {
+        dst->fanCount = src->fanCount;
+        dst->fanMax = src->fanMax;
+        memcpy(dst->fanSpeed, src->fanSpeed, sizeof(dst->fanSpeed));
+    }
+    if (bits & SNAP_MEM) {
+        dst->memTotal = src->memTotal;
+        dst->memUsed = src->memUsed;
+    }
+    if (bits & SNAP_MEM_DETAIL) {
+        dst->memFree = src->memFree;
+        dst->memActive = src->memActive;
+        dst->memInactive = src->memInactive;
+        dst->memWired = src->memWired;
+        dst->memCompressed = src->memCompressed;
+        dst->memPurgeable = src->memPurgeable;
+        dst->swapUsed = src->swapUsed;
+    }
+    if (bits & SNAP_MEM_RATES) {
+        dst->pageInRate = src->pageInRate;
+        dst->pageOutRate = src->pageOutRate;
+        dst->compressionRate = src->compressionRate;
+        dst->decompressionRate = src->decompressionRate;
+    }
+    if (bits & SNAP_MEM_TEMP) {
+        dst->memTemp = src->memTemp;
+    }
+    if (bits & SNAP_GPU_TEMP) {
+        dst->gpuTemp = src->gpuTemp;
+    }
+    if (bits & SNAP_SELF) {
+        dst->selfCpu = src->selfCpu;
+        dst->selfRss = src->selfRss;
+        dst->selfSyscalls = src->selfSyscalls;
+        dst->selfSmcCalls = src->selfSmcCalls;
+    }
+    if (bits & SNAP_BATTERY) {
+        dst->batteryPresent = src->batteryPresent;
+        dst->batteryPercent = src->batteryPercent;
+        dst->batteryPowered = src->batteryPowered;
+        dst->batteryMinutes = src->batteryMinutes;
+    }
+    if (bits & SNAP_BATTERY_TEMP) {
+        dst->batteryTemp = src->batteryTemp;
+    }
+    dst->valid = (dst->valid & ~bits) | (src->valid & bits);
+}
+
+const char *metric_name(int metric) {
+    return metrics[metric].name;
+}
+
+const char *metric_unit(int metric) {
+    return metrics[metric].unit;
+}
+
+const char *metric_help(int metric) {
+    return helps[metric];
+}
+
+uint32_t metric_valid_bit(int metric) {
+    return metrics[metric].validBit;
+}
+
+int snapshot_metric(const struct snapshot *snap, int metric, double *value) {
+    if (!(snap->valid & metrics[metric].validBit)) {
+        return 0;
+    }
+
+    switch (metric) {
+        case METRIC_DISK_USED:
+            *value = snap->diskTotal - snap->diskFree;
+            return 1;
+        case METRIC_CPU_BUSY:
+            *value = 100.0 - snap->cpuIdle;
+            return 1;
+        case METRIC_BATTERY_PERCENT:
+            if (!snap->batteryPresent) {
+                return 0;
+            }
+            break;
+        default:
+            if (metric >= METRIC_FAN_0 && metric - METRIC_FAN_0 >= snap->fanCount) {
+                return 0;
+            }
+            break;
+    }
+
+    const char *field = (const char *) snap + metrics[metric].offset;
+    *value = metrics[metric].isInt ? *(const int *) field : *(const double *) field;
+    return 1;
+}
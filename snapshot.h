@@ -0,0 +1,173 @@
+//
+// One sample of every metric macResMon knows about. Backends fill it, renderers and
+// exporters only ever read it, so collection never depends on how values are shown.
+//
+
+#ifndef FINALPROJECT_SNAPSHOT_H
+#define FINALPROJECT_SNAPSHOT_H
+
+#include <stdint.h>
+
+#define SNAPSHOT_MAX_FANS 10
+#define SNAPSHOT_MAX_VOLUMES 8
+#define SNAPSHOT_MAX_DEVICES 8
+#define SNAPSHOT_NAME_LENGTH 48
+#define SNAPSHOT_MAX_CORES 128
+#define SNAPSHOT_MAX_PROCESSES 10
+#define PROCESS_NAME_LENGTH 32
+
+// validity bits, a field group is only meaningful when its bit is set
+#define SNAP_DISK         (1u << 0)
+#define SNAP_CPU_TEMP     (1u << 1)
+#define SNAP_FANS         (1u << 2)
+#define SNAP_MEM          (1u << 3)
+#define SNAP_MEM_TEMP     (1u << 4)
+#define SNAP_GPU_TEMP     (1u << 5)
+#define SNAP_BATTERY      (1u << 6)
+#define SNAP_BATTERY_TEMP (1u << 7)
+#define SNAP_DISK_IO      (1u << 8)     // rates need two samples, so this lags SNAP_DISK by one
+#define SNAP_CPU_USAGE    (1u << 9)     // same for the tick counters
+#define SNAP_LOAD         (1u << 10)
+#define SNAP_PROCESSES    (1u << 11)    // cpu shares need two samples as well
+#define SNAP_MEM_DETAIL   (1u << 12)
+#define SNAP_MEM_RATES    (1u << 13)    // and so do the paging rates
+#define SNAP_SELF         (1u << 14)    // macResMon's own cost, filled by the engine
+
+// space of one mounted volume, GB
+struct volume_sample {
+    char mount[SNAPSHOT_NAME_LENGTH];
+    double total;
+    double free;
+};
+
+// one row of the process table
+struct process_sample {
+    int pid;
+    char name[PROCESS_NAME_LENGTH];
+    float cpu;          // percent of one core over the last sample interval
+    double rss;         // resident memory, MB
+};
+
+// activity of one block device, per second
+struct device_sample {
+    char name[SNAPSHOT_NAME_LENGTH];
+    double readBytes;
+    double writeBytes;
+    double reads;
+    double writes;
+};
+
+struct snapshot {
+    uint64_t timestamp;     // wall clock, nanoseconds since the epoch
+    uint32_t valid;         // SNAP_* bits
+    uint32_t stale;         // SNAP_* bits whose collector has been stuck past the timeout
+
+    // disk, GB, of the root volume
+    double diskTotal;
+    double diskFree;
+    // every mounted volume and the devices behind them
+    int volumeCount;
+    struct volume_sample volumes[SNAPSHOT_MAX_VOLUMES];
+    int deviceCount;
+    struct device_sample devices[SNAPSHOT_MAX_DEVICES];
+
+    // cpu usage over the last sample interval, percent. Per core values are kept as
+    // structure of arrays so every core is updated by one vectorizable loop
+    int coreCount;
+    float cpuUser, cpuSystem, cpuNice, cpuIdle;    // all cores together
+    float coreUser[SNAPSHOT_MAX_CORES];
+    float coreSystem[SNAPSHOT_MAX_CORES];
+    float coreNice[SNAPSHOT_MAX_CORES];
+    float coreIdle[SNAPSHOT_MAX_CORES];
+    double loadAverage[3];      // 1, 5 and 15 minutes
+
+    // busiest processes, sorted from the top
+    int processCount;           // processes running
+    int topCount;               // rows in each table
+    struct process_sample topCpu[SNAPSHOT_MAX_PROCESSES];
+    struct process_sample topMemory[SNAPSHOT_MAX_PROCESSES];
+
+    // temperatures, °C
+    double cpuTemp;
+    double memTemp;
+    double gpuTemp;
+    double batteryTemp;
+
+    // fans, rpm
+    int fanCount;
+    double fanMax;
+    double fanSpeed[SNAPSHOT_MAX_FANS];
+
+    // memory, GB
+    double memTotal;
+    double memUsed;
+    double memFree;
+    double memActive;
+    double memInactive;
+    double memWired;
+    double memCompressed;
+    double memPurgeable;
+    double swapUsed;
+    // memory pressure, pages per second
+    double pageInRate;
+    double pageOutRate;
+    double compressionRate;
+    double decompressionRate;
+
+    // what macResMon itself costs, over the last second
+    double selfCpu;             // percent of one core
+    double selfRss;             // MB
+    double selfSyscalls;        // per second, see struct self_usage
+    double selfSmcCalls;        // per second
+
+    // battery
+    int batteryPresent;
+    int batteryPercent;
+    int batteryPowered;     // charging or fully charged
+    int batteryMinutes;     // time to empty, -1 while the system is still calculating
+};
+
+/**
+Scalar metrics of a snapshot, addressable by number for history, statistics and export
+*/
+enum metric {
+    METRIC_DISK_USED,
+    METRIC_CPU_TEMP,
+    METRIC_CPU_BUSY,
+    METRIC_LOAD_1,
+    METRIC_MEM_TEMP,
+    METRIC_GPU_TEMP,
+    METRIC_BATTERY_TEMP,
+    METRIC_MEM_USED,
+    METRIC_SWAP_USED,
+    METRIC_PAGE_OUT_RATE,
+    METRIC_BATTERY_PERCENT,
+    METRIC_SELF_CPU,
+    METRIC_SELF_RSS,
+    METRIC_FAN_MAX,
+    METRIC_FAN_0,
+    METRIC_COUNT = METRIC_FAN_0 + SNAPSHOT_MAX_FANS
+};
+
+#define SNAP_BIT_COUNT 15
+
+// short name of a SNAP_* bit, e.g. "disk"
+const char *snapshot_bit_name(uint32_t bit);
+
+// copy the field groups of src whose validity bit is in bits, with their validity
+void snapshot_merge(struct snapshot *dst, const struct snapshot *src, uint32_t bits);
+
+const char *metric_name(int metric);
+
+const char *metric_unit(int metric);
+
+// one sentence on what metric measures, with its unit
+const char *metric_help(int metric);
+
+// SNAP_* bit that tells whether a snapshot carries metric
+uint32_t metric_valid_bit(int metric);
+
+// store metric of snap in value, returns 0 when the snapshot does not carry it
+int snapshot_metric(const struct snapshot *snap, int metric, double *value);
+
+#endif //FINALPROJECT_SNAPSHOT_H
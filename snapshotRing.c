@@ -0,0 +1,80 @@
+//
+// Lock-free snapshot ring, see snapshotRing.h
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshotRing.h"
+
+int snapshot_ring_init(struct snapshot_ring *ring, size_t capacity) {
+    size_t size = 1;
+    void *slots;
+
+    while (size < capacity) {
+        size <<= 1;
+    }
+    if (posix_memalign(&slots, CACHE_LINE_SIZE, size * sizeof(struct snapshot_slot)) != 0) {
+        return -1;
+    }
+    memset(slots, 0, size * sizeof(struct snapshot_slot));
+
+    ring->slots = slots;
+    ring->mask = size - 1;
+    for (size_t i = 0; i < size; i++) {
+        atomic_init(&ring->slots[i].seq, 0);
+    }
+    atomic_init(&ring->head, 0);
+    return 0;
+}
+
+void snapshot_ring_free(struct snapshot_ring *ring) {
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+void snapshot_ring_push(struct snapshot_ring *ring, const struct snapshot *snap) {
+    uint64_t index = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    struct snapshot_slot *slot = &ring->slots[index & ring->mask];
+
+    // odd sequence: readers that see it (or see it change) retry or give up on this slot
+    atomic_store_explicit(&slot->seq, 2 * index + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&slot->snap, snap, sizeof(struct snapshot));
+    atomic_store_explicit(&slot->seq, 2 * index + 2, memory_order_release);
+    atomic_store_explicit(&ring->head, index + 1, memory_order_release);
+}
+
+uint64_t snapshot_ring_head(const struct snapshot_ring *ring) {
+    return atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+int snapshot_ring_read(const struct snapshot_ring *ring, uint64_t index, struct snapshot *out) {
+    struct snapshot_slot *slot = &ring->slots[index & ring->mask];
+    uint64_t expected = 2 * index + 2;
+
+    uint64_t before = atomic_load_explicit(&slot->seq, memory_order_acquire);
+    if (before != expected) {
+        return -1;
+    }
+    memcpy(out, &slot->snap, sizeof(struct snapshot));
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t after = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    return after == expected ? 0 : -1;
+}
+
+int snapshot_ring_latest(const struct snapshot_ring *ring, struct snapshot *out, uint64_t *index) {
+    for (;;) {
+        uint64_t head = snapshot_ring_head(ring);
+        if (head == 0) {
+            return -1;
+        }
+        // only fails when the writer lapped us, the next head is then newer anyway
+        if (snapshot_ring_read(ring, head - 1, out) == 0) {
+            if (index != NULL) {
+                *index = head - 1;
+            }
+            return 0;
+        }
+    }
+}
@@ -0,0 +1,46 @@
+//
+// Fixed-capacity ring of timestamped snapshots with one writer and any number of readers.
+// Every slot carries its own sequence number used as a seqlock, so the sampling thread
+// never waits for a reader and a reader detects (and skips) a slot overwritten under it.
+//
+
+#ifndef FINALPROJECT_SNAPSHOTRING_H
+#define FINALPROJECT_SNAPSHOTRING_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "snapshot.h"
+
+#define CACHE_LINE_SIZE 64
+
+struct snapshot_slot {
+    // 2 * index + 2 once snapshot number index is complete, odd while it is being written
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t seq;
+    struct snapshot snap;
+};
+
+struct snapshot_ring {
+    // number of snapshots published so far, the newest one is head - 1
+    _Alignas(CACHE_LINE_SIZE) atomic_uint_fast64_t head;
+    _Alignas(CACHE_LINE_SIZE) struct snapshot_slot *slots;
+    uint64_t mask;
+};
+
+// capacity is rounded up to a power of two, returns 0 on success
+int snapshot_ring_init(struct snapshot_ring *ring, size_t capacity);
+
+void snapshot_ring_free(struct snapshot_ring *ring);
+
+// writer side, must only be called from one thread
+void snapshot_ring_push(struct snapshot_ring *ring, const struct snapshot *snap);
+
+uint64_t snapshot_ring_head(const struct snapshot_ring *ring);
+
+// copy snapshot number index, returns -1 when it is not published yet or already overwritten
+int snapshot_ring_read(const struct snapshot_ring *ring, uint64_t index, struct snapshot *out);
+
+// copy the newest snapshot and store its number in index (may be NULL), -1 when the ring is empty
+int snapshot_ring_latest(const struct snapshot_ring *ring, struct snapshot *out, uint64_t *index);
+
+#endif //FINALPROJECT_SNAPSHOTRING_H
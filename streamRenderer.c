@@ -0,0 +1,407 @@
+//
+// Streaming renderer for log shippers: one record per tick as CSV, NDJSON or a JSON
+// array, written to stdout or a file. The record template (the field names with their
+// quotes and separators) is built once from the sections in flag, so a record is only
+// copying those prefixes and formatting numbers into one buffer, handed to the kernel
+// with a single write().
+// Fans, cores, volumes, devices and process rows get one numbered field per element,
+// e.g. fan_0_rpm. The template covers the most elements seen so far, so a count that
+// grows rebuilds it (and repeats the CSV header) while a shrinking one writes nulls.
+//
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "renderer.h"
+#include "infoCollector.h"
+#include "textBuffer.h"
+#include "smcSensors.h"
+
+#define RECORD_SIZE 32768
+#define MAX_FIELDS 384
+#define TEMPLATE_SIZE 16384
+#define NAME_SIZE 64
+#define NO_COUNT ((size_t) -1)
+
+enum stream_format {
+    STREAM_CSV,
+    STREAM_NDJSON,
+    STREAM_JSON,        // one array, closed when the renderer closes
+};
+
+enum field_type {
+    FIELD_DOUBLE,
+    FIELD_FLOAT,
+    FIELD_INT,
+    FIELD_BUSY,                 // float idle percentage, written as 100 minus it
+    FIELD_STRING,               // char array
+};
+
+// a scalar of the snapshot, or a member of every element of one of its arrays, written
+// when flag is selected and validBit is set
+struct field {
+    const char *name;           // of an array member: name_INDEX_suffix
+    const char *suffix;
+    int flag;                   // section, 0 for always
+    uint32_t validBit;
+    size_t offset;              // of the scalar or of the member of element 0
+    enum field_type type;
+    size_t size;                // of the scalar or member, bounds a string
+    size_t countOffset;         // int element count of an array, NO_COUNT for a scalar
+    size_t stride;              // between two elements
+    int max;                    // elements of the array
+};
+
+#define MEMBER(member) (((struct snapshot *) 0)->member)
+#define FIELD(name, flag, bit, member, type) \
+    {name, NULL, flag, bit, offsetof(struct snapshot, member), type, sizeof(MEMBER(member)), NO_COUNT, 0, 1}
+// member of every element of array, count elements of it; consecutive EACH rows of the same
+// array are written element by element: volume_0_mount, volume_0_total_gb, volume_1_mount...
+#define EACH(name, suffix, flag, bit, array, member, type, count) \
+    {name, suffix, flag, bit, offsetof(struct snapshot, array[0] member), type, sizeof(MEMBER(array[0] member)), \
+     offsetof(struct snapshot, count), sizeof(MEMBER(array[0])), (int) (sizeof(MEMBER(array)) / sizeof(MEMBER(array[0])))}
+// a sampled SMC sensor, everything but the type comes from its row of the sensor table
+#define SENSOR(id, c0, c1, c2, c3, type, name, title, unit, section, validBit, field, perFan, warm, hot) \
+    {name, NULL, section, validBit, field, FIELD_DOUBLE, sizeof(double), NO_COUNT, 0, 1}
+
+static const struct field fields[] = {
+        FIELD("disk_total_gb", _DISK_STATUS, SNAP_DISK, diskTotal, FIELD_DOUBLE),
+        FIELD("disk_free_gb", _DISK_STATUS, SNAP_DISK, diskFree, FIELD_DOUBLE),
+        EACH("volume", "mount", _DISK_STATUS, SNAP_DISK, volumes, .mount, FIELD_STRING, volumeCount),
+        EACH("volume", "total_gb", _DISK_STATUS, SNAP_DISK, volumes, .total, FIELD_DOUBLE, volumeCount),
+        EACH("volume", "free_gb", _DISK_STATUS, SNAP_DISK, volumes, .free, FIELD_DOUBLE, volumeCount),
+        EACH("device", "name", _DISK_STATUS, SNAP_DISK_IO, devices, .name, FIELD_STRING, deviceCount),
+        EACH("device", "read_bytes_per_second", _DISK_STATUS, SNAP_DISK_IO, devices, .readBytes, FIELD_DOUBLE,
+             deviceCount),
+        EACH("device", "write_bytes_per_second", _DISK_STATUS, SNAP_DISK_IO, devices, .writeBytes, FIELD_DOUBLE,
+             deviceCount),
+        EACH("device", "reads_per_second", _DISK_STATUS, SNAP_DISK_IO, devices, .reads, FIELD_DOUBLE, deviceCount),
+        EACH("device", "writes_per_second", _DISK_STATUS, SNAP_DISK_IO, devices, .writes, FIELD_DOUBLE,
+             deviceCount),
+        SMC_SENSOR_CPU_0_PROXIMITY(SENSOR),
+        FIELD("cpu_user_percent", _CPU_USAGE, SNAP_CPU_USAGE, cpuUser, FIELD_FLOAT),
+        FIELD("cpu_system_percent", _CPU_USAGE, SNAP_CPU_USAGE, cpuSystem, FIELD_FLOAT),
+        FIELD("cpu_nice_percent", _CPU_USAGE, SNAP_CPU_USAGE, cpuNice, FIELD_FLOAT),
+        FIELD("cpu_idle_percent", _CPU_USAGE, SNAP_CPU_USAGE, cpuIdle, FIELD_FLOAT),
+        EACH("core", "busy_percent", _CPU_USAGE, SNAP_CPU_USAGE, coreIdle, , FIELD_BUSY, coreCount),
+        FIELD("load_1m", _CPU_USAGE, SNAP_LOAD, loadAverage[0], FIELD_DOUBLE),
+        FIELD("load_5m", _CPU_USAGE, SNAP_LOAD, loadAverage[1], FIELD_DOUBLE),
+        FIELD("load_15m", _CPU_USAGE, SNAP_LOAD, loadAverage[2], FIELD_DOUBLE),
+        FIELD("fan_count", _FAN_STATUS, SNAP_FANS, fanCount, FIELD_INT),
+        SMC_SENSOR_FAN_0_MAX_RPM(SENSOR),
+        EACH("fan", "rpm", _FAN_STATUS, SNAP_FANS, fanSpeed, , FIELD_DOUBLE, fanCount),
+        FIELD("mem_total_gb", _MEM_STATUS, SNAP_MEM, memTotal, FIELD_DOUBLE),
+        FIELD("mem_used_gb", _MEM_STATUS, SNAP_MEM, memUsed, FIELD_DOUBLE),
+        FIELD("mem_free_gb", _MEM_STATUS, SNAP_MEM_DETAIL, memFree, FIELD_DOUBLE),
+        FIELD("mem_active_gb", _MEM_STATUS, SNAP_MEM_DETAIL, memActive, FIELD_DOUBLE),
+        FIELD("mem_inactive_gb", _MEM_STATUS, SNAP_MEM_DETAIL, memInactive, FIELD_DOUBLE),
+        FIELD("mem_wired_gb", _MEM_STATUS, SNAP_MEM_DETAIL, memWired, FIELD_DOUBLE),
+        FIELD("mem_compressed_gb", _MEM_STATUS, SNAP_MEM_DETAIL, memCompressed, FIELD_DOUBLE),
+        FIELD("mem_purgeable_gb", _MEM_STATUS, SNAP_MEM_DETAIL, memPurgeable, FIELD_DOUBLE),
+        FIELD("swap_used_gb", _MEM_STATUS, SNAP_MEM_DETAIL, swapUsed, FIELD_DOUBLE),
+        FIELD("page_ins_per_second", _MEM_STATUS, SNAP_MEM_RATES, pageInRate, FIELD_DOUBLE),
+        FIELD("page_outs_per_second", _MEM_STATUS, SNAP_MEM_RATES, pageOutRate, FIELD_DOUBLE),
+        FIELD("compressions_per_second", _MEM_STATUS, SNAP_MEM_RATES, compressionRate, FIELD_DOUBLE),
+        FIELD("decompressions_per_second", _MEM_STATUS, SNAP_MEM_RATES, decompressionRate, FIELD_DOUBLE),
+        SMC_SENSOR_MEMORY_SLOTS_PROXIMITY(SENSOR),
+        SMC_SENSOR_GPU_0_PROXIMITY(SENSOR),
+        FIELD("battery_present", _BATTERY_STATUS, SNAP_BATTERY, batteryPresent, FIELD_INT),
+        FIELD("battery_percent", _BATTERY_STATUS, SNAP_BATTERY, batteryPercent, FIELD_INT),
+        FIELD("battery_powered", _BATTERY_STATUS, SNAP_BATTERY, batteryPowered, FIELD_INT),
+        FIELD("battery_minutes", _BATTERY_STATUS, SNAP_BATTERY, batteryMinutes, FIELD_INT),
+        SMC_SENSOR_BATTERY_0_TEMP(SENSOR),
+        FIELD("processes", _PROCESSES, SNAP_PROCESSES, processCount, FIELD_INT),
+        EACH("top_cpu", "pid", _PROCESSES, SNAP_PROCESSES, topCpu, .pid, FIELD_INT, topCount),
+        EACH("top_cpu", "name", _PROCESSES, SNAP_PROCESSES, topCpu, .name, FIELD_STRING, topCount),
+        EACH("top_cpu", "cpu_percent", _PROCESSES, SNAP_PROCESSES, topCpu, .cpu, FIELD_FLOAT, topCount),
+        EACH("top_cpu", "rss_mb", _PROCESSES, SNAP_PROCESSES, topCpu, .rss, FIELD_DOUBLE, topCount),
+        EACH("top_memory", "pid", _PROCESSES, SNAP_PROCESSES, topMemory, .pid, FIELD_INT, topCount),
+        EACH("top_memory", "name", _PROCESSES, SNAP_PROCESSES, topMemory, .name, FIELD_STRING, topCount),
+        EACH("top_memory", "cpu_percent", _PROCESSES, SNAP_PROCESSES, topMemory, .cpu, FIELD_FLOAT, topCount),
+        EACH("top_memory", "rss_mb", _PROCESSES, SNAP_PROCESSES, topMemory, .rss, FIELD_DOUBLE, topCount),
+        FIELD("self_cpu_percent", 0, SNAP_SELF, selfCpu, FIELD_DOUBLE),
+        FIELD("self_rss_mb", 0, SNAP_SELF, selfRss, FIELD_DOUBLE),
+        FIELD("self_syscalls_per_second", 0, SNAP_SELF, selfSyscalls, FIELD_DOUBLE),
+        FIELD("self_smc_calls_per_second", 0, SNAP_SELF, selfSmcCalls, FIELD_DOUBLE),
+};
+
+#define FIELD_COUNT (sizeof(fields) / sizeof(fields[0]))
+
+// the fields of the flag the template was built for, each with what goes before its value
+static struct {
+    int flag;                   // -1 before the first record
+    int elements[FIELD_COUNT];  // of every array field, the most seen so far
+    int count;
+    const struct field *field[MAX_FIELDS];
+    int index[MAX_FIELDS];      // element of an array field
+    const char *prefix[MAX_FIELDS];
+    size_t prefixLength[MAX_FIELDS];
+    char text[TEMPLATE_SIZE];
+} template;
+
+static enum stream_format format = STREAM_NDJSON;
+static const char *outputPath = NULL;
+static int fd = -1;
+static uint64_t records;
+static char record[RECORD_SIZE];
+
+int stream_renderer_configure(const char *formatName, const char *path) {
+    if (strcmp(formatName, "csv") == 0) {
+        format = STREAM_CSV;
+    } else if (strcmp(formatName, "ndjson") == 0) {
+        format = STREAM_NDJSON;
+    } else if (strcmp(formatName, "json") == 0) {
+        format = STREAM_JSON;
+    } else {
+        return -1;
+    }
+    outputPath = path;
+    return 0;
+}
+
+// the whole buffer, retried on short writes so a record is never torn
+static void write_all(const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        data += written;
+        length -= (size_t) written;
+    }
+}
+
+static int stream_open(void) {
+    if (outputPath == NULL) {
+        fd = STDOUT_FILENO;
+    } else if ((fd = open(outputPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) < 0) {
+        perror(outputPath);
+        return -1;
+    }
+    template.flag = -1;
+    memset(template.elements, 0, sizeof(template.elements));
+    records = 0;
+    if (format == STREAM_JSON) {
+        write_all("[", 1);
+    }
+    return 0;
+}
+
+static int elements_of(const struct snapshot *snap, const struct field *field) {
+    int count = *(const int *) ((const char *) snap + field->countOffset);
+    return count < 0 ? 0 : count > field->max ? field->max : count;
+}
+
+// one field of the template, returns -1 once it is full
+static int add_field(struct text *text, struct text *header, const struct field *field, int index) {
+    size_t start = text->length;
+    char name[NAME_SIZE];
+    struct text nameText = {name, 0, sizeof(name) - 1, 0};
+
+    text_put_str(&nameText, field->name);
+    if (field->countOffset != NO_COUNT) {
+        text_put_bytes(&nameText, "_", 1);
+        text_put_uint(&nameText, (uint64_t) index);
+        text_put_bytes(&nameText, "_", 1);
+        text_put_str(&nameText, field->suffix);
+    }
+    name[nameText.length] = '\0';
+
+    if (format == STREAM_CSV) {
+        text_put_bytes(text, ",", 1);
+        text_put_bytes(header, ",", 1);
+        text_put_str(header, name);
+    } else {
+        text_put_str(text, ",\"");
+        text_put_str(text, name);
+        text_put_str(text, "\":");
+    }
+    if (text->overflow || template.count == MAX_FIELDS) {
+        return -1;
+    }
+    template.field[template.count] = field;
+    template.index[template.count] = index;
+    template.prefix[template.count] = template.text + start;
+    template.prefixLength[template.count] = text->length - start;
+    template.count++;
+    return 0;
+}
+
+// prefixes of every field selected by flag, with as many elements of the arrays as the most
+// snap or an earlier one had, and the CSV header
+static void build_template(int flag, const struct snapshot *snap) {
+    struct text text = {template.text, 0, sizeof(template.text), 0};
+    struct text header = {record, 0, sizeof(record), 0};
+    int full = 0;
+
+    template.flag = flag;
+    template.count = 0;
+    text_put_str(&header, "time");
+    for (size_t i = 0; i < FIELD_COUNT && !full;) {
+        size_t end = i + 1;
+
+        if (fields[i].countOffset == NO_COUNT) {
+            if (fields[i].flag == 0 || (flag & fields[i].flag)) {
+                full = add_field(&text, &header, &fields[i], 0) != 0;
+            }
+            i = end;
+            continue;
+        }
+        // the rows of one array go out element by element
+        while (end < FIELD_COUNT && fields[end].countOffset == fields[i].countOffset) {
+            end++;
+        }
+        if (fields[i].flag == 0 || (flag & fields[i].flag)) {
+            int elements = elements_of(snap, &fields[i]);
+
+            if (elements > template.elements[i]) {
+                template.elements[i] = elements;
+            }
+            for (int index = 0; index < template.elements[i] && !full; index++) {
+                for (size_t k = i; k < end && !full; k++) {
+                    full = add_field(&text, &header, &fields[k], index) != 0;
+                }
+            }
+        }
+        i = end;
+    }
+    if (format == STREAM_CSV) {
+        text_put_bytes(&header, "\n", 1);
+        write_all(header.data, header.length);
+    }
+}
+
+// an array of snap has more elements than the template has fields for; the first row of
+// an array keeps the count for all of them
+static int template_too_small(const struct snapshot *snap) {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (fields[i].countOffset == NO_COUNT || (i > 0 && fields[i - 1].countOffset == fields[i].countOffset)) {
+            continue;
+        }
+        if ((template.flag & fields[i].flag) && elements_of(snap, &fields[i]) > template.elements[i]) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// a quoted string, escaped for JSON or with doubled quotes for CSV
+static void put_string(struct text *out, const char *value, size_t size) {
+    static const char hex[] = "0123456789abcdef";
+
+    text_put_bytes(out, "\"", 1);
+    for (size_t i = 0; i < size && value[i] != '\0'; i++) {
+        unsigned char c = (unsigned char) value[i];
+
+        if (c == '"') {
+            text_put_bytes(out, format == STREAM_CSV ? "\"\"" : "\\\"", 2);
+        } else if (format != STREAM_CSV && c == '\\') {
+            text_put_bytes(out, "\\\\", 2);
+        } else if (format != STREAM_CSV && c < 0x20) {
+            char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            text_put_bytes(out, escaped, sizeof(escaped));
+        } else {
+            text_put_bytes(out, &value[i], 1);
+        }
+    }
+    text_put_bytes(out, "\"", 1);
+}
+
+// seconds since the epoch with milliseconds, from integers so nothing is rounded
+static void put_time(struct text *out, uint64_t timestamp) {
+    uint64_t ms = timestamp / 1000000;
+    char fraction[4] = {'.', (char) ('0' + ms / 100 % 10), (char) ('0' + ms / 10 % 10), (char) ('0' + ms % 10)};
+
+    text_put_uint(out, ms / 1000);
+    text_put_bytes(out, fraction, sizeof(fraction));
+}
+
+static void put_value(struct text *out, const struct snapshot *snap, const struct field *field, int index) {
+    const char *member = (const char *) snap + field->offset + (size_t) index * field->stride;
+    double value = 0;
+    int present = (snap->valid & field->validBit) &&
+                  (field->countOffset == NO_COUNT || index < elements_of(snap, field));
+
+    switch (field->type) {
+        case FIELD_DOUBLE:
+            value = *(const double *) member;
+            break;
+        case FIELD_FLOAT:
+            value = *(const float *) member;
+            break;
+        case FIELD_INT:
+            value = *(const int *) member;
+            break;
+        case FIELD_BUSY:
+            value = 100.0f - *(const float *) member;
+            break;
+        case FIELD_STRING:
+            if (present) {
+                put_string(out, member, field->size);
+                return;
+            }
+            break;
+    }
+    // neither format has a spelling for NaN, it is written like a missing value
+    if (!present || !isfinite(value)) {
+        if (format != STREAM_CSV) {
+            text_put_str(out, "null");
+        }
+        return;
+    }
+    if (field->type == FIELD_INT) {
+        text_put_int(out, *(const int *) member);
+    } else {
+        text_put_double(out, value);
+    }
+}
+
+static void stream_render(const struct snapshot *snap, const struct metric_stats *stats, int flag) {
+    struct text out = {record, 0, sizeof(record), 0};
+
+    if (fd < 0) {
+        return;
+    }
+    if (flag != template.flag || template_too_small(snap)) {
+        build_template(flag, snap);
+    }
+    if (format == STREAM_JSON && records > 0) {
+        text_put_bytes(&out, ",", 1);
+    }
+    if (format != STREAM_CSV) {
+        text_put_str(&out, "{\"time\":");
+    }
+    put_time(&out, snap->timestamp);
+    for (int i = 0; i < template.count; i++) {
+        text_put_bytes(&out, template.prefix[i], template.prefixLength[i]);
+        put_value(&out, snap, template.field[i], template.index[i]);
+    }
+    text_put_str(&out, format == STREAM_CSV ? "\n" : "}\n");
+    if (!out.overflow) {
+        write_all(out.data, out.length);
+        records++;
+    }
+}
+
+static void stream_close(void) {
+    if (fd < 0) {
+        return;
+    }
+    if (format == STREAM_JSON) {
+        write_all("]\n", 2);
+    }
+    if (fd != STDOUT_FILENO) {
+        close(fd);
+    }
+    fd = -1;
+}
+
+const struct renderer stream_renderer = {"stream", stream_open, stream_render, stream_close, NULL, NULL};
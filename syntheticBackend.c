@@ -0,0 +1,134 @@
+//
+// Synthetic backend: smooth, deterministic waveforms that depend only on the time since
+// the backend was opened, for running the engine on machines without the real sensors.
+//
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "backend.h"
+#include "infoCollector.h"
+
+#define SYNTHETIC_FANS 2
+#define SYNTHETIC_CORES 8
+
+static double startTime;
+
+static double seconds_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// period in seconds
+static double wave(double elapsed, double base, double amplitude, double period) {
+    return base + amplitude * sin(2 * M_PI * elapsed / period);
+}
+
+static int synthetic_open(int flag) {
+    startTime = seconds_now();
+    return 0;
+}
+
+static void synthetic_sample(int flag, struct snapshot *snap) {
+    // local, sections are sampled from several collector threads at once
+    double elapsed = seconds_now() - startTime;
+    if (flag & _DISK_STATUS) {
+        snap->diskTotal = 500.0;
+        snap->diskFree = wave(elapsed, 200.0, 20.0, 600);
+        snap->volumeCount = 1;
+        snprintf(snap->volumes[0].mount, SNAPSHOT_NAME_LENGTH, "/");
+        snap->volumes[0].total = snap->diskTotal;
+        snap->volumes[0].free = snap->diskFree;
+        snap->deviceCount = 1;
+        snprintf(snap->devices[0].name, SNAPSHOT_NAME_LENGTH, "synth0");
+        snap->devices[0].readBytes = wave(elapsed, 50e6, 40e6, 20);
+        snap->devices[0].writeBytes = wave(elapsed, 20e6, 15e6, 30);
+        snap->devices[0].reads = wave(elapsed, 400.0, 300.0, 20);
+        snap->devices[0].writes = wave(elapsed, 150.0, 100.0, 30);
+        snap->valid |= SNAP_DISK | SNAP_DISK_IO;
+    }
+    if (flag & _CPU_USAGE) {
+        float busy = 0.0f;
+        snap->coreCount = SYNTHETIC_CORES;
+        for (int i = 0; i < SYNTHETIC_CORES; ++i) {
+            // every core a bit behind the previous one, so the strip moves
+            snap->coreUser[i] = (float) wave(elapsed + i * 2.0, 35.0, 30.0, 30);
+            snap->coreSystem[i] = (float) wave(elapsed + i * 2.0, 10.0, 8.0, 45);
+            snap->coreNice[i] = 0.0f;
+            snap->coreIdle[i] = 100.0f - snap->coreUser[i] - snap->coreSystem[i];
+            busy += snap->coreUser[i] + snap->coreSystem[i];
+        }
+        snap->cpuUser = snap->cpuSystem = snap->cpuNice = 0.0f;
+        for (int i = 0; i < SYNTHETIC_CORES; ++i) {
+            snap->cpuUser += snap->coreUser[i] / SYNTHETIC_CORES;
+            snap->cpuSystem += snap->coreSystem[i] / SYNTHETIC_CORES;
+        }
+        snap->cpuIdle = 100.0f - snap->cpuUser - snap->cpuSystem;
+        snap->loadAverage[0] = busy / 100.0;
+        snap->loadAverage[1] = wave(elapsed, busy / 100.0, 0.5, 300);
+        snap->loadAverage[2] = wave(elapsed, busy / 100.0, 0.2, 900);
+        snap->valid |= SNAP_CPU_USAGE | SNAP_LOAD;
+    }
+    if (flag & _CPU_TEMP) {
+        snap->cpuTemp = wave(elapsed, 55.0, 20.0, 60);
+        snap->valid |= SNAP_CPU_TEMP;
+    }
+    if (flag & _PROCESSES) {
+        static const char *names[] = {"compiler", "browser", "indexer", "database", "editor"};
+        snap->processCount = 300;
+        snap->topCount = 5;
+        for (int i = 0; i < snap->topCount; ++i) {
+            struct process_sample *process = &snap->topCpu[i];
+            process->pid = 1000 + i;
+            snprintf(process->name, PROCESS_NAME_LENGTH, "%s", names[i]);
+            process->cpu = (float) wave(elapsed, 80.0 / (i + 1), 10.0, 30);
+            process->rss = 2048.0 / (i + 1);
+            snap->topMemory[i] = *process;
+        }
+        snap->valid |= SNAP_PROCESSES;
+    }
+    if (flag & _FAN_STATUS) {
+        snap->fanCount = SYNTHETIC_FANS;
+        snap->fanMax = 6000.0;
+        for (int i = 0; i < SYNTHETIC_FANS; ++i) {
+            snap->fanSpeed[i] = wave(elapsed, 3000.0 + 200.0 * i, 1500.0, 60);
+        }
+        snap->valid |= SNAP_FANS;
+    }
+    if (flag & _MEM_STATUS) {
+        snap->memTotal = 16.0;
+        snap->memUsed = wave(elapsed, 10.0, 4.0, 120);
+        snap->memWired = 2.5;
+        snap->memCompressed = wave(elapsed, 1.0, 1.0, 120);
+        snap->memActive = snap->memUsed * 0.6;
+        snap->memInactive = snap->memUsed - snap->memActive - snap->memWired;
+        snap->memFree = snap->memTotal - snap->memUsed - snap->memCompressed;
+        snap->memPurgeable = 0.3;
+        snap->swapUsed = wave(elapsed, 0.5, 0.5, 300);
+        snap->pageInRate = wave(elapsed, 50.0, 50.0, 40);
+        snap->pageOutRate = 0.0;
+        snap->compressionRate = wave(elapsed, 200.0, 200.0, 120);
+        snap->decompressionRate = wave(elapsed, 150.0, 150.0, 120);
+        snap->memTemp = wave(elapsed, 45.0, 5.0, 90);
+        snap->valid |= SNAP_MEM | SNAP_MEM_TEMP | SNAP_MEM_DETAIL | SNAP_MEM_RATES;
+    }
+    if (flag & _GPU_STATUS) {
+        snap->gpuTemp = wave(elapsed, 50.0, 15.0, 45);
+        snap->valid |= SNAP_GPU_TEMP;
+    }
+    if (flag & _BATTERY_STATUS) {
+        snap->batteryPresent = 1;
+        snap->batteryPercent = 100 - (int) elapsed / 6 % 100;
+        snap->batteryPowered = 0;
+        snap->batteryMinutes = snap->batteryPercent * 6;
+        snap->batteryTemp = wave(elapsed, 32.0, 3.0, 300);
+        snap->valid |= SNAP_BATTERY | SNAP_BATTERY_TEMP;
+    }
+}
+
+static void synthetic_close(void) {
+}
+
+const struct backend synthetic_backend = {"synthetic", synthetic_open, synthetic_sample, synthetic_close};
@@ -2,86 +2,79 @@
 // Some parts of this c file come from Github repo /osx-cpu-temp and /libsmc and /iStats
 // Please refer to their repos for license information
 
-#include "systemManagementController.h"
-#include <IOKit/ps/IOPowerSources.h>
-#include <IOKit/ps/IOPSKeys.h>
+#include <pthread.h>
+#include <math.h>
 
+#include "systemManagementController.h"
+#include "selfStats.h"
 
+#ifdef __APPLE__
+static const SMCTransport_t *transport = &SMC_iokit_transport;
+#else
+#include "fakeSMC.h"
+static const SMCTransport_t *transport = &fakeSMC_transport;
+#endif
 
 /**
-SMC data types - 4 byte multi-character constants
+Key info cache - size and type of every key we have resolved, indexed by packed key.
+Open addressing with a bounded probe; when a key cannot be placed it is simply read uncached.
 */
-#define DATA_TYPE_UINT8  "ui8 "
-#define DATA_TYPE_UINT16 "ui16"
-#define DATA_TYPE_UINT32 "ui32"
-#define DATA_TYPE_FLAG   "flag"
-#define DATA_TYPE_FPE2   "fpe2"
-#define DATA_TYPE_SFDS   "{fds"
-#define DATA_TYPE_SP78   "sp78"
-
-
-typedef struct {
-    char major;
-    char minor;
-    char build;
-    char reserved[1];
-    UInt16 release;
-} SMCKeyData_vers_t;
+#define KEY_CACHE_SIZE  2048
+#define KEY_CACHE_PROBE 16
 
 typedef struct {
-    UInt16 version;
-    UInt16 length;
-    UInt32 cpuPLimit;
-    UInt32 gpuPLimit;
-    UInt32 memPLimit;
-} SMCKeyData_pLimitData_t;
+    SMCKey_t key;       // 0 marks an unused slot
+    uint32_t dataSize;  // 0 with valid set means the SMC reported the key as missing
+    uint32_t dataType;
+    int valid;
+} SMCKeyInfo_t;
 
-typedef struct {
-    UInt32 dataSize;
-    UInt32 dataType;
-    char dataAttributes;
-} SMCKeyData_keyInfo_t;
-
-typedef char SMCBytes_t[32];
+static SMCKeyInfo_t keyCache[KEY_CACHE_SIZE];
+static pthread_mutex_t smcLock = PTHREAD_MUTEX_INITIALIZER;
 
-typedef struct {
-    UInt32 key;
-    SMCKeyData_vers_t vers;
-    SMCKeyData_pLimitData_t pLimitData;
-    SMCKeyData_keyInfo_t keyInfo;
-    char result;
-    char status;
-    char data8;
-    UInt32 data32;
-    SMCBytes_t bytes;
-} SMCKeyData_t;
-
-typedef char UInt32Char_t[5];
+void SMC_lock(void) {
+    pthread_mutex_lock(&smcLock);
+}
 
-typedef struct {
-    UInt32Char_t key;
-    UInt32 dataSize;
-    UInt32Char_t dataType;
-    SMCBytes_t bytes;
-} SMCVal_t;
+void SMC_unlock(void) {
+    pthread_mutex_unlock(&smcLock);
+}
 
+static SMCKeyInfo_t *key_cache_slot(SMCKey_t key) {
+    uint32_t idx = (key * 2654435761u) & (KEY_CACHE_SIZE - 1);
+
+    for (int i = 0; i < KEY_CACHE_PROBE; i++) {
+        SMCKeyInfo_t *slot = &keyCache[(idx + i) & (KEY_CACHE_SIZE - 1)];
+        if (slot->key == key) {
+            return slot;
+        }
+        if (slot->key == 0) {
+            slot->key = key;
+            slot->valid = 0;
+            return slot;
+        }
+    }
+    return NULL;
+}
 
-typedef enum {
-    kSMCUserClientOpen = 0,
-    kSMCUserClientClose = 1,
-    kSMCHandleYPCEvent = 2,
-    kSMCReadKey = 5,
-    kSMCWriteKey = 6,
-    kSMCGetKeyCount = 7,
-    kSMCGetKeyFromIndex = 8,
-    kSMCGetKeyInfo = 9
-} selector_t;
+void SMC_invalidate_key(SMCKey_t key) {
+    SMCKeyInfo_t *slot = key_cache_slot(key);
+    if (slot != NULL) {
+        slot->valid = 0;
+    }
+}
 
+void SMC_invalidate_all(void) {
+    memset(keyCache, 0, sizeof(keyCache));
+}
 
-static io_connect_t conn;
+void SMC_set_transport(const SMCTransport_t *newTransport) {
+    transport = newTransport;
+    SMC_invalidate_all();
+}
 
-UInt32 str_to_uint32(char *str, int size, int base) {
-    UInt32 total = 0;
+uint32_t str_to_uint32(char *str, int size, int base) {
+    uint32_t total = 0;
     int i;
 
     for (i = 0; i < size; i++) {
@@ -93,245 +86,388 @@ UInt32 str_to_uint32(char *str, int size, int base) {
     return total;
 }
 
-void uint32_to_str(char *str, UInt32 val) {
-    str[0] = '\0';
-    sprintf(str, "%c%c%c%c",
-            (unsigned int) val >> 24,
-            (unsigned int) val >> 16,
-            (unsigned int) val >> 8,
-            (unsigned int) val);
+void uint32_to_str(char *str, uint32_t val) {
+    str[0] = (char) (val >> 24);
+    str[1] = (char) (val >> 16);
+    str[2] = (char) (val >> 8);
+    str[3] = (char) val;
+    str[4] = '\0';
 }
 
-kern_return_t SMC_open(void) {
-    kern_return_t result;
-    io_iterator_t iterator;
-    io_object_t device;
-
-    CFMutableDictionaryRef matchingDictionary = IOServiceMatching("AppleSMC");
-    result = IOServiceGetMatchingServices(kIOMasterPortDefault, matchingDictionary, &iterator);
-    if (result != kIOReturnSuccess) {
-        printf("Error: IOServiceGetMatchingServices() = %08x\n", result);
-        return 1;
-    }
-
-    device = IOIteratorNext(iterator);
-    IOObjectRelease(iterator);
-    if (device == 0) {
-        printf("Error: no SMC found\n");
-        return 1;
-    }
-
-    result = IOServiceOpen(device, mach_task_self(), 0, &conn);
-    IOObjectRelease(device);
-    if (result != kIOReturnSuccess) {
-        printf("Error: IOServiceOpen() = %08x\n", result);
-        return 1;
-    }
+SMCKey_t SMC_key(const char *name) {
+    return SMC_FOURCC((unsigned char) name[0], (unsigned char) name[1], (unsigned char) name[2],
+                      (unsigned char) name[3]);
+}
 
-    return kIOReturnSuccess;
+kern_return_t SMC_open(void) {
+    SMC_invalidate_all();
+    return transport->open();
 }
 
 kern_return_t SMC_close() {
-    return IOServiceClose(conn);
+    return transport->close();
 }
 
 kern_return_t SMC_call(int index, SMCKeyData_t *inputStructure, SMCKeyData_t *outputStructure) {
-    size_t structureInputSize;
-    size_t structureOutputSize;
-
-    structureInputSize = sizeof(SMCKeyData_t);
-    structureOutputSize = sizeof(SMCKeyData_t);
-
-    return IOConnectCallStructMethod(conn, index,
-            // inputStructure
-                                     inputStructure, structureInputSize,
-            // ouputStructure
-                                     outputStructure, &structureOutputSize);
+    self_stats_count_smc_call();
+    return transport->call(index, inputStructure, outputStructure);
 }
 
-kern_return_t SMC_read_key_val(UInt32Char_t key, SMCVal_t *val) {
+// size and type of key into val, only asks the SMC when they are not cached yet
+static kern_return_t resolve_key_info(SMCKey_t key, SMCKeyInfo_t *info, SMCVal_t *val) {
     kern_return_t result;
     SMCKeyData_t inputStructure;
     SMCKeyData_t outputStructure;
 
+    if (info != NULL && info->valid) {
+        if (info->dataSize == 0)
+            return kIOReturnNotFound;
+        val->dataSize = info->dataSize;
+        val->dataType = info->dataType;
+        return kIOReturnSuccess;
+    }
+
     memset(&inputStructure, 0, sizeof(SMCKeyData_t));
     memset(&outputStructure, 0, sizeof(SMCKeyData_t));
-    memset(val, 0, sizeof(SMCVal_t));
-
-    inputStructure.key = str_to_uint32(key, 4, 16);
+    inputStructure.key = key;
     inputStructure.data8 = kSMCGetKeyInfo;
 
     result = SMC_call(kSMCHandleYPCEvent, &inputStructure, &outputStructure);
     if (result != kIOReturnSuccess)
         return result;
 
+    if (outputStructure.result != kSMCSuccess) {
+        // a missing key stays missing, remember that so polling it costs nothing
+        if ((unsigned char) outputStructure.result == kSMCKeyNotFound && info != NULL) {
+            info->dataSize = 0;
+            info->dataType = 0;
+            info->valid = 1;
+        }
+        return kIOReturnNotFound;
+    }
+
+    if (info != NULL) {
+        info->dataSize = outputStructure.keyInfo.dataSize;
+        info->dataType = outputStructure.keyInfo.dataType;
+        info->valid = 1;
+    }
     val->dataSize = outputStructure.keyInfo.dataSize;
-    uint32_to_str(val->dataType, outputStructure.keyInfo.dataType);
+    val->dataType = outputStructure.keyInfo.dataType;
+    return kIOReturnSuccess;
+}
+
+kern_return_t SMC_read_key(SMCKey_t key, SMCVal_t *val) {
+    kern_return_t result;
+    SMCKeyData_t inputStructure;
+    SMCKeyData_t outputStructure;
+    SMCKeyInfo_t *info = key_cache_slot(key);
+
+    memset(val, 0, sizeof(SMCVal_t));
+    val->key = key;
+
+    result = resolve_key_info(key, info, val);
+    if (result != kIOReturnSuccess)
+        return result;
+
+    memset(&inputStructure, 0, sizeof(SMCKeyData_t));
+    memset(&outputStructure, 0, sizeof(SMCKeyData_t));
+    inputStructure.key = key;
     inputStructure.keyInfo.dataSize = val->dataSize;
     inputStructure.data8 = kSMCReadKey;
 
     result = SMC_call(kSMCHandleYPCEvent, &inputStructure, &outputStructure);
-    if (result != kIOReturnSuccess)
+    if (result == kIOReturnSuccess && outputStructure.result != kSMCSuccess)
+        result = kIOReturnError;
+    if (result != kIOReturnSuccess) {
+        // the cached info may be stale (e.g. after a firmware reset), re-resolve next time
+        if (info != NULL)
+            info->valid = 0;
         return result;
+    }
 
     memcpy(val->bytes, outputStructure.bytes, sizeof(outputStructure.bytes));
 
     return kIOReturnSuccess;
 }
 
-double SMC_get_temperature(char *key) {
-    SMCVal_t val;
+kern_return_t SMC_write_key(SMCKey_t key, const SMCVal_t *val) {
     kern_return_t result;
+    SMCKeyData_t inputStructure;
+    SMCKeyData_t outputStructure;
 
-    result = SMC_read_key_val(key, &val);
-    // check read and returned value
-    if (result == kIOReturnSuccess && val.dataSize > 0 && strcmp(val.dataType, DATA_TYPE_SP78) == 0) {
-        // convert sp78 value to temperature
-        int intValue = val.bytes[0] * 256 + (unsigned char) val.bytes[1];
-        return intValue / 256.0;
-    }
-    // read failed
-    return 0.0;
+    if (val->dataSize > sizeof(SMCBytes_t))
+        return kIOReturnError;
+
+    memset(&inputStructure, 0, sizeof(SMCKeyData_t));
+    memset(&outputStructure, 0, sizeof(SMCKeyData_t));
+    inputStructure.key = key;
+    inputStructure.keyInfo.dataSize = val->dataSize;
+    inputStructure.data8 = kSMCWriteKey;
+    memcpy(inputStructure.bytes, val->bytes, val->dataSize);
+
+    result = SMC_call(kSMCHandleYPCEvent, &inputStructure, &outputStructure);
+    if (result == kIOReturnSuccess && outputStructure.result != kSMCSuccess)
+        result = kIOReturnError;
+    return result;
 }
 
-double SMC_get_fan_speed(char *key) {
-    SMCVal_t val;
+kern_return_t SMC_write_value(SMCKey_t key, double value) {
     kern_return_t result;
+    SMCVal_t val;
 
-    result = SMC_read_key_val(key, &val);
-    if (result == kIOReturnSuccess && val.dataSize > 0 && strcmp(val.dataType, DATA_TYPE_FPE2) == 0) {
-        // convert fpe2 value to rpm
-        int intValue = (unsigned char) val.bytes[0] * 256 + (unsigned char) val.bytes[1];
-        return intValue / 4.0;
+    memset(&val, 0, sizeof(SMCVal_t));
+    val.key = key;
+    result = resolve_key_info(key, key_cache_slot(key), &val);
+    if (result != kIOReturnSuccess)
+        return result;
+    if (!SMC_encode(val.dataType, value, val.bytes, val.dataSize))
+        return kIOReturnError;
+    return SMC_write_key(key, &val);
+}
 
+void SMC_prime_key_info(SMCKey_t key, uint32_t dataSize, uint32_t dataType) {
+    SMCKeyInfo_t *info = key_cache_slot(key);
+    if (info != NULL) {
+        info->dataSize = dataSize;
+        info->dataType = dataType;
+        info->valid = 1;
     }
-    // read failed
-    return 0.0;
 }
 
-void SMC_get_fan_speeds(int fanNum, double *speeds) {
-    // loop through all fans and get info
-    for (int i = 0; i < fanNum; i++) {
-        char key[5] = FAN_0;
-        key[1] += i;
-        double speed = SMC_get_fan_speed(key);
-        speeds[i] = speed;
-    }
+kern_return_t SMC_get_key_info(SMCKey_t key, uint32_t *dataSize, uint32_t *dataType, uint8_t *attributes) {
+    kern_return_t result;
+    SMCKeyData_t inputStructure;
+    SMCKeyData_t outputStructure;
+
+    memset(&inputStructure, 0, sizeof(SMCKeyData_t));
+    memset(&outputStructure, 0, sizeof(SMCKeyData_t));
+    inputStructure.key = key;
+    inputStructure.data8 = kSMCGetKeyInfo;
+
+    result = SMC_call(kSMCHandleYPCEvent, &inputStructure, &outputStructure);
+    if (result != kIOReturnSuccess)
+        return result;
+    if (outputStructure.result != kSMCSuccess)
+        return kIOReturnNotFound;
+
+    *dataSize = outputStructure.keyInfo.dataSize;
+    *dataType = outputStructure.keyInfo.dataType;
+    *attributes = (uint8_t) outputStructure.keyInfo.dataAttributes;
+    SMC_prime_key_info(key, *dataSize, *dataType);
+    return kIOReturnSuccess;
 }
 
-int SMC_get_fan_num() {
-    SMCVal_t val;
+kern_return_t SMC_get_key_at(uint32_t index, SMCKey_t *key) {
     kern_return_t result;
+    SMCKeyData_t inputStructure;
+    SMCKeyData_t outputStructure;
 
-    result = SMC_read_key_val(NUM_FANS, &val);
-    if (result == kIOReturnSuccess && val.dataSize > 0 && strcmp(val.dataType, DATA_TYPE_UINT8) == 0) {
-        return val.bytes[0];
-    }
+    memset(&inputStructure, 0, sizeof(SMCKeyData_t));
+    memset(&outputStructure, 0, sizeof(SMCKeyData_t));
+    inputStructure.data8 = kSMCGetKeyFromIndex;
+    inputStructure.data32 = index;
 
-    return -1;
+    result = SMC_call(kSMCHandleYPCEvent, &inputStructure, &outputStructure);
+    if (result != kIOReturnSuccess)
+        return result;
+    if (outputStructure.result != kSMCSuccess)
+        return kIOReturnNotFound;
+
+    *key = outputStructure.key;
+    return kIOReturnSuccess;
 }
 
+kern_return_t SMC_read_key_val(char *key, SMCVal_t *val) {
+    return SMC_read_key(SMC_key(key), val);
+}
 
-CFDictionaryRef powerSourceInfo() {
-    CFTypeRef powerInfo = IOPSCopyPowerSourcesInfo();
+/**
+Decoders and encoders for the numeric SMC data types, looked up by packed type code
+*/
+static double decode_sp78(const unsigned char *bytes) {
+    // signed 7.8 fixed point
+    return (int16_t) (bytes[0] << 8 | bytes[1]) / 256.0;
+}
 
-    if (!powerInfo) return NULL;
+static double decode_fpe2(const unsigned char *bytes) {
+    // unsigned 14.2 fixed point
+    return (bytes[0] << 8 | bytes[1]) / 4.0;
+}
 
-    CFArrayRef powerSourcesList = IOPSCopyPowerSourcesList(powerInfo);
-    if (!powerSourcesList) {
-        CFRelease(powerInfo);
-        return NULL;
-    }
+static double decode_flt(const unsigned char *bytes) {
+    float value;
+    uint32_t bits = (uint32_t) bytes[3] << 24 | (uint32_t) bytes[2] << 16 | (uint32_t) bytes[1] << 8 | bytes[0];
 
-    if (CFArrayGetCount(powerSourcesList)) {
-        CFDictionaryRef powerSourceInformation = IOPSGetPowerSourceDescription(powerInfo,
-                                                                               CFArrayGetValueAtIndex(powerSourcesList,
-                                                                                                      0));
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
 
-        //CFRelease(powerInfo);
-        //CFRelease(powerSourcesList);
-        return powerSourceInformation;
-    }
+static double decode_ui8(const unsigned char *bytes) {
+    return bytes[0];
+}
 
-    CFRelease(powerInfo);
-    CFRelease(powerSourcesList);
-    return NULL;
+static double decode_ui16(const unsigned char *bytes) {
+    return bytes[0] << 8 | bytes[1];
 }
 
-int SMC_get_current_battery_percent() {
-    CFNumberRef currentCapacity;
-    int currentPercentage;
+static double decode_ui32(const unsigned char *bytes) {
+    return (double) ((uint32_t) bytes[0] << 24 | (uint32_t) bytes[1] << 16 | (uint32_t) bytes[2] << 8 | bytes[3]);
+}
+
+static double decode_flag(const unsigned char *bytes) {
+    return bytes[0] != 0;
+}
 
-    CFDictionaryRef powerSourceInformation;
+// big endian two's complement or unsigned integer of size bytes, clamped to its range
+static void encode_integer(unsigned char *bytes, int size, double value, double low, double high) {
+    double clamped = isnan(value) || value < low ? low : value > high ? high : value;
+    int64_t integer = (int64_t) llround(clamped);
 
-    // the result is a dictionary containing power source information
-    powerSourceInformation = powerSourceInfo();
-    if (powerSourceInformation == NULL) {
-        return 0;
+    for (int i = 0; i < size; i++) {
+        bytes[i] = (unsigned char) (integer >> (8 * (size - 1 - i)));
     }
+}
 
-    // returned result is the left battery percentage
-    currentCapacity = CFDictionaryGetValue(powerSourceInformation, CFSTR(kIOPSCurrentCapacityKey));
-    CFNumberGetValue(currentCapacity, kCFNumberIntType, &currentPercentage);
+static void encode_sp78(unsigned char *bytes, double value) {
+    encode_integer(bytes, 2, value * 256.0, -32768, 32767);
+}
 
-    return currentPercentage;
+static void encode_fpe2(unsigned char *bytes, double value) {
+    encode_integer(bytes, 2, value * 4.0, 0, 65535);
 }
 
-int SMC_is_battery_powered() {
-    CFDictionaryRef powerSourceInformation = powerSourceInfo();
-    if (powerSourceInformation == NULL) {
-        return 0;
+static void encode_flt(unsigned char *bytes, double value) {
+    float single = (float) value;
+    uint32_t bits;
+
+    memcpy(&bits, &single, sizeof(bits));
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char) (bits >> (8 * i));
     }
+}
+
+static void encode_ui8(unsigned char *bytes, double value) {
+    encode_integer(bytes, 1, value, 0, 255);
+}
 
-    CFBooleanRef isChargedBoolean = CFDictionaryGetValue(powerSourceInformation, CFSTR(kIOPSIsChargedKey));
-    CFBooleanRef isChargingBoolean = CFDictionaryGetValue(powerSourceInformation, CFSTR(kIOPSIsChargingKey));
+static void encode_ui16(unsigned char *bytes, double value) {
+    encode_integer(bytes, 2, value, 0, 65535);
+}
 
-    // if it is null then it is not fully charged
-    int charged = isChargedBoolean == NULL ? 0 : CFBooleanGetValue(isChargedBoolean);
-    int charging = CFBooleanGetValue(isChargingBoolean);
+static void encode_ui32(unsigned char *bytes, double value) {
+    encode_integer(bytes, 4, value, 0, 4294967295.0);
+}
 
-    // when a battery is full charged or is charging then the computer is powered
-    if (charged || charging) {
-        return 1;
+static void encode_flag(unsigned char *bytes, double value) {
+    bytes[0] = value != 0;
+}
+
+static const struct {
+    uint32_t dataType;
+    uint32_t dataSize;
+    double (*decode)(const unsigned char *bytes);
+    void (*encode)(unsigned char *bytes, double value);
+} codecs[] = {
+        {DATA_TYPE_SP78,   2, decode_sp78, encode_sp78},
+        {DATA_TYPE_FPE2,   2, decode_fpe2, encode_fpe2},
+        {DATA_TYPE_FLT,    4, decode_flt,  encode_flt},
+        {DATA_TYPE_UINT8,  1, decode_ui8,  encode_ui8},
+        {DATA_TYPE_UINT16, 2, decode_ui16, encode_ui16},
+        {DATA_TYPE_UINT32, 4, decode_ui32, encode_ui32},
+        {DATA_TYPE_FLAG,   1, decode_flag, encode_flag},
+};
+
+int SMC_decode(uint32_t dataType, const char *bytes, uint32_t dataSize, double *value) {
+    for (size_t i = 0; i < sizeof(codecs) / sizeof(codecs[0]); i++) {
+        if (codecs[i].dataType == dataType) {
+            if (dataSize < codecs[i].dataSize)
+                return 0;
+            *value = codecs[i].decode((const unsigned char *) bytes);
+            return 1;
+        }
     }
     return 0;
 }
 
-// return the health status of battery
-const char *SMC_get_battery_health() {
-    CFDictionaryRef powerSourceInformation = powerSourceInfo();
-    if (powerSourceInformation == NULL) {
-        return "Unknown";
+int SMC_encode(uint32_t dataType, double value, char *bytes, uint32_t dataSize) {
+    for (size_t i = 0; i < sizeof(codecs) / sizeof(codecs[0]); i++) {
+        if (codecs[i].dataType == dataType) {
+            if (dataSize != codecs[i].dataSize)
+                return 0;
+            codecs[i].encode((unsigned char *) bytes, value);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+size_t SMC_read_many(const SMCKey_t *keys, size_t n, SMCSample_t *out) {
+    size_t validCount = 0;
+    SMCVal_t val;
+
+    for (size_t i = 0; i < n; i++) {
+        out[i].key = keys[i];
+        out[i].dataType = 0;
+        out[i].value = 0.0;
+        out[i].valid = 0;
+        if (keys[i] == 0 || SMC_read_key(keys[i], &val) != kIOReturnSuccess)
+            continue;
+
+        out[i].dataType = val.dataType;
+        out[i].valid = SMC_decode(val.dataType, val.bytes, val.dataSize, &out[i].value);
+        validCount += out[i].valid;
     }
+    return validCount;
+}
 
-    CFStringRef batteryHealthRef = (CFStringRef) CFDictionaryGetValue(powerSourceInformation, CFSTR("BatteryHealth"));
-    const char *batteryHealth = CFStringGetCStringPtr(batteryHealthRef, // CFStringRef theString,
-                                                      kCFStringEncodingMacRoman); //CFStringEncoding encoding);
-    if (batteryHealth == NULL)
-        return "unknown";
+double SMC_get_sensor(enum smc_sensor_id sensor, int fan) {
+    const struct smc_sensor *info = &smc_sensors[sensor];
+    SMCKey_t key = SMC_FAN_KEY(info->key, info->perFan ? fan : 0);
+    SMCSample_t sample;
 
-    return batteryHealth;
+    SMC_read_many(&key, 1, &sample);
+    if (!sample.valid || sample.dataType != info->dataType)
+        return 0.0;
+    return sample.value;
+}
+
+void SMC_get_fan_speeds(int fanNum, double *speeds) {
+    SMCKey_t keys[fanNum];
+    SMCSample_t samples[fanNum];
+
+    // loop through all fans and get info in one batch
+    for (int i = 0; i < fanNum; i++) {
+        keys[i] = SMC_FAN_KEY(SMC_KEY_FAN_0, i);
+    }
+    SMC_read_many(keys, (size_t) fanNum, samples);
+    for (int i = 0; i < fanNum; i++) {
+        speeds[i] = samples[i].valid ? samples[i].value : 0.0;
+    }
 }
 
-// return the left time of the battery
-// -1 indicates the system is calculating the time
-int SMC_get_time_remaining() {
-    CFDictionaryRef powerSourceInformation = powerSourceInfo();
-    if (powerSourceInformation == NULL)
-        return 0;
+int SMC_get_key_count(void) {
+    SMCKey_t key = SMC_key(NUM_KEYS);
+    SMCSample_t sample;
 
-    int remainingMinutes;
-    CFNumberRef timeRemaining = CFDictionaryGetValue(powerSourceInformation, CFSTR(kIOPSTimeToEmptyKey));
-    CFNumberGetValue(timeRemaining, kCFNumberIntType, &remainingMinutes);
+    if (SMC_read_many(&key, 1, &sample) == 1 && sample.dataType == DATA_TYPE_UINT32) {
+        return (int) sample.value;
+    }
 
-    return remainingMinutes;
+    return -1;
 }
 
-int hasBattery() {
-    CFDictionaryRef powerSourceInformation = powerSourceInfo();
-    return powerSourceInformation != NULL;
+int SMC_get_fan_num() {
+    SMCKey_t key = SMC_key(NUM_FANS);
+    SMCSample_t sample;
+
+    if (SMC_read_many(&key, 1, &sample) == 1 && sample.dataType == DATA_TYPE_UINT8) {
+        return (int) sample.value;
+    }
+
+    return -1;
 }
 
+
 int systemSupported(){
     // at least MAC_OS_X_VERSION_10_5 required due to the function used in SMC_call
     #if MAC_OS_X_VERSION_10_5
@@ -6,58 +6,18 @@
 #ifndef FINALPROJECT_CPUSTATUS_H
 #define FINALPROJECT_CPUSTATUS_H
 
-#include <IOKit/IOKitLib.h>
 #include <printf.h>
 #include <memory.h>
+#include "smcTransport.h"
+#include "smcSensors.h"
 
 /**
-SMC keys
-- T = Temperature (if first char)
-- C = CPU
-- G = GPU
-- P = Proximity
-- D = Diode
-- H = Heatsink
-- B = Battery
-*/
-#define AMBIENT_AIR_0          "TA0P"
-#define AMBIENT_AIR_1          "TA1P"
-#define CPU_0_DIODE            "TC0D"
-#define CPU_0_HEATSINK         "TC0H"
-#define CPU_0_PROXIMITY        "TC0P"
-#define BATTERY_0_TEMP         "TB0T"
-#define ENCLOSURE_BASE_1       "TB1T"
-#define ENCLOSURE_BASE_2       "TB2T"
-#define ENCLOSURE_BASE_3       "TB3T"
-#define GPU_0_DIODE            "TG0D"
-#define GPU_0_HEATSINK         "TG0H"
-#define GPU_0_PROXIMITY        "TG0P"
-#define HARD_DRIVE_BAY         "TH0P"
-#define MEMORY_SLOT_0          "TM0S"
-#define MEMORY_SLOTS_PROXIMITY "TM0P"
-#define NORTHBRIDGE            "TN0H"
-#define NORTHBRIDGE_DIODE      "TN0D"
-#define NORTHBRIDGE_PROXIMITY  "TN0P"
-#define THUNDERBOLT_0          "TI0P"
-#define THUNDERBOLT_1          "TI1P"
-#define WIRELESS_MODULE        "TW0P"
-
-
-/**
-SMC keys for fans - 4CC code
-- F  = Fan
-- Ac = Acutal
-- Mn = Min
-- Mx = Max
-- Sf = Safe
-- Tg = Target
+SMC keys for fans that are not sensors, the sensors themselves (temperatures, fan speeds)
+are declared in smcSensors.h
+- Md = Mode
 Sources: See TMP SMC keys
 */
-#define FAN_0            "F0Ac"
-#define FAN_0_MIN_RPM    "F0Mn"
-#define FAN_0_MAX_RPM    "F0Mx"
-#define FAN_0_SAFE_RPM   "F0Sf"
-#define FAN_0_TARGET_RPM "F0Tg"
+#define FAN_0_MODE       "F0Md"         // 1 for manual where there is no FS!
 #define NUM_FANS         "FNum"
 #define FORCE_BITS       "FS! "
 
@@ -73,27 +33,91 @@ Sources: See TMP SMC keys
 #define MAX_BATTERY_CAP     2
 
 
-kern_return_t SMC_open(void);
+// packed four character key, e.g. "TC0P" -> 0x54433050
+typedef uint32_t SMCKey_t;
 
-kern_return_t SMC_close();
+typedef struct {
+    SMCKey_t key;
+    uint32_t dataSize;
+    uint32_t dataType;
+    SMCBytes_t bytes;
+} SMCVal_t;
 
-double SMC_get_temperature(char *key);
+// one decoded value of a batched read
+typedef struct {
+    SMCKey_t key;
+    uint32_t dataType;
+    double value;
+    int valid;
+} SMCSample_t;
 
-int SMC_get_fan_num();
+// route all SMC traffic through transport, must be called before SMC_open
+void SMC_set_transport(const SMCTransport_t *transport);
 
-void SMC_get_fan_speeds(int fanNum, double *speeds);
+SMCKey_t SMC_key(const char *name);
+
+uint32_t str_to_uint32(char *str, int size, int base);
+
+// unpack a key or type code into a 5 byte, NUL terminated buffer
+void uint32_to_str(char *str, uint32_t val);
+
+// read a key, its size and type are resolved on first use and cached afterwards
+// so a warm read is a single call into the transport
+kern_return_t SMC_read_key(SMCKey_t key, SMCVal_t *val);
+
+// write val->dataSize bytes of val->bytes to the key, the size must be the key's own
+kern_return_t SMC_write_key(SMCKey_t key, const SMCVal_t *val);
+
+// encode value in the key's data type (resolved like a read) and write it
+kern_return_t SMC_write_value(SMCKey_t key, double value);
+
+// serialize every user of the connection; the collectors and the fan controller run on
+// threads of their own and the connection and its key cache are shared
+void SMC_lock(void);
 
-double SMC_get_fan_speed(char *key);
+void SMC_unlock(void);
 
-int SMC_get_current_battery_percent();
+// forget the cached size and type of a key (or all keys) so the next read re-resolves it
+void SMC_invalidate_key(SMCKey_t key);
 
-int SMC_is_battery_powered();
+void SMC_invalidate_all(void);
 
-const char *SMC_get_battery_health();
+// key of fan i derived from the fan 0 key, e.g. F0Ac -> F2Ac
+#define SMC_FAN_KEY(fan0Key, i) ((SMCKey_t) ((fan0Key) + ((uint32_t) (i) << 16)))
 
-int SMC_get_time_remaining();
+// decode raw bytes of a sp78/fpe2/flt/ui8/ui16/ui32/flag value, returns 0 for unsupported types
+int SMC_decode(uint32_t dataType, const char *bytes, uint32_t dataSize, double *value);
 
-int hasBattery();
+// the reverse of SMC_decode, values out of range are clamped to the type
+int SMC_encode(uint32_t dataType, double value, char *bytes, uint32_t dataSize);
+
+// read and decode n keys in one pass, out[i] belongs to keys[i]; a key of 0 is skipped
+// returns the number of valid samples
+size_t SMC_read_many(const SMCKey_t *keys, size_t n, SMCSample_t *out);
+
+// number of keys the SMC exposes (#KEY), -1 when it cannot be read
+int SMC_get_key_count(void);
+
+// key at position index of the SMC's own sorted key list
+kern_return_t SMC_get_key_at(uint32_t index, SMCKey_t *key);
+
+// ask the SMC for size, type and attributes of key, the result also warms the key info cache
+kern_return_t SMC_get_key_info(SMCKey_t key, uint32_t *dataSize, uint32_t *dataType, uint8_t *attributes);
+
+// seed the key info cache with a size and type known from elsewhere (e.g. the on-disk catalog)
+void SMC_prime_key_info(SMCKey_t key, uint32_t dataSize, uint32_t dataType);
+
+kern_return_t SMC_open(void);
+
+kern_return_t SMC_close();
+
+// read one sensor of the table (fan is ignored unless it is a per fan sensor), 0 when the
+// read fails or the key is not of the sensor's type
+double SMC_get_sensor(enum smc_sensor_id sensor, int fan);
+
+int SMC_get_fan_num();
+
+void SMC_get_fan_speeds(int fanNum, double *speeds);
 
 int systemSupported();
 
@@ -0,0 +1,171 @@
+//
+// Alert rules: parsing, the hysteresis band, for= and rate windows, and a loaded rule
+// file whose log action gets the events
+//
+
+#include "test.h"
+#include "alerts.h"
+
+#define SECOND 1000000000ull
+
+static void parses_rules_and_rejects_bad_ones(void) {
+    static const char *bad[] = {
+            "nope > 5", "cpu_temp", "cpu_temp = 5", "cpu_temp >", "cpu_temp > hot", "cpu_temp rate > 5",
+            "cpu_temp rate > 5/0", "cpu_temp > 5 hysteresis=-1", "cpu_temp > 5 for=soon", "cpu_temp > 5 loud=1",
+            "cpu_temp > 5 action=log:",
+    };
+    struct alert_rule rule;
+    char error[128];
+
+    CHECK(alert_rule_parse("   \n", &rule, error, sizeof(error)) == 1);
+    CHECK(alert_rule_parse("# cpu_temp > 5", &rule, error, sizeof(error)) == 1);
+
+    CHECK(alert_rule_parse("cpu_temp > 80 hysteresis=5 for=10\n", &rule, error, sizeof(error)) == 0);
+    CHECK(rule.above && !rule.rate && rule.threshold == 80 && rule.hysteresis == 5);
+    CHECK(rule.holdNs == 10 * SECOND && rule.action == ALERT_STDERR);
+    CHECK(strcmp(rule.text, "cpu_temp > 80 hysteresis=5 for=10") == 0);
+
+    CHECK(alert_rule_parse("battery_percent < 10 action=exec:say low battery", &rule, error, sizeof(error)) == 0);
+    CHECK(!rule.above && rule.action == ALERT_EXEC && strcmp(rule.target, "say low battery") == 0);
+    free(rule.target);
+
+    CHECK(alert_rule_parse("cpu_temp rate > 5/2.5", &rule, error, sizeof(error)) == 0);
+    CHECK(rule.rate && rule.threshold == 5 && rule.windowNs == 5 * SECOND / 2);
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        error[0] = '\0';
+        CHECK(alert_rule_parse(bad[i], &rule, error, sizeof(error)) == -1);
+        CHECK(error[0] != '\0');
+    }
+
+    // a rule longer than the message text is shortened there
+    CHECK(alert_rule_parse("cpu_temp > 80 action=exec:echo a rather long command line that keeps going "
+                           "past the length of the message text", &rule, error, sizeof(error)) == 0);
+    CHECK(strlen(rule.text) == sizeof(rule.text) - 1);
+    CHECK(strcmp(rule.text + sizeof(rule.text) - 4, "...") == 0);
+    free(rule.target);
+}
+
+static void hysteresis_keeps_it_from_flapping(void) {
+    struct alert_rule rule;
+    char error[128];
+
+    alert_rule_parse("cpu_temp > 80 hysteresis=5", &rule, error, sizeof(error));
+    CHECK(alert_rule_step(&rule, 79, 1) == -1);
+    CHECK(alert_rule_step(&rule, 81, 2) == ALERT_FIRING);
+    // hovering at the threshold stays firing
+    CHECK(alert_rule_step(&rule, 79, 3) == -1);
+    CHECK(alert_rule_step(&rule, 81, 4) == -1);
+    CHECK(alert_rule_step(&rule, 75.5, 5) == -1);
+    CHECK(rule.state == ALERT_FIRING);
+    CHECK(alert_rule_step(&rule, 74.9, 6) == ALERT_CLEAR);
+    CHECK(alert_rule_step(&rule, 80, 7) == -1);
+
+    alert_rule_parse("battery_percent < 10 hysteresis=2", &rule, error, sizeof(error));
+    CHECK(alert_rule_step(&rule, 9, 1) == ALERT_FIRING);
+    CHECK(alert_rule_step(&rule, 11.5, 2) == -1);
+    CHECK(alert_rule_step(&rule, 12.5, 3) == ALERT_CLEAR);
+}
+
+static void for_waits_before_firing(void) {
+    struct alert_rule rule;
+    char error[128];
+
+    alert_rule_parse("cpu_temp > 80 for=10", &rule, error, sizeof(error));
+    CHECK(alert_rule_step(&rule, 85, 100 * SECOND) == ALERT_PENDING);
+    CHECK(alert_rule_step(&rule, 85, 105 * SECOND) == -1);
+    // a dip starts the wait over
+    CHECK(alert_rule_step(&rule, 70, 106 * SECOND) == ALERT_CLEAR);
+    CHECK(alert_rule_step(&rule, 85, 107 * SECOND) == ALERT_PENDING);
+    CHECK(alert_rule_step(&rule, 85, 116 * SECOND) == -1);
+    CHECK(alert_rule_step(&rule, 85, 117 * SECOND) == ALERT_FIRING);
+    CHECK(alert_rule_step(&rule, 85, 200 * SECOND) == -1);
+}
+
+static void rate_compares_the_change_over_the_window(void) {
+    struct alert_rule rule;
+    struct snapshot snap = {0};
+    char error[128];
+    double value = 0;
+    int fired = -1;
+
+    alert_rule_parse("cpu_temp rate > 5/10", &rule, error, sizeof(error));
+    snap.valid = SNAP_CPU_TEMP;
+    // half a degree a second is 5 per 10 s, at the threshold; then it speeds up
+    for (int t = 0; t <= 30; t++) {
+        snap.cpuTemp = 40 + (t <= 20 ? t * 0.5 : 10 + (t - 20) * 2.0);
+        if (!alert_rule_input(&rule, &snap, (uint64_t) t * SECOND, &value)) {
+            CHECK(t < 10);
+            continue;
+        }
+        CHECK(t >= 9);
+        if (t <= 20) {
+            CHECK_NEAR(value, 5, 1e-9);
+        }
+        if (alert_rule_step(&rule, value, (uint64_t) t * SECOND) == ALERT_FIRING) {
+            fired = t;
+        }
+    }
+    CHECK(fired == 21);
+
+    // a snapshot without the metric is no input
+    snap.valid = 0;
+    CHECK(!alert_rule_input(&rule, &snap, 31 * SECOND, &value));
+}
+
+static void loaded_rules_log_their_events(void) {
+    char rulesPath[] = "/tmp/macResMonRulesXXXXXX", logPath[] = "/tmp/macResMonAlertsXXXXXX";
+    char text[1024];
+    struct snapshot snap = {0};
+    FILE *file;
+    size_t length;
+    int fd;
+
+    CHECK((fd = mkstemp(rulesPath)) >= 0);
+    close(fd);
+    CHECK((fd = mkstemp(logPath)) >= 0);
+    close(fd);
+    file = fopen(rulesPath, "w");
+    fprintf(file, "# test rules\n\ncpu_temp > 80 hysteresis=5 action=log:%s\ngpu_temp > 1 for=100\n", logPath);
+    fclose(file);
+
+    CHECK(alerts_load(rulesPath) == 2);
+    CHECK(alerts_start() == 0);
+    snap.valid = SNAP_CPU_TEMP;
+    for (int t = 0; t < 6; t++) {
+        static const double temps[] = {70, 85, 79, 86, 60, 61};
+        snap.timestamp = (uint64_t) (t + 1) * SECOND;
+        snap.cpuTemp = temps[t];
+        alerts_evaluate(&snap);
+    }
+    alerts_stop();
+
+    file = fopen(logPath, "r");
+    length = fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    text[length] = '\0';
+    CHECK(strstr(text, "alert firing: cpu_temp > 80") != NULL);
+    CHECK(strstr(text, "(value 85.00)") != NULL);
+    CHECK(strstr(text, "alert resolved: cpu_temp > 80") != NULL);
+    CHECK(strstr(text, "(value 60.00)") != NULL);
+    // fired and resolved once each, the dip to 79 was inside the band
+    CHECK(strstr(strstr(text, "firing") + 1, "firing") == NULL);
+    CHECK(strstr(text, "gpu_temp") == NULL);
+
+    // a bad line rejects the whole file
+    file = fopen(rulesPath, "w");
+    fputs("cpu_temp > 80\ncpu_temp >> 80\n", file);
+    fclose(file);
+    CHECK(alerts_load(rulesPath) == -1);
+    unlink(rulesPath);
+    unlink(logPath);
+}
+
+int main(void) {
+    RUN(parses_rules_and_rejects_bad_ones);
+    RUN(hysteresis_keeps_it_from_flapping);
+    RUN(for_waits_before_firing);
+    RUN(rate_compares_the_change_over_the_window);
+    RUN(loaded_rules_log_their_events);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,123 @@
+//
+// CPU usage delta math: per core and total shares, counters that wrap between two reads,
+// cores that did not tick and core counts that differ between reads
+//
+
+#include "test.h"
+#include "cpuUsage.h"
+
+static void set_core(struct cpu_ticks *ticks, int core, uint32_t user, uint32_t system, uint32_t nice,
+                     uint32_t idle) {
+    ticks->user[core] = user;
+    ticks->system[core] = system;
+    ticks->nice[core] = nice;
+    ticks->idle[core] = idle;
+}
+
+static void shares_per_core_and_in_total(void) {
+    struct cpu_ticks before = {.count = 2}, after = {.count = 2};
+    struct snapshot snap = {0};
+
+    set_core(&before, 0, 1000, 500, 0, 8000);
+    set_core(&after, 0, 1060, 520, 20, 8100);      // 60/20/20/100 of 200
+    set_core(&before, 1, 0, 0, 0, 0);
+    set_core(&after, 1, 300, 100, 0, 200);         // 300/100/0/200 of 600
+    cpu_usage_compute(&before, &after, &snap);
+
+    CHECK(snap.valid & SNAP_CPU_USAGE);
+    CHECK(snap.coreCount == 2);
+    CHECK_NEAR(snap.coreUser[0], 30, 1e-4);
+    CHECK_NEAR(snap.coreSystem[0], 10, 1e-4);
+    CHECK_NEAR(snap.coreNice[0], 10, 1e-4);
+    CHECK_NEAR(snap.coreIdle[0], 50, 1e-4);
+    CHECK_NEAR(snap.coreUser[1], 50, 1e-4);
+    CHECK_NEAR(snap.coreIdle[1], 100.0 / 3, 1e-4);
+    // the total weighs each core by its ticks: 360/120/20/300 of 800
+    CHECK_NEAR(snap.cpuUser, 45, 1e-4);
+    CHECK_NEAR(snap.cpuSystem, 15, 1e-4);
+    CHECK_NEAR(snap.cpuNice, 2.5, 1e-4);
+    CHECK_NEAR(snap.cpuIdle, 37.5, 1e-4);
+}
+
+static void wrapped_counters_still_subtract(void) {
+    struct cpu_ticks before = {.count = 1}, after = {.count = 1};
+    struct snapshot snap = {0};
+
+    set_core(&before, 0, UINT32_MAX - 49, 10, 0, UINT32_MAX - 99);
+    set_core(&after, 0, 50, 10, 0, 100);           // 100 user, 200 idle across the wrap
+    cpu_usage_compute(&before, &after, &snap);
+    CHECK_NEAR(snap.coreUser[0], 100.0 / 3, 1e-4);
+    CHECK_NEAR(snap.coreIdle[0], 200.0 / 3, 1e-4);
+    CHECK_NEAR(snap.cpuUser, 100.0 / 3, 1e-4);
+    CHECK_NEAR(snap.cpuSystem, 0, 1e-6);
+}
+
+static void idle_and_missing_cores(void) {
+    struct cpu_ticks before = {.count = 3}, after = {.count = 2};
+    struct snapshot snap = {0};
+
+    // core 0 did not tick (offline), core 2 is gone from the second read
+    set_core(&before, 0, 5, 5, 5, 5);
+    set_core(&after, 0, 5, 5, 5, 5);
+    set_core(&before, 1, 0, 0, 0, 0);
+    set_core(&after, 1, 10, 0, 0, 30);
+    set_core(&before, 2, 0, 0, 0, 0);
+    cpu_usage_compute(&before, &after, &snap);
+    CHECK(snap.coreCount == 2);
+    CHECK_NEAR(snap.coreIdle[0], 100, 0);
+    CHECK_NEAR(snap.coreUser[0], 0, 0);
+    CHECK_NEAR(snap.cpuUser, 25, 1e-4);
+
+    // nothing ticked anywhere
+    after = before;
+    cpu_usage_compute(&before, &after, &snap);
+    CHECK(snap.coreCount == 3);
+    CHECK_NEAR(snap.cpuIdle, 100, 0);
+    CHECK_NEAR(snap.cpuUser, 0, 0);
+}
+
+static void every_core_of_a_large_machine(void) {
+    static struct cpu_ticks before, after;
+    struct snapshot snap = {0};
+
+    before.count = after.count = SNAPSHOT_MAX_CORES;
+    for (int i = 0; i < SNAPSHOT_MAX_CORES; i++) {
+        set_core(&before, i, 1000u * (uint32_t) i, 0, 0, 4000000000u);
+        set_core(&after, i, 1000u * (uint32_t) i + (uint32_t) i, 0, 0, 4000000000u + 400u - (uint32_t) i);
+    }
+    cpu_usage_compute(&before, &after, &snap);
+    CHECK(snap.coreCount == SNAPSHOT_MAX_CORES);
+    for (int i = 0; i < SNAPSHOT_MAX_CORES; i++) {
+        CHECK_NEAR(snap.coreUser[i] + snap.coreIdle[i], 100, 1e-3);
+        CHECK_NEAR(snap.coreUser[i], i / 4.0, 1e-3);
+    }
+}
+
+static void samples_of_this_machine(void) {
+    struct snapshot snap = {0};
+    struct timespec wait = {0, 50000000};
+
+    if (cpu_usage_open() != 0) {
+        printf("     no tick counters here, skipped\n");
+        return;
+    }
+    // the first sample only keeps the counters
+    cpu_usage_sample(&snap);
+    CHECK(!(snap.valid & SNAP_CPU_USAGE));
+    nanosleep(&wait, NULL);
+    cpu_usage_sample(&snap);
+    CHECK(snap.valid & SNAP_CPU_USAGE);
+    CHECK(snap.coreCount > 0);
+    CHECK(snap.cpuIdle >= -1e-3 && snap.cpuIdle <= 100 + 1e-3);
+    CHECK(snap.valid & SNAP_LOAD);
+    cpu_usage_close();
+}
+
+int main(void) {
+    RUN(shares_per_core_and_in_total);
+    RUN(wrapped_counters_still_subtract);
+    RUN(idle_and_missing_cores);
+    RUN(every_core_of_a_large_machine);
+    RUN(samples_of_this_machine);
+    return TEST_EXIT_CODE;
+}
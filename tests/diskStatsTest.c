@@ -0,0 +1,209 @@
+//
+// Disk subsystem: device rates between two reads, and on Linux the volumes and counters
+// read from a fake mount table and /proc/diskstats, and a mount noticed through POLLPRI
+//
+
+// unshare
+#define _GNU_SOURCE
+
+#include "test.h"
+#include "diskStats.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/mount.h>
+#endif
+
+static void rates_between_two_reads(void) {
+    struct disk_counters before[] = {
+            {"sda", 1000000, 500000, 100, 40},
+            {"sdb", 4096000, 8192, 900, 3},
+            {"sdc", 0, 0, 0, 0},
+    };
+    struct disk_counters after[] = {
+            {"sdb", 512, 8192, 2, 3},                       // went backwards, e.g. the device was replaced
+            {"sda", 3000000, 1500000, 300, 90},
+            {"sdd", 1 << 20, 0, 10, 0},                     // not there last time, nothing to compare with
+    };
+    struct snapshot snap = {0};
+
+    disk_rates(before, 3, after, 3, 2.0, &snap);
+    CHECK(snap.valid & SNAP_DISK_IO);
+    CHECK(snap.deviceCount == 2);
+    CHECK(strcmp(snap.devices[0].name, "sdb") == 0);
+    CHECK_NEAR(snap.devices[0].readBytes, 0, 0);
+    CHECK_NEAR(snap.devices[0].reads, 0, 0);
+    CHECK_NEAR(snap.devices[0].writeBytes, 0, 0);
+    CHECK(strcmp(snap.devices[1].name, "sda") == 0);
+    CHECK_NEAR(snap.devices[1].readBytes, 1000000, 1e-6);
+    CHECK_NEAR(snap.devices[1].writeBytes, 500000, 1e-6);
+    CHECK_NEAR(snap.devices[1].reads, 100, 1e-9);
+    CHECK_NEAR(snap.devices[1].writes, 25, 1e-9);
+
+    // no time passed, nothing to divide by
+    memset(&snap, 0, sizeof(snap));
+    disk_rates(before, 3, after, 3, 0.0, &snap);
+    CHECK(!(snap.valid & SNAP_DISK_IO));
+    disk_rates(before, 3, after, 3, -1.0, &snap);
+    CHECK(!(snap.valid & SNAP_DISK_IO));
+}
+
+#ifdef __linux__
+
+static char mountsPath[] = "/tmp/macResMonMountsXXXXXX";
+static char diskstatsPath[] = "/tmp/macResMonDiskstatsXXXXXX";
+
+// rewritten in place, the platform part keeps the file open and reads it again every sample
+static void write_file(const char *path, const char *text) {
+    FILE *file = fopen(path, "w");
+
+    fputs(text, file);
+    fclose(file);
+}
+
+static const struct device_sample *find_device(const struct snapshot *snap, const char *name) {
+    for (int i = 0; i < snap->deviceCount; i++) {
+        if (strcmp(snap->devices[i].name, name) == 0) {
+            return &snap->devices[i];
+        }
+    }
+    return NULL;
+}
+
+static void counters_of_mounted_devices(void) {
+    struct timespec wait = {0, 20000000};
+    struct snapshot snap = {0};
+    const struct device_sample *device;
+
+    // loop images, pseudo file systems and a second mount of the same directory are left out
+    write_file(mountsPath, "/dev/macresmon-b /tmp ext4 rw 0 0\n"
+                           "tmpfs /run tmpfs rw 0 0\n"
+                           "/dev/loop3 /snap/core squashfs ro 0 0\n"
+                           "/dev/macresmon-a / ext4 rw 0 0\n"
+                           "/dev/macresmon-b /tmp ext4 rw 0 0\n");
+    write_file(diskstatsPath, "   8       0 macresmon-a 100 0 2000 0 50 0 800 0 0 0 0\n"
+                              "   8      16 macresmon-b 7 0 56 0 0 0 0 0 0 0 0\n"
+                              "   8      32 macresmon-c 1 0 8 0 1 0 8 0 0 0 0\n");
+    disk_platform_set_paths(mountsPath, diskstatsPath);
+    CHECK(disk_stats_open() == 0);
+
+    disk_stats_sample(&snap);
+    CHECK(snap.valid & SNAP_DISK);
+    CHECK(!(snap.valid & SNAP_DISK_IO));
+    CHECK(snap.volumeCount == 2);
+    CHECK(strcmp(snap.volumes[0].mount, "/") == 0);
+    CHECK(strcmp(snap.volumes[1].mount, "/tmp") == 0);
+
+    // 2000 more sectors over 100 more reads, 4000 over 25 writes; the unmounted device stays out
+    write_file(diskstatsPath, "   8       0 macresmon-a 200 0 4000 0 75 0 4800 0 0 0 0\n"
+                              "   8      16 macresmon-b 7 0 56 0 0 0 0 0 0 0 0\n"
+                              "   8      32 macresmon-c 9 0 800 0 9 0 800 0 0 0 0\n");
+    nanosleep(&wait, NULL);
+    memset(&snap, 0, sizeof(snap));
+    disk_stats_sample(&snap);
+    CHECK(snap.valid & SNAP_DISK_IO);
+    CHECK(snap.deviceCount == 2);
+    CHECK(find_device(&snap, "macresmon-c") == NULL);
+    device = find_device(&snap, "macresmon-a");
+    CHECK(device != NULL);
+    if (device != NULL) {
+        CHECK(device->reads > 0 && device->writes > 0);
+        CHECK_NEAR(device->readBytes / device->reads, 2000 * 512 / 100, 1e-6);
+        CHECK_NEAR(device->writeBytes / device->writes, 4000 * 512 / 25, 1e-6);
+        CHECK_NEAR(device->reads / device->writes, 100 / 25, 1e-9);
+    }
+    device = find_device(&snap, "macresmon-b");
+    CHECK(device != NULL && device->reads == 0 && device->readBytes == 0);
+
+    // the counters going backwards reads as no I/O rather than a huge rate
+    write_file(diskstatsPath, "   8       0 macresmon-a 3 0 24 0 1 0 8 0 0 0 0\n");
+    nanosleep(&wait, NULL);
+    memset(&snap, 0, sizeof(snap));
+    disk_stats_sample(&snap);
+    device = find_device(&snap, "macresmon-a");
+    CHECK(snap.deviceCount == 1 && device != NULL);
+    if (device != NULL) {
+        CHECK(device->readBytes == 0 && device->reads == 0 && device->writeBytes == 0 && device->writes == 0);
+    }
+    disk_stats_close();
+    disk_platform_set_paths(NULL, NULL);
+}
+
+static int has_volume(const struct snapshot *snap, const char *mount) {
+    for (int i = 0; i < snap->volumeCount; i++) {
+        if (strcmp(snap->volumes[i].mount, mount) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// in a private mount namespace, prints the volume counts before, while and after a
+// directory is mounted, or why it could not try
+static void mount_in_namespace(void *arg) {
+    char directory[] = "/tmp/macResMonMountXXXXXX";
+    struct snapshot before = {0}, mounted = {0}, after = {0};
+
+    if (unshare(CLONE_NEWNS) != 0 && unshare(CLONE_NEWUSER | CLONE_NEWNS) != 0) {
+        printf("no mount namespace");
+        return;
+    }
+    if (mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL) != 0 || mkdtemp(directory) == NULL) {
+        printf("no private mounts");
+        return;
+    }
+    // the real mount table, the fake counters only keep the I/O side predictable
+    disk_platform_set_paths(NULL, diskstatsPath);
+    disk_stats_open();
+    disk_stats_sample(&before);
+    // tmpfs takes any source, a /dev/ one makes it look like a disk to the volume list
+    if (mount("/dev/macresmon-d", directory, "tmpfs", 0, "size=64k") != 0) {
+        printf("no tmpfs mount");
+        rmdir(directory);
+        return;
+    }
+    disk_stats_sample(&mounted);
+    umount(directory);
+    disk_stats_sample(&after);
+    disk_stats_close();
+    rmdir(directory);
+    printf("volumes %d %d %d listed %d %d", before.volumeCount, mounted.volumeCount, after.volumeCount,
+           has_volume(&mounted, directory), has_volume(&after, directory));
+}
+
+static void mount_changes_refresh_the_volumes(void) {
+    char out[256];
+    int before, mounted, after, listedMounted, listedAfter;
+
+    write_file(diskstatsPath, "");
+    CHECK(run_child(mount_in_namespace, NULL, 3000, SIGKILL, out, sizeof(out)) == 0);
+    if (strncmp(out, "volumes ", 8) != 0) {
+        printf("     %s here, skipped\n", out);
+        return;
+    }
+    CHECK(sscanf(out, "volumes %d %d %d listed %d %d", &before, &mounted, &after, &listedMounted,
+                 &listedAfter) == 5);
+    CHECK(mounted == before + 1 && listedMounted);
+    CHECK(after == before && !listedAfter);
+}
+
+#endif
+
+int main(void) {
+    RUN(rates_between_two_reads);
+#ifdef __linux__
+    int mountsFd = mkstemp(mountsPath), diskstatsFd = mkstemp(diskstatsPath);
+
+    if (mountsFd < 0 || diskstatsFd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(mountsFd);
+    close(diskstatsFd);
+    RUN(counters_of_mounted_devices);
+    RUN(mount_changes_refresh_the_volumes);
+    unlink(mountsPath);
+    unlink(diskstatsPath);
+#endif
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,111 @@
+//
+// The engine apart from any terminal: sampling a backend into snapshots, the text
+// renderer and a headless run of show() on the synthetic backend
+//
+
+#include "test.h"
+#include "infoCollector.h"
+
+static void collect_sets_only_the_asked_bits(void) {
+    static const struct {
+        int flag;
+        uint32_t allowed;
+    } sections[] = {
+            {_CPU_TEMP, SNAP_CPU_TEMP},
+            {_FAN_STATUS, SNAP_FANS},
+            {_GPU_STATUS, SNAP_GPU_TEMP},
+            {_MEM_STATUS, SNAP_MEM | SNAP_MEM_TEMP | SNAP_MEM_DETAIL | SNAP_MEM_RATES},
+            {_DISK_STATUS, SNAP_DISK | SNAP_DISK_IO},
+            {_BATTERY_STATUS, SNAP_BATTERY | SNAP_BATTERY_TEMP},
+            {_CPU_USAGE, SNAP_CPU_USAGE | SNAP_LOAD},
+            {_PROCESSES, SNAP_PROCESSES},
+    };
+    struct snapshot snap;
+
+    CHECK(synthetic_backend.open(_VERBOSE) == 0);
+    for (size_t i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+        collect(&synthetic_backend, sections[i].flag, &snap);
+        CHECK(snap.timestamp > 0);
+        CHECK(snap.valid != 0);
+        CHECK((snap.valid & ~sections[i].allowed) == 0);
+    }
+    collect(&synthetic_backend, _CPU_TEMP | _FAN_STATUS, &snap);
+    CHECK(snap.valid == (SNAP_CPU_TEMP | SNAP_FANS));
+    CHECK(snap.fanCount > 0 && snap.cpuTemp > 0);
+    synthetic_backend.close();
+}
+
+static void render_text(void *arg) {
+    text_renderer.render(arg, NULL, _VERBOSE);
+}
+
+static void text_shows_fans_only_when_there_are_some(void) {
+    struct snapshot snap;
+    char out[4096];
+
+    memset(&snap, 0, sizeof(snap));
+    snap.valid = SNAP_FANS | SNAP_CPU_TEMP;
+    snap.cpuTemp = 50;
+    capture_stdout(render_text, &snap, out, sizeof(out));
+    CHECK(strstr(out, "cpu temp: 50.00 C") != NULL);
+    CHECK(strstr(out, "fan") == NULL);
+
+    snap.fanCount = 2;
+    snap.fanMax = 6000;
+    snap.fanSpeed[1] = 2400;
+    capture_stdout(render_text, &snap, out, sizeof(out));
+    CHECK(strstr(out, "fan max: 6000 rpm") != NULL);
+    CHECK(strstr(out, "fan 1: 2400 rpm") != NULL);
+}
+
+static void lookups_and_periods(void) {
+    struct engine_options options;
+
+    CHECK(backend_find("synthetic") == &synthetic_backend);
+    CHECK(backend_find("nope") == NULL);
+    CHECK(renderer_find("text") == &text_renderer);
+    CHECK(renderer_find("json") == &json_renderer);
+    CHECK(renderer_find("nope") == NULL);
+
+    engine_default_options(&options);
+    CHECK(engine_set_period(&options, "disk=60000") == 0);
+    CHECK(options.periodMs[4] == 60000);
+    CHECK(engine_set_period(&options, "disk=0") != 0);
+    CHECK(engine_set_period(&options, "disk=5s") != 0);
+    CHECK(engine_set_period(&options, "nope=5") != 0);
+    CHECK(engine_set_period(&options, "disk") != 0);
+}
+
+static void run_show(void *arg) {
+    struct engine_options options;
+
+    engine_default_options(&options);
+    options.flag = _CPU_TEMP | _FAN_STATUS;
+    options.updateInterval = 0.05;
+    options.backend = &synthetic_backend;
+    options.renderer = &text_renderer;
+    show(&options);
+}
+
+static void show_runs_headless_until_sigint(void) {
+    static char out[65536];
+    const char *at = out;
+    int frames = 0;
+
+    CHECK(run_child(run_show, NULL, 600, SIGINT, out, sizeof(out)) == 0);
+    while ((at = strstr(at, "cpu temp: ")) != NULL) {
+        frames++;
+        at++;
+    }
+    CHECK(frames >= 3);
+    CHECK(strstr(out, "fan 0: ") != NULL);
+    CHECK(strstr(out, "gpu temp") == NULL);
+}
+
+int main(void) {
+    RUN(collect_sets_only_the_asked_bits);
+    RUN(text_shows_fans_only_when_there_are_some);
+    RUN(lookups_and_periods);
+    RUN(show_runs_headless_until_sigint);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,143 @@
+//
+// Event loop: each watched signal becomes its event, a signal or a key typed on the
+// terminal ends the sleep of event_clock early, and closing gives the handlers back
+//
+
+#define _XOPEN_SOURCE 700
+
+#include <fcntl.h>
+#include <pthread.h>
+
+#include "test.h"
+#include "eventLoop.h"
+
+#define SLEEP_NS NSEC_PER_SEC
+
+// how long event_clock slept towards a deadline SLEEP_NS away
+static uint64_t slept(void) {
+    uint64_t start = event_clock.now(NULL);
+
+    event_clock.sleep_until(NULL, start + SLEEP_NS);
+    return event_clock.now(NULL) - start;
+}
+
+static void *send_later(void *arg) {
+    struct timespec pause = {0, 50000000L};
+
+    nanosleep(&pause, NULL);
+    kill(getpid(), *(int *) arg);
+    return NULL;
+}
+
+static void signals_become_events(void) {
+    static const struct {
+        int signal;
+        enum event_type type;
+    } cases[] = {{SIGINT, EVENT_QUIT}, {SIGTERM, EVENT_QUIT}, {SIGWINCH, EVENT_RESIZE}, {SIGUSR1, EVENT_DUMP}};
+    struct event event;
+
+    CHECK(event_loop_open(0) == 0);
+    CHECK(event_loop_next(&event) == 0);
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        raise(cases[i].signal);
+        CHECK(event_loop_next(&event) == 1);
+        CHECK(event.type == cases[i].type);
+        CHECK(event_loop_next(&event) == 0);
+    }
+    // two pending at once come out in order
+    raise(SIGWINCH);
+    raise(SIGUSR1);
+    CHECK(event_loop_next(&event) == 1 && event.type == EVENT_RESIZE);
+    CHECK(event_loop_next(&event) == 1 && event.type == EVENT_DUMP);
+    event_loop_close();
+}
+
+static void signal_ends_the_sleep(void) {
+    int signal = SIGWINCH;
+    pthread_t thread;
+    struct event event;
+    uint64_t elapsed;
+
+    CHECK(event_loop_open(0) == 0);
+    pthread_create(&thread, NULL, send_later, &signal);
+    elapsed = slept();
+    pthread_join(thread, NULL);
+    CHECK(elapsed < SLEEP_NS / 4);
+    CHECK(event_loop_next(&event) == 1 && event.type == EVENT_RESIZE);
+    event_loop_close();
+}
+
+static void hotkeys_come_from_the_terminal(void) {
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    int saved = dup(STDIN_FILENO);
+    int slave;
+    struct event event;
+    uint64_t elapsed;
+
+    CHECK(master >= 0);
+    if (master < 0) {
+        return;
+    }
+    grantpt(master);
+    unlockpt(master);
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    CHECK(slave >= 0);
+    dup2(slave, STDIN_FILENO);
+
+    // keys are only read when asked for
+    CHECK(event_loop_open(0) == 0);
+    CHECK(write(master, "x\n", 2) == 2);
+    CHECK(slept() >= SLEEP_NS / 2 - 1);
+    CHECK(event_loop_next(&event) == 0);
+    event_loop_close();
+
+    // the line typed above is still there, so the sleep ends at once
+    CHECK(event_loop_open(1) == 0);
+    elapsed = slept();
+    CHECK(elapsed < SLEEP_NS / 4);
+    CHECK(event_loop_next(&event) == 1 && event.type == EVENT_KEY && event.key == 'x');
+    CHECK(event_loop_next(&event) == 1 && event.type == EVENT_KEY && event.key == '\n');
+    CHECK(event_loop_next(&event) == 0);
+    event_loop_close();
+
+    dup2(saved, STDIN_FILENO);
+    close(saved);
+    close(slave);
+    close(master);
+}
+
+static int seen;
+
+static void count_signal(int signal) {
+    (void) signal;
+    seen++;
+}
+
+static void close_gives_the_handlers_back(void) {
+    struct sigaction action, current;
+    struct event event;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = count_signal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, NULL);
+
+    CHECK(event_loop_open(0) == 0);
+    raise(SIGUSR1);
+    CHECK(seen == 0);
+    event_loop_close();
+    sigaction(SIGUSR1, NULL, &current);
+    CHECK(current.sa_handler == count_signal);
+    raise(SIGUSR1);
+    CHECK(seen == 1);
+    // closed, there is nothing to read and the clock sleeps on its own
+    CHECK(event_loop_next(&event) == 0);
+}
+
+int main(void) {
+    RUN(signals_become_events);
+    RUN(signal_ends_the_sleep);
+    RUN(hotkeys_come_from_the_terminal);
+    RUN(close_gives_the_handlers_back);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,217 @@
+//
+// Fan controller: the spec parser, the curve and PID outputs, a PID loop holding a simple
+// thermal model at its setpoint, and the control thread driving the fans of the simulated
+// machine through the fake SMC, failsafe and fallback to the firmware included
+//
+
+#include "test.h"
+#include "fanControl.h"
+#include "systemManagementController.h"
+#include "smcSensors.h"
+#include "fakeSMC.h"
+#include "thermalModel.h"
+
+static void parses_specs(void) {
+    static const char *bad[] = {
+            "auto", "curve:", "curve:70=40,50=0", "curve:50=101", "curve:50", "pid:", "pid:-5",
+            "pid:75,rate=0", "pid:75,loud=1", "curve:50=0,kp=1",
+    };
+    struct fan_control_config config;
+
+    CHECK(fan_control_parse("curve:50=0,70=40,85=100", &config) == 0);
+    CHECK(config.mode == FAN_CONTROL_CURVE && config.pointCount == 3);
+    CHECK(config.curveTemp[1] == 70 && config.curveLevel[1] == 0.4);
+    CHECK(config.rate == 4 && config.failsafeTemp == 95);
+
+    CHECK(fan_control_parse("pid:75,kp=0.2,ki=0,rate=10,failsafe=90", &config) == 0);
+    CHECK(config.mode == FAN_CONTROL_PID && config.setpoint == 75);
+    CHECK(config.kp == 0.2 && config.ki == 0 && config.rate == 10 && config.failsafeTemp == 90);
+
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        CHECK(fan_control_parse(bad[i], &config) == -1);
+    }
+}
+
+static void curve_interpolates_and_failsafe_wins(void) {
+    struct fan_control_config config;
+    struct fan_pid pid = {0};
+
+    fan_control_parse("curve:50=10,70=40,85=100,failsafe=90", &config);
+    CHECK_NEAR(fan_control_level(&config, &pid, 20, 0.25), 0.1, 1e-9);
+    CHECK_NEAR(fan_control_level(&config, &pid, 60, 0.25), 0.25, 1e-9);
+    CHECK_NEAR(fan_control_level(&config, &pid, 80, 0.25), 0.8, 1e-9);
+    CHECK_NEAR(fan_control_level(&config, &pid, 89, 0.25), 1.0, 1e-9);
+
+    fan_control_parse("curve:50=0,70=20", &config);
+    CHECK_NEAR(fan_control_level(&config, &pid, 94.9, 0.25), 0.2, 1e-9);
+    CHECK_NEAR(fan_control_level(&config, &pid, 95, 0.25), 1.0, 1e-9);
+}
+
+static void pid_reacts_and_does_not_wind_up(void) {
+    struct fan_control_config config;
+    struct fan_pid pid = {0};
+    double level;
+
+    fan_control_parse("pid:70,kp=0.1,ki=0.05,kd=0", &config);
+    // proportional at once, plus the integral of this step
+    CHECK_NEAR(fan_control_level(&config, &pid, 75, 1), 0.5 + 0.25, 1e-9);
+    CHECK_NEAR(pid.integral, 0.25, 1e-9);
+    CHECK_NEAR(fan_control_level(&config, &pid, 60, 1), 0, 1e-9);
+
+    // pinned at full for a long time, the integral does not grow past what it holds
+    memset(&pid, 0, sizeof(pid));
+    for (int i = 0; i < 600; i++) {
+        level = fan_control_level(&config, &pid, 85, 1);
+    }
+    CHECK_NEAR(level, 1, 1e-9);
+    CHECK(pid.integral < 1);
+    // so the fans come down as soon as the temperature drops below the setpoint
+    CHECK(fan_control_level(&config, &pid, 62, 1) < 0.5);
+
+    // the derivative works on the measurement, nothing on the first call
+    fan_control_parse("pid:70,kp=0,ki=0,kd=0.5", &config);
+    memset(&pid, 0, sizeof(pid));
+    CHECK_NEAR(fan_control_level(&config, &pid, 80, 1), 0, 1e-9);
+    CHECK_NEAR(fan_control_level(&config, &pid, 81, 0.5), 1.0, 1e-9);
+    CHECK_NEAR(fan_control_level(&config, &pid, 81, 0.5), 0, 1e-9);
+}
+
+// one die heated by a constant load and cooled through fans, the PID holds its setpoint
+static void pid_holds_a_thermal_model(void) {
+    struct fan_control_config config;
+    struct fan_pid pid = {0};
+    double temp = 45, level = 0, peak = 0;
+
+    fan_control_parse("pid:72", &config);
+    for (int tick = 0; tick < 4 * 1200; tick++) {
+        double dt = 0.25;
+        // 100 W into 40 J/K, 0.8 W/K to the 25 °C air with the fans stopped, 3.2 W/K more at full speed
+        temp += dt * (100 - (0.8 + 3.2 * level) * (temp - 25)) / 40;
+        level = fan_control_level(&config, &pid, temp, dt);
+        if (tick > 4 * 600 && temp > peak) {
+            peak = temp;
+        }
+    }
+    // settled: within a degree of the setpoint, fans neither stopped nor pinned
+    CHECK_NEAR(temp, 72, 1);
+    CHECK(peak < 73.5);
+    CHECK(level > 0.1 && level < 0.9);
+}
+
+static double read_key(SMCKey_t key) {
+    SMCSample_t sample;
+
+    return SMC_read_many(&key, 1, &sample) == 1 && sample.valid ? sample.value : -1;
+}
+
+static double target(int fan) {
+    return read_key(SMC_FAN_KEY(SMC_KEY_FAN_0_TARGET_RPM, fan));
+}
+
+// wait up to two seconds for the controller to write expected as every fan's target
+static int targets_reach(double expected) {
+    for (int tries = 0; tries < 200; tries++) {
+        struct timespec tick = {0, 10000000L};
+        int reached = 1;
+
+        for (int fan = 0; fan < THERMAL_MODEL_FANS; fan++) {
+            reached &= fabs(target(fan) - expected) < 1;
+        }
+        if (reached) {
+            return 1;
+        }
+        nanosleep(&tick, NULL);
+    }
+    return 0;
+}
+
+static int force_bits_reach(double expected) {
+    for (int tries = 0; tries < 200; tries++) {
+        struct timespec tick = {0, 10000000L};
+
+        if (read_key(SMC_key(FORCE_BITS)) == expected) {
+            return 1;
+        }
+        nanosleep(&tick, NULL);
+    }
+    return 0;
+}
+
+static void drives_the_simulated_fans(void) {
+    struct fan_control_config config;
+    double min, max;
+
+    // stepped by hand, so the temperatures stay what the test sets
+    thermal_model_open(0);
+    SMC_set_transport(&fakeSMC_transport);
+    CHECK(SMC_open() == kIOReturnSuccess);
+    min = read_key(SMC_KEY_FAN_0_MIN_RPM);
+    max = read_key(SMC_KEY_FAN_0_MAX_RPM);
+    CHECK(min >= 0 && max > min);
+    fakeSMC_set_sp78("TC0P", 60);
+    fakeSMC_set_sp78("TG0P", 40);
+
+    fan_control_parse("curve:50=0,70=40,85=100,failsafe=90,rate=50", &config);
+    CHECK(fan_control_start(&config) == 0);
+    // the hotter die decides: 60 °C is 20% of the range, and both fans are forced
+    CHECK(targets_reach(min + 0.2 * (max - min)));
+    CHECK(force_bits_reach(3));
+
+    fakeSMC_set_sp78("TG0P", 80);
+    CHECK(targets_reach(min + 0.8 * (max - min)));
+    fakeSMC_set_sp78("TC0P", 91);
+    CHECK(targets_reach(max));
+
+    // blind: back to the firmware until a temperature reads again
+    fakeSMC_fail_key("TC0P", 1);
+    fakeSMC_fail_key("TG0P", 1);
+    CHECK(force_bits_reach(0));
+    fakeSMC_fail_key("TC0P", 0);
+    fakeSMC_fail_key("TG0P", 0);
+    CHECK(force_bits_reach(3));
+
+    fan_control_stop();
+    CHECK(read_key(SMC_key(FORCE_BITS)) == 0);
+    SMC_close();
+    thermal_model_close();
+}
+
+// registered before the controller, so it runs after the controller's exit handler
+static void report_force_bits(void) {
+    printf("force bits %.0f\n", read_key(SMC_key(FORCE_BITS)));
+    fflush(stdout);
+}
+
+static void exit_while_running(void *arg) {
+    struct fan_control_config config;
+
+    (void) arg;
+    thermal_model_open(0);
+    SMC_set_transport(&fakeSMC_transport);
+    SMC_open();
+    fakeSMC_set_sp78("TC0P", 60);
+    atexit(report_force_bits);
+    fan_control_parse("curve:50=0,70=40,rate=100", &config);
+    if (fan_control_start(&config) != 0 || !force_bits_reach(3)) {
+        _exit(2);
+    }
+    exit(0);
+}
+
+static void exit_hands_the_fans_back(void) {
+    char out[256];
+
+    CHECK(run_child(exit_while_running, NULL, 3000, SIGKILL, out, sizeof(out)) == 0);
+    CHECK(strcmp(out, "force bits 0\n") == 0);
+}
+
+int main(void) {
+    RUN(parses_specs);
+    RUN(curve_interpolates_and_failsafe_wins);
+    RUN(pid_reacts_and_does_not_wind_up);
+    RUN(pid_holds_a_thermal_model);
+    // first, so the exit handler of the controller is registered in the child only
+    RUN(exit_hands_the_fans_back);
+    RUN(drives_the_simulated_fans);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,203 @@
+//
+// Fleet aggregator on a UNIX socket: the hello, samples summarized into the table row,
+// and an agent reconnecting before its old connection is noticed dead
+//
+
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "test.h"
+#include "fleet.h"
+#include "recording.h"
+
+static char directory[] = "/tmp/fleetTestXXXXXX";
+// the socket path, sized like sun_path so it always fits one
+static char address[sizeof(((struct sockaddr_un *) 0)->sun_path)];
+static struct fleet_host table[FLEET_MAX_HOSTS];
+
+// the row of name once condition holds for it, NULL when it did not within two seconds
+static const struct fleet_host *wait_for(const char *name, int (*condition)(const struct fleet_host *, long),
+                                         long arg) {
+    for (int tries = 0; tries < 200; tries++) {
+        struct timespec tick = {0, 10000000L};
+        int count = fleet_aggregator_hosts(table, FLEET_MAX_HOSTS);
+
+        for (int i = 0; i < count; i++) {
+            if (strcmp(table[i].name, name) == 0 && condition(&table[i], arg)) {
+                return &table[i];
+            }
+        }
+        nanosleep(&tick, NULL);
+    }
+    return NULL;
+}
+
+static int is_connected(const struct fleet_host *host, long connected) {
+    return host->connected == connected;
+}
+
+static int has_samples(const struct fleet_host *host, long samples) {
+    return host->samples >= (uint64_t) samples;
+}
+
+static int host_count(void) {
+    return fleet_aggregator_hosts(table, FLEET_MAX_HOSTS);
+}
+
+// a raw connection that says hello under name
+static int connect_as(const char *name) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    uint8_t hello[FLEET_HELLO_SIZE + FLEET_NAME_LENGTH];
+    size_t length = strlen(name);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", address);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        return -1;
+    }
+    memcpy(hello, FLEET_MAGIC, 4);
+    hello[4] = FLEET_VERSION >> 8;
+    hello[5] = FLEET_VERSION & 0xff;
+    hello[6] = REC_COLUMN_COUNT >> 8;
+    hello[7] = REC_COLUMN_COUNT & 0xff;
+    hello[8] = (uint8_t) length;
+    memcpy(hello + FLEET_HELLO_SIZE, name, length);
+    CHECK(write(fd, hello, FLEET_HELLO_SIZE + length) == (ssize_t) (FLEET_HELLO_SIZE + length));
+    return fd;
+}
+
+static void send_sample(int fd, struct recording_stream *stream, const struct snapshot *snap) {
+    uint8_t frame[2 + RECORDING_SAMPLE_MAX];
+    size_t length = recording_encode_sample(stream, snap, frame + 2);
+
+    frame[0] = (uint8_t) (length >> 8);
+    frame[1] = (uint8_t) length;
+    CHECK(write(fd, frame, 2 + length) == (ssize_t) (2 + length));
+}
+
+static void hello_adds_a_host(void) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    int fd = connect_as("alpha");
+    const struct fleet_host *host = wait_for("alpha", is_connected, 1);
+    int before;
+    char byte;
+
+    CHECK(host != NULL);
+    if (host != NULL) {
+        CHECK(host->samples == 0 && host->valid == 0);
+    }
+    close(fd);
+    CHECK(wait_for("alpha", is_connected, 0) != NULL);
+
+    // a client that does not speak the protocol is hung up on without a row
+    before = host_count();
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", address);
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    CHECK(connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    CHECK(write(fd, "GET / HTTP/1.0\r\n\r\n", 18) == 18);
+    CHECK(read(fd, &byte, 1) == 0);
+    close(fd);
+    CHECK(host_count() == before);
+}
+
+static void samples_fill_the_row(void) {
+    struct snapshot snap;
+    const struct fleet_host *host;
+
+    memset(&snap, 0, sizeof(snap));
+    snap.valid = SNAP_CPU_TEMP | SNAP_LOAD | SNAP_MEM | SNAP_FANS;
+    snap.cpuTemp = 61.5;
+    snap.loadAverage[0] = 2.25;
+    snap.memUsed = 6;
+    snap.memTotal = 16;
+    snap.fanCount = 3;
+    snap.fanMax = 6000;
+    snap.fanSpeed[0] = 1200;
+    snap.fanSpeed[1] = 2500;
+    snap.fanSpeed[2] = 1800;
+
+    CHECK(fleet_agent_open(address, "beta") == 0);
+    fleet_agent_send(&snap);
+    host = wait_for("beta", has_samples, 1);
+    CHECK(host != NULL);
+    if (host != NULL) {
+        CHECK(host->connected == 1);
+        CHECK(host->valid == snap.valid);
+        CHECK_NEAR(host->cpuTemp, 61.5, 0.01);
+        CHECK_NEAR(host->load, 2.25, 0.01);
+        CHECK_NEAR(host->memUsed, 6, 0.01);
+        // the fastest fan, not the maximum it could spin at
+        CHECK_NEAR(host->fanSpeed, 2500, 1);
+    }
+    // the next one is a delta against the first
+    snap.fanSpeed[2] = 3100;
+    snap.loadAverage[0] = 0.5;
+    fleet_agent_send(&snap);
+    host = wait_for("beta", has_samples, 2);
+    CHECK(host != NULL);
+    if (host != NULL) {
+        CHECK_NEAR(host->fanSpeed, 3100, 1);
+        CHECK_NEAR(host->load, 0.5, 0.01);
+    }
+    fleet_agent_close();
+    CHECK(wait_for("beta", is_connected, 0) != NULL);
+
+    // sorted by load, the loaded host first and hosts without a load by name
+    int count = host_count();
+    fleet_sort_hosts(table, count, FLEET_SORT_LOAD);
+    CHECK(count >= 2 && strcmp(table[0].name, "beta") == 0 && strcmp(table[1].name, "alpha") == 0);
+}
+
+static void reconnect_keeps_the_row(void) {
+    struct recording_stream oldStream, newStream;
+    struct snapshot snap;
+    int before = host_count();
+    int old = connect_as("gamma"), fresh;
+    const struct fleet_host *host;
+
+    memset(&snap, 0, sizeof(snap));
+    memset(&oldStream, 0, sizeof(oldStream));
+    memset(&newStream, 0, sizeof(newStream));
+    snap.valid = SNAP_LOAD;
+    snap.loadAverage[0] = 1;
+    send_sample(old, &oldStream, &snap);
+    CHECK(wait_for("gamma", has_samples, 1) != NULL);
+
+    // the agent comes back on a new connection while the old one still looks open
+    fresh = connect_as("gamma");
+    snap.loadAverage[0] = 2;
+    send_sample(fresh, &newStream, &snap);
+    host = wait_for("gamma", has_samples, 2);
+    CHECK(host != NULL && host->load == 2);
+    CHECK(host_count() == before + 1);
+
+    // whatever the old connection still sends is not the host's any more
+    snap.loadAverage[0] = 9;
+    send_sample(old, &oldStream, &snap);
+    close(old);
+    snap.loadAverage[0] = 3;
+    send_sample(fresh, &newStream, &snap);
+    host = wait_for("gamma", has_samples, 3);
+    CHECK(host != NULL && host->load == 3 && host->samples == 3);
+    // and closing it leaves the row up
+    CHECK(host != NULL && host->connected == 1);
+
+    close(fresh);
+    CHECK(wait_for("gamma", is_connected, 0) != NULL);
+}
+
+int main(void) {
+    CHECK(mkdtemp(directory) != NULL);
+    snprintf(address, sizeof(address), "%s/fleet.sock", directory);
+    if (fleet_aggregator_start(address) != 0) {
+        fprintf(stderr, "could not listen on %s\n", address);
+        return 1;
+    }
+    RUN(hello_adds_a_host);
+    RUN(samples_fill_the_row);
+    RUN(reconnect_keeps_the_row);
+    fleet_aggregator_stop();
+    rmdir(directory);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,56 @@
+//
+// Memory subsystem: paging rates between two reads and samples of the build machine
+//
+
+#include "test.h"
+#include "memoryStats.h"
+
+static void rates_between_two_reads(void) {
+    struct memory_counters before = {.pageIns = 1000, .pageOuts = 50, .compressions = 7, .decompressions = 9};
+    struct memory_counters after = before;
+    struct snapshot snap = {0};
+
+    after.pageIns += 500;
+    after.compressions += 20;
+    after.decompressions = 3;      // went backwards, e.g. the counter was reset
+    memory_rates(&before, &after, 2.0, &snap);
+    CHECK(snap.valid & SNAP_MEM_RATES);
+    CHECK_NEAR(snap.pageInRate, 250, 1e-9);
+    CHECK_NEAR(snap.pageOutRate, 0, 0);
+    CHECK_NEAR(snap.compressionRate, 10, 1e-9);
+    CHECK_NEAR(snap.decompressionRate, 0, 0);
+
+    // no time passed, nothing to divide by
+    memset(&snap, 0, sizeof(snap));
+    memory_rates(&before, &after, 0.0, &snap);
+    CHECK(!(snap.valid & SNAP_MEM_RATES));
+    memory_rates(&before, &after, -1.0, &snap);
+    CHECK(!(snap.valid & SNAP_MEM_RATES));
+}
+
+static void samples_of_this_machine(void) {
+    struct snapshot snap = {0};
+    struct timespec wait = {0, 20000000};
+
+    if (memory_stats_open() != 0) {
+        printf("     no memory statistics here, skipped\n");
+        return;
+    }
+    memory_stats_sample(&snap);
+    CHECK((snap.valid & (SNAP_MEM | SNAP_MEM_DETAIL)) == (SNAP_MEM | SNAP_MEM_DETAIL));
+    CHECK(!(snap.valid & SNAP_MEM_RATES));
+    CHECK(snap.memTotal > 0);
+    CHECK(snap.memUsed > 0 && snap.memUsed <= snap.memTotal);
+    CHECK(snap.memFree >= 0 && snap.memFree <= snap.memTotal);
+    nanosleep(&wait, NULL);
+    memory_stats_sample(&snap);
+    CHECK(snap.valid & SNAP_MEM_RATES);
+    CHECK(snap.pageInRate >= 0 && snap.compressionRate >= 0);
+    memory_stats_close();
+}
+
+int main(void) {
+    RUN(rates_between_two_reads);
+    RUN(samples_of_this_machine);
+    return TEST_EXIT_CODE;
+}
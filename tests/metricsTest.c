@@ -0,0 +1,177 @@
+//
+// Prometheus exposition: the encoder's output and a scrape of the metrics server
+//
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "test.h"
+#include "metricsEncoder.h"
+#include "metricsServer.h"
+#include "textBuffer.h"
+
+static void sample_snapshot(struct snapshot *snap) {
+    memset(snap, 0, sizeof(struct snapshot));
+    snap->timestamp = 1500000000ull;
+    snap->valid = SNAP_CPU_TEMP | SNAP_FANS | SNAP_DISK;
+    snap->cpuTemp = 47.25;
+    snap->fanCount = 2;
+    snap->fanSpeed[0] = 1200;
+    snap->fanSpeed[1] = 1850.5;
+    snap->fanMax = 6000;
+    snap->volumeCount = 1;
+    snprintf(snap->volumes[0].mount, sizeof(snap->volumes[0].mount), "/Volumes/a \"b\"");
+    snap->volumes[0].total = 500;
+    snap->volumes[0].free = 120.5;
+}
+
+static void numbers_are_fixed_point(void) {
+    char buffer[64];
+    struct text out = {buffer, 0, sizeof(buffer), 0};
+
+    text_put_double(&out, 3.14159);
+    text_put_bytes(&out, " ", 1);
+    text_put_double(&out, -2.5);
+    text_put_bytes(&out, " ", 1);
+    text_put_double(&out, 7);
+    text_put_bytes(&out, " ", 1);
+    text_put_double(&out, NAN);
+    text_put_bytes(&out, " ", 1);
+    text_put_double(&out, -INFINITY);
+    CHECK(out.length == strlen("3.142 -2.5 7 NaN -Inf"));
+    CHECK(memcmp(buffer, "3.142 -2.5 7 NaN -Inf", out.length) == 0);
+}
+
+static void encodes_the_valid_sections(void) {
+    static char text[METRICS_TEXT_SIZE];
+    struct snapshot snap;
+    size_t length;
+
+    sample_snapshot(&snap);
+    length = metrics_encode(&snap, text, sizeof(text));
+    CHECK(length > 0 && length < sizeof(text));
+    text[length] = '\0';
+    CHECK(strstr(text, "\nmacresmon_cpu_temp 47.25\n") != NULL);
+    CHECK(strstr(text, "# TYPE macresmon_cpu_temp gauge\n") != NULL);
+    CHECK(strstr(text, "macresmon_sample_timestamp_seconds 1.5\n") != NULL);
+    CHECK(strstr(text, "macresmon_fan_rpm{fan=\"0\"} 1200\n") != NULL);
+    CHECK(strstr(text, "macresmon_fan_rpm{fan=\"1\"} 1850.5\n") != NULL);
+    CHECK(strstr(text, "macresmon_fan_max_rpm 6000\n") != NULL);
+    CHECK(strstr(text, "macresmon_volume_free_gb{mount=\"/Volumes/a \\\"b\\\"\"} 120.5\n") != NULL);
+    // invalid sections are left out entirely
+    CHECK(strstr(text, "gpu_temp") == NULL);
+    CHECK(strstr(text, "battery") == NULL);
+    CHECK(text[length - 1] == '\n');
+}
+
+// a # HELP line is a sentence, not a bare unit such as "GB"
+static void every_series_has_a_description(void) {
+    static char text[METRICS_TEXT_SIZE];
+    struct snapshot snap;
+    size_t length;
+    int helps = 0;
+
+    sample_snapshot(&snap);
+    snap.valid = (1u << SNAP_BIT_COUNT) - 1;
+    snap.batteryPresent = 1;
+    snap.deviceCount = 1;
+    snap.coreCount = 2;
+    length = metrics_encode(&snap, text, sizeof(text));
+    CHECK(length > 0 && length < sizeof(text));
+    text[length] = '\0';
+    for (char *line = strstr(text, "# HELP "); line != NULL; line = strstr(line + 1, "# HELP ")) {
+        char *name = line + 7, *help = strchr(name, ' '), *end = strchr(name, '\n');
+        int sentence = help != NULL && end != NULL && help < end && end - help > 4 && end[-1] == '.' &&
+                       memchr(help + 1, ' ', (size_t) (end - help - 1)) != NULL;
+
+        if (!sentence) {
+            fprintf(stderr, "no description: %.*s\n", end != NULL ? (int) (end - line) : 40, line);
+        }
+        CHECK(sentence);
+        helps++;
+    }
+    CHECK(helps > 30);
+}
+
+static void short_buffers_fail(void) {
+    static char text[METRICS_TEXT_SIZE];
+    struct snapshot snap;
+    size_t length;
+
+    sample_snapshot(&snap);
+    length = metrics_encode(&snap, text, sizeof(text));
+    CHECK(metrics_encode(&snap, text, length) == length);
+    CHECK(metrics_encode(&snap, text, length - 1) == 0);
+    CHECK(metrics_encode(&snap, text, 8) == 0);
+}
+
+static int scrape(int port, const char *request, char *response, size_t size) {
+    struct sockaddr_in address = {.sin_family = AF_INET, .sin_port = htons((uint16_t) port)};
+    size_t length = 0;
+    ssize_t got;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, (struct sockaddr *) &address, sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    write(fd, request, strlen(request));
+    while (length + 1 < size && (got = read(fd, response + length, size - length - 1)) > 0) {
+        length += (size_t) got;
+    }
+    response[length] = '\0';
+    close(fd);
+    return 0;
+}
+
+static void server_answers_scrapes(void) {
+    static char response[METRICS_TEXT_SIZE + 512];
+    struct snapshot_ring history;
+    struct snapshot snap;
+    int port = 0;
+
+    CHECK(snapshot_ring_init(&history, 4) == 0);
+    sample_snapshot(&snap);
+    snapshot_ring_push(&history, &snap);
+    for (int attempt = 0; attempt < 20 && port == 0; attempt++) {
+        int candidate = 20000 + (int) ((getpid() * 7 + attempt * 131) % 30000);
+
+        if (metrics_server_start(candidate, &history) == 0) {
+            port = candidate;
+        }
+    }
+    CHECK(port != 0);
+    if (port == 0) {
+        snapshot_ring_free(&history);
+        return;
+    }
+
+    CHECK(scrape(port, "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n", response, sizeof(response)) == 0);
+    CHECK(strncmp(response, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    CHECK(strstr(response, "\nmacresmon_cpu_temp 47.25\n") != NULL);
+
+    // a newer sample is picked up by the next scrape
+    snap.cpuTemp = 51;
+    snapshot_ring_push(&history, &snap);
+    CHECK(scrape(port, "GET /metrics HTTP/1.1\r\n\r\n", response, sizeof(response)) == 0);
+    CHECK(strstr(response, "\nmacresmon_cpu_temp 51\n") != NULL);
+
+    CHECK(scrape(port, "GET /other HTTP/1.1\r\n\r\n", response, sizeof(response)) == 0);
+    CHECK(strncmp(response, "HTTP/1.1 404", 12) == 0);
+
+    metrics_server_stop();
+    snapshot_ring_free(&history);
+}
+
+int main(void) {
+    RUN(numbers_are_fixed_point);
+    RUN(encodes_the_valid_sections);
+    RUN(every_series_has_a_description);
+    RUN(short_buffers_fail);
+    RUN(server_answers_scrapes);
+    return TEST_EXIT_CODE;
+}
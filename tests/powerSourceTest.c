@@ -0,0 +1,56 @@
+//
+// Battery state through the fake power source: one fetch per read, failures read as no battery
+//
+
+#include "test.h"
+#include "fakePowerSource.h"
+
+static void one_fetch_per_read(void) {
+    struct power_info battery = {.present = 1, .percent = 87, .charging = 1, .minutesToEmpty = -1,
+                                 .health = "Good"};
+    struct power_info info;
+
+    power_source_set(&fake_power_source);
+    fakePower_set(&battery);
+    fakePower_reset_counts();
+    CHECK(power_source_read(&info) == 0);
+    CHECK(fakePower_read_count() == 1);
+    CHECK(info.present == 1 && info.percent == 87 && info.minutesToEmpty == -1);
+    CHECK(strcmp(info.health, "Good") == 0);
+    CHECK(power_info_powered(&info));
+
+    battery.charging = 0;
+    battery.minutesToEmpty = 212;
+    fakePower_set(&battery);
+    CHECK(power_source_read(&info) == 0);
+    CHECK(fakePower_read_count() == 2);
+    CHECK(!power_info_powered(&info) && info.minutesToEmpty == 212);
+
+    battery.charged = 1;
+    fakePower_set(&battery);
+    power_source_read(&info);
+    CHECK(power_info_powered(&info));
+}
+
+static void failures_read_as_absent(void) {
+    struct power_info battery = {.present = 1, .percent = 50};
+    struct power_info info;
+
+    power_source_set(&fake_power_source);
+    fakePower_set(&battery);
+    fakePower_fail(1);
+    memset(&info, 0xff, sizeof(info));
+    CHECK(power_source_read(&info) == -1);
+    CHECK(info.present == 0);
+    fakePower_fail(0);
+
+    fakePower_set(NULL);
+    CHECK(power_source_read(&info) == 0);
+    CHECK(info.present == 0);
+}
+
+int main(void) {
+    RUN(one_fetch_per_read);
+    RUN(failures_read_as_absent);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,127 @@
+//
+// Process tracker: cpu shares between two updates, pid reuse, the top rows against a full
+// sort, and a table that grows past the initial map
+//
+
+#include "test.h"
+#include "processTable.h"
+
+#define SECOND 1000000000ull
+
+static void add_process(struct process_counters *process, int pid, uint64_t startTime, uint64_t cpuTime,
+                        uint64_t rssMB) {
+    memset(process, 0, sizeof(struct process_counters));
+    process->pid = pid;
+    process->startTime = startTime;
+    process->cpuTime = cpuTime;
+    process->rss = rssMB << 20;
+    snprintf(process->name, PROCESS_NAME_LENGTH, "p%d", pid);
+}
+
+static void shares_between_two_updates(void) {
+    struct process_tracker tracker;
+    struct process_counters processes[4];
+    struct snapshot snap = {0};
+
+    process_tracker_init(&tracker);
+    add_process(&processes[0], 10, 1, 5 * SECOND, 100);
+    add_process(&processes[1], 11, 1, 0, 300);
+    add_process(&processes[2], 12, 1, 2 * SECOND, 200);
+    CHECK(process_tracker_update(&tracker, processes, 3, 100 * SECOND, &snap) == 0);
+    CHECK(!(snap.valid & SNAP_PROCESSES));
+
+    // two seconds later: 10 used one, 11 none, 12 was replaced by a new process of the same
+    // pid that has run for one second, and 13 is new without a known age
+    processes[0].cpuTime += SECOND;
+    add_process(&processes[2], 12, 2, SECOND, 200);
+    processes[2].age = SECOND;
+    add_process(&processes[3], 13, 1, SECOND / 2, 50);
+    CHECK(process_tracker_update(&tracker, processes, 4, 102 * SECOND, &snap) == 0);
+    CHECK(snap.valid & SNAP_PROCESSES);
+    CHECK(snap.processCount == 4 && snap.topCount == 4);
+    // the new processes count from their start, or from the last update
+    CHECK(snap.topCpu[0].pid == 12);
+    CHECK_NEAR(snap.topCpu[0].cpu, 100, 1e-4);
+    CHECK(snap.topCpu[1].pid == 10);
+    CHECK_NEAR(snap.topCpu[1].cpu, 50, 1e-4);
+    CHECK(strcmp(snap.topCpu[1].name, "p10") == 0);
+    CHECK(snap.topCpu[2].pid == 13);
+    CHECK_NEAR(snap.topCpu[2].cpu, 25, 1e-4);
+    CHECK(snap.topCpu[3].pid == 11);
+    CHECK_NEAR(snap.topCpu[3].cpu, 0, 0);
+    CHECK(snap.topMemory[0].pid == 11 && snap.topMemory[1].pid == 12 && snap.topMemory[2].pid == 10 &&
+          snap.topMemory[3].pid == 13);
+    CHECK_NEAR(snap.topMemory[0].rss, 300, 1e-9);
+
+    // a counter that went backwards reads as idle rather than as a huge share
+    processes[0].cpuTime -= SECOND;
+    CHECK(process_tracker_update(&tracker, processes, 4, 103 * SECOND, &snap) == 0);
+    for (int i = 0; i < 4; i++) {
+        CHECK_NEAR(snap.topCpu[i].cpu, 0, 0);
+    }
+    process_tracker_free(&tracker);
+}
+
+static int by_share(const void *a, const void *b) {
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x < y) - (x > y);
+}
+
+static void top_rows_of_a_large_table(void) {
+    static struct process_counters processes[5000];
+    static double shares[5000];
+    struct process_tracker tracker;
+    struct snapshot snap = {0};
+    int mismatches = 0;
+
+    process_tracker_init(&tracker);
+    // starts small and grows past the first map, earlier readings must survive the rehash
+    for (int i = 0; i < 600; i++) {
+        add_process(&processes[i], 100 + i, 7, 0, (uint64_t) (i * 37 % 1000));
+    }
+    process_tracker_update(&tracker, processes, 600, SECOND, &snap);
+    for (int i = 600; i < 5000; i++) {
+        add_process(&processes[i], 100 + i, 7, 0, (uint64_t) (i * 37 % 1000));
+    }
+    process_tracker_update(&tracker, processes, 5000, 2 * SECOND, &snap);
+    CHECK(tracker.capacity >= 10000);
+
+    for (int i = 0; i < 5000; i++) {
+        uint64_t used = (uint64_t) ((i * 7919) % 1000) * 1000000ull;
+
+        processes[i].cpuTime += used;
+        shares[i] = (double) used * 100.0 / SECOND;
+    }
+    CHECK(process_tracker_update(&tracker, processes, 5000, 3 * SECOND, &snap) == 0);
+    qsort(shares, 5000, sizeof(double), by_share);
+    CHECK(snap.topCount == SNAPSHOT_MAX_PROCESSES);
+    for (int row = 0; row < SNAPSHOT_MAX_PROCESSES; row++) {
+        mismatches += fabs(snap.topCpu[row].cpu - shares[row]) > 1e-3;
+        mismatches += snap.topMemory[row].rss != 999 - row / 5;
+    }
+    CHECK(mismatches == 0);
+    process_tracker_free(&tracker);
+}
+
+static void samples_of_this_machine(void) {
+    struct snapshot snap = {0};
+    struct timespec wait = {0, 20000000};
+
+    if (process_table_open() != 0) {
+        printf("     no process table here, skipped\n");
+        return;
+    }
+    process_table_sample(&snap);
+    nanosleep(&wait, NULL);
+    process_table_sample(&snap);
+    CHECK(snap.valid & SNAP_PROCESSES);
+    CHECK(snap.processCount > 0 && snap.topCount > 0);
+    process_table_close();
+}
+
+int main(void) {
+    RUN(shares_between_two_updates);
+    RUN(top_rows_of_a_large_table);
+    RUN(samples_of_this_machine);
+    return TEST_EXIT_CODE;
+}
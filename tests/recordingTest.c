@@ -0,0 +1,339 @@
+//
+// Recording format: block and single sample round trips, partial blocks on a time bound,
+// the size of a week at 1 Hz and damaged files
+//
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/stat.h>
+
+#include "test.h"
+#include "recording.h"
+
+static char path[] = "/tmp/macResMonRecordingXXXXXX";
+
+static void sample_at(struct snapshot *snap, int i) {
+    memset(snap, 0, sizeof(struct snapshot));
+    snap->timestamp = 1700000000000000000ull + (uint64_t) i * 100000000ull;
+    snap->valid = SNAP_CPU_TEMP | SNAP_FANS | SNAP_MEM | SNAP_LOAD | SNAP_DISK_IO | SNAP_CPU_USAGE;
+    snap->cpuTemp = 45.0 + (i % 17) * 0.25;
+    snap->fanCount = 2;
+    snap->fanMax = 6200;
+    snap->fanSpeed[0] = 1200 + (i / 10) * 4;
+    snap->fanSpeed[1] = 1300.25;
+    snap->memTotal = 16;
+    snap->memUsed = 9.5 + (i % 3) * 0.001;
+    snap->loadAverage[0] = 1.25;
+    snap->deviceCount = 1;
+    snap->coreCount = 4;
+    // the battery comes and goes, its columns follow the validity bits
+    if (i % 50 < 25) {
+        snap->valid |= SNAP_BATTERY;
+        snap->batteryPresent = 1;
+        snap->batteryPercent = 80 - i / 50;
+        snap->batteryMinutes = -1;
+    }
+}
+
+static int same_recorded(const struct snapshot *read, const struct snapshot *written) {
+    uint32_t recorded = written->valid & ~(SNAP_DISK_IO | SNAP_CPU_USAGE);
+
+    return read->timestamp == written->timestamp && read->valid == recorded &&
+           fabs(read->cpuTemp - written->cpuTemp) <= 1 / 256.0 && read->fanCount == written->fanCount &&
+           read->fanSpeed[0] == written->fanSpeed[0] && read->fanSpeed[1] == written->fanSpeed[1] &&
+           read->fanMax == written->fanMax && fabs(read->memUsed - written->memUsed) <= 0.001 &&
+           read->loadAverage[0] == written->loadAverage[0] && read->batteryPercent == written->batteryPercent &&
+           read->batteryMinutes == written->batteryMinutes && read->deviceCount == 0 && read->coreCount == 0;
+}
+
+static int write_samples(int count) {
+    struct recording_writer writer;
+    struct snapshot snap;
+
+    unlink(path);
+    if (recording_writer_open(&writer, path) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        sample_at(&snap, i);
+        if (recording_append(&writer, &snap) != 0) {
+            return -1;
+        }
+    }
+    return recording_writer_close(&writer);
+}
+
+// samples readable from the file, stops at the first block that does not read
+static int read_samples(int *mismatches) {
+    struct recording_reader reader;
+    struct snapshot read, written;
+    int count = 0;
+
+    *mismatches = 0;
+    if (recording_reader_open(&reader, path) != 0) {
+        return -1;
+    }
+    while (recording_read(&reader, &read) == 0) {
+        sample_at(&written, count++);
+        *mismatches += !same_recorded(&read, &written);
+    }
+    recording_reader_close(&reader);
+    return count;
+}
+
+static void blocks_round_trip(void) {
+    struct recording_reader reader;
+    int mismatches, blocks = 0;
+
+    CHECK(write_samples(1500) == 0);
+    CHECK(read_samples(&mismatches) == 1500);
+    CHECK(mismatches == 0);
+
+    // flushing on the time bound rewrites the open block, so every block but the last is full
+    CHECK(recording_reader_open(&reader, path) == 0);
+    while (recording_next_block(&reader) == 0) {
+        CHECK(reader.block.count == (blocks < 1500 / RECORDING_BLOCK_SAMPLES ? RECORDING_BLOCK_SAMPLES
+                                                                             : 1500 % RECORDING_BLOCK_SAMPLES));
+        blocks++;
+    }
+    recording_reader_close(&reader);
+    CHECK(blocks == 1500 / RECORDING_BLOCK_SAMPLES + 1);
+}
+
+static int block_count(void) {
+    struct recording_reader reader;
+    int blocks = 0;
+
+    if (recording_reader_open(&reader, path) != 0) {
+        return -1;
+    }
+    while (recording_next_block(&reader) == 0) {
+        blocks++;
+    }
+    recording_reader_close(&reader);
+    return blocks;
+}
+
+static void partial_blocks_reach_disk(void) {
+    struct recording_writer writer;
+    struct snapshot snap;
+    int mismatches, spanning = (int) (RECORDING_FLUSH_INTERVAL / 100000000ull) + 1;
+
+    unlink(path);
+    CHECK(recording_writer_open(&writer, path) == 0);
+    for (int i = 0; i < spanning - 1; i++) {
+        sample_at(&snap, i);
+        recording_append(&writer, &snap);
+    }
+    CHECK(read_samples(&mismatches) == 0);
+    // the sample completing the interval writes the block while the writer stays open
+    sample_at(&snap, spanning - 1);
+    recording_append(&writer, &snap);
+    CHECK(read_samples(&mismatches) == spanning);
+    CHECK(mismatches == 0);
+    // the next interval grows the same block on disk instead of adding one
+    for (int i = spanning; i < 2 * spanning; i++) {
+        sample_at(&snap, i);
+        recording_append(&writer, &snap);
+    }
+    CHECK(read_samples(&mismatches) == 2 * spanning);
+    CHECK(block_count() == 1);
+    sample_at(&snap, 2 * spanning);
+    recording_append(&writer, &snap);
+    CHECK(recording_writer_close(&writer) == 0);
+    CHECK(read_samples(&mismatches) == 2 * spanning + 1);
+    CHECK(mismatches == 0);
+    CHECK(block_count() == 1);
+
+    // a new session starts a block of its own after the one left open
+    CHECK(recording_writer_open(&writer, path) == 0);
+    sample_at(&snap, 2 * spanning + 1);
+    recording_append(&writer, &snap);
+    CHECK(recording_writer_close(&writer) == 0);
+    CHECK(read_samples(&mismatches) == 2 * spanning + 2);
+    CHECK(block_count() == 2);
+}
+
+// one step down or up an eighth of the time each, from a fixed seed so every run writes the same file
+static int wander(uint32_t *seed) {
+    uint32_t byte;
+
+    *seed = *seed * 1103515245u + 12345u;
+    byte = *seed >> 16 & 0xff;
+    return byte < 32 ? -1 : byte >= 224;
+}
+
+// 1 Hz for a week from ~30 sensors that wander by one step of their resolution now and then
+static void one_week_fits_a_few_megabytes(void) {
+    struct recording_writer writer;
+    struct snapshot snap;
+    struct stat status;
+    uint32_t seed = 1;
+    double cpu = 50, gpu = 45, memTemp = 40, batteryTemp = 30, used = 9.5, load = 1.5, load5 = 1.5, load15 = 1.5;
+    struct recording_reader reader;
+    int week = 7 * 24 * 3600, read = 0;
+
+    unlink(path);
+    CHECK(recording_writer_open(&writer, path) == 0);
+    for (int i = 0; i < week; i++) {
+        memset(&snap, 0, sizeof(snap));
+        snap.timestamp = 1700000000000000000ull + (uint64_t) i * 1000000000ull;
+        snap.valid = SNAP_DISK | SNAP_CPU_TEMP | SNAP_FANS | SNAP_MEM | SNAP_MEM_TEMP | SNAP_GPU_TEMP |
+                     SNAP_BATTERY | SNAP_BATTERY_TEMP | SNAP_LOAD | SNAP_MEM_DETAIL | SNAP_MEM_RATES;
+        cpu = fmin(95, fmax(35, cpu + wander(&seed) * 0.25));
+        gpu = fmin(90, fmax(30, gpu + wander(&seed) * 0.25));
+        memTemp = fmin(70, fmax(30, memTemp + wander(&seed) * 0.25));
+        batteryTemp = fmin(45, fmax(25, batteryTemp + wander(&seed) * 0.25));
+        used = fmin(15, fmax(4, used + wander(&seed) * 0.004));
+        load = fmax(0, load + wander(&seed) * 0.01);
+        load5 += (load - load5) / 300;
+        load15 += (load - load15) / 900;
+        snap.diskTotal = 500;
+        snap.diskFree = 200 - (i / 60) * 0.001;
+        snap.cpuTemp = cpu;
+        snap.gpuTemp = gpu;
+        snap.memTemp = memTemp;
+        snap.batteryTemp = batteryTemp;
+        snap.fanCount = 2;
+        snap.fanMax = 6000;
+        snap.fanSpeed[0] = snap.fanSpeed[1] = cpu < 60 ? 1200 : 1200 + floor((cpu - 60) / 2) * 200;
+        snap.memTotal = 16;
+        snap.memUsed = used;
+        snap.batteryPresent = 1;
+        snap.batteryPercent = 100 - i / 3600 % 80;
+        snap.batteryPowered = 1;
+        snap.batteryMinutes = -1;
+        snap.loadAverage[0] = round(load * 100) / 100;
+        snap.loadAverage[1] = round(load5 * 100) / 100;
+        snap.loadAverage[2] = round(load15 * 100) / 100;
+        snap.memWired = 2.5;
+        snap.memCompressed = 1;
+        snap.memActive = used - 3.5;
+        snap.memInactive = 1;
+        snap.memFree = snap.memTotal - used - 1;
+        snap.memPurgeable = 0.3;
+        snap.swapUsed = 0.5;
+        snap.pageInRate = wander(&seed) > 0 ? 40 : 0;
+        snap.compressionRate = wander(&seed) < 0 ? 120 : 0;
+        CHECK(recording_append(&writer, &snap) == 0);
+    }
+    CHECK(recording_writer_close(&writer) == 0);
+
+    // one header per full block however often the open one was flushed, a header per
+    // RECORDING_FLUSH_INTERVAL alone would take ~38 MB
+    CHECK(block_count() == (week + RECORDING_BLOCK_SAMPLES - 1) / RECORDING_BLOCK_SAMPLES);
+    CHECK(stat(path, &status) == 0);
+    CHECK(status.st_size < 6 * 1000 * 1000);
+    printf("     one week at 1 Hz: %.2f MB\n", status.st_size / 1e6);
+
+    CHECK(recording_reader_open(&reader, path) == 0);
+    while (recording_read(&reader, &snap) == 0) {
+        read++;
+    }
+    recording_reader_close(&reader);
+    CHECK(read == week);
+}
+
+// the header of the first block follows the file header
+static void patch_first_block(size_t offset, const void *bytes, size_t length) {
+    FILE *file = fopen(path, "r+b");
+
+    fseek(file, (long) (sizeof(struct recording_header) + offset), SEEK_SET);
+    fwrite(bytes, length, 1, file);
+    fclose(file);
+}
+
+static void damaged_blocks_are_rejected(void) {
+    struct recording_writer writer;
+    struct stat status;
+    FILE *file;
+    uint32_t value;
+    int mismatches;
+
+    // a count no writer produces
+    CHECK(write_samples(30) == 0);
+    value = RECORDING_BLOCK_SAMPLES + 1;
+    patch_first_block(offsetof(struct recording_block, count), &value, sizeof(value));
+    CHECK(read_samples(&mismatches) == 0);
+
+    // one sample more than the payload holds
+    CHECK(write_samples(30) == 0);
+    value = 31;
+    patch_first_block(offsetof(struct recording_block, count), &value, sizeof(value));
+    CHECK(read_samples(&mismatches) == 0);
+
+    // a payload larger than any block
+    CHECK(write_samples(30) == 0);
+    value = UINT32_MAX;
+    patch_first_block(offsetof(struct recording_block, payloadSize), &value, sizeof(value));
+    CHECK(read_samples(&mismatches) == 0);
+
+    // a block cut short by a crash is dropped when the writer opens the file again
+    CHECK(write_samples(30) == 0);
+    CHECK(recording_writer_open(&writer, path) == 0);
+    recording_writer_close(&writer);
+    CHECK(truncate(path, 200) == 0);
+    CHECK(recording_writer_open(&writer, path) == 0);
+    recording_writer_close(&writer);
+    CHECK(read_samples(&mismatches) == 0);
+
+    // a block torn while being rewritten still has its length but no longer decodes
+    CHECK(write_samples(30) == 0);
+    file = fopen(path, "r+b");
+    fseek(file, -1, SEEK_END);
+    fputc(0x80, file);
+    fclose(file);
+    CHECK(recording_writer_open(&writer, path) == 0);
+    recording_writer_close(&writer);
+    CHECK(read_samples(&mismatches) == 0);
+    CHECK(stat(path, &status) == 0 && status.st_size == (off_t) sizeof(struct recording_header));
+
+    // not a recording at all
+    CHECK(truncate(path, 0) == 0);
+    patch_first_block(0, "garbage!", 8);
+    CHECK(read_samples(&mismatches) == -1);
+}
+
+static void single_samples_round_trip(void) {
+    struct recording_stream sender = {0}, receiver = {0};
+    uint8_t frame[RECORDING_SAMPLE_MAX];
+    struct snapshot written, read;
+    size_t length, firstLength = 0;
+    int mismatches = 0;
+
+    for (int i = 0; i < 200; i++) {
+        sample_at(&written, i);
+        length = recording_encode_sample(&sender, &written, frame);
+        CHECK(length <= RECORDING_SAMPLE_MAX);
+        if (i == 0) {
+            firstLength = length;
+        } else {
+            // everything but the timestamp barely changes
+            CHECK(length < firstLength);
+        }
+        CHECK(recording_decode_sample(&receiver, frame, length, &read) == 0);
+        mismatches += !same_recorded(&read, &written);
+    }
+    CHECK(mismatches == 0);
+    // a frame cut short does not decode
+    sample_at(&written, 200);
+    length = recording_encode_sample(&sender, &written, frame);
+    CHECK(recording_decode_sample(&receiver, frame, length - 1, &read) == -1);
+}
+
+int main(void) {
+    int fd = mkstemp(path);
+
+    if (fd < 0) {
+        perror(path);
+        return 1;
+    }
+    close(fd);
+    RUN(blocks_round_trip);
+    RUN(partial_blocks_reach_disk);
+    RUN(one_week_fits_a_few_megabytes);
+    RUN(damaged_blocks_are_rejected);
+    RUN(single_samples_round_trip);
+    unlink(path);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,118 @@
+//
+// Deadline scheduler driven by a mock clock: run order, the period grid, set_period and
+// the adaptive backoff
+//
+
+#include "test.h"
+#include "scheduler.h"
+
+static uint64_t mockNow;
+
+static uint64_t mock_now(void *ctx) {
+    return mockNow;
+}
+
+static void mock_sleep_until(void *ctx, uint64_t deadline) {
+    mockNow = deadline;
+}
+
+static const struct sched_clock mock_clock = {mock_now, mock_sleep_until, NULL};
+
+static char runLog[64];
+static int changes;
+
+static int log_run(void *arg) {
+    size_t length = strlen(runLog);
+
+    if (length + 1 < sizeof(runLog)) {
+        runLog[length] = *(const char *) arg;
+    }
+    return changes;
+}
+
+static void runs_in_deadline_order(void) {
+    struct scheduler sched;
+    struct sched_task a = {.name = "a", .period = 10 * NSEC_PER_MSEC, .run = log_run, .arg = "a"};
+    struct sched_task b = {.name = "b", .period = 25 * NSEC_PER_MSEC, .run = log_run, .arg = "b"};
+    struct sched_task c = {.name = "c", .period = 40 * NSEC_PER_MSEC, .run = log_run, .arg = "c"};
+
+    mockNow = 0;
+    memset(runLog, 0, sizeof(runLog));
+    scheduler_init(&sched, &mock_clock, 0);
+    // added out of deadline order on purpose, ties go to the one added first
+    CHECK(scheduler_add(&sched, &c) == 0);
+    CHECK(scheduler_add(&sched, &a) == 0);
+    CHECK(scheduler_add(&sched, &b) == 0);
+    while (scheduler_next_deadline(&sched) <= 100 * NSEC_PER_MSEC) {
+        scheduler_step(&sched);
+    }
+    CHECK(strcmp(runLog, "cabaabacaabaabcaaab") == 0);
+    CHECK(a.runs == 11 && b.runs == 5 && c.runs == 3);
+    CHECK(a.maxLateness == 0 && b.maxLateness == 0);
+}
+
+static void late_runs_keep_the_grid(void) {
+    struct scheduler sched;
+    struct sched_task a = {.name = "a", .period = 10 * NSEC_PER_MSEC, .run = log_run, .arg = "a"};
+
+    mockNow = 1000 * NSEC_PER_MSEC;
+    memset(runLog, 0, sizeof(runLog));
+    scheduler_init(&sched, &mock_clock, 0);
+    scheduler_add(&sched, &a);
+    CHECK(scheduler_run_due(&sched) == 1);
+    // woken 35ms late: one run, the missed slots are skipped, the next stays on the grid
+    mockNow += 45 * NSEC_PER_MSEC;
+    CHECK(scheduler_run_due(&sched) == 1);
+    CHECK(a.maxLateness == 35 * NSEC_PER_MSEC);
+    CHECK(scheduler_next_deadline(&sched) == 1050 * NSEC_PER_MSEC);
+    CHECK(scheduler_run_due(&sched) == 0);
+}
+
+static void set_period_runs_right_away(void) {
+    struct scheduler sched;
+    struct sched_task a = {.name = "a", .period = 10 * NSEC_PER_MSEC, .run = log_run, .arg = "a"};
+    struct sched_task b = {.name = "b", .period = 1000 * NSEC_PER_MSEC, .run = log_run, .arg = "b"};
+
+    mockNow = 0;
+    memset(runLog, 0, sizeof(runLog));
+    scheduler_init(&sched, &mock_clock, 0);
+    scheduler_add(&sched, &a);
+    scheduler_add(&sched, &b);
+    scheduler_run_due(&sched);
+    mockNow = 5 * NSEC_PER_MSEC;
+    scheduler_set_period(&sched, &b, 20 * NSEC_PER_MSEC);
+    CHECK(scheduler_next_deadline(&sched) == 5 * NSEC_PER_MSEC);
+    CHECK(scheduler_step(&sched) == 1);
+    CHECK(b.deadline == 25 * NSEC_PER_MSEC && b.currentPeriod == 20 * NSEC_PER_MSEC);
+    CHECK(strcmp(runLog, "abb") == 0);
+}
+
+static void adaptive_backs_off_and_snaps_back(void) {
+    struct scheduler sched;
+    struct sched_task a = {.name = "a", .period = 10 * NSEC_PER_MSEC, .run = log_run, .arg = "a"};
+    uint64_t periods[6];
+
+    mockNow = 0;
+    changes = 0;
+    scheduler_init(&sched, &mock_clock, 1);
+    scheduler_add(&sched, &a);
+    for (int i = 0; i < 5; i++) {
+        scheduler_step(&sched);
+        periods[i] = a.currentPeriod / NSEC_PER_MSEC;
+    }
+    changes = 1;
+    scheduler_step(&sched);
+    periods[5] = a.currentPeriod / NSEC_PER_MSEC;
+    // doubles while nothing changes, up to adaptiveLimit times the base period
+    CHECK(periods[0] == 20 && periods[1] == 40 && periods[2] == 80 && periods[3] == 80 && periods[4] == 80);
+    CHECK(periods[5] == 10);
+    changes = 0;
+}
+
+int main(void) {
+    RUN(runs_in_deadline_order);
+    RUN(late_runs_keep_the_grid);
+    RUN(set_period_runs_right_away);
+    RUN(adaptive_backs_off_and_snaps_back);
+    return TEST_EXIT_CODE;
+}
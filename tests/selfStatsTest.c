@@ -0,0 +1,94 @@
+//
+// Self instrumentation and daemon mode: the latency histogram, the process's own usage,
+// and a daemon that ignores SIGHUP, reports on SIGUSR1 and stops on SIGTERM
+//
+
+#include <pthread.h>
+
+#include "test.h"
+#include "selfStats.h"
+#include "infoCollector.h"
+
+static void histogram_percentiles(void) {
+    static struct latency_histogram histogram;
+    uint64_t p50, p99;
+
+    for (uint64_t i = 1; i <= 1000; i++) {
+        latency_record(&histogram, i * 1000);
+    }
+    CHECK(atomic_load(&histogram.count) == 1000);
+    CHECK(atomic_load(&histogram.total) == 500500000);
+    CHECK(atomic_load(&histogram.max) == 1000000);
+    // bucket bounds, at most one bucket (12.5%) above the exact value
+    p50 = latency_percentile(&histogram, 0.5);
+    p99 = latency_percentile(&histogram, 0.99);
+    CHECK(p50 >= 500000 && p50 <= 500000 * 1.125);
+    CHECK(p99 >= 990000 && p99 <= 990000 * 1.125);
+    CHECK(latency_percentile(&histogram, 1.0) >= 1000000);
+
+    // small values are exact
+    memset(&histogram, 0, sizeof(histogram));
+    latency_record(&histogram, 3);
+    latency_record(&histogram, 7);
+    CHECK(latency_percentile(&histogram, 0.5) == 3);
+    CHECK(latency_percentile(&histogram, 1.0) == 7);
+}
+
+static void usage_of_this_process(void) {
+    struct self_usage before, after;
+    volatile double spin = 0;
+
+    CHECK(self_usage_read(&before) == 0);
+    for (int i = 0; i < 20000000; i++) {
+        spin += i;
+    }
+    CHECK(self_usage_read(&after) == 0);
+    CHECK(after.rssMB > 0);
+    CHECK(after.cpuSeconds > before.cpuSeconds);
+    CHECK(after.syscalls >= before.syscalls);
+}
+
+static void *signal_self(void *arg) {
+    struct timespec wait = {0, 150000000};
+
+    nanosleep(&wait, NULL);
+    kill(getpid(), SIGHUP);
+    nanosleep(&wait, NULL);
+    kill(getpid(), SIGUSR1);
+    return NULL;
+}
+
+static void run_daemon(void *arg) {
+    struct engine_options options;
+    pthread_t signaller;
+
+    // the self stats go to stderr, the test reads stdout
+    dup2(STDOUT_FILENO, STDERR_FILENO);
+    engine_default_options(&options);
+    options.flag = _CPU_TEMP | _MEM_STATUS;
+    options.updateInterval = 0.05;
+    options.backend = &synthetic_backend;
+    options.renderer = &null_renderer;
+    options.daemon = 1;
+    options.selfStats = 1;
+    pthread_create(&signaller, NULL, signal_self, NULL);
+    show(&options);
+}
+
+static void daemon_stops_on_sigterm(void) {
+    static char out[65536];
+    const char *second;
+
+    CHECK(run_child(run_daemon, NULL, 700, SIGTERM, out, sizeof(out)) == 0);
+    // once for SIGUSR1 and once at exit
+    CHECK((second = strstr(out, "macResMon self stats over")) != NULL);
+    CHECK(second != NULL && strstr(second + 1, "macResMon self stats over") != NULL);
+    CHECK(strstr(out, "cpu temp") == NULL);
+}
+
+int main(void) {
+    RUN(histogram_percentiles);
+    RUN(usage_of_this_process);
+    RUN(daemon_stops_on_sigterm);
+    return TEST_EXIT_CODE;
+}
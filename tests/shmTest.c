@@ -0,0 +1,167 @@
+//
+// Shared memory segment: what the reader sees of a published snapshot, reads that never
+// come out torn while the publisher keeps writing, and show() leaving no segment behind
+// when it gives up early
+//
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "test.h"
+#include "shmPublisher.h"
+#include "macResMonShm.h"
+#include "infoCollector.h"
+
+static char name[64];
+
+static void snapshot_of(struct snapshot *snap, uint64_t number) {
+    memset(snap, 0, sizeof(struct snapshot));
+    snap->timestamp = number;
+    snap->valid = SNAP_CPU_TEMP | SNAP_FANS | SNAP_MEM;
+    // first, middle and last field, so a torn copy shows
+    snap->cpuTemp = (double) number;
+    snap->memUsed = (double) number;
+    snap->processCount = (int) number;
+    snap->fanSpeed[SNAPSHOT_MAX_FANS - 1] = (double) number;
+}
+
+static int consistent(const struct mrm_values *values) {
+    return values->cpuTemp == (double) values->timestamp && values->memUsed == values->cpuTemp &&
+           values->processCount == (int32_t) values->timestamp &&
+           values->fanSpeed[MRM_MAX_FANS - 1] == values->cpuTemp;
+}
+
+static void reader_sees_what_was_published(void) {
+    struct mrm_shm *shm;
+    struct mrm_values values;
+    struct snapshot snap;
+    uint64_t sequence = 0;
+
+    CHECK(mrm_shm_open(name) == NULL);
+    CHECK(shm_publisher_open(name) == 0);
+    shm = mrm_shm_open(name);
+    CHECK(shm != NULL);
+    if (shm == NULL) {
+        shm_publisher_close();
+        return;
+    }
+    CHECK(shm->pid == (int32_t) getpid());
+    CHECK(mrm_shm_read(shm, &values, NULL) == -1);
+    CHECK(mrm_shm_sequence(shm) == 0);
+
+    snapshot_of(&snap, 7);
+    snap.valid |= SNAP_BATTERY | SNAP_SELF | SNAP_MEM_DETAIL;
+    snap.stale = SNAP_BATTERY;
+    snap.fanCount = 2;
+    snap.fanSpeed[1] = 2400;
+    snap.batteryMinutes = -1;
+    shm_publisher_publish(&snap);
+    CHECK(mrm_shm_sequence(shm) == 1);
+    CHECK(mrm_shm_read(shm, &values, &sequence) == 0 && sequence == 1);
+    CHECK(values.timestamp == 7 && values.cpuTemp == 7 && values.fanCount == 2 && values.fanSpeed[1] == 2400);
+    CHECK(values.batteryMinutes == -1);
+    // stale sections and the ones the segment has no fields for are not valid
+    CHECK(values.valid == (MRM_CPU_TEMP | MRM_FANS | MRM_MEM));
+
+    snapshot_of(&snap, 8);
+    shm_publisher_publish(&snap);
+    CHECK(mrm_shm_read(shm, &values, &sequence) == 0 && sequence == 2 && values.timestamp == 8);
+
+    // the segment is gone for new readers, this one keeps the last sample
+    shm_publisher_close();
+    CHECK(mrm_shm_open(name) == NULL);
+    CHECK(mrm_shm_read(shm, &values, NULL) == 0 && values.timestamp == 8);
+    mrm_shm_close(shm);
+}
+
+static struct mrm_shm *stressShm;
+static atomic_int writing;
+static atomic_ulong tornReads, goodReads, backwards;
+
+static void *stress_reader(void *arg) {
+    struct mrm_values values;
+    uint64_t sequence, last = 0;
+
+    while (atomic_load(&writing)) {
+        if (mrm_shm_read(stressShm, &values, &sequence) != 0) {
+            continue;
+        }
+        atomic_fetch_add(consistent(&values) ? &goodReads : &tornReads, 1);
+        if (sequence < last) {
+            atomic_fetch_add(&backwards, 1);
+        }
+        last = sequence;
+    }
+    return arg;
+}
+
+static void reads_are_never_torn(void) {
+    pthread_t readers[3];
+    struct snapshot snap;
+    struct timespec start, now;
+    uint64_t published = 0;
+
+    CHECK(shm_publisher_open(name) == 0);
+    stressShm = mrm_shm_open(name);
+    CHECK(stressShm != NULL);
+    if (stressShm == NULL) {
+        shm_publisher_close();
+        return;
+    }
+    atomic_store(&writing, 1);
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&readers[i], NULL, stress_reader, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do {
+        snapshot_of(&snap, ++published);
+        shm_publisher_publish(&snap);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while ((now.tv_sec - start.tv_sec) * 1000000000L + (now.tv_nsec - start.tv_nsec) < 500000000L);
+    atomic_store(&writing, 0);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(readers[i], NULL);
+    }
+    CHECK(atomic_load(&tornReads) == 0);
+    CHECK(atomic_load(&backwards) == 0);
+    CHECK(atomic_load(&goodReads) > 0);
+    CHECK(mrm_shm_sequence(stressShm) == published);
+    mrm_shm_close(stressShm);
+    shm_publisher_close();
+}
+
+static int failing_open(int flag) {
+    (void) flag;
+    return -1;
+}
+
+static void failing_sample(int flag, struct snapshot *snap) {
+    (void) flag;
+    (void) snap;
+}
+
+static void failing_close(void) {
+}
+
+static const struct backend failing_backend = {"failing", failing_open, failing_sample, failing_close};
+
+static void show_giving_up_unlinks_the_segment(void) {
+    struct engine_options options;
+
+    engine_default_options(&options);
+    options.flag = _CPU_TEMP;
+    options.backend = &failing_backend;
+    options.renderer = &null_renderer;
+    options.shmName = name;
+    show(&options);
+    CHECK(mrm_shm_open(name) == NULL);
+}
+
+int main(void) {
+    snprintf(name, sizeof(name), "/macResMonTest%d", (int) getpid());
+    RUN(reader_sees_what_was_published);
+    RUN(reads_are_never_torn);
+    RUN(show_giving_up_unlinks_the_segment);
+    shm_unlink(name);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,91 @@
+//
+// Key info cache of the SMC layer: what each read costs in SMC calls, and when the cache
+// has to ask again
+//
+
+#include "test.h"
+#include "systemManagementController.h"
+#include "fakeSMC.h"
+
+static void setup(void) {
+    SMC_set_transport(&fakeSMC_transport);
+    fakeSMC_reset();
+    fakeSMC_set_sp78("TC0P", 52.25);
+    fakeSMC_set_fpe2("F0Ac", 2150);
+    SMC_open();
+    fakeSMC_reset_counts();
+}
+
+static void warm_read_is_one_call(void) {
+    SMCVal_t val;
+
+    setup();
+    CHECK(SMC_read_key(SMC_key("TC0P"), &val) == kIOReturnSuccess);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 1);
+    CHECK(fakeSMC_call_count(kSMCReadKey) == 1);
+    CHECK(val.dataType == DATA_TYPE_SP78 && val.dataSize == 2);
+    for (int i = 0; i < 10; i++) {
+        CHECK(SMC_read_key(SMC_key("TC0P"), &val) == kIOReturnSuccess);
+    }
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 1);
+    CHECK(fakeSMC_call_count(kSMCReadKey) == 11);
+}
+
+static void missing_key_is_remembered(void) {
+    SMCVal_t val;
+
+    setup();
+    CHECK(SMC_read_key(SMC_key("TZ9Z"), &val) != kIOReturnSuccess);
+    CHECK(SMC_read_key(SMC_key("TZ9Z"), &val) != kIOReturnSuccess);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 1);
+    CHECK(fakeSMC_call_count(kSMCReadKey) == 0);
+}
+
+static void failed_read_resolves_again(void) {
+    SMCVal_t val;
+
+    setup();
+    CHECK(SMC_read_key(SMC_key("TC0P"), &val) == kIOReturnSuccess);
+    fakeSMC_fail_key("TC0P", 1);
+    CHECK(SMC_read_key(SMC_key("TC0P"), &val) != kIOReturnSuccess);
+    fakeSMC_fail_key("TC0P", 0);
+    CHECK(SMC_read_key(SMC_key("TC0P"), &val) == kIOReturnSuccess);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 2);
+}
+
+static void invalidate_picks_up_a_new_type(void) {
+    SMCVal_t val;
+
+    setup();
+    CHECK(SMC_read_key(SMC_key("F0Ac"), &val) == kIOReturnSuccess && val.dataType == DATA_TYPE_FPE2);
+    // firmware update: same key, another type
+    fakeSMC_set_ui8("F0Ac", 7);
+    SMC_invalidate_key(SMC_key("F0Ac"));
+    CHECK(SMC_read_key(SMC_key("F0Ac"), &val) == kIOReturnSuccess);
+    CHECK(val.dataType == DATA_TYPE_UINT8 && val.dataSize == 1 && val.bytes[0] == 7);
+    // the other key stays cached
+    CHECK(SMC_read_key(SMC_key("TC0P"), &val) == kIOReturnSuccess);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 3);
+    CHECK(SMC_read_key(SMC_key("TC0P"), &val) == kIOReturnSuccess);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 3);
+}
+
+static void open_forgets_everything(void) {
+    SMCVal_t val;
+
+    setup();
+    CHECK(SMC_read_key(SMC_key("TC0P"), &val) == kIOReturnSuccess);
+    SMC_close();
+    SMC_open();
+    CHECK(SMC_read_key(SMC_key("TC0P"), &val) == kIOReturnSuccess);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 2);
+}
+
+int main(void) {
+    RUN(warm_read_is_one_call);
+    RUN(missing_key_is_remembered);
+    RUN(failed_read_resolves_again);
+    RUN(invalidate_picks_up_a_new_type);
+    RUN(open_forgets_everything);
+    return TEST_EXIT_CODE;
+}
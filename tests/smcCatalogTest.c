@@ -0,0 +1,113 @@
+//
+// Key enumeration and the on-disk key catalog: written, mapped, searched and used to
+// prime the key info cache
+//
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "test.h"
+#include "smcCatalog.h"
+#include "fakeSMC.h"
+
+static char path[] = "/tmp/macResMonCatalogXXXXXX";
+
+static void setup(void) {
+    char key[5] = "T000";
+
+    SMC_set_transport(&fakeSMC_transport);
+    fakeSMC_reset();
+    // 300 keys, inserted out of order
+    for (int i = 299; i >= 0; i--) {
+        key[1] = (char) ('A' + i / 100);
+        key[2] = (char) ('0' + i / 10 % 10);
+        key[3] = (char) ('0' + i % 10);
+        fakeSMC_set_sp78(key, i);
+    }
+    fakeSMC_set_ui8("FNum", 2);
+    SMC_open();
+}
+
+static void enumerate_write_and_find(void) {
+    SMCCatalogRecord_t *records;
+    SMCCatalog_t catalog;
+    uint32_t count;
+
+    setup();
+    CHECK(SMC_enumerate_keys(&records, &count) == 0);
+    CHECK(count == 301);
+    for (uint32_t i = 1; i < count; i++) {
+        CHECK(records[i - 1].key < records[i].key);
+    }
+    CHECK(SMC_catalog_write(path, records, count, count) == 0);
+    free(records);
+
+    CHECK(SMC_catalog_open(path, &catalog) == 0);
+    CHECK(catalog.count == 301 && catalog.smcKeyCount == 301);
+    const SMCCatalogRecord_t *found = SMC_catalog_find(&catalog, SMC_key("TB42"));
+    CHECK(found != NULL && found->dataType == DATA_TYPE_SP78 && found->dataSize == 2);
+    found = SMC_catalog_find(&catalog, SMC_key("FNum"));
+    CHECK(found != NULL && found->dataType == DATA_TYPE_UINT8 && found->dataSize == 1);
+    CHECK(SMC_catalog_find(&catalog, SMC_key("TZ99")) == NULL);
+    CHECK(SMC_catalog_find(&catalog, 0) == NULL);
+    SMC_catalog_close(&catalog);
+}
+
+static void rejects_a_damaged_file(void) {
+    SMCCatalog_t catalog;
+    long size;
+    FILE *file = fopen(path, "r+");
+
+    CHECK(file != NULL);
+    if (file == NULL) {
+        return;
+    }
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fclose(file);
+    CHECK(truncate(path, size - 3) == 0);
+    CHECK(SMC_catalog_open(path, &catalog) != 0);
+    CHECK(SMC_catalog_open("/nonexistent/catalog", &catalog) != 0);
+}
+
+static void prime_spares_the_lookups(void) {
+    SMCCatalogRecord_t *records;
+    SMCVal_t val;
+    uint32_t count;
+
+    setup();
+    CHECK(SMC_enumerate_keys(&records, &count) == 0);
+    CHECK(SMC_catalog_write(path, records, count, count) == 0);
+    free(records);
+
+    SMC_open();
+    CHECK(SMC_catalog_prime(path) == 0);
+    fakeSMC_reset_counts();
+    CHECK(SMC_read_key(SMC_key("TC99"), &val) == kIOReturnSuccess);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 0);
+    CHECK(fakeSMC_call_count(kSMCReadKey) == 1);
+
+    // another key count means other firmware, the catalog is not used
+    fakeSMC_set_sp78("TZ00", 1);
+    SMC_open();
+    CHECK(SMC_catalog_prime(path) != 0);
+    fakeSMC_reset_counts();
+    CHECK(SMC_read_key(SMC_key("TC99"), &val) == kIOReturnSuccess);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 1);
+}
+
+int main(void) {
+    int fd = mkstemp(path);
+
+    if (fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    close(fd);
+    RUN(enumerate_write_and_find);
+    RUN(rejects_a_damaged_file);
+    RUN(prime_spares_the_lookups);
+    unlink(path);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,104 @@
+//
+// Decoding of the SMC data types and the batched SMC_read_many
+//
+
+#include <string.h>
+
+#include "test.h"
+#include "systemManagementController.h"
+#include "fakeSMC.h"
+
+static double decoded(uint32_t dataType, const char *bytes, uint32_t dataSize) {
+    double value = -12345;
+    CHECK(SMC_decode(dataType, bytes, dataSize, &value));
+    return value;
+}
+
+static void decodes_known_bytes(void) {
+    CHECK_NEAR(decoded(DATA_TYPE_SP78, "\x34\x40", 2), 52.25, 0);
+    CHECK_NEAR(decoded(DATA_TYPE_SP78, "\xff\x00", 2), -1.0, 0);
+    CHECK_NEAR(decoded(DATA_TYPE_FPE2, "\x21\x98", 2), 2150.0, 0);
+    CHECK_NEAR(decoded(DATA_TYPE_UINT8, "\xc8", 1), 200, 0);
+    CHECK_NEAR(decoded(DATA_TYPE_UINT16, "\x01\x02", 2), 258, 0);
+    CHECK_NEAR(decoded(DATA_TYPE_UINT32, "\x80\x00\x00\x01", 4), 2147483649.0, 0);
+    CHECK_NEAR(decoded(DATA_TYPE_FLAG, "\x05", 1), 1, 0);
+    // little endian IEEE float 1800.5
+    CHECK_NEAR(decoded(DATA_TYPE_FLT, "\x00\x10\xe1\x44", 4), 1800.5, 0);
+}
+
+static void rejects_unknown_and_short(void) {
+    double value;
+
+    CHECK(!SMC_decode(DATA_TYPE_SFDS, "\0\0\0\0", 4, &value));
+    CHECK(!SMC_decode(DATA_TYPE_SP78, "\x34", 1, &value));
+    CHECK(!SMC_decode(DATA_TYPE_UINT32, "\0\0", 2, &value));
+}
+
+static void encode_round_trips(void) {
+    static const struct {
+        uint32_t dataType;
+        uint32_t dataSize;
+        double value;
+    } cases[] = {
+            {DATA_TYPE_SP78, 2, 52.25}, {DATA_TYPE_SP78, 2, -7.5}, {DATA_TYPE_FPE2, 2, 5999.75},
+            {DATA_TYPE_FLT, 4, 1234.5}, {DATA_TYPE_UINT8, 1, 3}, {DATA_TYPE_UINT16, 2, 65535},
+            {DATA_TYPE_UINT32, 4, 4000000000.0}, {DATA_TYPE_FLAG, 1, 1},
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        char bytes[4];
+        double value;
+
+        CHECK(SMC_encode(cases[i].dataType, cases[i].value, bytes, cases[i].dataSize));
+        CHECK(SMC_decode(cases[i].dataType, bytes, cases[i].dataSize, &value));
+        CHECK_NEAR(value, cases[i].value, 0);
+    }
+}
+
+static void encode_clamps_to_the_type(void) {
+    char bytes[2];
+    double value;
+
+    CHECK(SMC_encode(DATA_TYPE_FPE2, -100, bytes, 2));
+    CHECK(SMC_decode(DATA_TYPE_FPE2, bytes, 2, &value) && value == 0);
+    CHECK(SMC_encode(DATA_TYPE_UINT8, 1000, bytes, 1));
+    CHECK(SMC_decode(DATA_TYPE_UINT8, bytes, 1, &value) && value == 255);
+    // the size has to be the type's own
+    CHECK(!SMC_encode(DATA_TYPE_SP78, 1, bytes, 1));
+}
+
+static void read_many_batches(void) {
+    SMCKey_t keys[5] = {SMC_key("TC0P"), 0, SMC_key("F0Ac"), SMC_key("TZ9Z"), SMC_key("FNum")};
+    SMCSample_t samples[5];
+
+    SMC_set_transport(&fakeSMC_transport);
+    fakeSMC_reset();
+    fakeSMC_set_sp78("TC0P", 52.25);
+    fakeSMC_set_fpe2("F0Ac", 2150);
+    fakeSMC_set_ui8("FNum", 2);
+    SMC_open();
+
+    CHECK(SMC_read_many(keys, 5, samples) == 3);
+    CHECK(samples[0].valid && samples[0].dataType == DATA_TYPE_SP78);
+    CHECK_NEAR(samples[0].value, 52.25, 0);
+    // a key of 0 is skipped without a call, a missing one is invalid
+    CHECK(!samples[1].valid && samples[1].key == 0);
+    CHECK(samples[2].valid);
+    CHECK_NEAR(samples[2].value, 2150, 0);
+    CHECK(!samples[3].valid && samples[3].value == 0);
+    CHECK(samples[4].valid && samples[4].value == 2);
+
+    // warm: one read per present key, nothing else
+    fakeSMC_reset_counts();
+    CHECK(SMC_read_many(keys, 5, samples) == 3);
+    CHECK(fakeSMC_call_count(kSMCGetKeyInfo) == 0);
+    CHECK(fakeSMC_call_count(kSMCReadKey) == 3);
+}
+
+int main(void) {
+    RUN(decodes_known_bytes);
+    RUN(rejects_unknown_and_short);
+    RUN(encode_round_trips);
+    RUN(encode_clamps_to_the_type);
+    RUN(read_many_batches);
+    return TEST_EXIT_CODE;
+}
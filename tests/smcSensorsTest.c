@@ -0,0 +1,96 @@
+//
+// Sensor table: its rows agree with each other, fan keys map back to their sensor, and a
+// plan reads per fan arrays for every fan but a scalar fan field from fan 0 only
+//
+
+#include "test.h"
+#include "smcSensors.h"
+#include "systemManagementController.h"
+#include "infoCollector.h"
+#include "fakeSMC.h"
+
+static void rows_are_consistent(void) {
+    for (int i = 0; i < SMC_SENSOR_COUNT; i++) {
+        const struct smc_sensor *sensor = &smc_sensors[i];
+
+        CHECK(SMC_key(sensor->keyName) == sensor->key);
+        CHECK(sensor->name != NULL && sensor->title != NULL && sensor->unit != NULL);
+        // fan sensors are the F<n> keys, of fan 0 in the table
+        CHECK(!sensor->perFan || (sensor->keyName[0] == 'F' && sensor->keyName[1] == '0'));
+        // a sampled sensor has a section and a validity bit, the others neither
+        CHECK((sensor->offset == SENSOR_NO_FIELD) == (sensor->section == 0));
+        CHECK((sensor->offset == SENSOR_NO_FIELD) == (sensor->validBit == 0));
+        CHECK(sensor->offset == SENSOR_NO_FIELD || sensor->offset + sizeof(double) <= sizeof(struct snapshot));
+        for (int j = 0; j < i; j++) {
+            CHECK(smc_sensors[j].key != sensor->key);
+            CHECK(strcmp(smc_sensors[j].name, sensor->name) != 0);
+        }
+    }
+    CHECK(smc_sensors[SENSOR_FAN_0].elements == SNAPSHOT_MAX_FANS);
+    CHECK(smc_sensors[SENSOR_FAN_0_MAX_RPM].elements == 1);
+    CHECK(smc_sensors[SENSOR_FAN_0_MAX_RPM].perFan);
+}
+
+static void finds_fan_keys(void) {
+    CHECK(smc_sensor_find(SMC_key("TC0P")) == &smc_sensors[SENSOR_CPU_0_PROXIMITY]);
+    CHECK(smc_sensor_find(SMC_key("F0Ac")) == &smc_sensors[SENSOR_FAN_0]);
+    CHECK(smc_sensor_find(SMC_key("F3Ac")) == &smc_sensors[SENSOR_FAN_0]);
+    CHECK(smc_sensor_find(SMC_key("F9Mx")) == &smc_sensors[SENSOR_FAN_0_MAX_RPM]);
+    CHECK(smc_sensor_find(SMC_key("F1Tg")) == &smc_sensors[SENSOR_FAN_0_TARGET_RPM]);
+    // same pattern, but not a fan number
+    CHECK(smc_sensor_find(SMC_key("FxAc")) == NULL);
+    CHECK(smc_sensor_find(SMC_key("F:Ac")) == NULL);
+    CHECK(smc_sensor_find(SMC_key("F/Mn")) == NULL);
+    // the second character of a temperature is not a fan
+    CHECK(smc_sensor_find(SMC_key("TC1P")) == NULL);
+    CHECK(smc_sensor_find(SMC_key("ZZZZ")) == NULL);
+}
+
+static void plan_samples_each_fan_once(void) {
+    struct smc_sensor_plan plan;
+    struct snapshot snap;
+    int speeds = 0, maxima = 0;
+
+    smc_sensor_plan_compile(&plan, _FAN_STATUS, 3);
+    for (int i = 0; i < plan.count; i++) {
+        speeds += plan.sensor[i] == SENSOR_FAN_0;
+        maxima += plan.sensor[i] == SENSOR_FAN_0_MAX_RPM;
+    }
+    CHECK(speeds == 3 && maxima == 1);
+    CHECK(plan.count == 4);
+
+    SMC_set_transport(&fakeSMC_transport);
+    fakeSMC_reset();
+    for (int fan = 0; fan < 4; fan++) {
+        char key[5] = {'F', (char) ('0' + fan), 'A', 'c', '\0'};
+
+        fakeSMC_set_fpe2(key, 1000 + 100 * fan);
+        key[2] = 'M';
+        key[3] = 'x';
+        fakeSMC_set_fpe2(key, 5000 + 100 * fan);
+    }
+    fakeSMC_set_sp78("TC0P", 48.5);
+    CHECK(SMC_open() == kIOReturnSuccess);
+
+    memset(&snap, 0, sizeof(snap));
+    snap.fanSpeed[3] = -1;
+    smc_sensor_plan_sample(&plan, _FAN_STATUS | _CPU_TEMP, &snap);
+    CHECK(snap.valid == SNAP_FANS);
+    CHECK(snap.fanSpeed[0] == 1000 && snap.fanSpeed[1] == 1100 && snap.fanSpeed[2] == 1200);
+    CHECK(snap.fanSpeed[3] == -1);
+    // fan 0's maximum, the others do not land past the field
+    CHECK(snap.fanMax == 5000);
+
+    // more fans than the snapshot holds are cut at its arrays
+    smc_sensor_plan_compile(&plan, _FAN_STATUS | _CPU_TEMP, SNAPSHOT_MAX_FANS + 5);
+    CHECK(plan.fanCount == SNAPSHOT_MAX_FANS);
+    CHECK(plan.count == SNAPSHOT_MAX_FANS + 2);
+    SMC_close();
+}
+
+int main(void) {
+    RUN(rows_are_consistent);
+    RUN(finds_fan_keys);
+    RUN(plan_samples_each_fan_once);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,143 @@
+//
+// History ring (one writer, readers never block it) and the windowed metric statistics
+//
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "test.h"
+#include "snapshotRing.h"
+#include "metricStats.h"
+
+static void snapshot_of(struct snapshot *snap, uint64_t number) {
+    memset(snap, 0, sizeof(struct snapshot));
+    snap->timestamp = number;
+    snap->valid = SNAP_CPU_TEMP;
+    // spread over the whole struct so a torn copy shows
+    snap->cpuTemp = (double) number;
+    snap->fanSpeed[SNAPSHOT_MAX_FANS - 1] = (double) number;
+    snap->selfRss = (double) number;
+}
+
+static int consistent(const struct snapshot *snap) {
+    return snap->cpuTemp == (double) snap->timestamp && snap->fanSpeed[SNAPSHOT_MAX_FANS - 1] == snap->cpuTemp &&
+           snap->selfRss == snap->cpuTemp;
+}
+
+static void read_window(void) {
+    struct snapshot_ring ring;
+    struct snapshot snap;
+    uint64_t index;
+
+    CHECK(snapshot_ring_init(&ring, 5) == 0);
+    CHECK(snapshot_ring_latest(&ring, &snap, &index) == -1);
+    CHECK(snapshot_ring_read(&ring, 0, &snap) == -1);
+    for (uint64_t i = 0; i < 20; i++) {
+        snapshot_of(&snap, i);
+        snapshot_ring_push(&ring, &snap);
+    }
+    CHECK(snapshot_ring_head(&ring) == 20);
+    CHECK(snapshot_ring_latest(&ring, &snap, &index) == 0 && index == 19 && snap.timestamp == 19);
+    // rounded up to 8: the last 8 are there, older ones are gone
+    CHECK(snapshot_ring_read(&ring, 12, &snap) == 0 && snap.timestamp == 12);
+    CHECK(snapshot_ring_read(&ring, 11, &snap) == -1);
+    CHECK(snapshot_ring_read(&ring, 20, &snap) == -1);
+    snapshot_ring_free(&ring);
+}
+
+static struct snapshot_ring stressRing;
+static atomic_int writing;
+static atomic_ulong tornReads, goodReads;
+
+static void *stress_reader(void *arg) {
+    struct snapshot snap;
+
+    while (atomic_load(&writing)) {
+        uint64_t head = snapshot_ring_head(&stressRing);
+
+        if (snapshot_ring_latest(&stressRing, &snap, NULL) == 0) {
+            atomic_fetch_add(consistent(&snap) ? &goodReads : &tornReads, 1);
+        }
+        // the oldest slot is the one the writer is most likely overwriting
+        if (head > 4 && snapshot_ring_read(&stressRing, head - 4, &snap) == 0) {
+            atomic_fetch_add(consistent(&snap) && snap.timestamp == head - 4 ? &goodReads : &tornReads, 1);
+        }
+    }
+    return NULL;
+}
+
+static void no_torn_reads_under_load(void) {
+    pthread_t readers[3];
+    struct snapshot snap;
+    struct timespec start, now;
+
+    CHECK(snapshot_ring_init(&stressRing, 4) == 0);
+    atomic_store(&writing, 1);
+    for (int i = 0; i < 3; i++) {
+        pthread_create(&readers[i], NULL, stress_reader, NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t i = 0;; i++) {
+        snapshot_of(&snap, i);
+        snapshot_ring_push(&stressRing, &snap);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if ((double) (now.tv_sec - start.tv_sec) + (double) (now.tv_nsec - start.tv_nsec) / 1e9 >= 0.5) {
+            break;
+        }
+    }
+    atomic_store(&writing, 0);
+    for (int i = 0; i < 3; i++) {
+        pthread_join(readers[i], NULL);
+    }
+    printf("     %lu consistent reads, %lu torn\n", atomic_load(&goodReads), atomic_load(&tornReads));
+    CHECK(atomic_load(&tornReads) == 0);
+    CHECK(atomic_load(&goodReads) > 1000);
+    snapshot_ring_free(&stressRing);
+}
+
+static void push_temperature(struct metric_stats *stats, double value, uint32_t bits) {
+    struct snapshot snap;
+
+    memset(&snap, 0, sizeof(snap));
+    snap.valid = SNAP_CPU_TEMP;
+    snap.cpuTemp = value;
+    metric_stats_update(stats, &snap, bits);
+}
+
+static void window_statistics(void) {
+    struct metric_stats stats;
+    struct metric_summary summary;
+
+    CHECK(metric_stats_init(&stats, 3, 0.5) == 0);
+    CHECK(metric_stats_get(&stats, METRIC_CPU_TEMP, &summary) == 0);
+    push_temperature(&stats, 1, SNAP_CPU_TEMP);
+    push_temperature(&stats, 9, SNAP_CPU_TEMP);
+    push_temperature(&stats, 5, SNAP_CPU_TEMP);
+    push_temperature(&stats, 2, SNAP_CPU_TEMP);
+    // a sample whose bit is not asked for is left out
+    push_temperature(&stats, 100, SNAP_FANS);
+    CHECK(metric_stats_get(&stats, METRIC_CPU_TEMP, &summary) == 1);
+    CHECK(summary.count == 3);
+    CHECK_NEAR(summary.min, 2, 0);
+    CHECK_NEAR(summary.max, 9, 0);
+    CHECK_NEAR(summary.mean, 16.0 / 3, 1e-9);
+    CHECK_NEAR(summary.last, 2, 0);
+    // 1, then halfway towards 9, 5 and 2
+    CHECK_NEAR(summary.ewma, ((1 + 9) / 2.0 + 5) / 2.0 / 2.0 + 1, 1e-9);
+    CHECK(metric_stats_get(&stats, METRIC_GPU_TEMP, &summary) == 0);
+
+    // the maximum leaves the window with its sample
+    push_temperature(&stats, 3, SNAP_CPU_TEMP);
+    push_temperature(&stats, 4, SNAP_CPU_TEMP);
+    CHECK(metric_stats_get(&stats, METRIC_CPU_TEMP, &summary) == 1);
+    CHECK_NEAR(summary.max, 4, 0);
+    CHECK_NEAR(summary.min, 2, 0);
+    metric_stats_free(&stats);
+}
+
+int main(void) {
+    RUN(read_window);
+    RUN(no_torn_reads_under_load);
+    RUN(window_statistics);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,111 @@
+//
+// Stream renderer: the numbered fields of the arrays, escaping, null past an element count
+// and the CSV header written again when a count grows
+//
+
+#include <stdlib.h>
+
+#include "test.h"
+#include "renderer.h"
+#include "infoCollector.h"
+
+static char path[] = "/tmp/streamTestXXXXXX";
+
+static void fill(struct snapshot *snap) {
+    memset(snap, 0, sizeof(struct snapshot));
+    snap->timestamp = 1700000000000000000ull;
+    snap->valid = SNAP_DISK | SNAP_DISK_IO | SNAP_CPU_USAGE | SNAP_FANS | SNAP_PROCESSES;
+    snap->volumeCount = 2;
+    snprintf(snap->volumes[0].mount, sizeof(snap->volumes[0].mount), "/");
+    snap->volumes[0].total = 500;
+    snprintf(snap->volumes[1].mount, sizeof(snap->volumes[1].mount), "/Volumes/\"Backup\"");
+    snap->deviceCount = 1;
+    snprintf(snap->devices[0].name, sizeof(snap->devices[0].name), "disk0");
+    snap->devices[0].readBytes = 4096;
+    snap->coreCount = 2;
+    snap->coreIdle[0] = 75;
+    snap->coreIdle[1] = 10;
+    snap->fanCount = 2;
+    snap->fanMax = 6000;
+    snap->fanSpeed[0] = 1200;
+    snap->fanSpeed[1] = 1800;
+    snap->processCount = 100;
+    snap->topCount = 1;
+    snap->topCpu[0].pid = 42;
+    snprintf(snap->topCpu[0].name, sizeof(snap->topCpu[0].name), "make");
+}
+
+// everything written to path so far
+static void written(char *out, size_t size) {
+    FILE *file = fopen(path, "r");
+    size_t length = fread(out, 1, size - 1, file);
+
+    out[length] = '\0';
+    fclose(file);
+}
+
+static void ndjson_numbers_the_elements(void) {
+    static char out[65536];
+    struct snapshot snap;
+    int flag = _DISK_STATUS | _CPU_USAGE | _FAN_STATUS | _PROCESSES;
+
+    fill(&snap);
+    CHECK(stream_renderer_configure("ndjson", path) == 0);
+    CHECK(stream_renderer.open() == 0);
+    stream_renderer.render(&snap, NULL, flag);
+    snap.fanCount = 1;
+    snap.fanSpeed[1] = 0;
+    stream_renderer.render(&snap, NULL, flag);
+    stream_renderer.close();
+    written(out, sizeof(out));
+
+    CHECK(strstr(out, "\"fan_max_rpm\":6000,\"fan_0_rpm\":1200,\"fan_1_rpm\":1800") != NULL);
+    CHECK(strstr(out, "\"core_0_busy_percent\":25,\"core_1_busy_percent\":90") != NULL);
+    CHECK(strstr(out, "\"volume_0_mount\":\"/\",\"volume_0_total_gb\":500") != NULL);
+    CHECK(strstr(out, "\"volume_1_mount\":\"/Volumes/\\\"Backup\\\"\"") != NULL);
+    CHECK(strstr(out, "\"device_0_name\":\"disk0\",\"device_0_read_bytes_per_second\":4096") != NULL);
+    CHECK(strstr(out, "\"top_cpu_0_pid\":42,\"top_cpu_0_name\":\"make\"") != NULL);
+    // the second record keeps the field of the fan that went away
+    CHECK(strstr(out, "\"fan_0_rpm\":1200,\"fan_1_rpm\":null") != NULL);
+    CHECK(strstr(out, "fan_2_rpm") == NULL);
+}
+
+static void csv_header_follows_the_counts(void) {
+    static char out[65536];
+    char *second;
+    struct snapshot snap;
+
+    fill(&snap);
+    snap.fanCount = 1;
+    CHECK(stream_renderer_configure("csv", path) == 0);
+    CHECK(stream_renderer.open() == 0);
+    stream_renderer.render(&snap, NULL, _FAN_STATUS | _DISK_STATUS);
+    stream_renderer.render(&snap, NULL, _FAN_STATUS | _DISK_STATUS);
+    snap.fanCount = 2;
+    stream_renderer.render(&snap, NULL, _FAN_STATUS | _DISK_STATUS);
+    stream_renderer.close();
+    written(out, sizeof(out));
+
+    CHECK(strncmp(out, "time,", 5) == 0);
+    CHECK(strstr(out, ",fan_0_rpm,self_cpu_percent") != NULL);
+    CHECK(strstr(out, "\"/Volumes/\"\"Backup\"\"\"") != NULL);
+    // a header, two records, then a longer header for the second fan and its record
+    second = strstr(out + 1, "\ntime,");
+    CHECK(second != NULL);
+    if (second != NULL) {
+        CHECK(strstr(second, ",fan_0_rpm,fan_1_rpm,") != NULL);
+        CHECK(strstr(second, ",1200,1800,") != NULL);
+        CHECK(strstr(second + 1, "\ntime,") == NULL);
+    }
+}
+
+int main(void) {
+    int file = mkstemp(path);
+
+    CHECK(file >= 0);
+    close(file);
+    RUN(ndjson_numbers_the_elements);
+    RUN(csv_header_follows_the_counts);
+    unlink(path);
+    return TEST_EXIT_CODE;
+}
@@ -0,0 +1,107 @@
+//
+// The few checks the tests under tests/ need. Every test file is an executable of its own
+// that runs its cases in order, reports each failed check with its line and exits 1 when
+// any failed; ctest runs them all (see CMakeLists.txt). They run on the fake SMC and the
+// synthetic backend, so they pass the same on any platform.
+//
+
+#ifndef FINALPROJECT_TEST_H
+#define FINALPROJECT_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+static int testFailures = 0;
+
+#define CHECK(condition) do { \
+    if (!(condition)) { \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+        testFailures++; \
+    } \
+} while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance) do { \
+    double actualValue = (actual), expectedValue = (expected); \
+    if (!(fabs(actualValue - expectedValue) <= (tolerance))) { \
+        fprintf(stderr, "%s:%d: %s is %g, expected %g\n", __FILE__, __LINE__, #actual, actualValue, \
+                expectedValue); \
+        testFailures++; \
+    } \
+} while (0)
+
+// run one case and say how it went
+#define RUN(test) do { \
+    int failuresBefore = testFailures; \
+    test(); \
+    printf("%s %s\n", testFailures == failuresBefore ? "ok  " : "FAIL", #test); \
+} while (0)
+
+// what fn(arg) prints on stdout, NUL terminated in out; fn runs in this process
+static inline void capture_stdout(void (*fn)(void *), void *arg, char *out, size_t size) {
+    FILE *file = tmpfile();
+    int saved;
+    size_t length;
+
+    fflush(stdout);
+    saved = dup(STDOUT_FILENO);
+    dup2(fileno(file), STDOUT_FILENO);
+    fn(arg);
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+    rewind(file);
+    length = fread(out, 1, size - 1, file);
+    out[length] = '\0';
+    fclose(file);
+}
+
+// run fn(arg) in a child with stdout in a temporary file, send it sig after ms and
+// wait for it; returns its exit status (128 + signal when it was killed), -1 when it
+// had to be killed after another two seconds
+static inline int run_child(void (*fn)(void *), void *arg, unsigned int ms, int sig, char *out, size_t size) {
+    FILE *file = tmpfile();
+    struct timespec pause = {ms / 1000, (long) (ms % 1000) * 1000000L};
+    int status = 0, exited = 0;
+    size_t length;
+    pid_t pid;
+
+    fflush(stdout);
+    pid = fork();
+    if (pid == 0) {
+        dup2(fileno(file), STDOUT_FILENO);
+        fn(arg);
+        fflush(stdout);
+        _exit(0);
+    }
+    nanosleep(&pause, NULL);
+    kill(pid, sig);
+    for (int i = 0; i < 200 && !exited; i++) {
+        struct timespec tick = {0, 10000000L};
+        exited = waitpid(pid, &status, WNOHANG) == pid;
+        if (!exited) {
+            nanosleep(&tick, NULL);
+        }
+    }
+    if (!exited) {
+        kill(pid, SIGKILL);
+        waitpid(pid, &status, 0);
+    }
+    rewind(file);
+    length = fread(out, 1, size - 1, file);
+    out[length] = '\0';
+    fclose(file);
+    if (!exited) {
+        return -1;
+    }
+    return WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+}
+
+#define TEST_EXIT_CODE (testFailures != 0)
+
+#endif //FINALPROJECT_TEST_H
@@ -0,0 +1,109 @@
+//
+// Collector threads: a stuck task only holds up its own worker, stop leaves it behind,
+// and the engine reports its section as stale
+//
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "test.h"
+#include "workerPool.h"
+#include "infoCollector.h"
+
+static atomic_int fastRuns, stuckRuns, sigintBlocked;
+
+static int fast_task(void *arg) {
+    sigset_t mask;
+
+    pthread_sigmask(SIG_BLOCK, NULL, &mask);
+    atomic_store(&sigintBlocked, sigismember(&mask, SIGINT));
+    atomic_fetch_add(&fastRuns, 1);
+    return 0;
+}
+
+static int stuck_task(void *arg) {
+    struct timespec hang = {3, 0};
+
+    atomic_fetch_add(&stuckRuns, 1);
+    nanosleep(&hang, NULL);
+    return 0;
+}
+
+static void stuck_worker_is_left_behind(void) {
+    struct worker_pool pool;
+    struct sched_task fast = {.name = "fast", .period = 10 * NSEC_PER_MSEC, .run = fast_task};
+    struct sched_task stuck = {.name = "stuck", .period = 10 * NSEC_PER_MSEC, .run = stuck_task};
+    struct timespec wait = {0, 300 * (long) NSEC_PER_MSEC};
+    struct timespec start, end;
+    int runs;
+
+    CHECK(worker_pool_init(&pool, 0) == 0);
+    scheduler_add(worker_pool_scheduler(&pool, "sensors"), &fast);
+    scheduler_add(worker_pool_scheduler(&pool, "disk"), &stuck);
+    CHECK(worker_pool_scheduler(&pool, "sensors") == worker_pool_scheduler(&pool, "sensors"));
+    CHECK(worker_pool_start(&pool) == 0);
+    nanosleep(&wait, NULL);
+
+    runs = atomic_load(&fastRuns);
+    CHECK(runs >= 15);
+    CHECK(atomic_load(&stuckRuns) == 1);
+    CHECK(atomic_load(&sigintBlocked) == 1);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    CHECK(worker_pool_stop(&pool, 100) == 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    CHECK((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000 < 1000);
+    runs = atomic_load(&fastRuns);
+    nanosleep(&wait, NULL);
+    CHECK(atomic_load(&fastRuns) == runs);
+}
+
+// the synthetic backend with a disk that never answers in time
+static void hanging_disk_sample(int flag, struct snapshot *snap) {
+    if (flag & _DISK_STATUS) {
+        struct timespec hang = {5, 0};
+        nanosleep(&hang, NULL);
+    }
+    synthetic_backend.sample(flag, snap);
+}
+
+static int hanging_disk_open(int flag) {
+    return synthetic_backend.open(flag);
+}
+
+static void hanging_disk_close(void) {
+    synthetic_backend.close();
+}
+
+static const struct backend hanging_disk_backend = {"hanging", hanging_disk_open, hanging_disk_sample,
+                                                    hanging_disk_close};
+
+static void run_show(void *arg) {
+    struct engine_options options;
+
+    engine_default_options(&options);
+    options.flag = _CPU_TEMP | _DISK_STATUS;
+    options.updateInterval = 0.05;
+    options.staleMs = 150;
+    options.backend = &hanging_disk_backend;
+    options.renderer = &text_renderer;
+    show(&options);
+}
+
+static void engine_flags_the_stuck_section(void) {
+    static char out[65536];
+    const char *last;
+
+    CHECK(run_child(run_show, NULL, 800, SIGINT, out, sizeof(out)) == 0);
+    CHECK(strstr(out, "stale: disk") != NULL);
+    // the other section keeps coming while the disk is stuck
+    last = strstr(out, "stale: disk");
+    CHECK(last != NULL && strstr(last, "cpu temp: ") != NULL);
+    CHECK(strstr(out, "disk total") == NULL);
+}
+
+int main(void) {
+    RUN(stuck_worker_is_left_behind);
+    RUN(engine_flags_the_stuck_section);
+    return TEST_EXIT_CODE;
+}
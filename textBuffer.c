@@ -0,0 +1,71 @@
+//
+// Text buffer, see textBuffer.h
+//
+
+#include <string.h>
+#include <math.h>
+
+#include "textBuffer.h"
+
+void text_put_bytes(struct text *out, const char *bytes, size_t length) {
+    if (out->length + length > out->size) {
+        out->overflow = 1;
+        return;
+    }
+    memcpy(out->data + out->length, bytes, length);
+    out->length += length;
+}
+
+void text_put_str(struct text *out, const char *str) {
+    text_put_bytes(out, str, strlen(str));
+}
+
+void text_put_uint(struct text *out, uint64_t value) {
+    char digits[20];
+    int count = 0;
+
+    do {
+        digits[sizeof(digits) - ++count] = (char) ('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    text_put_bytes(out, digits + sizeof(digits) - count, (size_t) count);
+}
+
+void text_put_int(struct text *out, int64_t value) {
+    if (value < 0) {
+        text_put_bytes(out, "-", 1);
+        text_put_uint(out, (uint64_t) 0 - (uint64_t) value);
+        return;
+    }
+    text_put_uint(out, (uint64_t) value);
+}
+
+void text_put_double(struct text *out, double value) {
+    char fraction[FRACTION_DIGITS];
+    uint64_t scaled, whole, part;
+    int digits = FRACTION_DIGITS;
+
+    if (!isfinite(value) || fabs(value) >= 1e15) {
+        text_put_str(out, isnan(value) ? "NaN" : value > 0 ? "+Inf" : "-Inf");
+        return;
+    }
+    if (value < 0) {
+        text_put_bytes(out, "-", 1);
+        value = -value;
+    }
+    scaled = (uint64_t) llround(value * FRACTION_SCALE);
+    whole = scaled / FRACTION_SCALE;
+    part = scaled % FRACTION_SCALE;
+    text_put_uint(out, whole);
+    for (int i = FRACTION_DIGITS - 1; i >= 0; i--) {
+        fraction[i] = (char) ('0' + part % 10);
+        part /= 10;
+    }
+    while (digits > 0 && fraction[digits - 1] == '0') {
+        digits--;
+    }
+    if (digits > 0) {
+        text_put_bytes(out, ".", 1);
+        text_put_bytes(out, fraction, (size_t) digits);
+    }
+}
@@ -0,0 +1,35 @@
+//
+// Appending text to a caller supplied buffer with hand rolled number formatting instead
+// of printf, shared by the Prometheus encoder and the streaming renderer. Writes past the
+// end of the buffer are dropped and remembered in overflow.
+//
+
+#ifndef FINALPROJECT_TEXTBUFFER_H
+#define FINALPROJECT_TEXTBUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define FRACTION_DIGITS 3
+#define FRACTION_SCALE 1000
+
+struct text {
+    char *data;
+    size_t length;
+    size_t size;
+    int overflow;
+};
+
+void text_put_bytes(struct text *out, const char *bytes, size_t length);
+
+void text_put_str(struct text *out, const char *str);
+
+void text_put_uint(struct text *out, uint64_t value);
+
+void text_put_int(struct text *out, int64_t value);
+
+// fixed point with FRACTION_DIGITS decimals, trailing zeros dropped; NaN and the
+// infinities are written the way Prometheus spells them
+void text_put_double(struct text *out, double value);
+
+#endif //FINALPROJECT_TEXTBUFFER_H
@@ -0,0 +1,161 @@
+//
+// Plain text renderer: one block of "name: value" lines per snapshot on stdout,
+// for terminals without curses and for piping into other tools.
+//
+
+#include <stdio.h>
+
+#include "renderer.h"
+#include "infoCollector.h"
+
+static int text_open(void) {
+    return 0;
+}
+
+static void text_render(const struct snapshot *snap, const struct metric_stats *stats, int flag) {
+    printf("time: %llu.%03llu\n", (unsigned long long) (snap->timestamp / 1000000000),
+           (unsigned long long) (snap->timestamp / 1000000 % 1000));
+    if (snap->stale) {
+        fputs("stale:", stdout);
+        for (int i = 0; i < SNAP_BIT_COUNT; i++) {
+            if (snap->stale & (1u << i)) {
+                printf(" %s", snapshot_bit_name(1u << i));
+            }
+        }
+        putchar('\n');
+    }
+    if ((flag & _DISK_STATUS) && (snap->valid & SNAP_DISK)) {
+        printf("disk total: %.2f GB\n", snap->diskTotal);
+        printf("disk used: %.2f GB\n", snap->diskTotal - snap->diskFree);
+        for (int i = 0; i < snap->volumeCount; ++i) {
+            printf("volume %s: %.2f of %.2f GB used\n", snap->volumes[i].mount,
+                   snap->volumes[i].total - snap->volumes[i].free, snap->volumes[i].total);
+        }
+    }
+    if ((flag & _DISK_STATUS) && (snap->valid & SNAP_DISK_IO)) {
+        for (int i = 0; i < snap->deviceCount; ++i) {
+            const struct device_sample *device = &snap->devices[i];
+            printf("device %s: read %.0f B/s %.1f IOPS, write %.0f B/s %.1f IOPS\n", device->name,
+                   device->readBytes, device->reads, device->writeBytes, device->writes);
+        }
+    }
+    if ((flag & _CPU_USAGE) && (snap->valid & SNAP_CPU_USAGE)) {
+        printf("cpu: %.1f%% user, %.1f%% system, %.1f%% nice, %.1f%% idle\n",
+               snap->cpuUser, snap->cpuSystem, snap->cpuNice, snap->cpuIdle);
+        for (int i = 0; i < snap->coreCount; ++i) {
+            printf("core %d: %.1f%% busy\n", i, 100.0f - snap->coreIdle[i]);
+        }
+    }
+    if ((flag & _CPU_USAGE) && (snap->valid & SNAP_LOAD)) {
+        printf("load average: %.2f %.2f %.2f\n", snap->loadAverage[0], snap->loadAverage[1], snap->loadAverage[2]);
+    }
+    if ((flag & _CPU_TEMP) && (snap->valid & SNAP_CPU_TEMP)) {
+        printf("cpu temp: %.2f C\n", snap->cpuTemp);
+    }
+    // machines without fans (and the Linux backend without hwmon fans) have nothing to show
+    if ((flag & _FAN_STATUS) && (snap->valid & SNAP_FANS) && snap->fanCount > 0) {
+        printf("fan max: %.0f rpm\n", snap->fanMax);
+        for (int i = 0; i < snap->fanCount; ++i) {
+            printf("fan %d: %.0f rpm\n", i, snap->fanSpeed[i]);
+        }
+    }
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM)) {
+        printf("mem total: %.1f GB\n", snap->memTotal);
+        printf("mem used: %.2f GB\n", snap->memUsed);
+    }
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM_DETAIL)) {
+        printf("mem free %.2f, active %.2f, inactive %.2f, wired %.2f, compressed %.2f, purgeable %.2f GB\n",
+               snap->memFree, snap->memActive, snap->memInactive, snap->memWired, snap->memCompressed,
+               snap->memPurgeable);
+        printf("swap used: %.2f GB\n", snap->swapUsed);
+    }
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM_RATES)) {
+        printf("paging: %.0f in/s, %.0f out/s, %.0f compressions/s, %.0f decompressions/s\n", snap->pageInRate,
+               snap->pageOutRate, snap->compressionRate, snap->decompressionRate);
+    }
+    if ((flag & _MEM_STATUS) && (snap->valid & SNAP_MEM_TEMP)) {
+        printf("mem temp: %.2f C\n", snap->memTemp);
+    }
+    if ((flag & _GPU_STATUS) && (snap->valid & SNAP_GPU_TEMP)) {
+        printf("gpu temp: %.2f C\n", snap->gpuTemp);
+    }
+    if ((flag & _BATTERY_STATUS) && (snap->valid & SNAP_BATTERY) && snap->batteryPresent) {
+        printf("battery: %d %%%s\n", snap->batteryPercent, snap->batteryPowered ? " (powered)" : "");
+        if (!snap->batteryPowered) {
+            printf("battery remaining: %d min\n", snap->batteryMinutes);
+        }
+        if (snap->valid & SNAP_BATTERY_TEMP) {
+            printf("battery temp: %.2f C\n", snap->batteryTemp);
+        }
+    }
+    if ((flag & _PROCESSES) && (snap->valid & SNAP_PROCESSES)) {
+        printf("processes: %d\n", snap->processCount);
+        for (int i = 0; i < snap->topCount; ++i) {
+            printf("top cpu %d: %d %s %.1f%% %.1f MB\n", i, snap->topCpu[i].pid, snap->topCpu[i].name,
+                   snap->topCpu[i].cpu, snap->topCpu[i].rss);
+        }
+        for (int i = 0; i < snap->topCount; ++i) {
+            printf("top memory %d: %d %s %.1f%% %.1f MB\n", i, snap->topMemory[i].pid, snap->topMemory[i].name,
+                   snap->topMemory[i].cpu, snap->topMemory[i].rss);
+        }
+    }
+    if (snap->valid & SNAP_SELF) {
+        printf("self: %.2f%% cpu, %.1f MB, %.0f syscalls/s, %.0f SMC calls/s\n", snap->selfCpu, snap->selfRss,
+               snap->selfSyscalls, snap->selfSmcCalls);
+    }
+    putchar('\n');
+    fflush(stdout);
+}
+
+// a block per refresh, one line per host
+static void text_render_fleet(const struct fleet_host *hosts, int count, enum fleet_sort sort, uint64_t now) {
+    printf("%-24s %6s %7s %6s %13s %6s %7s %7s\n", "host", "seen", "cpu_c", "load", "memory_gb", "disk%", "gpu_c",
+           "fan_rpm");
+    for (int i = 0; i < count; i++) {
+        const struct fleet_host *host = &hosts[i];
+
+        printf("%-24s ", host->name);
+        if (host->connected) {
+            printf("%5.0fs ", now > host->lastSeen ? (now - host->lastSeen) / 1e9 : 0.0);
+        } else {
+            printf("%6s ", "down");
+        }
+        if (host->valid & SNAP_CPU_TEMP) {
+            printf("%7.1f ", host->cpuTemp);
+        } else {
+            printf("%7s ", "-");
+        }
+        if (host->valid & SNAP_LOAD) {
+            printf("%6.2f ", host->load);
+        } else {
+            printf("%6s ", "-");
+        }
+        if (host->valid & SNAP_MEM) {
+            printf("%6.1f/%-6.1f ", host->memUsed, host->memTotal);
+        } else {
+            printf("%13s ", "-");
+        }
+        if ((host->valid & SNAP_DISK) && host->diskTotal > 0) {
+            printf("%6.1f ", (host->diskTotal - host->diskFree) / host->diskTotal * 100);
+        } else {
+            printf("%6s ", "-");
+        }
+        if (host->valid & SNAP_GPU_TEMP) {
+            printf("%7.1f ", host->gpuTemp);
+        } else {
+            printf("%7s ", "-");
+        }
+        if (host->valid & SNAP_FANS) {
+            printf("%7.0f\n", host->fanSpeed);
+        } else {
+            printf("%7s\n", "-");
+        }
+    }
+    putchar('\n');
+    fflush(stdout);
+}
+
+static void text_close(void) {
+}
+
+const struct renderer text_renderer = {"text", text_open, text_render, text_close, NULL, text_render_fleet};
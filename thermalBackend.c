@@ -0,0 +1,52 @@
+//
+// Thermal backend: the temperatures and fans of the simulated machine in thermalModel.c,
+// read through the SMC layer from the fake SMC exactly like the mac backend reads the
+// real one, so the fan controller can be run against it anywhere. Every other section
+// comes from the synthetic backend.
+//
+
+#include <stdio.h>
+
+#include "backend.h"
+#include "infoCollector.h"
+#include "systemManagementController.h"
+#include "fakeSMC.h"
+#include "thermalModel.h"
+
+#define SMC_SECTIONS (_CPU_TEMP | _GPU_STATUS | _FAN_STATUS)
+
+static struct smc_sensor_plan plan;
+
+static int thermal_open(int flag) {
+    thermal_model_open(1);
+    SMC_set_transport(&fakeSMC_transport);
+    if (SMC_open() != kIOReturnSuccess) {
+        return -1;
+    }
+    smc_sensor_plan_compile(&plan, flag & SMC_SECTIONS, THERMAL_MODEL_FANS);
+    return synthetic_backend.open(flag & ~SMC_SECTIONS);
+}
+
+static void thermal_sample(int flag, struct snapshot *snap) {
+    synthetic_backend.sample(flag & ~SMC_SECTIONS, snap);
+    if (!(flag & SMC_SECTIONS)) {
+        return;
+    }
+    smc_sensor_plan_sample(&plan, flag & SMC_SECTIONS, snap);
+    if (flag & _FAN_STATUS) {
+        snap->fanCount = THERMAL_MODEL_FANS;
+    }
+}
+
+static void thermal_close(void) {
+    struct thermal_model_stats stats;
+
+    synthetic_backend.close();
+    SMC_close();
+    thermal_model_stats(&stats);
+    thermal_model_close();
+    fprintf(stderr, "thermal model: %.0f s, %.1f s throttled, %.1f%% of the CPU work done, CPU peaked at %.1f C\n",
+            stats.seconds, stats.throttledSeconds, stats.workDone * 100.0, stats.maxCpuTemp);
+}
+
+const struct backend thermal_backend = {"thermal", thermal_open, thermal_sample, thermal_close};
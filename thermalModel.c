@@ -0,0 +1,180 @@
+//
+// Thermal model behind the fake SMC, see thermalModel.h
+//
+
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include "thermalModel.h"
+#include "fakeSMC.h"
+#include "systemManagementController.h"
+
+#define AMBIENT 25.0
+#define THROTTLE_TEMP 95.0
+#define FAN_MIN_RPM 1200.0
+#define FAN_MAX_RPM 6000.0
+#define FAN_SLEW 600.0          // rpm per second
+#define STEP 0.05               // longest integration step, seconds
+#define WORKLOAD_PERIOD 60.0
+#define WORKLOAD_BUSY 40.0      // seconds of each period spent rendering
+
+struct die {
+    enum smc_sensor_id sensor;
+    double heatCapacity;        // J/K
+    double idleConductance;     // W/K with the fans stopped
+    double fanConductance;      // W/K added at full fan speed
+    double busyPower, idlePower;
+    double phase;               // seconds the workload of this die lags the CPU's
+    double temp;
+};
+
+static struct die dies[] = {
+        {SENSOR_CPU_0_PROXIMITY, 40.0, 0.6, 2.4, 125.0, 15.0, 0.0,  AMBIENT},
+        {SENSOR_GPU_0_PROXIMITY, 30.0, 0.4, 1.6, 60.0,  8.0,  20.0, AMBIENT},
+};
+
+#define DIE_COUNT (sizeof(dies) / sizeof(dies[0]))
+
+static double fanRpm[THERMAL_MODEL_FANS];
+static struct thermal_model_stats totals;
+static double workAsked, workDone;
+static uint64_t lastStep;       // monotonic ns, 0 when stepped by hand
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000ull + (uint64_t) now.tv_nsec;
+}
+
+static double read_key(const char *key) {
+    SMCBytes_t bytes;
+    uint32_t dataType;
+    double value = 0;
+    int size = fakeSMC_get_key(key, &dataType, bytes);
+
+    if (size > 0) {
+        SMC_decode(dataType, bytes, (uint32_t) size, &value);
+    }
+    return value;
+}
+
+// name of fan's key of a per fan sensor, the fake SMC takes keys by name
+static const char *fan_key(char *key, int fan, enum smc_sensor_id sensor) {
+    uint32_to_str(key, SMC_FAN_KEY(smc_sensors[sensor].key, fan));
+    return key;
+}
+
+static double clamp(double value, double low, double high) {
+    return value < low ? low : value > high ? high : value;
+}
+
+// where the fans are headed: the forced target, or what the firmware wants for the
+// hottest die; the firmware only starts ramping at 92 °C
+static double fan_target(int fan, int forced, double hottest) {
+    char key[5];
+
+    fan_key(key, fan, SENSOR_FAN_0_TARGET_RPM);
+    if (forced) {
+        return clamp(read_key(key), FAN_MIN_RPM, FAN_MAX_RPM);
+    }
+    double target = FAN_MIN_RPM + (FAN_MAX_RPM - FAN_MIN_RPM) * clamp((hottest - 92.0) / 12.0, 0, 1);
+    fakeSMC_set_fpe2(key, target);
+    return target;
+}
+
+static void integrate(double dt) {
+    int forceBits = (int) read_key(FORCE_BITS);
+    double hottest = dies[0].temp > dies[1].temp ? dies[0].temp : dies[1].temp;
+    double share = 0;
+    int throttled = 0;
+
+    for (int fan = 0; fan < THERMAL_MODEL_FANS; fan++) {
+        double target = fan_target(fan, forceBits & (1 << fan), hottest);
+        double step = clamp(target - fanRpm[fan], -FAN_SLEW * dt, FAN_SLEW * dt);
+
+        fanRpm[fan] += step;
+        share += fanRpm[fan] / FAN_MAX_RPM / THERMAL_MODEL_FANS;
+    }
+    for (size_t i = 0; i < DIE_COUNT; i++) {
+        struct die *die = &dies[i];
+        double cycle = totals.seconds - die->phase;
+        int busy = cycle >= 0 && fmod(cycle, WORKLOAD_PERIOD) < WORKLOAD_BUSY;
+        double power = busy ? die->busyPower : die->idlePower;
+        // clocks drop with the temperature past the limit, taking power and work with them
+        double speed = clamp(1.0 - (die->temp - THROTTLE_TEMP) / 5.0, 0.3, 1.0);
+        double conductance = die->idleConductance + die->fanConductance * share;
+
+        die->temp += (power * speed - conductance * (die->temp - AMBIENT)) / die->heatCapacity * dt;
+        throttled |= speed < 1.0;
+        if (i == 0 && busy) {
+            workAsked += dt;
+            workDone += speed * dt;
+        }
+    }
+    totals.seconds += dt;
+    totals.throttledSeconds += throttled ? dt : 0;
+    if (dies[0].temp > totals.maxCpuTemp) {
+        totals.maxCpuTemp = dies[0].temp;
+    }
+}
+
+static void publish(void) {
+    char key[5];
+
+    for (size_t i = 0; i < DIE_COUNT; i++) {
+        fakeSMC_set_sp78(smc_sensors[dies[i].sensor].keyName, dies[i].temp);
+    }
+    fakeSMC_set_sp78(smc_sensors[SENSOR_MEMORY_SLOTS_PROXIMITY].keyName, AMBIENT + (dies[0].temp - AMBIENT) * 0.4);
+    for (int fan = 0; fan < THERMAL_MODEL_FANS; fan++) {
+        fakeSMC_set_fpe2(fan_key(key, fan, SENSOR_FAN_0), fanRpm[fan]);
+    }
+}
+
+void thermal_model_step(double seconds) {
+    while (seconds > 0) {
+        double dt = seconds < STEP ? seconds : STEP;
+        integrate(dt);
+        seconds -= dt;
+    }
+    publish();
+}
+
+static void realtime_hook(void) {
+    uint64_t now = now_ns();
+
+    thermal_model_step((double) (now - lastStep) / 1e9);
+    lastStep = now;
+}
+
+void thermal_model_open(int realtime) {
+    static const unsigned char noneForced[2] = {0, 0};
+    char key[5];
+
+    fakeSMC_reset();
+    memset(&totals, 0, sizeof(totals));
+    workAsked = workDone = 0;
+    for (size_t i = 0; i < DIE_COUNT; i++) {
+        dies[i].temp = AMBIENT + 15.0;
+    }
+    fakeSMC_set_ui8(NUM_FANS, THERMAL_MODEL_FANS);
+    fakeSMC_set_key(FORCE_BITS, DATA_TYPE_UINT16, 2, noneForced);
+    for (int fan = 0; fan < THERMAL_MODEL_FANS; fan++) {
+        fanRpm[fan] = FAN_MIN_RPM;
+        fakeSMC_set_fpe2(fan_key(key, fan, SENSOR_FAN_0_MIN_RPM), FAN_MIN_RPM);
+        fakeSMC_set_fpe2(fan_key(key, fan, SENSOR_FAN_0_MAX_RPM), FAN_MAX_RPM);
+        fakeSMC_set_fpe2(fan_key(key, fan, SENSOR_FAN_0_TARGET_RPM), FAN_MIN_RPM);
+    }
+    publish();
+    lastStep = realtime ? now_ns() : 0;
+    fakeSMC_set_hook(realtime ? realtime_hook : NULL);
+}
+
+void thermal_model_stats(struct thermal_model_stats *stats) {
+    *stats = totals;
+    stats->workDone = workAsked > 0 ? workDone / workAsked : 1.0;
+}
+
+void thermal_model_close(void) {
+    fakeSMC_set_hook(NULL);
+}
@@ -0,0 +1,36 @@
+//
+// Simulated machine behind the fake SMC, so the fan controller can be run and tuned
+// without a Mac. A CPU and a GPU heat up under a repeating render workload and cool
+// through two fans whose conductance grows with their speed; a die past 95 °C throttles,
+// dropping the work it gets done. The fans follow their targets at a limited slew rate,
+// and while no fan is forced (FS!) the simulated firmware picks the targets itself from
+// a deliberately lazy curve, like a machine tuned for quiet.
+//
+// The keys (TC0P, TG0P, TM0P, FNum, F0Ac, F0Mn, F0Mx, F0Tg, FS! and those of fan 1) are
+// brought up to date from the monotonic clock before every SMC call, or only by
+// thermal_model_step when the model is opened without the clock.
+//
+
+#ifndef FINALPROJECT_THERMALMODEL_H
+#define FINALPROJECT_THERMALMODEL_H
+
+#define THERMAL_MODEL_FANS 2
+
+struct thermal_model_stats {
+    double seconds;             // simulated
+    double throttledSeconds;    // with either die throttling
+    double workDone;            // CPU work done over the work asked for, 0..1
+    double maxCpuTemp;
+};
+
+// fill the fake SMC with the keys of the model, realtime keeps them current on every call
+void thermal_model_open(int realtime);
+
+// advance the model by seconds and update the keys
+void thermal_model_step(double seconds);
+
+void thermal_model_stats(struct thermal_model_stats *stats);
+
+void thermal_model_close(void);
+
+#endif //FINALPROJECT_THERMALMODEL_H
@@ -0,0 +1,109 @@
+//
+// Collector threads, see workerPool.h
+//
+
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <poll.h>
+#include <time.h>
+
+#include "workerPool.h"
+
+// like monotonic_clock but the sleep also ends when the pool is stopped
+static void worker_sleep_until(void *ctx, uint64_t deadline) {
+    struct worker *worker = ctx;
+    uint64_t now = monotonic_clock.now(NULL);
+    struct pollfd stop = {worker->pool->stopPipe[0], POLLIN, 0};
+
+    if (deadline <= now) {
+        return;
+    }
+    // rounded up, poll counts in milliseconds
+    poll(&stop, 1, (int) ((deadline - now + NSEC_PER_MSEC - 1) / NSEC_PER_MSEC));
+}
+
+static void *worker_main(void *arg) {
+    struct worker *worker = arg;
+
+    while (!atomic_load(&worker->pool->stopping)) {
+        scheduler_step(&worker->sched);
+    }
+    atomic_store(&worker->finished, 1);
+    return NULL;
+}
+
+int worker_pool_init(struct worker_pool *pool, int adaptive) {
+    pool->count = 0;
+    pool->adaptive = adaptive;
+    atomic_init(&pool->stopping, 0);
+    return pipe(pool->stopPipe);
+}
+
+struct scheduler *worker_pool_scheduler(struct worker_pool *pool, const char *name) {
+    struct worker *worker;
+
+    for (unsigned int i = 0; i < pool->count; i++) {
+        if (strcmp(pool->workers[i].name, name) == 0) {
+            return &pool->workers[i].sched;
+        }
+    }
+    if (pool->count == WORKER_MAX) {
+        return NULL;
+    }
+    worker = &pool->workers[pool->count++];
+    worker->name = name;
+    worker->pool = pool;
+    worker->clock = (struct sched_clock) {monotonic_clock.now, worker_sleep_until, worker};
+    atomic_init(&worker->finished, 0);
+    scheduler_init(&worker->sched, &worker->clock, pool->adaptive);
+    return &worker->sched;
+}
+
+int worker_pool_start(struct worker_pool *pool) {
+    sigset_t all, previous;
+    int result = 0;
+
+    // signals stay with the UI thread, whose sleep they are meant to interrupt
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &previous);
+    for (unsigned int i = 0; i < pool->count && result == 0; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, worker_main, &pool->workers[i]) != 0) {
+            // the ones already running are stopped by worker_pool_stop
+            pool->count = i;
+            result = -1;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    return result;
+}
+
+int worker_pool_stop(struct worker_pool *pool, unsigned int timeoutMs) {
+    struct timespec step = {0, (long) NSEC_PER_MSEC};
+    unsigned int waited = 0;
+    int abandoned = 0;
+
+    atomic_store(&pool->stopping, 1);
+    if (write(pool->stopPipe[1], "", 1) < 0) {
+        return (int) pool->count;
+    }
+    for (unsigned int i = 0; i < pool->count; i++) {
+        struct worker *worker = &pool->workers[i];
+        for (; !atomic_load(&worker->finished) && waited < timeoutMs; waited++) {
+            nanosleep(&step, NULL);
+        }
+        if (atomic_load(&worker->finished)) {
+            pthread_join(worker->thread, NULL);
+        } else {
+            pthread_detach(worker->thread);
+            abandoned++;
+        }
+    }
+    // an abandoned worker may still poll the pipe, it is only closed when every one is gone
+    if (abandoned == 0) {
+        close(pool->stopPipe[0]);
+        close(pool->stopPipe[1]);
+    }
+    pool->count = 0;
+    return abandoned;
+}
@@ -0,0 +1,46 @@
+//
+// Collector threads. Each worker runs its own deadline scheduler on its own thread, so a
+// collector that blocks (a statvfs on a hung network volume, a stuck IOKit call) only
+// delays the tasks of its own worker and never the UI thread or the other workers.
+//
+
+#ifndef FINALPROJECT_WORKERPOOL_H
+#define FINALPROJECT_WORKERPOOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "scheduler.h"
+
+#define WORKER_MAX 8
+
+struct worker {
+    const char *name;
+    struct worker_pool *pool;
+    struct scheduler sched;
+    struct sched_clock clock;
+    pthread_t thread;
+    atomic_int finished;
+};
+
+struct worker_pool {
+    struct worker workers[WORKER_MAX];
+    unsigned int count;
+    int adaptive;
+    atomic_int stopping;
+    int stopPipe[2];        // becomes readable on stop and wakes every sleeping worker
+};
+
+int worker_pool_init(struct worker_pool *pool, int adaptive);
+
+// scheduler of the worker called name, created on first use, NULL when the pool is full
+struct scheduler *worker_pool_scheduler(struct worker_pool *pool, const char *name);
+
+// start a thread per worker with every signal blocked, returns 0 on success
+int worker_pool_start(struct worker_pool *pool);
+
+// stop the workers, waiting up to timeoutMs in total for the ones still inside a task
+// before leaving them behind, returns the number of workers left behind
+int worker_pool_stop(struct worker_pool *pool, unsigned int timeoutMs);
+
+#endif //FINALPROJECT_WORKERPOOL_H